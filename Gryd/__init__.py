@@ -24,7 +24,8 @@ within python API using epsg id or name.
 # Raster map interpolation
 
 `Gryd.Crs` provides functions for raster map coordinates interpolation using
-calibration `Points` (two minimum are required).
+calibration `Points` (two minimum are required). A calibration model is
+fitted once on them so that whole rasters are interpolated in a single call.
 
 ## Geodesic object
 
@@ -33,9 +34,15 @@ calibration `Points` (two minimum are required).
 
 import os
 import sys
+import copy
 import math
+import array
 import ctypes
+import struct
 import sqlite3
+import threading
+
+from types import MappingProxyType
 
 from Gryd.geodesy import Geodesic
 
@@ -47,7 +54,7 @@ __author__ = "Bruno THOORENS"
 # there is a major change in the design.
 __version__ = "1.2.1"
 # add C projection functions here
-__c_proj__ = ["tmerc", "merc", "lcc", "eqc", "miller"]
+__c_proj__ = ["tmerc", "ktmerc", "merc", "lcc", "omerc", "eqc", "miller"]
 # add python projection modules here
 __py_proj__ = ["utm", "mgrs", "bng", "ing"]
 
@@ -87,9 +94,285 @@ def t_byref(ctype, n, *args):
     return ctypes.cast((ctype * n)(*args), ctypes.POINTER(ctype))
 
 
-# Connection to epsg.sqlite database
-EPSG_CON = sqlite3.connect(get_data_file("db/epsg.sqlite"))
-EPSG_CON.row_factory = sqlite3.Row
+# Return a contiguous ctypes array of ctype from a sequence of ctype
+def t_array(ctype, points):
+    if isinstance(points, ctypes.Array) and points._type_ is ctype:
+        return points
+    return (ctype * len(points))(*points)
+
+
+# Return a ctypes double table sharing memory with a buffer object (numpy
+# array, array.array, bytearray...) if possible, a copy elsewhere. Given n,
+# ValueError is raised if buffer holds less than n values, and outputs have
+# to be writable buffers so that C never writes past or into caller memory
+def t_buffer(obj, n=None, output=False):
+    if obj is None:
+        return None
+    interface = getattr(obj, "__array_interface__", None)
+    if interface is not None:
+        if interface["typestr"] not in ["<f8", "=f8", "|f8"] or \
+           interface.get("strides") not in [None, (8,)]:
+            raise TypeError("contiguous float64 array expected")
+        size = 1
+        for dim in interface["shape"]:
+            size *= dim
+        address, readonly = interface["data"]
+        table = None
+    else:
+        try:
+            view = memoryview(obj)
+        except TypeError:
+            if output:
+                raise TypeError("writable float64 buffer expected")
+            view = None
+            size, readonly = len(obj), False
+        else:
+            if view.format != "d" or not view.c_contiguous:
+                raise TypeError("contiguous float64 buffer expected")
+            size, readonly = view.nbytes // 8, view.readonly
+    if output and readonly:
+        raise ValueError("output buffer is read only")
+    if n is not None and size < n:
+        raise ValueError("buffer of at least %d values expected" % n)
+    if interface is not None:
+        return ctypes.cast(address, ctypes.POINTER(ctypes.c_double))
+    if view is None:
+        return (ctypes.c_double * size)(*obj)
+    if readonly:
+        return (ctypes.c_double * size).from_buffer_copy(view)
+    return (ctypes.c_double * size).from_buffer(obj)
+
+
+# Return t_buffer tables of buffers holding at least n values each, the
+# required first ones can not be None
+def t_buffers(buffers, n, output=False, required=2):
+    if len(buffers) < required or \
+       any(obj is None for obj in buffers[:required]):
+        raise TypeError("%d buffers at least expected" % required)
+    return [t_buffer(obj, n, output) for obj in buffers]
+
+
+# Return out if it is a ctypes table of at least n ctype, a new one if None.
+# TypeError is raised on other tables and ValueError on shorter ones, as
+# t_buffer does
+def t_out(ctype, n, out):
+    if out is None:
+        return (ctype * n)()
+    if not isinstance(out, ctypes.Array) or out._type_ is not ctype:
+        raise TypeError("table of %s expected" % ctype.__name__)
+    if len(out) < n:
+        raise ValueError("table of at least %d %s expected" % (
+            n, ctype.__name__
+        ))
+    return out
+
+
+# Return a zero filled buffer of n doubles
+def t_zeros(n):
+    return array.array("d", bytes(8 * n))
+
+
+# Return sqlite file change counter and size of database
+def sqlite_stamp(path):
+    with open(path, "rb") as db:
+        header = db.read(28)
+    return struct.unpack(">I", header[24:28])[0], os.path.getsize(path)
+
+
+class Registry(object):
+    """
+    In-memory copy of the EPSG database. When the binary snapshot generated
+    at build time (see `Gryd.snapshot`) matches the sqlite database, records
+    are read in place from its mapping. Otherwise, for example after an edit
+    of the database, tables are loaded once from sqlite into read-only
+    records indexed by epsg id and name. Either way no sqlite query is done
+    after loading, so `Gryd.Epsg` objects can be created from any thread
+    without locking.
+    """
+    #: tables loaded from sqlite database
+    tables = ["unit", "prime", "ellipsoid", "datum", "projection", "grid"]
+    #: snapshot section of each table
+    sections = {
+        "unit": 0, "prime": 1, "ellipsoid": 2, "datum": 3, "grid": 4,
+        "projection": 5
+    }
+    #: snapshot strings of table records
+    texts = {
+        "grid": ["name", "region", "projection"],
+        "projection": ["name", "typeproj"]
+    }
+
+    def __init__(self, path, snapshot=None):
+        """
+        Arguments:
+            path (str): sqlite database path
+            snapshot (str): binary snapshot path (default is `path` with
+                            `.bin` extension), `False` to use sqlite only
+        """
+        self.path = path
+        self.snapshot = os.path.splitext(path)[0] + ".bin" \
+            if snapshot is None else snapshot
+        self._lock = threading.Lock()
+        self._snap = None
+        self._opened = False
+        self._epsg = None
+        self._name = None
+        self._shared = {}
+
+    def _open(self):
+        with self._lock:
+            if self._opened:
+                return
+            snap = snapshot_open(self.snapshot.encode("utf-8")) \
+                if self.snapshot else None
+            if snap:
+                header = snapshot_header(snap).contents
+                if (header.source, header.length) == sqlite_stamp(self.path):
+                    self._snap = snap
+                else:
+                    snapshot_close(snap)
+            self._opened = True
+
+    def _load(self):
+        with self._lock:
+            if self._epsg is not None:
+                return
+            con = sqlite3.connect(self.path)
+            con.row_factory = sqlite3.Row
+            epsg, name = {}, {}
+            for table in self.tables:
+                by_epsg, by_name = {}, {}
+                for row in con.execute("SELECT * from %s" % table):
+                    record = MappingProxyType(dict(row))
+                    # first record wins, as with a sqlite query
+                    by_epsg.setdefault(record["epsg"], record)
+                    by_name.setdefault(record["name"], record)
+                epsg[table] = MappingProxyType(by_epsg)
+                name[table] = MappingProxyType(by_name)
+            con.close()
+            self._name = MappingProxyType(name)
+            # set last, _epsg is the loaded flag
+            self._epsg = MappingProxyType(epsg)
+
+    def _texts(self, table, index):
+        section = self.sections[table]
+        return dict(
+            (key, snapshot_text(self._snap, section, index, i).decode("utf-8"))
+            for i, key in enumerate(self.texts.get(table, ["name"]))
+        )
+
+    @property
+    def mapped(self):
+        """
+        `True` if records are read from the binary snapshot.
+        """
+        if not self._opened:
+            self._open()
+        return self._snap is not None
+
+    def lookup(self, table, epsg=None, name=None):
+        """
+        Return a tuple `(address, record)` for the `table` entry matching
+        `epsg` id or `name`. With the binary snapshot, address is the one of
+        the structure to copy and record holds the string values. Otherwise
+        address is `None` and record is the sqlite one. Record is an empty
+        `dict` if not found.
+        """
+        if not self.mapped:
+            return None, self.record(table, epsg, name) or {}
+        section = self.sections[table]
+        if epsg is not None:
+            index = snapshot_find(self._snap, section, epsg)
+        else:
+            index = snapshot_search(self._snap, section, name.encode("utf-8"))
+        if index < 0:
+            return None, {}
+        return snapshot_value(self._snap, section, index), \
+            self._texts(table, index)
+
+    def names(self, table):
+        """
+        Return list of tuples (name and epsg reference) of `table`.
+        """
+        if not self.mapped:
+            return [(r["name"], r["epsg"]) for r in self.records(table)]
+        section = self.sections[table]
+        return [
+            (
+                snapshot_text(self._snap, section, i, 0).decode("utf-8"),
+                snapshot_key(self._snap, section, i)
+            ) for i in range(
+                snapshot_header(self._snap).contents.sections[section].count
+            )
+        ]
+
+    def record(self, table, epsg=None, name=None):
+        """
+        Return the read-only sqlite record of `table` matching `epsg` id or
+        `name`, `None` if not found.
+        """
+        if self._epsg is None:
+            self._load()
+        if epsg is not None:
+            return self._epsg[table].get(epsg, None)
+        return self._name[table].get(name, None)
+
+    def records(self, table):
+        """
+        Return all read-only sqlite records of `table` in database order.
+        """
+        if self._epsg is None:
+            self._load()
+        return list(self._epsg[table].values())
+
+    def crs(self, value):
+        """
+        Return a shared read-only `Gryd.Crs` using epsg id or name. Same
+        instance is returned for a given value, a `copy.copy` of it is a
+        writable one. With the binary snapshot, the instance is the mapped
+        record itself.
+
+        ```python
+        >>> Gryd.REGISTRY.crs(27700) is Gryd.REGISTRY.crs(27700)
+        True
+        >>> Gryd.REGISTRY.crs(27700).k0 = 1.
+        Traceback (most recent call last):
+        ...
+        AttributeError: shared Crs is read-only
+        ```
+        """
+        shared = self._shared.get(value, None)
+        if shared is None:
+            address, record = None, {}
+            if self.mapped:
+                address, record = self.lookup("grid", **(
+                    {"epsg": value} if isinstance(value, int) else
+                    {"name": value}
+                ))
+            if address is not None:
+                shared = Crs.from_address(address)
+                for key, value_ in sorted(record.items()):
+                    setattr(shared, key, value_)
+            else:
+                shared = Crs(value)
+            shared.map_points = ()
+            shared.calibration = "affine"
+            shared.__dict__["_frozen"] = True
+            shared = self._shared.setdefault(value, shared)
+        return shared
+
+
+#: EPSG database registry
+REGISTRY = Registry(get_data_file("db/epsg.sqlite"))
+
+
+# True if obj or the structure it is a member of is a shared one
+def is_frozen(obj):
+    while obj is not None:
+        if obj.__dict__.get("_frozen", False):
+            return True
+        obj = getattr(obj, "_b_base_", None)
+    return False
 
 
 def names(cls):
@@ -103,11 +386,7 @@ def names(cls):
         (`str`, `int`) list
     """
     if not hasattr(cls, "_names"):
-        setattr(cls, "_names", [
-            (r["name"], r["epsg"]) for r in Epsg.sqlite.execute(
-                "SELECT * from %s" % cls.table,
-            ).fetchall()
-        ])
+        setattr(cls, "_names", REGISTRY.names(cls.table))
     return getattr(cls, "_names")
 
 
@@ -168,6 +447,41 @@ class Geographic(ctypes.Structure):
         return "<X=%.3f Y=%.3fs alt=%.3f>" % (self.x, self.y, self.altitude)
 
 
+class Geocentrics(ctypes.Structure):
+    """
+    `ctypes` structure of arrays for geocentric coordinates batch.
+    """
+    _fields_ = [
+        ("x", ctypes.POINTER(ctypes.c_double)),
+        ("y", ctypes.POINTER(ctypes.c_double)),
+        ("z", ctypes.POINTER(ctypes.c_double))
+    ]
+
+
+class Geodesics(ctypes.Structure):
+    """
+    `ctypes` structure of arrays for geodesic coordinates batch, longitudes
+    and latitudes are in radians. Altitude may be a `NULL` pointer.
+    """
+    _fields_ = [
+        ("longitude", ctypes.POINTER(ctypes.c_double)),
+        ("latitude",  ctypes.POINTER(ctypes.c_double)),
+        ("altitude",  ctypes.POINTER(ctypes.c_double))
+    ]
+
+
+class Geographics(ctypes.Structure):
+    """
+    `ctypes` structure of arrays for geographic coordinates batch. Altitude
+    may be a `NULL` pointer.
+    """
+    _fields_ = [
+        ("x",        ctypes.POINTER(ctypes.c_double)),
+        ("y",        ctypes.POINTER(ctypes.c_double)),
+        ("altitude", ctypes.POINTER(ctypes.c_double))
+    ]
+
+
 class Grid(ctypes.Structure):
     """
     `ctypes` structure for grided coordinates. Another coordinates system
@@ -237,6 +551,150 @@ class Point(ctypes.Structure):
         )
 
 
+#: calibration models : `"affine"` (least squares, each axis scaled with 2
+#: points), `"quadratic"` and `"cubic"` polynomials (6 and 10 points
+#: minimum) or `"triangles"`, piecewise affine over the Delaunay
+#: triangulation of pixels (exact on calibration points, 3 points minimum)
+CALIBRATIONS = {"triangles": 0, "affine": 1, "quadratic": 2, "cubic": 3}
+
+
+class Triangle(ctypes.Structure):
+    """
+    `ctypes` structure of a calibration triangle with the affine mappings
+    between its pixel and geographic vertices.
+    """
+    _fields_ = [
+        ("pixel",     (ctypes.c_double * 2) * 3),
+        ("xy",        (ctypes.c_double * 2) * 3),
+        ("neighbour", ctypes.c_int * 3),
+        ("forward",   ctypes.c_double * 6),
+        ("inverse",   ctypes.c_double * 6)
+    ]
+
+
+class Calibration(ctypes.Structure):
+    """
+    `ctypes` structure of a calibration model fitted once on calibration
+    points. It is returned by `Gryd.Crs.calibrate` function.
+
+    Arguments:
+        points (sequence or ctypes array of Gryd.Point): calibration points
+        model (str): calibration model (see `Gryd.CALIBRATIONS`)
+    """
+    _fields_ = [
+        ("model",      ctypes.c_int),
+        ("count",      ctypes.c_int),
+        ("pixel",      ctypes.c_double * 3),
+        ("xy",         ctypes.c_double * 3),
+        ("_forward",   (ctypes.c_double * 10) * 2),
+        ("_inverse",   (ctypes.c_double * 10) * 2),
+        ("triangles",  ctypes.POINTER(Triangle))
+    ]
+
+    def __init__(self, points, model="affine"):
+        ctypes.Structure.__init__(self)
+        if model not in CALIBRATIONS:
+            raise ValueError("unknown calibration model %r" % model)
+        points = t_array(Point, points)
+        n = len(points)
+        self._triangles = (Triangle * max(1, 2 * n))()
+        if not calibration_fit(
+            points, n, CALIBRATIONS[model], self._triangles, self
+        ):
+            raise ValueError(
+                "calibration points do not fit %r model" % model
+            )
+
+    def __reduce__(self):
+        raise TypeError("calibration can not be pickled")
+
+    def __repr__(self):
+        return "<Calibration model %r%s>" % (
+            [k for k, v in CALIBRATIONS.items() if v == self.model][0],
+            " triangles=%d" % self.count if self.count else ""
+        )
+
+    def forward(self, px, py):
+        """
+        Return geographic coordinates of pixel.
+
+        Arguments:
+            px (float): pixel column position
+            py (float): pixel row position
+        Returns:
+            `Gryd.Geographic` coordinates
+        """
+        return calibration_forward(self, px, py)
+
+    def inverse(self, xya):
+        """
+        Return pixel position of geographic coordinates.
+
+        Arguments:
+            xya (Gryd.Geographic): geographic coordinates
+        Returns:
+            (px, py) `float` tuple
+        """
+        px, py = ctypes.c_double(), ctypes.c_double()
+        calibration_inverse(self, xya, px, py)
+        return px.value, py.value
+
+    def forward_arrays(self, px, py, out=None):
+        """
+        Geographic coordinates of pixel arrays in a single foreign function
+        call, see `Gryd.Prepared.forward_arrays` for buffers.
+
+        Arguments:
+            px (buffer): pixel column positions
+            py (buffer): pixel row positions
+            out (tuple): optional (x, y) buffers to fill
+        Returns:
+            (x, y) buffers
+        """
+        n = len(px)
+        out = out or (t_zeros(n), t_zeros(n))
+        src, dst = t_buffers([px, py], n), t_buffers(out, n, output=True)
+        calibration_forward_n(self, src[0], src[1], dst[0], dst[1], n)
+        return out
+
+    def inverse_arrays(self, x, y, out=None):
+        """
+        Pixel positions of geographic coordinates arrays in a single foreign
+        function call.
+
+        Arguments:
+            x (buffer): geographic x coordinates
+            y (buffer): geographic y coordinates
+            out (tuple): optional (px, py) buffers to fill
+        Returns:
+            (px, py) buffers
+        """
+        n = len(x)
+        out = out or (t_zeros(n), t_zeros(n))
+        src, dst = t_buffers([x, y], n), t_buffers(out, n, output=True)
+        calibration_inverse_n(self, src[0], src[1], dst[0], dst[1], n)
+        return out
+
+    def raster(self, width, height, out=None):
+        """
+        Geographic coordinates of every pixel of a raster image, row after
+        row.
+
+        Arguments:
+            width (int): number of columns
+            height (int): number of rows
+            out (tuple): optional (x, y) buffers of `width * height` items
+        Returns:
+            (x, y) buffers
+        """
+        n = width * height
+        out = out or (t_zeros(n), t_zeros(n))
+        calibration_raster(
+            self, width, height, *t_buffers(out, n, output=True)
+        )
+        return out
+
+
 class Vincenty_dist(ctypes.Structure):
     """
     Great circle distance computation result using Vincenty formulae.
@@ -288,6 +746,104 @@ class Vincenty_dest(ctypes.Structure):
         )
 
 
+class Track(ctypes.Structure):
+    """
+    Streaming state of a track, vertices being fed chunk by chunk in
+    contiguous buffers so that tracks of any size are processed in bounded
+    memory. A track is either measured with `Gryd.Track.feed` or resampled
+    with `Gryd.Track.resample`, not both.
+
+    ```python
+    >>> track = Gryd.Track(wgs84, mode="karney", spacing=100000.)
+    >>> len(track.resample([dublin, londre]))
+    5
+    >>> track.length
+    464025.2235...
+    ```
+
+    Attributes:
+        last (Gryd.Geodesic): last vertex fed
+        count (int): number of vertices fed
+        length (float): length in meters of the track fed so far
+        samples (int): number of resampled points returned so far
+    """
+    _fields_ = [
+        ("last", Geodesic),
+        ("count", ctypes.c_size_t),
+        ("length", ctypes.c_double),
+        ("samples", ctypes.c_size_t)
+    ]
+
+    def __init__(self, ellps, mode="vincenty", spacing=None):
+        ctypes.Structure.__init__(self)
+        if spacing is not None and not spacing > 0:
+            raise ValueError("spacing must be positive")
+        self.ellps, self.mode, self.spacing = ellps, mode, spacing
+
+    def __repr__(self):
+        return "<Track %d vertices %.3fkm>" % (self.count, self.length / 1000)
+
+    def feed(self, points, out=None):
+        """
+        Add vertices to the track and return its length.
+
+        Arguments:
+            points (list): sequence or ctypes array of `Gryd.Geodesic`
+            out (buffer): optional float64 buffer of `len(points)` values
+                          filled with the track length at each vertex
+        Returns:
+            track length in meters
+        """
+        n = len(points)
+        cumulative = None
+        if isinstance(out, list):
+            if len(out) < n:
+                raise ValueError("out buffer must hold %d values" % n)
+            cumulative = (ctypes.c_double * n)()
+        elif out is not None:
+            cumulative = t_buffer(out, n, output=True)
+        length = track_length(
+            self.ellps, self, t_array(Geodesic, points), n,
+            _distance_mode(self.mode)[0], cumulative
+        )
+        if isinstance(out, list):
+            out[:n] = cumulative[:n]
+        return length
+
+    def resample(self, points, block=65536):
+        """
+        Add vertices to the track and return points located every `spacing`
+        meters along it from its first vertex, altitudes being linearly
+        interpolated. Segments are `"vincenty"` or `"karney"` geodesics.
+
+        Arguments:
+            points (list): sequence or ctypes array of `Gryd.Geodesic`
+            block (int): number of points computed per foreign call
+        Returns:
+            ctypes array of `Gryd.Geodesic`
+        """
+        if self.spacing is None:
+            raise ValueError("track has no resampling spacing")
+        if block < 1:
+            raise ValueError("block must be positive")
+        index = _geodesic_mode(self.mode)[0]
+        points = t_array(Geodesic, points)
+        n, start, data = len(points), 0, bytearray()
+        buffer, consumed = (Geodesic * block)(), ctypes.c_size_t()
+        size = ctypes.sizeof(Geodesic)
+        while start < n:
+            count = track_resample(
+                self.ellps, self, ctypes.cast(
+                    ctypes.addressof(points) + start * size,
+                    ctypes.POINTER(Geodesic)
+                ), n - start, self.spacing, index, buffer, block,
+                ctypes.byref(consumed)
+            )
+            data += ctypes.string_at(buffer, count * size)
+            start += consumed.value
+        return (Geodesic * (len(data) // size)).from_buffer(data)
+
+
 class Dms(ctypes.Structure):
     """
     Degrees Minutes Seconde value of a float value. `Dms` structure are
@@ -358,11 +914,10 @@ class Dmm(ctypes.Structure):
 
 class Epsg(ctypes.Structure):
     """
-    `ctypes` structure with a sqlite connection to EPSG database for
-    initialization purpose.
+    `ctypes` structure initialized from EPSG database registry.
     """
-    #: Shared sqlite database to be linked with
-    sqlite = EPSG_CON.cursor()
+    #: EPSG database registry to be linked with
+    registry = REGISTRY
     #: The table database name where `__init__` will find data
     table = ""
 
@@ -392,34 +947,44 @@ class Epsg(ctypes.Structure):
             elif isinstance(args[0], (bytes, str)):
                 pairs["name"] = args[0]
             args = ()
-        # try to find data in database using epsg or name
-        try:
-            if "epsg" in pairs:
-                record = Epsg.sqlite.execute(
-                    "SELECT * from %s WHERE epsg=?" % self.table,
-                    (pairs.pop("epsg"),)
-                ).fetchall()[0]
-            elif "name" in pairs:
-                record = Epsg.sqlite.execute(
-                    "SELECT * from %s WHERE name=?" % self.table,
-                    (pairs.pop("name"),)
-                ).fetchall()[0]
-        except IndexError:
-            pass
+        # try to find data in database using epsg or name, a snapshot record
+        # is copied as is and only its strings are set as attributes
+        address = None
+        if "epsg" in pairs:
+            address, record = Epsg.registry.lookup(
+                self.table, epsg=pairs.pop("epsg")
+            )
+        elif "name" in pairs:
+            address, record = Epsg.registry.lookup(
+                self.table, name=pairs.pop("name")
+            )
 
         # merge database record with eventually given pairs
         pairs = dict(record, **pairs)
         # initialize in the order of _fields_ attribute
         ctypes.Structure.__init__(self, *args)
+        if address is not None:
+            ctypes.memmove(ctypes.addressof(self), address, ctypes.sizeof(self))
         for key, value in sorted(pairs.items(), key=lambda e: e[0]):
             if key == "lambda":
                 key, value = "longitude", math.radians(value)
-            elif key in ["lambda0", "phi0", "phi1", "phi2", "azimut"]:
+            elif key == "azimuth":
+                key, value = "azimut", math.radians(value or 0.)
+            elif key in [
+                "lambda0", "phi0", "phi1", "phi2", "azimut", "gamma"
+            ]:
                 value = math.radians(value)
             elif key in ["rf", "1/f", "invf"]:
                 key, value = ("f", 1./value) if value != 0. else ("f", 0.)
             setattr(self, key, value)
 
+    def __setattr__(self, attr, value):
+        if REGISTRY._shared and is_frozen(self):
+            raise AttributeError(
+                "shared %s is read-only" % self.__class__.__name__
+            )
+        ctypes.Structure.__setattr__(self, attr, value)
+
 
 class Unit(Epsg):
     """
@@ -479,6 +1044,33 @@ class Prime(Epsg):
         )
 
 
+#: iterative solvers accuracy profiles : name -> (C index, tolerance in
+#: radians, iteration budget), see geoid.h
+ACCURACIES = {
+    "default": (0, 1e-10, 100),
+    "fast": (1, 1e-7, 20),
+    "survey": (2, 1e-12, 200)
+}
+
+
+def _accuracy_index(name):
+    try:
+        return ACCURACIES[name][0]
+    except KeyError:
+        raise ValueError(
+            "unknown accuracy %r, use one of %s" % (
+                name, ", ".join(sorted(ACCURACIES))
+            )
+        )
+
+
+def _accuracy_name(index):
+    for name, (value, tolerance, iterations) in ACCURACIES.items():
+        if value == index:
+            return name
+    return "default"
+
+
 class Ellipsoid(Epsg):
     """
     Ellipsoid model. If initialized with no args nor keyword args, it is a
@@ -490,12 +1082,21 @@ class Ellipsoid(Epsg):
     <Ellispoid epsg=7030 a=6378137.000000 1/f=298.25722356>
     ```
 
+    Iterative solvers (geocentric to geodesic conversion, Vincenty
+    problems, Karney transverse Mercator inverse) stop on the `accuracy`
+    profile of the ellipsoid they work on, see `Gryd.ACCURACIES`.
+
+    ```python
+    >>> fast = Gryd.Ellipsoid("WGS 84", accuracy="fast")
+    ```
+
     Attributes:
         epsg (int): EPSG reference
         a (float): semi major axis
         b (float): semi minor axis
         e (float): exentricity
         f (float): flattening
+        accuracy (str): solver accuracy profile
     """
     table = "ellipsoid"
     _fields_ = [
@@ -503,9 +1104,18 @@ class Ellipsoid(Epsg):
         ("a",    ctypes.c_double),
         ("b",    ctypes.c_double),
         ("e",    ctypes.c_double),
-        ("f",    ctypes.c_double)
+        ("f",    ctypes.c_double),
+        ("_accuracy", ctypes.c_int)
     ]
 
+    @property
+    def accuracy(self):
+        return _accuracy_name(self._accuracy)
+
+    @accuracy.setter
+    def accuracy(self, value):
+        self._accuracy = _accuracy_index(value)
+
     def __init__(self, *args, **pairs):
         if len(args) == len(pairs) == 0:
             pairs["a"] = pairs["b"] = 6378137.
@@ -532,7 +1142,7 @@ class Ellipsoid(Epsg):
                 self, "b", math.sqrt(self.a**2 * (1 - self.e**2))
             )
 
-    def distance(self, lla0, lla1):
+    def distance(self, lla0, lla1, mode="vincenty"):
         """
         Return Vincenty distance between two geodesic points.
 
@@ -544,15 +1154,24 @@ class Ellipsoid(Epsg):
         <Dist 464.025km initial bearing=113.6 final bearing=118.5°>
         ```
 
+        With `mode="karney"`, Karney series are used instead of Vincenty
+        iteration : accurate to 15 nm, with a bounded cost and convergent for
+        any pair of points, nearly antipodal ones included.
+
+        Approximate modes `"haversine"`, `"andoyer"` and `"flat"` are much
+        cheaper and give no bearings (NaN), their maximum relative errors are
+        listed in `Gryd.APPROXIMATE_MODES` (see `Gryd.Ellipsoid.within`).
+
         Arguments:
             lla0 (Gryd.Geodesic): point A
             lla1 (Gryd.Geodesic): point B
+            mode (str): `"vincenty"`, `"karney"` or an approximate mode
         Returns:
             `Gryd.Vincenty_dist` structure
         """
-        return distance(self, lla0, lla1)
+        return _distance_mode(mode)[1](self, lla0, lla1)
 
-    def destination(self, lla, bearing, distance):
+    def destination(self, lla, bearing, distance, mode="vincenty"):
         """
         Return Vincenty destination from geodesic start point following
         specific bearing with a determined distance.
@@ -566,22 +1185,166 @@ class Ellipsoid(Epsg):
         <lon=-006°15'33.973'' lat=+053°21'2.754'' alt=0.000>
         ```
 
+        With `mode="karney"`, destination is computed without any iteration
+        (see `Gryd.Ellipsoid.distance`).
+
         Arguments:
             lla (Gryd.Geodesic): start point
             bearing (float): start bearing in degrees
             distance (float): distance in meters
+            mode (str): `"vincenty"` or `"karney"`
         Returns:
             `Gryd.Vincenty_dest` structure
         """
-        return destination(
+        return _geodesic_mode(mode)[2](
             self, lla, Vincenty_dist(distance, math.radians(bearing))
         )
 
-    def npoints(self, lla0, lla1, n):
+    def distance_many(self, starts, stops, mode="vincenty", out=None):
+        """
+        Return Vincenty distances between pairs of geodesic points in a single
+        foreign function call, spread over `Gryd.set_threads` workers.
+
+        ```python
+        >>> wgs84.distance_many([dublin], [london])[0]
+        <Dist 464.025km initial bearing=113.6 final bearing=118.5°>
+        ```
+
+        Arguments:
+            starts (list): sequence of `Gryd.Geodesic` start points
+            stops (list): sequence of `Gryd.Geodesic` end points
+            mode (str): `"vincenty"`, `"karney"` or an approximate mode
+            out (ctypes array): optional `Gryd.Vincenty_dist` table to fill
+        Returns:
+            ctypes array of `Gryd.Vincenty_dist` structures
+        """
+        n = len(starts)
+        if len(stops) != n:
+            raise ValueError("starts and stops must have the same length")
+        result = t_out(Vincenty_dist, n, out)
+        distance_n(
+            self, t_array(Geodesic, starts), t_array(Geodesic, stops),
+            result, n, _distance_mode(mode)[0]
+        )
+        return result
+
+    def distance_matrix(
+        self, origins, targets, mode="vincenty", bearings=True, out=None
+    ):
+        """
+        Return distances from every origin to every target in a single
+        foreign function call, spread over `Gryd.set_threads` workers.
+        Reduced latitudes are computed once per point, and bearings are
+        skipped if not asked for.
+
+        ```python
+        >>> m = wgs84.distance_matrix([dublin, london], [london, dublin])
+        >>> m[0]
+        <Dist 464.025km initial bearing=113.6 final bearing=118.5°>
+        >>> wgs84.distance_matrix(dublin, [london], bearings=False)[0]
+        464025.2235062019
+        ```
+
+        Arguments:
+            origins (list): sequence of `Gryd.Geodesic` origins or a single
+                            one (one to many distances)
+            targets (list): sequence of `Gryd.Geodesic` targets
+            mode (str): `"vincenty"`, `"karney"` or an approximate mode
+            bearings (bool): if False, only distances (meters) are computed
+            out (ctypes array or buffer): optional `Gryd.Vincenty_dist`
+                                          table, or float64 buffer without
+                                          bearings, of `n*m` items to fill
+        Returns:
+            row major ctypes array of `n*m` `Gryd.Vincenty_dist` structures,
+            `array.array` of float64 distances (or `out`) without bearings
+        """
+        if isinstance(origins, Geodesic):
+            origins = [origins]
+        n, m = len(origins), len(targets)
+        if bearings:
+            result = t_out(Vincenty_dist, n * m, out)
+            table, distances = result, None
+        else:
+            result = t_zeros(n * m) if out is None else out
+            table, distances = None, t_buffer(result, n * m, output=True)
+        distance_matrix(
+            self, t_array(Geodesic, origins), n, t_array(Geodesic, targets),
+            m, table, distances, _distance_mode(mode)[0]
+        )
+        return result
+
+    def within(self, origin, targets, radius, mode="andoyer", exact="karney"):
+        """
+        Return indexes of targets closer than radius to origin, as a two
+        stage filter : approximate distances are computed for every target
+        and exact ones only for targets within the error bound of `mode`
+        around radius (see `Gryd.APPROXIMATE_MODES`). Andoyer distances are
+        used when radius around origin exceeds the domain of `mode` error
+        bound.
+
+        ```python
+        >>> wgs84.within(dublin, [london, dublin], 100000.)
+        [1]
+        ```
+
+        Arguments:
+            origin (Gryd.Geodesic): center point
+            targets (list): sequence of `Gryd.Geodesic` points
+            radius (float): distance threshold in meters
+            mode (str): approximate distance mode
+            exact (str): `"vincenty"` or `"karney"` mode for candidates near
+                         radius
+        Returns:
+            sorted `list` of indexes
+        """
+        try:
+            error, (distance, latitude) = APPROXIMATE_MODES[mode][2:]
+        except KeyError:
+            raise ValueError(
+                "unknown mode %r, use one of %s" % (
+                    mode, ", ".join(APPROXIMATE_MODES)
+                )
+            )
+        # meridian radius is a*(1-e^2) at least, so that targets closer than
+        # radius are within this latitude of origin one
+        reach = radius * (1 + error) / (self.a * (1 - self.e ** 2))
+        if radius * (1 + error) > distance or \
+           abs(origin.latitude) + reach > latitude:
+            mode = "andoyer"
+            error = APPROXIMATE_MODES[mode][2]
+        targets = t_array(Geodesic, targets)
+        approximate = self.distance_matrix(
+            origin, targets, mode=mode, bearings=False
+        )
+        result, candidates = [], []
+        for i, d in enumerate(approximate):
+            if d * (1 + error) < radius:
+                result.append(i)
+            elif d * (1 - error) <= radius:
+                candidates.append(i)
+        if candidates:
+            distances = self.distance_matrix(
+                origin, [targets[i] for i in candidates], mode=exact,
+                bearings=False
+            )
+            result.extend(
+                i for i, d in zip(candidates, distances) if d < radius
+            )
+        return sorted(result)
+
+    def npoints(
+        self, lla0, lla1, n=None, max_segment=None, mode="vincenty", out=None
+    ):
         """
         Return number of intermediary geodesic coordinates points between two
         points using Vincenty formulae.
 
+        With `mode="karney"`, the geodesic is solved once and points are
+        evaluated along it at constant cost per point, without the error
+        build up of successive destinations. If `max_segment` is given, `n`
+        is the lowest number of points so that no segment is longer than
+        `max_segment` meters, and Karney mode is used.
+
         ```python
         >>> for p in wgs84.npoints(dublin, londre, 4): print(p)
         ...
@@ -596,15 +1359,100 @@ class Ellipsoid(Epsg):
             lla0 (Gryd.Geodesic): start point
             lla1 (Gryd.Geodesic): end point
             n (int): number uf intermediary points
+            max_segment (float): maximum segment length in meters
+            mode (str): `"vincenty"` or `"karney"`
+            out (ctypes array): optional table of at least n+2
+                                `Gryd.Vincenty_dest` to fill, returned items
+                                share its memory
         Returns:
             list of `Gryd.Vincenty_dest` (start, *intermediaries, end)
         """
-        result = ()
-        pts = npoints(self, lla0, lla1, n)
-        for i in range(n + 2):
-            result += (pts[i], )
+        if max_segment is not None:
+            if max_segment <= 0:
+                raise ValueError("max_segment must be positive")
+            mode = "karney"
+            n = max(0, int(math.ceil(
+                distance_karney(self, lla0, lla1).distance / max_segment
+            )) - 1)
+        elif n is None:
+            raise TypeError("n or max_segment argument is required")
+        out = t_out(Vincenty_dest, n + 2, out)
+        _geodesic_mode(mode)[3](self, lla0, lla1, n, out)
+        return tuple(out[i] for i in range(n + 2))
+
+    def track_length(self, points, mode="vincenty", cumulative=False):
+        """
+        Return length of a track in a single foreign function call, segments
+        being solved by `Gryd.Ellipsoid.distance_many` kernels. Use
+        `Gryd.Track` to feed very long tracks chunk by chunk.
+
+        ```python
+        >>> wgs84.track_length([dublin, londre, dublin])
+        928050.447...
+        ```
+
+        Arguments:
+            points (list): sequence or ctypes array of `Gryd.Geodesic`
+            mode (str): `"vincenty"`, `"karney"` or an approximate mode
+            cumulative (bool): return track length at every vertex instead
+        Returns:
+            length in meters or `array.array` of float64 lengths
+        """
+        out = t_zeros(len(points)) if cumulative else None
+        length = Track(self, mode).feed(points, out)
+        return out if cumulative else length
+
+    def resample(self, points, spacing, mode="vincenty", end=True):
+        """
+        Return points every `spacing` meters along a track, from its first
+        vertex (see `Gryd.Track.resample`).
+
+        ```python
+        >>> len(wgs84.resample([dublin, londre], 100000.))
+        6
+        ```
+
+        Arguments:
+            points (list): sequence or ctypes array of `Gryd.Geodesic`
+            spacing (float): distance between points in meters
+            mode (str): `"vincenty"` or `"karney"`
+            end (bool): append last vertex if not already written
+        Returns:
+            ctypes array of `Gryd.Geodesic`
+        """
+        track = Track(self, mode, spacing)
+        result = track.resample(points)
+        if end and len(points) and \
+           (track.samples - 1) * spacing < track.length:
+            result = (Geodesic * (len(result) + 1))(*result, track.last)
         return result
 
+    def simplify(self, points, tolerance):
+        """
+        Return indexes of the vertices kept by Douglas-Peucker simplification
+        so that no removed vertex is farther than `tolerance` meters from the
+        simplified track. Cross track distances are measured on the authalic
+        sphere, within 0.5% of geodesic ones.
+
+        ```python
+        >>> wgs84.simplify([dublin, londre, dublin], 1000.)
+        [0, 1, 2]
+        ```
+
+        Arguments:
+            points (list): sequence or ctypes array of `Gryd.Geodesic`
+            tolerance (float): maximum distance in meters
+        Returns:
+            sorted `list` of indexes
+        """
+        n = len(points)
+        keep = (ctypes.c_ubyte * n)()
+        if n and not track_simplify(
+            self, t_array(Geodesic, points), n, tolerance, keep
+        ):
+            raise MemoryError("can not allocate %d vertices" % n)
+        return [i for i in range(n) if keep[i]]
+
 
 class Datum(Epsg):
     """
@@ -680,7 +1528,7 @@ class Datum(Epsg):
         return geocentric(self.ellipsoid, lla)
     geographic = xyz
 
-    def lla(self, xyz):
+    def lla(self, xyz, solver="iterative"):
         """
         Convert geocentric coordinates to geodesic coordinates.
 
@@ -691,37 +1539,197 @@ class Datum(Epsg):
         <lon=-000°07'37.218'' lat=+051°31'6.967'' alt=0.000>
         ```
 
+        Available solvers are `"iterative"` (fixed point iteration, the
+        default), `"bowring"` (two Bowring steps) and `"vermeille"` (closed
+        form). Both latter are exact to rounding errors from sub-surface to
+        orbital altitudes and several times faster.
+
         Arguments:
             xyz (Gryd.Geodesic): geocentric coordinates
+            solver (str): latitude solver
         Returns:
             `Gryd.Geodesic` coordinates
         """
-        lla = geodesic(self.ellipsoid, xyz)
+        lla = _solver(solver)[1](self.ellipsoid, xyz)
         lla.longitude -= self.prime.longitude
         return lla
     geodesic = lla
 
-    def transform(self, dst, lla):
+    def xyz_many(self, points):
         """
-        Transform geodesic coordinates to another datum.
-
-        ```python
-        >>> airy = Gryd.Datum(epsg=4277)
-        >>> wgs84.transform(airy, london)
-        <lon=-000°07'31.431'' lat=+051°31'5.137'' alt=-46.118>
-        ```
+        Convert a sequence of geodesic coordinates to geocentric coordinates
+        in a single foreign function call, spread over `Gryd.set_threads`
+        workers. Unlike `Datum.xyz`, input points are left unchanged.
 
         Arguments:
-            dst (Gryd.Datum): destination datum
-            lla (Gryd.Geodesic): geodesic coordinates to transform
+            points (list): sequence of `Gryd.Geodesic` coordinates
         Returns:
-            `Gryd.Geodesic` coordinates
+            ctypes array of `Gryd.Geocentric` coordinates
         """
-        return dst.lla(dat2dat(self, dst, self.xyz(lla)))
+        n = len(points)
+        lla = (Geodesic * n)(*points)
+        if self.prime.longitude != 0.:
+            for p in lla:
+                p.longitude += self.prime.longitude
+        result = (Geocentric * n)()
+        geocentric_n(self.ellipsoid, lla, result, n)
+        return result
 
+    def xyz_graticule(self, longitudes, latitudes, altitude=0., out=None):
+        """
+        Convert the points of a graticule, rows of constant latitude by
+        columns of constant longitude, to geocentric coordinates in a single
+        foreign function call. Radius terms are computed once per row and
+        longitude sines and cosines once per column of a
+        `Gryd.GRATICULE_TILE` rows tile.
 
-class Crs(Epsg):
-    """
+        Arguments:
+            longitudes (buffer): column longitudes in radians
+            latitudes (buffer): row latitudes in radians
+            altitude (float): altitude of all points in meters
+            out (ctypes array): optional `Gryd.Geocentric` table of
+                                `len(latitudes) * len(longitudes)` items
+        Returns:
+            row major ctypes array of `Gryd.Geocentric` coordinates
+        """
+        nlon, nlat = len(longitudes), len(latitudes)
+        if self.prime.longitude != 0.:
+            longitudes = array.array(
+                "d", [l + self.prime.longitude for l in longitudes]
+            )
+        result = t_out(Geocentric, nlon * nlat, out)
+        geocentric_graticule(
+            self.ellipsoid, t_buffer(longitudes), nlon, t_buffer(latitudes),
+            nlat, altitude, result
+        )
+        return result
+
+    def lla_many(self, points, solver="iterative", out=None):
+        """
+        Convert a sequence of geocentric coordinates to geodesic coordinates
+        in a single foreign function call, spread over `Gryd.set_threads`
+        workers.
+
+        Arguments:
+            points (list): sequence of `Gryd.Geocentric` coordinates
+            solver (str): latitude solver, see `Gryd.Datum.lla`
+            out (ctypes array): optional `Gryd.Geodesic` table to fill
+        Returns:
+            ctypes array of `Gryd.Geodesic` coordinates
+        """
+        n = len(points)
+        result = t_out(Geodesic, n, out)
+        geodesic_n(
+            self.ellipsoid, t_array(Geocentric, points), result, n,
+            _solver(solver)[0]
+        )
+        if self.prime.longitude != 0.:
+            for i in range(n):
+                result[i].longitude -= self.prime.longitude
+        return result
+
+    def xyz_arrays(self, lon, lat, alt=None, out=None):
+        """
+        Convert arrays of geodesic coordinates to geocentric coordinates in a
+        single foreign function call. Any contiguous float64 buffer (numpy
+        array, `array.array`...) is used without copy.
+
+        ```python
+        >>> x, y, z = wgs84.xyz_arrays(
+        ...     array.array("d", [london.longitude]),
+        ...     array.array("d", [london.latitude])
+        ... )
+        >>> x[0], y[0], z[0]
+        (3977018.848..., -8815.695..., 4969650.564...)
+        ```
+
+        Arguments:
+            lon (buffer): longitudes in radians
+            lat (buffer): latitudes in radians
+            alt (buffer): altitudes in meters (0 if not given)
+            out (tuple): optional (x, y, z) buffers to fill
+        Returns:
+            (x, y, z) buffers
+        """
+        n = len(lon)
+        src = t_buffers([lon, lat, alt], n)
+        if self.prime.longitude != 0.:
+            src[0] = t_buffer(
+                array.array("d", [l + self.prime.longitude for l in lon])
+            )
+        out = out or (t_zeros(n), t_zeros(n), t_zeros(n))
+        geocentric_soa(
+            self.ellipsoid, Geodesics(*src),
+            Geocentrics(*t_buffers(out, n, output=True, required=3)), n
+        )
+        return out
+
+    def lla_arrays(self, x, y, z, out=None, solver="iterative"):
+        """
+        Convert arrays of geocentric coordinates to geodesic coordinates in a
+        single foreign function call. Any contiguous float64 buffer (numpy
+        array, `array.array`...) is used without copy.
+
+        Arguments:
+            x (buffer): X-axis values
+            y (buffer): Y-axis values
+            z (buffer): Z-axis values
+            out (tuple): optional (lon, lat, alt) buffers to fill
+            solver (str): latitude solver, see `Gryd.Datum.lla`
+        Returns:
+            (lon, lat, alt) buffers, longitudes and latitudes in radians
+        """
+        n = len(x)
+        out = out or (t_zeros(n), t_zeros(n), t_zeros(n))
+        geodesic_soa(
+            self.ellipsoid, Geocentrics(*t_buffers([x, y, z], n, required=3)),
+            Geodesics(*t_buffers(out, n, output=True)), n,
+            _solver(solver)[0]
+        )
+        if self.prime.longitude != 0.:
+            for i in range(n):
+                out[0][i] -= self.prime.longitude
+        return out
+
+    def transform(self, dst, lla):
+        """
+        Transform geodesic coordinates to another datum.
+
+        ```python
+        >>> airy = Gryd.Datum(epsg=4277)
+        >>> wgs84.transform(airy, london)
+        <lon=-000°07'31.431'' lat=+051°31'5.137'' alt=-46.118>
+        ```
+
+        Arguments:
+            dst (Gryd.Datum): destination datum
+            lla (Gryd.Geodesic): geodesic coordinates to transform
+        Returns:
+            `Gryd.Geodesic` coordinates
+        """
+        return dst.lla(dat2dat(self, dst, self.xyz(lla)))
+
+    def transform_many(self, dst, points):
+        """
+        Transform a sequence of geodesic coordinates to another datum, each
+        step being a single foreign function call spread over
+        `Gryd.set_threads` workers.
+
+        Arguments:
+            dst (Gryd.Datum): destination datum
+            points (list): sequence of `Gryd.Geodesic` coordinates
+        Returns:
+            ctypes array of `Gryd.Geodesic` coordinates
+        """
+        n = len(points)
+        xyz = self.xyz_many(points)
+        result = (Geocentric * n)()
+        dat2dat_n(self, dst, xyz, result, n)
+        return dst.lla_many(result)
+
+
+class Crs(Epsg):
+    """
     Coordinate reference system object allowing projection of geodesic
     coordinates to flat map (geographic coordinates).
 
@@ -746,6 +1754,8 @@ class Crs(Epsg):
         epsg (int): EPSG reference
         datum (Gryd.Datum): prime used in crs
         unit (Gryd.Unit): unit used in crs
+        projection (str): projection name, `"ktmerc"` is a drop-in wide
+                          zone replacement of `"tmerc"`
         lambda0 (float): tmerc projection coef
         phi0 (float): tmerc and omerc projection coef
         phi1 (float): lcc projection coef
@@ -754,6 +1764,10 @@ class Crs(Epsg):
         x0 (float): false northing
         y0 (float): false easting
         azimut (float): omerc projection coef
+        gamma (float): omerc rectified grid angle (azimut if not given)
+        map_points (list): calibration points of a raster image
+        calibration (str): model fitted on map points (see
+                           `Gryd.CALIBRATIONS`)
     """
     table = "grid"
     _fields_ = [
@@ -767,7 +1781,8 @@ class Crs(Epsg):
         ("k0",      ctypes.c_double),
         ("x0",      ctypes.c_double),
         ("y0",      ctypes.c_double),
-        ("azimut",  ctypes.c_double)
+        ("azimut",  ctypes.c_double),
+        ("gamma",   ctypes.c_double)
     ]
 
     proj = property(
@@ -779,13 +1794,17 @@ class Crs(Epsg):
 
     def __reduce__(self):
         """
-        special method that allows `Gryd.Crs` instance to be pickled
+        special method that allows `Gryd.Crs` instance to be pickled, copies
+        of a shared crs are writable ones
         """
-        if hasattr(self, "forward"):
-            self.__dict__.pop("forward")
-        if hasattr(self, "inverse"):
-            self.__dict__.pop("inverse")
-        return Epsg.__reduce__(self)
+        func, (cls, (state, data)) = Epsg.__reduce__(self)
+        state = dict(
+            (key, value) for key, value in state.items()
+            if key not in ["forward", "inverse", "forward_n", "inverse_n",
+                           "_frozen", "_calibrated"]
+        )
+        state["map_points"] = list(state.get("map_points", []))
+        return func, (cls, (state, data))
 
     def __repr__(self):
         return "<Crs epsg=%d:\n%r\n%r\nProjection %r>" % (
@@ -794,7 +1813,10 @@ class Crs(Epsg):
 
     def __init__(self, *args, **kwargs):
         self.map_points = []
+        self.calibration = "affine"
         self.projection = "latlong"
+        # NaN is the unset gamma, so that omerc keeps an explicit 0
+        self.gamma = math.nan
         Epsg.__init__(self, *args, **kwargs)
         self.unit = kwargs.pop("unit", 9001)
 
@@ -803,13 +1825,15 @@ class Crs(Epsg):
             value = Datum(value)
         elif attr == "unit" and not isinstance(value, Unit):
             value = Unit(value)
+        elif attr in ["calibration", "map_points"]:
+            if attr == "calibration" and value not in CALIBRATIONS:
+                raise ValueError("unknown calibration model %r" % value)
+            self.__dict__.pop("_calibrated", None)
         elif attr == "projection":
             if isinstance(value, int):
-                record = Epsg.sqlite.execute(
-                    "SELECT * from projection WHERE epsg=%r;" % value
-                ).fetchall()
-                if len(record) > 0:
-                    value = record[0]["typeproj"]
+                record = Epsg.registry.lookup("projection", epsg=value)[1]
+                if record:
+                    value = record["typeproj"]
                 else:
                     raise Exception("EPSG projection #%d unknown" % value)
             if value in __c_proj__:
@@ -819,12 +1843,20 @@ class Crs(Epsg):
                 Epsg.__setattr__(self, "inverse", getattr(
                     sys.modules[__name__], value + "_inverse"
                 ))
+                Epsg.__setattr__(self, "forward_n", getattr(
+                    sys.modules[__name__], value + "_forward_n"
+                ))
+                Epsg.__setattr__(self, "inverse_n", getattr(
+                    sys.modules[__name__], value + "_inverse_n"
+                ))
             elif value in __py_proj__:
                 module = __import__(
                     'Gryd.' + value, globals(), locals(), [value], 0
                 )
                 Epsg.__setattr__(self, "forward", module.forward)
                 Epsg.__setattr__(self, "inverse", module.inverse)
+                Epsg.__setattr__(self, "forward_n", None)
+                Epsg.__setattr__(self, "inverse_n", None)
             else:
                 value = "latlong"
                 Epsg.__setattr__(
@@ -845,6 +1877,8 @@ class Crs(Epsg):
                             xya.altitude
                         )
                 )
+                Epsg.__setattr__(self, "forward_n", None)
+                Epsg.__setattr__(self, "inverse_n", None)
         Epsg.__setattr__(self, attr, value)
 
     def __call__(self, element):
@@ -867,7 +1901,8 @@ class Crs(Epsg):
         if not hasattr(self, "forward"):
             setattr(self, "projection", getattr(self, "projection", None))
 
-        ratio = self.unit.ratio
+        # C projections already work in crs unit
+        ratio = 1. if self.forward_n is not None else self.unit.ratio
         if isinstance(element, Geodesic):
             xya = self.forward(self, element)
             xya.x /= ratio
@@ -878,6 +1913,72 @@ class Crs(Epsg):
             element.y *= ratio
             return self.inverse(self, element)
 
+    def forward_many(self, points, out=None):
+        """
+        Project a batch of geodesic coordinates. With a C projection, the
+        whole batch is computed in a single foreign function call.
+
+        ```python
+        >>> osgb36.forward_many([london, dublin])
+        <Gryd.Geographic_Array_2 object at 0x...>
+        >>> list(_)
+        [<X=529939.106 Y=181680.962s alt=0.000>, \
+<X=116572.029 Y=392252.917s alt=0.000>]
+        ```
+
+        Arguments:
+            points (sequence or ctypes array of Gryd.Geodesic): coordinates
+                                                                to project
+            out (ctypes array): optional `Gryd.Geographic` table to fill
+                                (C projections only)
+        Returns:
+            `ctypes` array of `Gryd.Geographic` coordinates (`list` of
+            `Gryd.Grid` with python projections)
+        """
+        if not hasattr(self, "forward"):
+            setattr(self, "projection", getattr(self, "projection", None))
+
+        if self.forward_n is None:
+            module = sys.modules.get("Gryd.%s" % self.projection)
+            if hasattr(module, "forward_many"):
+                return module.forward_many(self, points)
+            return [self(p) for p in points]
+
+        lla = t_array(Geodesic, points)
+        n = len(lla)
+        xya = t_out(Geographic, n, out)
+        self.forward_n(self, lla, xya, n)
+        return xya
+
+    def inverse_many(self, points, out=None):
+        """
+        Deproject a batch of geographic coordinates. With a C projection, the
+        whole batch is computed in a single foreign function call. Unlike
+        `Gryd.Crs.__call__`, given points are left untouched.
+
+        Arguments:
+            points (sequence or ctypes array of Gryd.Geographic): coordinates
+                                                                  to deproject
+            out (ctypes array): optional `Gryd.Geodesic` table to fill (C
+                                projections only)
+        Returns:
+            `ctypes` array of `Gryd.Geodesic` coordinates
+        """
+        if not hasattr(self, "inverse"):
+            setattr(self, "projection", getattr(self, "projection", None))
+
+        if self.inverse_n is None:
+            module = sys.modules.get("Gryd.%s" % self.projection)
+            if hasattr(module, "inverse_many"):
+                return module.inverse_many(self, points)
+            return t_array(Geodesic, [self(copy.copy(p)) for p in points])
+
+        xya = t_array(Geographic, points)
+        n = len(xya)
+        lla = t_out(Geodesic, n, out)
+        self.inverse_n(self, xya, lla, n)
+        return lla
+
     def transform(self, dst, xya):
         """
         Transform geographical coordinates to another coordinate reference
@@ -899,16 +2000,103 @@ class Crs(Epsg):
         Returns:
             `Gryd.Geographic` coordinates
         """
+        if self.projection in __c_proj__ and dst.projection in __c_proj__:
+            return crs_transform(
+                self, _prepare_fn(self), dst, _prepare_fn(dst), xya
+            )
         return dst(self.datum.transform(dst.datum, self(xya)))
 
-    def _xiyi(self):
-        points = self.map_points
-        geographics = [p.xya for p in self.map_points]
-        n = len(points)
-        self._pxi = t_byref(ctypes.c_double, n, *[p.px for p in points])
-        self._pyi = t_byref(ctypes.c_double, n, *[p.py for p in points])
-        self._Xi = t_byref(ctypes.c_double, n, *[p.x for p in geographics])
-        self._Yi = t_byref(ctypes.c_double, n, *[p.y for p in geographics])
+    def transformer(self, dst, accuracy=None):
+        """
+        Return a `Gryd.Transformer` object from this coordinate reference
+        system to another one.
+
+        Arguments:
+            dst (Gryd.Crs): destination coordinate reference system
+            accuracy (str): solver accuracy profile of the transformer, the
+                            ellipsoid ones by default
+        Returns:
+            `Gryd.Transformer` object
+        """
+        return Transformer(self, dst, accuracy)
+
+    def transform_many(self, dst, points):
+        """
+        Transform a batch of geographic coordinates to another coordinate
+        reference system. With C projections, the whole chain (deprojection,
+        datum shift and projection) runs in a single foreign function call.
+
+        ```python
+        >>> list(osgb36.transform_many(pvs, [osgb36(london)]))
+        [<X=-14317.072 Y=6680144.273s alt=-13015.770>]
+        ```
+
+        Arguments:
+            dst (Gryd.Crs): destination coordinate reference system
+            points (sequence or ctypes array of Gryd.Geographic): coordinates
+                                                                  to transform
+        Returns:
+            `ctypes` array of `Gryd.Geographic` coordinates (`list` with
+            python projections)
+        """
+        if self.projection in __c_proj__ and dst.projection in __c_proj__:
+            return Transformer(self, dst).transform_many(points)
+        return [self.transform(dst, copy.copy(p)) for p in points]
+
+    def forward_arrays(self, lon, lat, alt=None, out=None):
+        """
+        Project arrays of geodesic coordinates, see
+        `Gryd.Prepared.forward_arrays`.
+        """
+        return Prepared(self).forward_arrays(lon, lat, alt, out)
+
+    def inverse_arrays(self, x, y, alt=None, out=None):
+        """
+        Deproject arrays of geographic coordinates, see
+        `Gryd.Prepared.inverse_arrays`.
+        """
+        return Prepared(self).inverse_arrays(x, y, alt, out)
+
+    def prepare(self, accuracy=None):
+        """
+        Return a prepared copy of coordinate reference system where projection
+        constants are computed once. Only C projections can be prepared.
+
+        ```python
+        >>> prep = osgb36.prepare()
+        >>> prep(london)
+        <X=529939.106 Y=181680.962s alt=0.000>
+        ```
+
+        Arguments:
+            accuracy (str): solver accuracy profile of the prepared copy,
+                            the ellipsoid one by default
+        Returns:
+            `Gryd.Prepared` crs
+        """
+        return Prepared(self, accuracy)
+
+    def calibrate(self):
+        """
+        Return the `calibration` model fitted on map points. It is computed
+        once and kept until map points or model change, so pixel queries do
+        not depend on the number of calibration points.
+
+        ```python
+        >>> pvs.calibration = "triangles"
+        >>> x, y = pvs.calibrate().raster(512, 512)
+        ```
+
+        Returns:
+            `Gryd.Calibration` model
+        """
+        calibrated = self.__dict__.get("_calibrated", None)
+        if calibrated is None:
+            if len(self.map_points) < 2:
+                raise Exception("no enough calibration points in this Crs")
+            calibrated = Calibration(self.map_points, self.calibration)
+            self.__dict__["_calibrated"] = calibrated
+        return calibrated
 
     def add_map_point(self, px, py, point):
         """
@@ -937,9 +2125,8 @@ class Crs(Epsg):
             point (Gryd.Geodesic or Gryd.Geographic): geodesic or geographic
                                                       coordinates
         """
-        if px in [p.px for p in self.map_points] or \
-           py in [p.py for p in self.map_points]:
-            raise Exception("pixel row or column already referenced")
+        if (px, py) in [(p.px, p.py) for p in self.map_points]:
+            raise Exception("pixel already referenced")
         if isinstance(point, Geodesic):
             geodesic = point
             geographic = self(point)
@@ -947,7 +2134,7 @@ class Crs(Epsg):
             geodesic = self(point)
             geographic = point
         self.map_points.append(Point(px, py, geodesic, geographic))
-        self._xiyi()
+        self.__dict__.pop("_calibrated", None)
 
     def delete_map_point(self, *points_or_indexes):
         """
@@ -985,7 +2172,7 @@ class Crs(Epsg):
                         self.map_points.index(point_or_index)
                     )
                 )
-        self._xiyi()
+        self.__dict__.pop("_calibrated", None)
         return result
 
     def map2crs(self, px, py, geographic=False):
@@ -1007,16 +2194,8 @@ class Crs(Epsg):
         Returns:
             `Gryd.Geographic` if `geographic` is True else `Gryd.Geodesic`
         """
-        n = len(self.map_points)
-        if n >= 2:
-            x = lagrange(px, self._pxi, self._Xi, n)
-            y = lagrange(py, self._pyi, self._Yi, n)
-            if geographic:
-                return Geographic(x, y, 0)
-            else:
-                return self(Geographic(x, y, 0))
-        else:
-            raise Exception("no enough calibration points in this Crs")
+        xya = self.calibrate().forward(px, py)
+        return xya if geographic else self(xya)
 
     def crs2map(self, point):
         """
@@ -1050,111 +2229,1605 @@ class Crs(Epsg):
         else:
             raise Exception("not a valid point")
 
-        n = len(self.map_points)
-        if n >= 2:
-            return Point(
-                lagrange(point.x, self._Xi, self._pxi, n),
-                lagrange(point.y, self._Yi, self._pyi, n),
-                geodesic_point,
-                point
-            )
-        else:
-            raise Exception("no enough calibration points in this Crs")
+        px, py = self.calibrate().inverse(point)
+        return Point(px, py, geodesic_point, point)
 
 
-def _Geodesic__repr(obj):
-    return "<lon=%r lat=%r alt=%.3f>" % (
-        dms(math.degrees(obj.longitude)),
-        dms(math.degrees(obj.latitude)),
-        obj.altitude
-    )
+#: rows of a graticule tile (see `Gryd.Prepared.graticule`)
+GRATICULE_TILE = 64
 
 
-setattr(Geodesic, "__repr__", _Geodesic__repr)
+class Prepared(ctypes.Structure):
+    """
+    Opaque `ctypes` structure of a coordinate reference system ready for
+    projection. It holds a copy of the crs and the constants derived from it,
+    so further modifications of the source crs are not taken into account.
+    It is returned by `Gryd.Crs.prepare` function.
+    """
+    _fields_ = [
+        ("crs",          Crs),
+        ("_forward",     ctypes.c_void_p),
+        ("_inverse",     ctypes.c_void_p),
+        ("_forward_n",   ctypes.c_void_p),
+        ("_inverse_n",   ctypes.c_void_p),
+        ("_forward_soa", ctypes.c_void_p),
+        ("_inverse_soa", ctypes.c_void_p),
+        ("_graticule",   ctypes.c_void_p),
+        ("_coef",        ctypes.c_double * 32)
+    ]
 
+    def __init__(self, crs, accuracy=None):
+        ctypes.Structure.__init__(self)
+        if crs.projection not in __c_proj__:
+            raise Exception(
+                "projection %r can not be prepared" % crs.projection
+            )
+        self.projection = crs.projection
+        getattr(proj, crs.projection + "_prepare")(crs, self)
+        if accuracy is not None:
+            self.crs.datum.ellipsoid._accuracy = _accuracy_index(accuracy)
 
-#######################
-# loading C libraries #
-#######################
-# defining library name
-__dll_ext__ = "dll" if sys.platform.startswith("win") else \
-              "so" if sys.platform.startswith("linux") else \
-              "so"
-geoid = ctypes.CDLL(get_data_file("geoid.%s" % __dll_ext__))
-proj = ctypes.CDLL(get_data_file("proj.%s" % __dll_ext__))
+    def __reduce__(self):
+        raise TypeError("prepared crs can not be pickled")
 
-dms = geoid.dms
-dms.argtypes = [ctypes.c_double]
-dms.restype = Dms
+    def __repr__(self):
+        return "<Prepared crs epsg=%d projection %r>" % (
+            self.crs.epsg, self.projection
+        )
 
-dmm = geoid.dmm
-dmm.argtypes = [ctypes.c_double]
-dmm.restype = Dmm
+    def __call__(self, element):
+        """
+        Project `Gryd.Geodesic` or deproject `Gryd.Geographic` coordinates.
+        Unlike `Gryd.Crs.__call__`, given element is left untouched.
 
-geocentric = geoid.geocentric
-geocentric.argtypes = [ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesic)]
-geocentric.restype = Geocentric
+        Arguments:
+            element (Gryd.Geodesic or Gryd.Geographic): coordinates to be
+                                                        transformed
+        Returns:
+            `Gryd.Geographic` or `Gryd.Geodesic` coordinates
+        """
+        if isinstance(element, Geodesic):
+            return prepared_forward(self, element)
+        else:
+            return prepared_inverse(self, element)
 
-geodesic = geoid.geodesic
-geodesic.argtypes = [ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geocentric)]
-geodesic.restype = Geodesic
+    def forward_many(self, points, out=None):
+        """
+        Project a batch of geodesic coordinates in a single foreign function
+        call.
 
-distance = geoid.distance
-distance.argtypes = [
-    ctypes.POINTER(Ellipsoid),
-    ctypes.POINTER(Geodesic),
-    ctypes.POINTER(Geodesic)
-]
-distance.restype = Vincenty_dist
+        Arguments:
+            points (sequence or ctypes array of Gryd.Geodesic): coordinates
+                                                                to project
+            out (ctypes array): optional `Gryd.Geographic` table to fill
+        Returns:
+            `ctypes` array of `Gryd.Geographic` coordinates
+        """
+        lla = t_array(Geodesic, points)
+        n = len(lla)
+        xya = t_out(Geographic, n, out)
+        prepared_forward_n(self, lla, xya, n)
+        return xya
 
-destination = geoid.destination
-destination.argtypes = [
-    ctypes.POINTER(Ellipsoid),
-    ctypes.POINTER(Geodesic),
-    ctypes.POINTER(Vincenty_dist)
-]
-destination.restype = Vincenty_dest
+    def inverse_many(self, points, out=None):
+        """
+        Deproject a batch of geographic coordinates in a single foreign
+        function call.
 
-dat2dat = geoid.dat2dat
-dat2dat.argtypes = [
-    ctypes.POINTER(Datum),
-    ctypes.POINTER(Datum),
-    ctypes.POINTER(Geocentric)
-]
-dat2dat.restype = Geocentric
+        Arguments:
+            points (sequence or ctypes array of Gryd.Geographic): coordinates
+                                                                  to deproject
+            out (ctypes array): optional `Gryd.Geodesic` table to fill
+        Returns:
+            `ctypes` array of `Gryd.Geodesic` coordinates
+        """
+        xya = t_array(Geographic, points)
+        n = len(xya)
+        lla = t_out(Geodesic, n, out)
+        prepared_inverse_n(self, xya, lla, n)
+        return lla
 
-npoints = geoid.npoints
-npoints.argtypes = [
-    ctypes.POINTER(Ellipsoid),
-    ctypes.POINTER(Geodesic),
-    ctypes.POINTER(Geodesic),
-    ctypes.c_int
-]
-npoints.restype = ctypes.POINTER(Vincenty_dest)
+    def forward_arrays(self, lon, lat, alt=None, out=None):
+        """
+        Project arrays of geodesic coordinates in a single foreign function
+        call. Any contiguous float64 buffer (numpy array, `array.array`...) is
+        used without copy so dataframe columns go straight to C.
 
-lagrange = geoid.lagrange
-lagrange.argtypes = [
-    ctypes.c_double,
-    ctypes.POINTER(ctypes.c_double),
-    ctypes.POINTER(ctypes.c_double),
-    ctypes.c_int
-]
-lagrange.restype = ctypes.c_double
+        ```python
+        >>> x, y, alt = prep.forward_arrays(
+        ...     numpy.radians(df.lon.values), numpy.radians(df.lat.values)
+        ... )
+        ```
 
-for name in __c_proj__:
-    forward_name = name + "_forward"
-    inverse_name = name + "_inverse"
+        Arguments:
+            lon (buffer): longitudes in radians
+            lat (buffer): latitudes in radians
+            alt (buffer): altitudes in meters (0 if not given)
+            out (tuple): optional (x, y, alt) buffers to fill
+        Returns:
+            (x, y, alt) buffers
+        """
+        n = len(lon)
+        out = out or (t_zeros(n), t_zeros(n), t_zeros(n))
+        prepared_forward_soa(
+            self, Geodesics(*t_buffers([lon, lat, alt], n)),
+            Geographics(*t_buffers(out, n, output=True)), n
+        )
+        return out
 
-    setattr(
-        getattr(proj, forward_name), "argtypes",
-        [ctypes.POINTER(Crs), ctypes.POINTER(Geodesic)]
-    )
-    setattr(getattr(proj, forward_name), "restype", Geographic)
-    setattr(sys.modules[__name__], forward_name, getattr(proj, forward_name))
+    def graticule(self, longitudes, latitudes, altitude=0., out=None):
+        """
+        Project the points of a graticule, rows of constant latitude by
+        columns of constant longitude, in a single foreign function call.
+        Latitude terms are computed once per row and, with `"tmerc"`,
+        `"merc"` and `"lcc"` projections, longitude terms once per column of
+        a `Gryd.GRATICULE_TILE` rows tile. Graticule lines, tile bounds or
+        MGRS grid lines do not pay per point trigonometry.
 
-    setattr(
-        getattr(proj, inverse_name), "argtypes",
-        [ctypes.POINTER(Crs), ctypes.POINTER(Geographic)]
-    )
-    setattr(getattr(proj, inverse_name), "restype", Geodesic)
-    setattr(sys.modules[__name__], inverse_name, getattr(proj, inverse_name))
+        ```python
+        >>> xya = prep.graticule(
+        ...     array.array("d", [math.radians(l) for l in range(-8, 3)]),
+        ...     array.array("d", [math.radians(l) for l in range(49, 61)])
+        ... )
+        >>> len(xya)
+        132
+        ```
+
+        Arguments:
+            longitudes (buffer): column longitudes in radians
+            latitudes (buffer): row latitudes in radians
+            altitude (float): altitude of all points in meters
+            out (ctypes array): optional `Gryd.Geographic` table of
+                                `len(latitudes) * len(longitudes)` items
+        Returns:
+            row major `ctypes` array of `Gryd.Geographic` coordinates
+        """
+        nlon, nlat = len(longitudes), len(latitudes)
+        xya = t_out(Geographic, nlon * nlat, out)
+        prepared_graticule(
+            self, t_buffer(longitudes), nlon, t_buffer(latitudes), nlat,
+            altitude, xya
+        )
+        return xya
+
+    def inverse_arrays(self, x, y, alt=None, out=None):
+        """
+        Deproject arrays of geographic coordinates in a single foreign
+        function call. Any contiguous float64 buffer (numpy array,
+        `array.array`...) is used without copy.
+
+        Arguments:
+            x (buffer): X-projection-axis values
+            y (buffer): Y-projection-axis values
+            alt (buffer): altitudes in meters (0 if not given)
+            out (tuple): optional (lon, lat, alt) buffers to fill
+        Returns:
+            (lon, lat, alt) buffers, longitudes and latitudes in radians
+        """
+        n = len(x)
+        out = out or (t_zeros(n), t_zeros(n), t_zeros(n))
+        prepared_inverse_soa(
+            self, Geographics(*t_buffers([x, y, alt], n)),
+            Geodesics(*t_buffers(out, n, output=True)), n
+        )
+        return out
+
+
+class Transformer(ctypes.Structure):
+    """
+    `ctypes` structure holding the source and destination prepared crs along
+    with the datum shift matrix, so that a transformation from one crs to
+    another is done without any python round trip. It is returned by
+    `Gryd.Crs.transformer` function.
+
+    ```python
+    >>> tr = osgb36.transformer(pvs)
+    >>> tr(osgb36(london))
+    <X=-14317.072 Y=6680144.273s alt=-13015.770>
+    ```
+    """
+    _fields_ = [
+        ("src",      Prepared),
+        ("dst",      Prepared),
+        ("_helmert", ctypes.c_double * 12)
+    ]
+
+    def __init__(self, src, dst, accuracy=None):
+        ctypes.Structure.__init__(self)
+        for crs in [src, dst]:
+            if crs.projection not in __c_proj__:
+                raise Exception(
+                    "projection %r can not be prepared" % crs.projection
+                )
+        transformer_init(self, src, _prepare_fn(src), dst, _prepare_fn(dst))
+        if accuracy is not None:
+            index = _accuracy_index(accuracy)
+            self.src.crs.datum.ellipsoid._accuracy = index
+            self.dst.crs.datum.ellipsoid._accuracy = index
+
+    def __reduce__(self):
+        raise TypeError("transformer can not be pickled")
+
+    def __repr__(self):
+        return "<Transformer epsg=%d to epsg=%d>" % (
+            self.src.crs.epsg, self.dst.crs.epsg
+        )
+
+    def __call__(self, xya):
+        """
+        Transform geographic coordinates, given element is left untouched.
+
+        Arguments:
+            xya (Gryd.Geographic): geographic coordinates to transform
+        Returns:
+            `Gryd.Geographic` coordinates
+        """
+        return transform_point(self, xya)
+
+    def transform_many(self, points, out=None):
+        """
+        Transform a batch of geographic coordinates in a single foreign
+        function call, spread over `Gryd.set_threads` workers.
+
+        Arguments:
+            points (sequence or ctypes array of Gryd.Geographic): coordinates
+                                                                  to transform
+            out (ctypes array): optional `Gryd.Geographic` table to fill
+        Returns:
+            `ctypes` array of `Gryd.Geographic` coordinates
+        """
+        xya = t_array(Geographic, points)
+        n = len(xya)
+        result = t_out(Geographic, n, out)
+        transform_n(self, xya, result, n)
+        return result
+
+    def transform_arrays(self, x, y, alt=None, out=None):
+        """
+        Transform arrays of geographic coordinates in a single foreign
+        function call. Any contiguous float64 buffer (numpy array,
+        `array.array`...) is used without copy.
+
+        Arguments:
+            x (buffer): X-projection-axis values
+            y (buffer): Y-projection-axis values
+            alt (buffer): altitudes in meters (0 if not given)
+            out (tuple): optional (x, y, alt) buffers to fill
+        Returns:
+            (x, y, alt) buffers
+        """
+        n = len(x)
+        out = out or (t_zeros(n), t_zeros(n), t_zeros(n))
+        transform_soa(
+            self, Geographics(*t_buffers([x, y, alt], n)),
+            Geographics(*t_buffers(out, n, output=True)), n
+        )
+        return out
+
+    def warp_map(self, dst, src=None, tolerance=0.125, out=None):
+        """
+        Inverse mapping of a raster reprojection : source pixel positions of
+        every pixel of destination raster, transformer going from
+        destination crs to source one. Transformations are exact on a mesh
+        refined until bilinear interpolation is within tolerance, destination
+        tiles being spread over `Gryd.set_threads` workers.
+
+        ```python
+        >>> tr = pvs.transformer(osgb36)
+        >>> px, py = tr.warp_map(
+        ...     Gryd.Extent(-20000, 6720000, 20, -20, 256, 256),
+        ...     Gryd.Extent(520000, 190000, 25, -25, 400, 400)
+        ... )
+        ```
+
+        With a scanned map, source crs coordinates (`src=None`) are turned
+        into pixels by `Gryd.Calibration.inverse_arrays`.
+
+        Arguments:
+            dst (Gryd.Extent): destination raster
+            src (Gryd.Extent): source raster, `None` to get source crs
+                               coordinates
+            tolerance (float): interpolation error allowed in source pixels
+                               (or source crs units), 0 for exact mapping
+            out (tuple): optional (px, py) buffers of `dst.width *
+                         dst.height` items
+        Returns:
+            (px, py) buffers, NaN where transformation fails
+        """
+        n = dst.width * dst.height
+        out = out or (t_zeros(n), t_zeros(n))
+        px, py = t_buffers(out, n, output=True)
+        warp_map(self, dst, src, tolerance, px, py)
+        return out
+
+    def warp(self, band, dst, src, method="bilinear", tolerance=0.125,
+             nodata=math.nan, out=None):
+        """
+        Reproject a raster band tile by tile, without building the whole
+        inverse mapping (see `Gryd.Transformer.warp_map`).
+
+        ```python
+        >>> tr = pvs.transformer(osgb36)
+        >>> result = tr.warp(band, dst, src, method="nearest")
+        ```
+
+        Arguments:
+            band (buffer): `src.width * src.height` float64 values, row
+                           after row
+            dst (Gryd.Extent): destination raster
+            src (Gryd.Extent): source raster
+            method (str): resampling method (see `Gryd.WARP_METHODS`)
+            tolerance (float): interpolation error allowed in source pixels
+            nodata (float): value of pixels outside source raster
+            out (buffer): optional buffer of `dst.width * dst.height` items
+        Returns:
+            destination band buffer
+        """
+        n = dst.width * dst.height
+        out = out or t_zeros(n)
+        warp_band(
+            self, dst, src, tolerance, t_buffer(band, src.width * src.height),
+            _warp_method(method), nodata, t_buffer(out, n, output=True)
+        )
+        return out
+
+    def convert(
+        self, src, dst, format="csv", columns=(0, 1), delimiter=",",
+        header=0, precision=4, fields=3, chunk=0
+    ):
+        """
+        Transform a coordinate file into another one with bounded memory :
+        chunks of `chunk` points are read (memory mapped on linux), pushed
+        through `Gryd.Transformer.transform_many` kernels and written by a
+        background thread while the next chunk is computed.
+
+        Csv lines without coordinates (the `header` first ones and empty
+        ones) and other fields are copied verbatim, quoted delimiters are
+        not supported. Binary files are records of `fields` native float64
+        values, x y [altitude] first, other values being copied verbatim.
+
+        ```python
+        >>> tr = pvs.transformer(osgb36)
+        >>> tr.convert("survey.csv", "survey_osgb36.csv", header=1)
+        1000000
+        ```
+
+        Arguments:
+            src (str): input file path
+            dst (str): output file path
+            format (str): `"csv"` or `"binary"` (see `Gryd.CONVERT_FORMATS`)
+            columns (tuple): csv x, y [and altitude] column indexes,
+                             altitude is 0 when not given
+            delimiter (str): csv field separator
+            header (int): csv lines copied verbatim first
+            precision (int): csv decimals of written coordinates
+            fields (int): binary float64 values per record
+            chunk (int): points per chunk, `Gryd.CONVERT_CHUNK` if 0
+        Returns:
+            number of points converted
+        """
+        columns = tuple(columns) + (-1,) * (3 - len(columns))
+        opt = Convert(
+            _convert_format(format), fields, delimiter.encode("ascii"),
+            columns[0], columns[1], columns[2], header, precision, chunk
+        )
+        status = convert_file(
+            self, os.fsencode(src), os.fsencode(dst), ctypes.byref(opt)
+        )
+        if status == CONVERT_EREAD:
+            raise IOError("can not read %s" % src)
+        elif status == CONVERT_EWRITE:
+            raise IOError("can not write %s" % dst)
+        elif status == CONVERT_EMEMORY:
+            raise MemoryError("can not allocate chunk of %d points" % chunk)
+        elif status == CONVERT_ESYNTAX:
+            raise ValueError(
+                "%s line %d : no valid coordinates" % (src, opt.line)
+            )
+        elif status == CONVERT_EFORMAT:
+            raise ValueError("bad options or truncated binary record")
+        return opt.points
+
+
+#: raster resampling methods
+WARP_METHODS = {"nearest": 0, "bilinear": 1}
+
+
+def _warp_method(name):
+    try:
+        return WARP_METHODS[name]
+    except KeyError:
+        raise ValueError("unknown resampling method %r" % name)
+
+
+#: coordinate file formats
+CONVERT_FORMATS = {"binary": 0, "csv": 1}
+CONVERT_CHUNK = 65536
+(CONVERT_OK, CONVERT_EREAD, CONVERT_EWRITE, CONVERT_EMEMORY, CONVERT_ESYNTAX,
+ CONVERT_EFORMAT) = range(6)
+
+
+def _convert_format(name):
+    try:
+        return CONVERT_FORMATS[name]
+    except KeyError:
+        raise ValueError("unknown file format %r" % name)
+
+
+class Convert(ctypes.Structure):
+    """
+    `ctypes` structure of `Gryd.Transformer.convert` options.
+    """
+    _fields_ = [
+        ("format", ctypes.c_int),
+        ("fields", ctypes.c_int),
+        ("delimiter", ctypes.c_char),
+        ("x", ctypes.c_int),
+        ("y", ctypes.c_int),
+        ("altitude", ctypes.c_int),
+        ("header", ctypes.c_int),
+        ("precision", ctypes.c_int),
+        ("chunk", ctypes.c_size_t),
+        ("points", ctypes.c_uint64),
+        ("line", ctypes.c_uint64)
+    ]
+
+
+class Extent(ctypes.Structure):
+    """
+    `ctypes` structure of north up raster georeferencing : pixel (column,
+    row) is located at (x0 + column * dx, y0 + row * dy) in crs units.
+
+    ```python
+    >>> # 1000 x 1000 pixels of 10 m, top left corner at (500000, 200000)
+    >>> Gryd.Extent(500000, 200000, 10, -10, 1000, 1000)
+    <Extent 1000x1000 from X=500000.000 Y=200000.000 by 10.000x-10.000>
+    ```
+    """
+    _fields_ = [
+        ("x0",     ctypes.c_double),
+        ("y0",     ctypes.c_double),
+        ("dx",     ctypes.c_double),
+        ("dy",     ctypes.c_double),
+        ("width",  ctypes.c_int),
+        ("height", ctypes.c_int)
+    ]
+
+    def __repr__(self):
+        return "<Extent %dx%d from X=%.3f Y=%.3f by %.3fx%.3f>" % (
+            self.width, self.height, self.x0, self.y0, self.dx, self.dy
+        )
+
+    def resample(self, band, px, py, method="bilinear", nodata=math.nan,
+                 out=None):
+        """
+        Sample a raster band of this extent at pixel positions in a single
+        foreign function call.
+
+        Arguments:
+            band (buffer): `width * height` float64 values, row after row
+            px (buffer): pixel column positions
+            py (buffer): pixel row positions
+            method (str): resampling method (see `Gryd.WARP_METHODS`)
+            nodata (float): value of positions outside band, nodata values
+                            are skipped by bilinear interpolation
+            out (buffer): optional buffer to fill
+        Returns:
+            values buffer
+        """
+        n = len(px)
+        out = out or t_zeros(n)
+        px, py = t_buffers([px, py], n)
+        warp_resample(
+            t_buffer(band, self.width * self.height), self, px, py, n,
+            _warp_method(method), nodata, t_buffer(out, n, output=True)
+        )
+        return out
+
+
+# Return the address of the C prepare function of a crs projection
+def _prepare_fn(crs):
+    return ctypes.cast(
+        getattr(proj, crs.projection + "_prepare"), ctypes.c_void_p
+    )
+
+
+def _Geodesic__repr(obj):
+    return "<lon=%r lat=%r alt=%.3f>" % (
+        dms(math.degrees(obj.longitude)),
+        dms(math.degrees(obj.latitude)),
+        obj.altitude
+    )
+
+
+setattr(Geodesic, "__repr__", _Geodesic__repr)
+
+
+#######################
+# loading C libraries #
+#######################
+# defining library name
+__dll_ext__ = "dll" if sys.platform.startswith("win") else \
+              "so" if sys.platform.startswith("linux") else \
+              "so"
+geoid = ctypes.CDLL(get_data_file("geoid.%s" % __dll_ext__))
+proj = ctypes.CDLL(get_data_file("proj.%s" % __dll_ext__))
+
+for lib in [geoid, proj]:
+    lib.set_threads.argtypes = [ctypes.c_int]
+    lib.set_threads.restype = None
+    lib.get_threads.argtypes = []
+    lib.get_threads.restype = ctypes.c_int
+
+
+def set_threads(n):
+    """
+    Set the number of worker threads used by batch functions (`_many` and
+    `_arrays` methods). Batches are split in contiguous chunks, small ones
+    run on the calling thread. Worker threads are started on first use and
+    kept for next batches, a batch issued while another one is running is
+    processed on its calling thread. Foreign function calls release the GIL
+    so that other python threads keep running meanwhile.
+
+    Arguments:
+        n (int): number of threads, 0 or less to use all available cores
+    """
+    geoid.set_threads(n)
+    proj.set_threads(n)
+
+
+def get_threads():
+    """
+    Return the number of worker threads used by batch functions.
+    """
+    return proj.get_threads()
+
+
+# solver statistics layout, see stats.h
+STATS_BINS = 128
+STATS_SAMPLES = 16
+
+#: instrumented iterative solvers : name -> C index
+STATS_SOLVERS = {"geodesic": 0, "distance": 1, "destination": 2, "karney": 3}
+
+
+class Stats(ctypes.Structure):
+    _fields_ = [
+        ("calls", ctypes.c_uint64),
+        ("iterations", ctypes.c_uint64),
+        ("failures", ctypes.c_uint64),
+        ("histogram", ctypes.c_uint64 * STATS_BINS),
+        ("samples", ctypes.c_int),
+        ("next", ctypes.c_int),
+        ("sample", (ctypes.c_double * 4) * STATS_SAMPLES)
+    ]
+
+    def quantile(self, q):
+        """
+        Return the iteration count under which q ratio of calls stopped.
+        """
+        limit, total = q * self.calls, 0
+        for i, count in enumerate(self.histogram):
+            total += count
+            if total >= limit and total:
+                return i
+        return 0
+
+    def inputs(self):
+        """
+        Return inputs of last non converged calls, oldest first.
+        """
+        return [
+            tuple(self.sample[(self.next - self.samples + k) % STATS_SAMPLES])
+            for k in range(self.samples)
+        ]
+
+
+for lib in [geoid, proj]:
+    lib.stats_enabled.argtypes = []
+    lib.stats_enabled.restype = ctypes.c_int
+    lib.stats_flush.argtypes = []
+    lib.stats_flush.restype = None
+    lib.stats_read.argtypes = [ctypes.c_int, ctypes.POINTER(Stats)]
+    lib.stats_read.restype = ctypes.c_int
+    lib.stats_reset.argtypes = []
+    lib.stats_reset.restype = None
+
+#: True if libraries are built with GRYD_STATS=1
+STATS_ENABLED = bool(geoid.stats_enabled())
+
+
+def stats(reset=False):
+    """
+    Return iteration statistics of iterative solvers since last reset :
+    `geodesic` (iterative geocentric to geodesic conversion), `distance`
+    and `destination` (vincenty inverse and direct problems) and `karney`
+    (inverse problem). Counters are empty unless libraries are built with
+    `GRYD_STATS=1` environment variable (see `Gryd.STATS_ENABLED`).
+
+    Calls of every thread are accounted for as soon as they return.
+
+    Arguments:
+        reset (bool): clear counters once read
+    Returns:
+        `dict` solver name -> `dict` with `calls`, `iterations` (total),
+        `failures` (calls stopped on iteration limit), `mean`, `p50`, `p99`
+        and `max` iteration counts, `histogram` (call count for each
+        iteration count) and `inputs` (radians and meters inputs of the last
+        non converged calls)
+    """
+    result = {}
+    for name, index in STATS_SOLVERS.items():
+        calls = iterations = failures = 0
+        histogram = [0] * STATS_BINS
+        inputs = []
+        # geodesic conversion is also used by fused transformers
+        for lib in [geoid, proj]:
+            data = Stats()
+            lib.stats_read(index, ctypes.byref(data))
+            calls += data.calls
+            iterations += data.iterations
+            failures += data.failures
+            histogram = [a + b for a, b in zip(histogram, data.histogram)]
+            inputs.extend(data.inputs())
+        merged = Stats(calls, iterations, failures)
+        merged.histogram[:] = histogram
+        while len(histogram) > 1 and not histogram[-1]:
+            histogram.pop()
+        result[name] = {
+            "calls": calls, "iterations": iterations, "failures": failures,
+            "mean": float(iterations) / calls if calls else 0.,
+            "p50": merged.quantile(0.5), "p99": merged.quantile(0.99),
+            "max": len(histogram) - 1 if calls else 0,
+            "histogram": histogram, "inputs": inputs[-STATS_SAMPLES:]
+        }
+    if reset:
+        reset_stats()
+    return result
+
+
+def reset_stats():
+    """
+    Clear iteration statistics of iterative solvers.
+    """
+    geoid.stats_reset()
+    proj.stats_reset()
+
+
+# EPSG snapshot layout, see snapshot.h
+SNAPSHOT_VERSION = 2
+SNAPSHOT_TEXT = 80
+
+
+class Section(ctypes.Structure):
+    _fields_ = [
+        ("count",   ctypes.c_uint64),
+        ("size",    ctypes.c_uint64),
+        ("texts",   ctypes.c_uint64),
+        ("keys",    ctypes.c_uint64),
+        ("values",  ctypes.c_uint64),
+        ("strings", ctypes.c_uint64)
+    ]
+
+
+class SnapshotHeader(ctypes.Structure):
+    _fields_ = [
+        ("magic",    ctypes.c_char * 8),
+        ("version",  ctypes.c_uint32),
+        ("source",   ctypes.c_uint32),
+        ("length",   ctypes.c_uint64),
+        ("sections", Section * 6)
+    ]
+
+
+snapshot_open = geoid.snapshot_open
+snapshot_open.argtypes = [ctypes.c_char_p]
+snapshot_open.restype = ctypes.c_void_p
+
+snapshot_close = geoid.snapshot_close
+snapshot_close.argtypes = [ctypes.c_void_p]
+snapshot_close.restype = None
+
+snapshot_header = geoid.snapshot_header
+snapshot_header.argtypes = [ctypes.c_void_p]
+snapshot_header.restype = ctypes.POINTER(SnapshotHeader)
+
+snapshot_find = geoid.snapshot_find
+snapshot_find.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_int]
+snapshot_find.restype = ctypes.c_long
+
+snapshot_search = geoid.snapshot_search
+snapshot_search.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_char_p]
+snapshot_search.restype = ctypes.c_long
+
+snapshot_key = geoid.snapshot_key
+snapshot_key.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_long]
+snapshot_key.restype = ctypes.c_int
+
+snapshot_value = geoid.snapshot_value
+snapshot_value.argtypes = [ctypes.c_void_p, ctypes.c_int, ctypes.c_long]
+snapshot_value.restype = ctypes.c_void_p
+
+snapshot_text = geoid.snapshot_text
+snapshot_text.argtypes = [
+    ctypes.c_void_p, ctypes.c_int, ctypes.c_long, ctypes.c_int
+]
+snapshot_text.restype = ctypes.c_char_p
+
+calibration_fit = geoid.calibration_fit
+calibration_fit.argtypes = [
+    ctypes.POINTER(Point), ctypes.c_int, ctypes.c_int,
+    ctypes.POINTER(Triangle), ctypes.POINTER(Calibration)
+]
+calibration_fit.restype = ctypes.c_int
+
+calibration_forward = geoid.calibration_forward
+calibration_forward.argtypes = [
+    ctypes.POINTER(Calibration), ctypes.c_double, ctypes.c_double
+]
+calibration_forward.restype = Geographic
+
+calibration_inverse = geoid.calibration_inverse
+calibration_inverse.argtypes = [
+    ctypes.POINTER(Calibration), ctypes.POINTER(Geographic),
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double)
+]
+calibration_inverse.restype = None
+
+calibration_forward_n = geoid.calibration_forward_n
+calibration_forward_n.argtypes = [
+    ctypes.POINTER(Calibration),
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double),
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double),
+    ctypes.c_size_t
+]
+calibration_forward_n.restype = None
+
+calibration_inverse_n = geoid.calibration_inverse_n
+calibration_inverse_n.argtypes = [
+    ctypes.POINTER(Calibration),
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double),
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double),
+    ctypes.c_size_t
+]
+calibration_inverse_n.restype = None
+
+calibration_raster = geoid.calibration_raster
+calibration_raster.argtypes = [
+    ctypes.POINTER(Calibration), ctypes.c_int, ctypes.c_int,
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double)
+]
+calibration_raster.restype = None
+
+dms = geoid.dms
+dms.argtypes = [ctypes.c_double]
+dms.restype = Dms
+
+dmm = geoid.dmm
+dmm.argtypes = [ctypes.c_double]
+dmm.restype = Dmm
+
+geocentric = geoid.geocentric
+geocentric.argtypes = [ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesic)]
+geocentric.restype = Geocentric
+
+geodesic = geoid.geodesic
+geodesic.argtypes = [ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geocentric)]
+geodesic.restype = Geodesic
+
+geodesic_bowring = geoid.geodesic_bowring
+geodesic_bowring.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geocentric)
+]
+geodesic_bowring.restype = Geodesic
+
+geodesic_vermeille = geoid.geodesic_vermeille
+geodesic_vermeille.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geocentric)
+]
+geodesic_vermeille.restype = Geodesic
+
+# geocentric to geodesic solvers : name -> (C batch index, function)
+SOLVERS = {
+    "iterative": (0, geodesic),
+    "bowring": (1, geodesic_bowring),
+    "vermeille": (2, geodesic_vermeille)
+}
+
+
+def _solver(name):
+    try:
+        return SOLVERS[name]
+    except KeyError:
+        raise ValueError(
+            "unknown solver %r, use one of %s" % (name, ", ".join(SOLVERS))
+        )
+
+
+geocentric_soa = geoid.geocentric_soa
+geocentric_soa.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesics),
+    ctypes.POINTER(Geocentrics), ctypes.c_size_t
+]
+geocentric_soa.restype = None
+
+geodesic_soa = geoid.geodesic_soa
+geodesic_soa.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geocentrics),
+    ctypes.POINTER(Geodesics), ctypes.c_size_t, ctypes.c_int
+]
+geodesic_soa.restype = None
+
+geocentric_n = geoid.geocentric_n
+geocentric_n.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geocentric), ctypes.c_size_t
+]
+geocentric_n.restype = None
+
+geocentric_graticule = geoid.geocentric_graticule
+geocentric_graticule.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(ctypes.c_double),
+    ctypes.c_size_t, ctypes.POINTER(ctypes.c_double), ctypes.c_size_t,
+    ctypes.c_double, ctypes.POINTER(Geocentric)
+]
+geocentric_graticule.restype = None
+
+geodesic_n = geoid.geodesic_n
+geodesic_n.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geocentric),
+    ctypes.POINTER(Geodesic), ctypes.c_size_t, ctypes.c_int
+]
+geodesic_n.restype = None
+
+distance = geoid.distance
+distance.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geodesic)
+]
+distance.restype = Vincenty_dist
+
+destination = geoid.destination
+destination.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Vincenty_dist)
+]
+destination.restype = Vincenty_dest
+
+dat2dat = geoid.dat2dat
+dat2dat.argtypes = [
+    ctypes.POINTER(Datum),
+    ctypes.POINTER(Datum),
+    ctypes.POINTER(Geocentric)
+]
+dat2dat.restype = Geocentric
+
+dat2dat_n = geoid.dat2dat_n
+dat2dat_n.argtypes = [
+    ctypes.POINTER(Datum), ctypes.POINTER(Datum),
+    ctypes.POINTER(Geocentric), ctypes.POINTER(Geocentric), ctypes.c_size_t
+]
+dat2dat_n.restype = None
+
+distance_n = geoid.distance_n
+distance_n.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geodesic), ctypes.POINTER(Vincenty_dist), ctypes.c_size_t,
+    ctypes.c_int
+]
+distance_n.restype = None
+
+distance_matrix = geoid.distance_matrix
+distance_matrix.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesic), ctypes.c_size_t,
+    ctypes.POINTER(Geodesic), ctypes.c_size_t,
+    ctypes.POINTER(Vincenty_dist), ctypes.POINTER(ctypes.c_double),
+    ctypes.c_int
+]
+distance_matrix.restype = None
+
+distance_karney = geoid.distance_karney
+distance_karney.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geodesic)
+]
+distance_karney.restype = Vincenty_dist
+
+destination_karney = geoid.destination_karney
+destination_karney.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Vincenty_dist)
+]
+destination_karney.restype = Vincenty_dest
+
+npoints = geoid.npoints
+npoints.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geodesic),
+    ctypes.c_int
+]
+npoints.restype = ctypes.POINTER(Vincenty_dest)
+
+npoints_karney = geoid.npoints_karney
+npoints_karney.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geodesic),
+    ctypes.c_int
+]
+npoints_karney.restype = ctypes.POINTER(Vincenty_dest)
+
+npoints_free = geoid.npoints_free
+npoints_free.argtypes = [ctypes.POINTER(Vincenty_dest)]
+npoints_free.restype = None
+
+npoints_into = geoid.npoints_into
+npoints_into.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geodesic),
+    ctypes.c_int,
+    ctypes.POINTER(Vincenty_dest)
+]
+npoints_into.restype = None
+
+npoints_karney_into = geoid.npoints_karney_into
+npoints_karney_into.argtypes = [
+    ctypes.POINTER(Ellipsoid),
+    ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geodesic),
+    ctypes.c_int,
+    ctypes.POINTER(Vincenty_dest)
+]
+npoints_karney_into.restype = None
+
+# geodesic problem modes :
+# name -> (C batch index, distance, destination, npoints_into)
+GEODESIC_MODES = {
+    "vincenty": (0, distance, destination, npoints_into),
+    "karney": (1, distance_karney, destination_karney, npoints_karney_into)
+}
+
+
+def _geodesic_mode(name):
+    try:
+        return GEODESIC_MODES[name]
+    except KeyError:
+        raise ValueError(
+            "unknown mode %r, use one of %s" % (
+                name, ", ".join(GEODESIC_MODES)
+            )
+        )
+
+
+for name in ["haversine", "andoyer", "flat"]:
+    func = getattr(geoid, "distance_" + name)
+    func.argtypes = [
+        ctypes.POINTER(Ellipsoid),
+        ctypes.POINTER(Geodesic),
+        ctypes.POINTER(Geodesic)
+    ]
+    func.restype = Vincenty_dist
+
+# approximate distance modes, without bearings :
+# name -> (C batch index, distance, maximum relative error, (distance,
+# latitude) domain where the error holds)
+# errors are measured against Karney distances on WGS84 :
+#  + haversine on the authalic sphere : 0.6% at any distance
+#  + Andoyer-Lambert flattening correction on reduced latitudes : 2e-6 up to
+#    5000 km, 3e-4 for nearly antipodal points
+#  + flat earth on the tangent plane at mean latitude : 4e-6 up to 10 km and
+#    4e-4 up to 100 km within 80 degrees of latitude, unbounded beyond
+APPROXIMATE_MODES = {
+    "haversine": (2, geoid.distance_haversine, 6e-3, (math.inf, math.pi/2)),
+    "andoyer": (3, geoid.distance_andoyer, 3e-4, (math.inf, math.pi/2)),
+    "flat": (4, geoid.distance_flat, 4e-4, (1e5, math.radians(80)))
+}
+
+
+# (C batch index, distance) of exact and approximate modes
+def _distance_mode(name):
+    if name in APPROXIMATE_MODES:
+        return APPROXIMATE_MODES[name][:2]
+    try:
+        return GEODESIC_MODES[name][:2]
+    except KeyError:
+        raise ValueError(
+            "unknown mode %r, use one of %s" % (
+                name, ", ".join(list(GEODESIC_MODES) + list(APPROXIMATE_MODES))
+            )
+        )
+
+track_length = geoid.track_length
+track_length.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Track),
+    ctypes.POINTER(Geodesic), ctypes.c_size_t, ctypes.c_int,
+    ctypes.POINTER(ctypes.c_double)
+]
+track_length.restype = ctypes.c_double
+
+track_resample = geoid.track_resample
+track_resample.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Track),
+    ctypes.POINTER(Geodesic), ctypes.c_size_t, ctypes.c_double,
+    ctypes.c_int, ctypes.POINTER(Geodesic), ctypes.c_size_t,
+    ctypes.POINTER(ctypes.c_size_t)
+]
+track_resample.restype = ctypes.c_size_t
+
+track_simplify = geoid.track_simplify
+track_simplify.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesic), ctypes.c_size_t,
+    ctypes.c_double, ctypes.POINTER(ctypes.c_ubyte)
+]
+track_simplify.restype = ctypes.c_size_t
+
+
+lagrange = geoid.lagrange
+lagrange.argtypes = [
+    ctypes.c_double,
+    ctypes.POINTER(ctypes.c_double),
+    ctypes.POINTER(ctypes.c_double),
+    ctypes.c_int
+]
+lagrange.restype = ctypes.c_double
+
+geohash_encode = geoid.geohash_encode
+geohash_encode.argtypes = [ctypes.c_double, ctypes.c_double, ctypes.c_int]
+geohash_encode.restype = ctypes.c_uint64
+
+geohash_decode = geoid.geohash_decode
+geohash_decode.argtypes = [
+    ctypes.c_uint64, ctypes.c_int,
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double)
+]
+geohash_decode.restype = None
+
+geohash_split = geoid.geohash_split
+geohash_split.argtypes = [
+    ctypes.c_uint64, ctypes.c_int,
+    ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_uint64)
+]
+geohash_split.restype = None
+
+geohash_join = geoid.geohash_join
+geohash_join.argtypes = [
+    ctypes.c_uint64, ctypes.c_int, ctypes.c_uint64, ctypes.c_int
+]
+geohash_join.restype = ctypes.c_uint64
+
+geohash_str = geoid.geohash_str
+geohash_str.argtypes = [
+    ctypes.c_uint64, ctypes.c_int, ctypes.c_char_p, ctypes.c_char_p
+]
+geohash_str.restype = ctypes.c_int
+
+geohash_int = geoid.geohash_int
+geohash_int.argtypes = [
+    ctypes.c_char_p, ctypes.c_int, ctypes.c_char_p,
+    ctypes.POINTER(ctypes.c_uint64)
+]
+geohash_int.restype = ctypes.c_int
+
+geohash_n = geoid.geohash_n
+geohash_n.argtypes = [
+    ctypes.POINTER(Geodesic), ctypes.POINTER(ctypes.c_uint64),
+    ctypes.c_size_t, ctypes.c_int
+]
+geohash_n.restype = None
+
+geohash_decode_n = geoid.geohash_decode_n
+geohash_decode_n.argtypes = [
+    ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(Geodesic),
+    ctypes.c_size_t, ctypes.c_int, ctypes.c_int
+]
+geohash_decode_n.restype = None
+
+geohash_str_n = geoid.geohash_str_n
+geohash_str_n.argtypes = [
+    ctypes.POINTER(ctypes.c_uint64), ctypes.c_size_t, ctypes.c_int,
+    ctypes.c_char_p, ctypes.c_char_p
+]
+geohash_str_n.restype = None
+
+geohash_neighbour = geoid.geohash_neighbour
+geohash_neighbour.argtypes = [
+    ctypes.c_uint64, ctypes.c_int, ctypes.c_int, ctypes.c_int,
+    ctypes.POINTER(ctypes.c_uint64)
+]
+geohash_neighbour.restype = ctypes.c_int
+
+geohash_neighbours = geoid.geohash_neighbours
+geohash_neighbours.argtypes = [
+    ctypes.c_uint64, ctypes.c_int, ctypes.POINTER(ctypes.c_uint64)
+]
+geohash_neighbours.restype = None
+
+geohash_cover_box = geoid.geohash_cover_box
+geohash_cover_box.argtypes = [
+    ctypes.c_double, ctypes.c_double, ctypes.c_double, ctypes.c_double,
+    ctypes.c_int, ctypes.POINTER(ctypes.c_uint64), ctypes.c_size_t
+]
+geohash_cover_box.restype = ctypes.c_size_t
+
+geohash_cover_circle = geoid.geohash_cover_circle
+geohash_cover_circle.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(Geodesic), ctypes.c_double,
+    ctypes.POINTER(ctypes.c_int), ctypes.POINTER(ctypes.c_uint64),
+    ctypes.c_size_t
+]
+geohash_cover_circle.restype = ctypes.c_size_t
+
+geohash_index = geoid.geohash_index
+geohash_index.argtypes = [
+    ctypes.POINTER(Geodesic), ctypes.c_size_t,
+    ctypes.POINTER(ctypes.c_uint64), ctypes.POINTER(ctypes.c_size_t)
+]
+geohash_index.restype = ctypes.c_int
+
+geohash_within = geoid.geohash_within
+geohash_within.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(ctypes.c_uint64),
+    ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(Geodesic),
+    ctypes.c_size_t, ctypes.POINTER(Geodesic), ctypes.c_double,
+    ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_double),
+    ctypes.c_size_t
+]
+geohash_within.restype = ctypes.c_long
+
+geohash_nearest = geoid.geohash_nearest
+geohash_nearest.argtypes = [
+    ctypes.POINTER(Ellipsoid), ctypes.POINTER(ctypes.c_uint64),
+    ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(Geodesic),
+    ctypes.c_size_t, ctypes.POINTER(Geodesic), ctypes.c_size_t,
+    ctypes.POINTER(ctypes.c_size_t), ctypes.POINTER(ctypes.c_double)
+]
+geohash_nearest.restype = ctypes.c_long
+
+prepared_forward = proj.prepared_forward
+prepared_forward.argtypes = [ctypes.POINTER(Prepared), ctypes.POINTER(Geodesic)]
+prepared_forward.restype = Geographic
+
+prepared_inverse = proj.prepared_inverse
+prepared_inverse.argtypes = [
+    ctypes.POINTER(Prepared), ctypes.POINTER(Geographic)
+]
+prepared_inverse.restype = Geodesic
+
+prepared_forward_n = proj.prepared_forward_n
+prepared_forward_n.argtypes = [
+    ctypes.POINTER(Prepared), ctypes.POINTER(Geodesic),
+    ctypes.POINTER(Geographic), ctypes.c_size_t
+]
+prepared_forward_n.restype = None
+
+prepared_inverse_n = proj.prepared_inverse_n
+prepared_inverse_n.argtypes = [
+    ctypes.POINTER(Prepared), ctypes.POINTER(Geographic),
+    ctypes.POINTER(Geodesic), ctypes.c_size_t
+]
+prepared_inverse_n.restype = None
+
+prepared_forward_soa = proj.prepared_forward_soa
+prepared_forward_soa.argtypes = [
+    ctypes.POINTER(Prepared), ctypes.POINTER(Geodesics),
+    ctypes.POINTER(Geographics), ctypes.c_size_t
+]
+prepared_forward_soa.restype = None
+
+prepared_inverse_soa = proj.prepared_inverse_soa
+prepared_inverse_soa.argtypes = [
+    ctypes.POINTER(Prepared), ctypes.POINTER(Geographics),
+    ctypes.POINTER(Geodesics), ctypes.c_size_t
+]
+prepared_inverse_soa.restype = None
+
+prepared_graticule = proj.prepared_graticule
+prepared_graticule.argtypes = [
+    ctypes.POINTER(Prepared), ctypes.POINTER(ctypes.c_double),
+    ctypes.c_size_t, ctypes.POINTER(ctypes.c_double), ctypes.c_size_t,
+    ctypes.c_double, ctypes.POINTER(Geographic)
+]
+prepared_graticule.restype = None
+
+transformer_init = proj.transformer_init
+transformer_init.argtypes = [
+    ctypes.POINTER(Transformer), ctypes.POINTER(Crs), ctypes.c_void_p,
+    ctypes.POINTER(Crs), ctypes.c_void_p
+]
+transformer_init.restype = None
+
+transform_point = proj.transform_point
+transform_point.argtypes = [
+    ctypes.POINTER(Transformer), ctypes.POINTER(Geographic)
+]
+transform_point.restype = Geographic
+
+crs_transform = proj.crs_transform
+crs_transform.argtypes = [
+    ctypes.POINTER(Crs), ctypes.c_void_p, ctypes.POINTER(Crs),
+    ctypes.c_void_p, ctypes.POINTER(Geographic)
+]
+crs_transform.restype = Geographic
+
+transform_n = proj.transform_n
+transform_n.argtypes = [
+    ctypes.POINTER(Transformer), ctypes.POINTER(Geographic),
+    ctypes.POINTER(Geographic), ctypes.c_size_t
+]
+transform_n.restype = None
+
+transform_soa = proj.transform_soa
+transform_soa.argtypes = [
+    ctypes.POINTER(Transformer), ctypes.POINTER(Geographics),
+    ctypes.POINTER(Geographics), ctypes.c_size_t
+]
+transform_soa.restype = None
+
+warp_map = proj.warp_map
+warp_map.argtypes = [
+    ctypes.POINTER(Transformer), ctypes.POINTER(Extent),
+    ctypes.POINTER(Extent), ctypes.c_double,
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double)
+]
+warp_map.restype = ctypes.c_size_t
+
+warp_resample = proj.warp_resample
+warp_resample.argtypes = [
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(Extent),
+    ctypes.POINTER(ctypes.c_double), ctypes.POINTER(ctypes.c_double),
+    ctypes.c_size_t, ctypes.c_int, ctypes.c_double,
+    ctypes.POINTER(ctypes.c_double)
+]
+warp_resample.restype = None
+
+warp_band = proj.warp_band
+warp_band.argtypes = [
+    ctypes.POINTER(Transformer), ctypes.POINTER(Extent),
+    ctypes.POINTER(Extent), ctypes.c_double,
+    ctypes.POINTER(ctypes.c_double), ctypes.c_int, ctypes.c_double,
+    ctypes.POINTER(ctypes.c_double)
+]
+warp_band.restype = None
+
+convert_file = proj.convert_file
+convert_file.argtypes = [
+    ctypes.POINTER(Transformer), ctypes.c_char_p, ctypes.c_char_p,
+    ctypes.POINTER(Convert)
+]
+convert_file.restype = ctypes.c_int
+
+# stable handle API of C and C++ programs, see gryd.h : handles are opaque
+# pointers and coordinates any table of double triples
+GRYD_ABI_VERSION = 1
+GRYD_OK = 0
+GRYD_EHANDLE = 1
+GRYD_EARGUMENT = 2
+GRYD_ACCURACY_KEEP = -1
+#: gryd_crs_new parameters order
+GRYD_PARAMETERS = [
+    "lambda0", "phi0", "phi1", "phi2", "k0", "x0", "y0", "azimut", "gamma"
+]
+
+for lib in [geoid, proj]:
+    lib.gryd_abi_version.argtypes = []
+    lib.gryd_abi_version.restype = ctypes.c_int
+    lib.gryd_ellipsoid_new.argtypes = [
+        ctypes.c_int, ctypes.c_double, ctypes.c_double, ctypes.c_int
+    ]
+    lib.gryd_ellipsoid_new.restype = ctypes.c_void_p
+    lib.gryd_ellipsoid_epsg.argtypes = [ctypes.c_void_p]
+    lib.gryd_ellipsoid_epsg.restype = ctypes.c_int
+    lib.gryd_ellipsoid_axes.argtypes = [
+        ctypes.c_void_p, ctypes.POINTER(ctypes.c_double),
+        ctypes.POINTER(ctypes.c_double)
+    ]
+    lib.gryd_ellipsoid_axes.restype = ctypes.c_int
+    lib.gryd_datum_new.argtypes = [
+        ctypes.c_void_p, ctypes.c_int, ctypes.c_double,
+        ctypes.POINTER(ctypes.c_double)
+    ]
+    lib.gryd_datum_new.restype = ctypes.c_void_p
+    lib.gryd_datum_epsg.argtypes = [ctypes.c_void_p]
+    lib.gryd_datum_epsg.restype = ctypes.c_int
+    for name in ["gryd_datum_geocentric", "gryd_datum_geodesic"]:
+        getattr(lib, name).argtypes = [
+            ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p,
+            ctypes.c_size_t
+        ]
+        getattr(lib, name).restype = ctypes.c_int
+    lib.gryd_datum_shift.argtypes = [
+        ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p,
+        ctypes.c_size_t
+    ]
+    lib.gryd_datum_shift.restype = ctypes.c_int
+    lib.gryd_crs_new.argtypes = [
+        ctypes.c_void_p, ctypes.c_int, ctypes.c_char_p, ctypes.c_double,
+        ctypes.POINTER(ctypes.c_double)
+    ]
+    lib.gryd_crs_new.restype = ctypes.c_void_p
+    lib.gryd_crs_epsg.argtypes = [ctypes.c_void_p]
+    lib.gryd_crs_epsg.restype = ctypes.c_int
+    lib.gryd_crs_projection.argtypes = [ctypes.c_void_p]
+    lib.gryd_crs_projection.restype = ctypes.c_char_p
+    for name in [
+        "gryd_ellipsoid_free", "gryd_datum_free", "gryd_crs_free"
+    ]:
+        getattr(lib, name).argtypes = [ctypes.c_void_p]
+        getattr(lib, name).restype = None
+
+gryd_abi_version = geoid.gryd_abi_version
+gryd_ellipsoid_new = geoid.gryd_ellipsoid_new
+gryd_ellipsoid_free = geoid.gryd_ellipsoid_free
+gryd_ellipsoid_epsg = geoid.gryd_ellipsoid_epsg
+gryd_ellipsoid_axes = geoid.gryd_ellipsoid_axes
+gryd_datum_new = geoid.gryd_datum_new
+gryd_datum_free = geoid.gryd_datum_free
+gryd_datum_epsg = geoid.gryd_datum_epsg
+gryd_datum_geocentric = geoid.gryd_datum_geocentric
+gryd_datum_geodesic = geoid.gryd_datum_geodesic
+gryd_datum_shift = geoid.gryd_datum_shift
+gryd_crs_new = geoid.gryd_crs_new
+gryd_crs_free = geoid.gryd_crs_free
+gryd_crs_epsg = geoid.gryd_crs_epsg
+gryd_crs_projection = geoid.gryd_crs_projection
+
+gryd_snapshot_open = geoid.gryd_snapshot_open
+gryd_snapshot_open.argtypes = [ctypes.c_char_p]
+gryd_snapshot_open.restype = ctypes.c_void_p
+
+gryd_snapshot_close = geoid.gryd_snapshot_close
+gryd_snapshot_close.argtypes = [ctypes.c_void_p]
+gryd_snapshot_close.restype = None
+
+for name in [
+    "gryd_snapshot_ellipsoid", "gryd_snapshot_datum", "gryd_snapshot_crs"
+]:
+    getattr(geoid, name).argtypes = [ctypes.c_void_p, ctypes.c_int]
+    getattr(geoid, name).restype = ctypes.c_void_p
+gryd_snapshot_ellipsoid = geoid.gryd_snapshot_ellipsoid
+gryd_snapshot_datum = geoid.gryd_snapshot_datum
+gryd_snapshot_crs = geoid.gryd_snapshot_crs
+
+for name in ["gryd_ellipsoid_distance", "gryd_ellipsoid_destination"]:
+    getattr(geoid, name).argtypes = [
+        ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p,
+        ctypes.c_size_t, ctypes.c_int
+    ]
+    getattr(geoid, name).restype = ctypes.c_int
+gryd_ellipsoid_distance = geoid.gryd_ellipsoid_distance
+gryd_ellipsoid_destination = geoid.gryd_ellipsoid_destination
+
+gryd_prepared_new = proj.gryd_prepared_new
+gryd_prepared_new.argtypes = [ctypes.c_void_p, ctypes.c_int]
+gryd_prepared_new.restype = ctypes.c_void_p
+
+gryd_transformer_new = proj.gryd_transformer_new
+gryd_transformer_new.argtypes = [
+    ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int
+]
+gryd_transformer_new.restype = ctypes.c_void_p
+
+for name in [
+    "gryd_prepared_forward", "gryd_prepared_inverse", "gryd_transformer_apply"
+]:
+    getattr(proj, name).argtypes = [
+        ctypes.c_void_p, ctypes.c_void_p, ctypes.c_void_p, ctypes.c_size_t
+    ]
+    getattr(proj, name).restype = ctypes.c_int
+gryd_prepared_forward = proj.gryd_prepared_forward
+gryd_prepared_inverse = proj.gryd_prepared_inverse
+gryd_transformer_apply = proj.gryd_transformer_apply
+
+for name in ["gryd_prepared_free", "gryd_transformer_free"]:
+    getattr(proj, name).argtypes = [ctypes.c_void_p]
+    getattr(proj, name).restype = None
+gryd_prepared_free = proj.gryd_prepared_free
+gryd_transformer_free = proj.gryd_transformer_free
+
+for name in __c_proj__:
+    forward_name = name + "_forward"
+    inverse_name = name + "_inverse"
+
+    setattr(
+        getattr(proj, name + "_prepare"), "argtypes",
+        [ctypes.POINTER(Crs), ctypes.POINTER(Prepared)]
+    )
+    setattr(getattr(proj, name + "_prepare"), "restype", None)
+
+    setattr(
+        getattr(proj, forward_name), "argtypes",
+        [ctypes.POINTER(Crs), ctypes.POINTER(Geodesic)]
+    )
+    setattr(getattr(proj, forward_name), "restype", Geographic)
+    setattr(sys.modules[__name__], forward_name, getattr(proj, forward_name))
+
+    setattr(
+        getattr(proj, inverse_name), "argtypes",
+        [ctypes.POINTER(Crs), ctypes.POINTER(Geographic)]
+    )
+    setattr(getattr(proj, inverse_name), "restype", Geodesic)
+    setattr(sys.modules[__name__], inverse_name, getattr(proj, inverse_name))
+
+    setattr(
+        getattr(proj, forward_name + "_n"), "argtypes",
+        [
+            ctypes.POINTER(Crs), ctypes.POINTER(Geodesic),
+            ctypes.POINTER(Geographic), ctypes.c_size_t
+        ]
+    )
+    setattr(getattr(proj, forward_name + "_n"), "restype", None)
+    setattr(
+        sys.modules[__name__], forward_name + "_n",
+        getattr(proj, forward_name + "_n")
+    )
+
+    setattr(
+        getattr(proj, inverse_name + "_n"), "argtypes",
+        [
+            ctypes.POINTER(Crs), ctypes.POINTER(Geographic),
+            ctypes.POINTER(Geodesic), ctypes.c_size_t
+        ]
+    )
+    setattr(getattr(proj, inverse_name + "_n"), "restype", None)
+    setattr(
+        sys.modules[__name__], inverse_name + "_n",
+        getattr(proj, inverse_name + "_n")
+    )
+
+# grid reference engines, areas are GRID_AREA null terminated chars buffers
+GRID_AREA = 8
+
+utm_zone = proj.utm_zone
+utm_zone.argtypes = [ctypes.c_double, ctypes.c_double]
+utm_zone.restype = ctypes.c_int
+
+utm_letter = proj.utm_letter
+utm_letter.argtypes = [ctypes.c_double]
+utm_letter.restype = ctypes.c_char
+
+for name in __py_proj__:
+    encode_name = name + "_encode"
+    decode_name = name + "_decode"
+
+    setattr(
+        getattr(proj, encode_name), "argtypes",
+        [
+            ctypes.POINTER(Prepared), ctypes.POINTER(Geodesic),
+            ctypes.POINTER(Geographic), ctypes.c_char_p
+        ]
+    )
+    setattr(getattr(proj, encode_name), "restype", ctypes.c_int)
+    setattr(sys.modules[__name__], encode_name, getattr(proj, encode_name))
+
+    setattr(
+        getattr(proj, decode_name), "argtypes",
+        [
+            ctypes.POINTER(Prepared), ctypes.POINTER(Geographic),
+            ctypes.c_char_p, ctypes.POINTER(Geodesic)
+        ]
+    )
+    setattr(getattr(proj, decode_name), "restype", ctypes.c_int)
+    setattr(sys.modules[__name__], decode_name, getattr(proj, decode_name))
+
+    setattr(
+        getattr(proj, encode_name + "_n"), "argtypes",
+        [
+            ctypes.POINTER(Prepared), ctypes.POINTER(Geodesic),
+            ctypes.POINTER(Geographic), ctypes.c_char_p, ctypes.c_size_t
+        ]
+    )
+    setattr(getattr(proj, encode_name + "_n"), "restype", None)
+    setattr(
+        sys.modules[__name__], encode_name + "_n",
+        getattr(proj, encode_name + "_n")
+    )
+
+    setattr(
+        getattr(proj, decode_name + "_n"), "argtypes",
+        [
+            ctypes.POINTER(Prepared), ctypes.POINTER(Geographic),
+            ctypes.c_char_p, ctypes.POINTER(Geodesic), ctypes.c_size_t
+        ]
+    )
+    setattr(getattr(proj, decode_name + "_n"), "restype", None)
+    setattr(
+        sys.modules[__name__], decode_name + "_n",
+        getattr(proj, decode_name + "_n")
+    )
+
+
+def grid_prepare(crs, engine, **kw):
+    """
+    Return a `Gryd.Prepared` copy of crs using `engine` projection (`"tmerc"`
+    or `"ktmerc"`) with `kw` parameters, as expected by grid reference
+    engines. `utm`, `bng` and `ing` modules use their `ENGINE` value,
+    `"tmerc"` by default, `"ktmerc"` keeping nanometer accuracy far from the
+    central meridian.
+    """
+    tm = copy.deepcopy(crs)
+    tm.projection = engine
+    for key, value in kw.items():
+        setattr(tm, key, value)
+    return Prepared(tm)
+
+
+def _grid_area(grid):
+    area = grid.area.encode("ascii")
+    if len(area) >= GRID_AREA:
+        raise ValueError("invalid grid area %r" % grid.area)
+    return area
+
+
+def grid_encode(encode, prep, lla):
+    """
+    Compute grid reference of geodesic coordinates with one of `utm_encode`,
+    `mgrs_encode`, `bng_encode` or `ing_encode` engine.
+    """
+    xya = Geographic()
+    area = ctypes.create_string_buffer(GRID_AREA)
+    if not encode(prep, lla, xya, area):
+        raise ValueError("%r is out of grid" % lla)
+    return Grid(
+        area=area.value.decode("ascii"),
+        easting=xya.x, northing=xya.y, altitude=xya.altitude
+    )
+
+
+def grid_decode(decode, prep, grid):
+    """
+    Compute geodesic coordinates of grid reference with one of `utm_decode`,
+    `mgrs_decode`, `bng_decode` or `ing_decode` engine.
+    """
+    lla = Geodesic()
+    xya = Geographic(grid.easting, grid.northing, grid.altitude)
+    if not decode(prep, xya, _grid_area(grid), lla):
+        raise ValueError("invalid grid area %r" % grid.area)
+    return lla
+
+
+def grid_encode_n(encode_n, prep, points):
+    """
+    Batch version of `grid_encode` using `<name>_encode_n` engine, the whole
+    batch is computed in a single foreign function call.
+    """
+    lla = t_array(Geodesic, points)
+    n = len(lla)
+    xya = (Geographic * n)()
+    area = ctypes.create_string_buffer(GRID_AREA * n)
+    encode_n(prep, lla, xya, area, n)
+    raw = area.raw
+    result = []
+    for i in range(n):
+        value = raw[i * GRID_AREA:(i + 1) * GRID_AREA].split(b"\0", 1)[0]
+        if not value:
+            raise ValueError("%r is out of grid" % lla[i])
+        p = xya[i]
+        result.append(Grid(
+            area=value.decode("ascii"),
+            easting=p.x, northing=p.y, altitude=p.altitude
+        ))
+    return result
+
+
+def grid_decode_n(decode_n, prep, grids):
+    """
+    Batch version of `grid_decode` using `<name>_decode_n` engine, the whole
+    batch is computed in a single foreign function call.
+    """
+    n = len(grids)
+    xya = (Geographic * n)(*[
+        Geographic(g.easting, g.northing, g.altitude) for g in grids
+    ])
+    area = b"".join(_grid_area(g).ljust(GRID_AREA, b"\0") for g in grids)
+    lla = (Geodesic * n)()
+    decode_n(prep, xya, area, lla, n)
+    for i in range(n):
+        if math.isnan(lla[i].longitude):
+            raise ValueError("invalid grid area %r" % grids[i].area)
+    return lla
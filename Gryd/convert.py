@@ -0,0 +1,66 @@
+# -*- encoding:utf-8 -*-
+# Streaming coordinate file conversion
+
+"""
+Command line entry of `Gryd.Transformer.convert`, reprojecting csv or binary
+coordinate files of any size between two EPSG crs:
+
+```
+$ python -m Gryd.convert 27700 3785 survey.csv survey_3785.csv --header 1
+1000000 points converted
+```
+"""
+
+import sys
+import argparse
+import Gryd
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(
+        prog="python -m Gryd.convert",
+        description="Transform coordinate files between two EPSG crs."
+    )
+    parser.add_argument("source", type=int, help="source crs EPSG code")
+    parser.add_argument("target", type=int, help="target crs EPSG code")
+    parser.add_argument("src", help="input file")
+    parser.add_argument("dst", help="output file")
+    parser.add_argument(
+        "-f", "--format", default="csv", choices=sorted(Gryd.CONVERT_FORMATS)
+    )
+    parser.add_argument(
+        "-c", "--columns", default="0,1",
+        help="csv x,y[,altitude] column indexes, altitude is optional "
+        "(default 0,1)"
+    )
+    parser.add_argument("-d", "--delimiter", default=",")
+    parser.add_argument("--header", type=int, default=0)
+    parser.add_argument("-p", "--precision", type=int, default=4)
+    parser.add_argument(
+        "--fields", type=int, default=3, help="binary float64 per record"
+    )
+    parser.add_argument("--chunk", type=int, default=0)
+    parser.add_argument("-t", "--threads", type=int, default=0)
+    parser.add_argument("-a", "--accuracy", choices=sorted(Gryd.ACCURACIES))
+    args = parser.parse_args(argv)
+
+    Gryd.set_threads(args.threads)
+    tr = Gryd.Crs(epsg=args.source).transformer(
+        Gryd.Crs(epsg=args.target), accuracy=args.accuracy
+    )
+    try:
+        count = tr.convert(
+            args.src, args.dst, format=args.format,
+            columns=[int(c) for c in args.columns.split(",")],
+            delimiter=args.delimiter, header=args.header,
+            precision=args.precision, fields=args.fields, chunk=args.chunk
+        )
+    except (IOError, ValueError, MemoryError) as error:
+        sys.stderr.write("%s\n" % error)
+        return 1
+    sys.stdout.write("%d points converted\n" % count)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
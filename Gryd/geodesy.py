@@ -143,7 +143,7 @@ class Geodesic(ctypes.Structure):
 
         ```python
         >>> Gryd.Geodesic.from_geohash('gc7x3r04z7')
-        <lon=-006°16'22.347" lat=+053°20'40.590" alt=0.000>
+        <lon=-006°16'22.357" lat=+053°20'40.585" alt=0.000>
         >>> Gryd.Geodesic.from_geohash('gc7x3r04z77csw')
         <lon=-006°16'22.357" lat=+053°20'40.582" alt=0.000>
         ```
@@ -2,7 +2,8 @@
 
 """
 Efficient geohash computing library based on bitwise operation with python
-integer.
+integer. Geohashes up to 64 bits are computed by the C library with bit
+interleaving, longer ones fall back to python bisection.
 
 ```python
 >>> from Gryd import geohash
@@ -32,6 +33,9 @@ Geohash can be encoded with a custom 32-element-sized base.
 """
 
 import math
+import ctypes
+
+import Gryd
 
 # for python 2 set builtin int as builtin long
 try:
@@ -42,6 +46,32 @@ except Exception:
 
 #: Popular Visualisation Spheroid radius (epsg #7059 ellipsoid)
 EARTH_RADIUS = 6378137.0
+#: default geohash base
+BASE32 = "0123456789bcdefghjkmnpqrstuvwxyz"
+#: longest geohash handled by the C library
+C_BITS = 64
+
+
+# return value as bytes usable by C functions or None
+def _ascii(value):
+    if isinstance(value, bytes):
+        return value
+    try:
+        return value.encode("ascii")
+    except (UnicodeError, AttributeError):
+        return None
+
+
+# return base as 32 bytes usable by C functions or None
+def _c_base(base):
+    base = _ascii(base)
+    return base if base is not None and len(base) == 32 else None
+
+
+def _geoh(value, bits):
+    value = GeoH(value)
+    value._bit_length = bits
+    return value
 
 
 class GeoH(int):
@@ -90,6 +120,9 @@ def geoh(lon, lat, bits=25):
     Returns:
         `Gryd.geohash.GeoH`
     """
+    if bits <= C_BITS:
+        return _geoh(Gryd.geohash_encode(lon, lat, bits), bits)
+
     min_lon, max_lon = -180., 180.
     min_lat, max_lat = -90., 90.
     mid_lon, mid_lat = 0., 0.
@@ -115,9 +148,7 @@ def geoh(lon, lat, bits=25):
         mask >>= 1
         odd = not odd
 
-    geoh = GeoH(geoh)
-    geoh._bit_length = bits
-    return geoh
+    return _geoh(geoh, bits)
 
 
 def lonlat(value, centered=False):
@@ -129,11 +160,20 @@ def lonlat(value, centered=False):
         centered (bool): returns bottom-left corner (if `False`) or center (if
                          `True`) of geohash surface
     Returns:
-        longitude, latitude and precision as (dlon, dlat) tuple
+        longitude, latitude and precision as (dlon, dlat) tuple, the half
+        size of the geohash surface
     """
     if not isinstance(value, GeoH):
         value = GeoH(value)
 
+    if value._bit_length <= C_BITS:
+        lonlat, size = (ctypes.c_double * 2)(), (ctypes.c_double * 2)()
+        Gryd.geohash_decode(value, value._bit_length, lonlat, size)
+        eps_lon, eps_lat = size[0] / 2., size[1] / 2.
+        if centered:
+            return lonlat[0] + eps_lon, lonlat[1] + eps_lat, (eps_lon, eps_lat)
+        return lonlat[0], lonlat[1], (eps_lon, eps_lat)
+
     eps_lon, eps_lat = 360./2., 180./2.
     min_lon, max_lon = -180., 180.
     min_lat, max_lat = -90., 90.
@@ -170,18 +210,24 @@ def lonlat(value, centered=False):
         mask >>= 1
         odd = not odd
 
+    # mid values are the center of the geohash surface
     if centered:
-        eps_lon /= 2.
-        eps_lat /= 2.
-        return mid_lon + eps_lon, mid_lat + eps_lat, (eps_lon, eps_lat)
-    else:
         return mid_lon, mid_lat, (eps_lon, eps_lat)
+    else:
+        return mid_lon - eps_lon, mid_lat - eps_lat, (eps_lon, eps_lat)
 
 
-def as_str(value, base="0123456789bcdefghjkmnpqrstuvwxyz"):
+def as_str(value, base=BASE32):
     if not isinstance(value, GeoH):
         value = GeoH(value)
 
+    c_base = _c_base(base)
+    if value._bit_length <= C_BITS and c_base is not None:
+        result = ctypes.create_string_buffer(value._bit_length // 5)
+        Gryd.geohash_str(value, value._bit_length, c_base, result)
+        return result.raw if isinstance(base, bytes) else \
+            result.raw.decode("ascii")
+
     geoh = bytearray() if isinstance(base, bytes) else []
     value = value >> (value._bit_length % 5)
     while value > 0:
@@ -192,10 +238,18 @@ def as_str(value, base="0123456789bcdefghjkmnpqrstuvwxyz"):
     return bytes(geoh) if isinstance(base, bytes) else "".join(geoh)
 
 
-def as_int(geoh, base="0123456789bcdefghjkmnpqrstuvwxyz"):
+def as_int(geoh, base=BASE32):
     if not isinstance(geoh, type(base)):
         raise TypeError("base and geohash have to be from same type")
 
+    c_base = _c_base(base)
+    c_geoh = _ascii(geoh)
+    if len(geoh) * 5 <= C_BITS and c_base is not None and c_geoh is not None:
+        value = ctypes.c_uint64()
+        if Gryd.geohash_int(c_geoh, len(geoh), c_base, value) < 0:
+            raise ValueError("%r is not a geohash in %r base" % (geoh, base))
+        return _geoh(value.value, len(geoh) * 5)
+
     first = base.index(geoh[0])
     value = 0 | first
     for c in geoh[1:]:
@@ -211,6 +265,14 @@ def split(value):
     if not isinstance(value, GeoH):
         value = GeoH(value)
 
+    if value._bit_length <= C_BITS:
+        lon, lat = ctypes.c_uint64(), ctypes.c_uint64()
+        Gryd.geohash_split(value, value._bit_length, lon, lat)
+        return (
+            _geoh(lon.value, (value._bit_length + 1) // 2),
+            _geoh(lat.value, value._bit_length // 2)
+        )
+
     lon, lon_bit_length = 0, 0
     lat, lat_bit_length = 0, 0
     odd = False
@@ -239,7 +301,14 @@ def join(lon, lat):
     if not isinstance(lon, GeoH):
         lon = GeoH(lon)
     if not isinstance(lat, GeoH):
-        lat = GeoH(lon)
+        lat = GeoH(lat)
+
+    if lon._bit_length + lat._bit_length <= C_BITS and \
+       lon._bit_length - lat._bit_length in (0, 1):
+        return _geoh(
+            Gryd.geohash_join(lon, lon._bit_length, lat, lat._bit_length),
+            lon._bit_length + lat._bit_length
+        )
 
     geoh = 0
     odd = False
@@ -256,19 +325,245 @@ def join(lon, lat):
             lat_mask >>= 1
         odd = not odd
 
-    geoh = GeoH(geoh)
-    geoh._bit_length = lon._bit_length + lat._bit_length
-    return geoh
+    return _geoh(geoh, lon._bit_length + lat._bit_length)
 
 
-def geohash(lon, lat, digit=10, base="0123456789bcdefghjkmnpqrstuvwxyz"):
+def geohash(lon, lat, digit=10, base=BASE32):
     return as_str(geoh(lon, lat, digit * 5), base)
 
 
-def geodesic(geoh, base="0123456789bcdefghjkmnpqrstuvwxyz", centered=True):
+def geodesic(geoh, base=BASE32, centered=True):
     return lonlat(as_int(geoh, base), centered=centered)
 
 
+def geoh_many(points, bits=25):
+    """
+    Geohash a batch of geodesic coordinates in a single foreign function
+    call.
+
+    Arguments:
+        points (sequence or ctypes array of Gryd.Geodesic): coordinates
+        bits (int): length of the geohashes in bit (64 max)
+    Returns:
+        `ctypes` array of `ctypes.c_uint64`
+    """
+    if bits > C_BITS:
+        raise ValueError("batch geohash is limited to %d bits" % C_BITS)
+    lla = Gryd.t_array(Gryd.Geodesic, points)
+    n = len(lla)
+    result = (ctypes.c_uint64 * n)()
+    Gryd.geohash_n(lla, result, n, bits)
+    return result
+
+
+def geohash_many(points, digit=10, base=BASE32):
+    """
+    Convert a batch of geodesic coordinates to geohash strings.
+
+    Arguments:
+        points (sequence or ctypes array of Gryd.Geodesic): coordinates
+        digit (int): total digit to use in the geohashes (12 max)
+        base (str or bytes): 32-element-sized base
+    Returns:
+        `list` of geohashes (`bytes` if base is `bytes`)
+    """
+    c_base = _c_base(base)
+    if c_base is None:
+        raise ValueError("base has to be 32 ascii characters or bytes")
+    values = geoh_many(points, digit * 5)
+    n = len(values)
+    result = ctypes.create_string_buffer(n * digit)
+    Gryd.geohash_str_n(values, n, digit * 5, c_base, result)
+    raw = result.raw
+    if not isinstance(base, bytes):
+        raw = raw.decode("ascii")
+    return [raw[i:i+digit] for i in range(0, n * digit, digit)]
+
+
+def lonlat_many(values, bits, centered=False):
+    """
+    Decode a batch of geohash integers of the same length.
+
+    Arguments:
+        values (sequence or ctypes array of int): geohash values
+        bits (int): length of the geohashes in bit (64 max)
+        centered (bool): returns bottom-left corner (if `False`) or center (if
+                         `True`) of geohash surfaces
+    Returns:
+        `ctypes` array of `Gryd.Geodesic` coordinates
+    """
+    if bits > C_BITS:
+        raise ValueError("batch geohash is limited to %d bits" % C_BITS)
+    values = Gryd.t_array(ctypes.c_uint64, values)
+    n = len(values)
+    result = (Gryd.Geodesic * n)()
+    Gryd.geohash_decode_n(values, result, n, bits, 1 if centered else 0)
+    return result
+
+
+def neighbours(value):
+    """
+    Return the eight neighbours of a geohash, clockwise from north. Longitude
+    wraps around the antimeridian, beyond the poles neighbours are `None`.
+
+    Arguments:
+        value (Gryd.geohash.GeoH): geohash value (64 bits max)
+    Returns:
+        `list` of `Gryd.geohash.GeoH` (N, NE, E, SE, S, SW, W, NW)
+    """
+    if not isinstance(value, GeoH):
+        value = GeoH(value)
+    result = []
+    cell = ctypes.c_uint64()
+    for dlon, dlat in [
+        (0, 1), (1, 1), (1, 0), (1, -1), (0, -1), (-1, -1), (-1, 0), (-1, 1)
+    ]:
+        if Gryd.geohash_neighbour(
+            value, value._bit_length, dlon, dlat, cell
+        ):
+            result.append(_geoh(cell.value, value._bit_length))
+        else:
+            result.append(None)
+    return result
+
+
+def _cells(count, fill, bits):
+    cells = (ctypes.c_uint64 * count)()
+    n = fill(cells, count)
+    if n > count:
+        cells = (ctypes.c_uint64 * n)()
+        fill(cells, n)
+    return [_geoh(cells[i], bits) for i in range(n)]
+
+
+def cover_box(lon_min, lat_min, lon_max, lat_max, bits=25):
+    """
+    Return geohashes covering a bounding box. If `lon_min` is greater than
+    `lon_max`, box crosses the antimeridian.
+
+    Arguments:
+        lon_min (float): west longitude
+        lat_min (float): south latitude
+        lon_max (float): east longitude
+        lat_max (float): north latitude
+        bits (int): length of the geohashes in bit (64 max)
+    Returns:
+        `list` of `Gryd.geohash.GeoH`
+    """
+    return _cells(16, lambda cells, n: Gryd.geohash_cover_box(
+        lon_min, lat_min, lon_max, lat_max, bits, cells, n
+    ), bits)
+
+
+def cover(lon, lat, radius, bits=None, ellps=None):
+    """
+    Return geohashes covering a circle on the ellipsoid. Cells having no point
+    within radius are dropped.
+
+    Arguments:
+        lon (float): center longitude
+        lat (float): center latitude
+        radius (float): circle radius in meters
+        bits (int): length of the geohashes in bit, if `None` the longest
+                    one giving at most 16 cells
+        ellps (Gryd.Ellipsoid): ellipsoid used for distances (WGS 84 if
+                                `None`)
+    Returns:
+        `list` of `Gryd.geohash.GeoH`
+    """
+    ellps = _ellipsoid(ellps)
+    center = Gryd.Geodesic(lon, lat)
+    length = ctypes.c_int(bits or 0)
+    cells = _cells(16, lambda cells, n: Gryd.geohash_cover_circle(
+        ellps, center, radius, length, cells, n
+    ), 0)
+    for cell in cells:
+        cell._bit_length = length.value
+    return cells
+
+
+def _ellipsoid(ellps):
+    return Gryd.Ellipsoid(epsg=7030) if ellps is None else ellps
+
+
+class Index(object):
+    """
+    Sorted geohash index of geodesic coordinates answering proximity queries
+    by range scans over the geohashes covering the search circle.
+
+    ```python
+    >>> dublin = Gryd.Geodesic(-6.272877, 53.344606)
+    >>> london = Gryd.Geodesic(-0.1275, 51.507222)
+    >>> paris = Gryd.Geodesic(2.3508, 48.8567)
+    >>> index = geohash.Index([dublin, london, paris])
+    >>> index.within(Gryd.Geodesic(-3., 52.), 400000.)
+    [(1, 205780.98429074962), (0, 267171.4340770951)]
+    >>> index.nearest(Gryd.Geodesic(1., 50.), 2)
+    [(2, 160526.36064827928), (1, 185584.12317504545)]
+    ```
+
+    Arguments:
+        points (sequence or ctypes array of Gryd.Geodesic): coordinates
+        ellps (Gryd.Ellipsoid): ellipsoid used for distances (WGS 84 if
+                                `None`)
+    """
+
+    def __init__(self, points, ellps=None):
+        self.ellps = _ellipsoid(ellps)
+        self.points = Gryd.t_array(Gryd.Geodesic, points)
+        n = len(self.points)
+        self.keys = (ctypes.c_uint64 * n)()
+        self.order = (ctypes.c_size_t * n)()
+        if Gryd.geohash_index(self.points, n, self.keys, self.order) < 0:
+            raise MemoryError("not enough memory to sort the index")
+
+    def __len__(self):
+        return len(self.points)
+
+    def within(self, center, radius):
+        """
+        Return points within radius from center.
+
+        Arguments:
+            center (Gryd.Geodesic): search center
+            radius (float): search radius in meters
+        Returns:
+            `list` of (point index, distance) sorted by distance
+        """
+        n, size = 64, 0
+        while n > size:
+            size = n
+            result = (ctypes.c_size_t * size)()
+            dist = (ctypes.c_double * size)()
+            n = Gryd.geohash_within(
+                self.ellps, self.keys, self.order, self.points,
+                len(self.points), center, radius, result, dist, size
+            )
+        return sorted(
+            [(result[i], dist[i]) for i in range(n)], key=lambda e: e[1]
+        )
+
+    def nearest(self, center, k=1):
+        """
+        Return the k nearest points from center.
+
+        Arguments:
+            center (Gryd.Geodesic): search center
+            k (int): number of points
+        Returns:
+            `list` of (point index, distance) sorted by distance
+        """
+        result = (ctypes.c_size_t * k)()
+        dist = (ctypes.c_double * k)()
+        n = Gryd.geohash_nearest(
+            self.ellps, self.keys, self.order, self.points, len(self.points),
+            center, k, result, dist
+        )
+        if n < 0:
+            raise MemoryError("not enough memory to rank neighbours")
+        return [(result[i], dist[i]) for i in range(n)]
+
+
 #: backward compatibility
 to_geohash = geohash
 #: backward compatibility
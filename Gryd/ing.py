@@ -4,47 +4,33 @@
 # @http://www.gridreference.ie
 
 from . import *
-from math import radians, floor, degrees
 
-ENGINE_F = tmerc_forward
-ENGINE_I = tmerc_inverse
+ENGINE = "tmerc"
 CRS = Crs(epsg=29900)
+PREPARED = {}
 
 
-def forward(crs, lla):
-    return _grid(ENGINE_F(CRS, lla))
-
-
-def inverse(crs, grid):
-    return ENGINE_I(CRS, _inv_grid(grid))
+def prepare(crs=None):
+    """
+    Return the prepared national grid used by ING engine. Given crs is not
+    used, grid references are always computed on TM75 Irish grid.
+    """
+    if ENGINE not in PREPARED:
+        PREPARED[ENGINE] = grid_prepare(CRS, ENGINE)
+    return PREPARED[ENGINE]
 
 
-inv_grid_100 = {
-    "A": (0., 4.), "B": (1., 4.), "C": (2., 4.), "D": (3., 4.), "E": (4., 4.),
-    "F": (0., 3.), "G": (1., 3.), "H": (2., 3.), "J": (3., 3.), "K": (4., 3.),
-    "L": (0., 2.), "M": (1., 2.), "N": (2., 2.), "O": (3., 2.), "P": (4., 2.),
-    "Q": (0., 1.), "R": (1., 1.), "S": (2., 1.), "T": (3., 1.), "U": (4., 1.),
-    "V": (0., 0.), "W": (1., 0.), "X": (2., 0.), "Y": (3., 0.), "Z": (4., 0.)
-}
-
-grid_100 = dict((v, k) for (k, v) in inv_grid_100.items())
+def forward(crs, lla):
+    return grid_encode(ing_encode, prepare(crs), lla)
 
 
-def _grid(xya):
-    nb1e = floor(xya.x / 100000)
-    xya.x -= nb1e * 100000
+def inverse(crs, grid):
+    return grid_decode(ing_decode, prepare(crs), grid)
 
-    nb1n = floor(xya.y / 100000)
-    xya.y -= nb1n * 100000
 
-    return Grid(
-        area=grid_100[nb1e, nb1n],
-        easting=xya.x, northing=xya.y, altitude=xya.altitude
-    )
+def forward_many(crs, points):
+    return grid_encode_n(ing_encode_n, prepare(crs), points)
 
 
-def _inv_grid(grid):
-    e1, n1 = (e * 100000 for e in inv_grid_100[grid.area])
-    return Geographic(
-        x=e1 + grid.easting, y=n1 + grid.northing, altitude=grid.altitude
-    )
+def inverse_many(crs, grids):
+    return grid_decode_n(ing_decode_n, prepare(crs), grids)
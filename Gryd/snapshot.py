@@ -0,0 +1,100 @@
+# -*- encoding:utf-8 -*-
+# Binary snapshot of the EPSG database
+
+"""
+Generate the memory-mappable binary snapshot of EPSG database described in
+`snapshot.h`. Records are the `ctypes` structures built from the sqlite
+database, so that reading the snapshot gives the very same objects. It is
+run by `setup.py` once the libraries are built:
+
+```
+$ python -m Gryd.snapshot [sqlite_path [snapshot_path]]
+```
+"""
+
+import os
+import sys
+import ctypes
+import struct
+import Gryd
+
+TABLES = [
+    ("unit", Gryd.Unit), ("prime", Gryd.Prime),
+    ("ellipsoid", Gryd.Ellipsoid), ("datum", Gryd.Datum),
+    ("grid", Gryd.Crs), ("projection", None)
+]
+
+
+def _text(value):
+    value = ("" if value is None else str(value)).encode("utf-8")
+    if len(value) >= Gryd.SNAPSHOT_TEXT:
+        raise ValueError("%r is too long for snapshot" % value)
+    return value.ljust(Gryd.SNAPSHOT_TEXT, b"\0")
+
+
+def _align(data, n=8):
+    data.extend(b"\0" * (-len(data) % n))
+    return len(data)
+
+
+def write(path=None, snapshot=None):
+    """
+    Write the binary snapshot of sqlite database.
+
+    Arguments:
+        path (str): sqlite database (package one by default)
+        snapshot (str): output path (`path` with `.bin` extension by
+                        default)
+    Returns:
+        snapshot path
+    """
+    path = path or Gryd.get_data_file("db/epsg.sqlite")
+    snapshot = snapshot or os.path.splitext(path)[0] + ".bin"
+    registry = Gryd.Registry(path, snapshot=False)
+    header = Gryd.SnapshotHeader()
+    header.magic = b"GRYDEPSG"
+    header.version = Gryd.SNAPSHOT_VERSION
+    header.source, header.length = Gryd.sqlite_stamp(path)
+    data = bytearray(ctypes.sizeof(header))
+
+    # objects are built from sqlite database only
+    linked, Gryd.Epsg.registry = Gryd.Epsg.registry, registry
+    try:
+        for i, (table, cls) in enumerate(TABLES):
+            records = sorted(registry.records(table), key=lambda r: r["epsg"])
+            columns = registry.texts.get(table, ["name"])
+            section = header.sections[i]
+            section.count = len(records)
+            section.size = 0 if cls is None else ctypes.sizeof(cls)
+            section.texts = len(columns)
+
+            section.keys = _align(data)
+            data.extend(struct.pack(
+                "<%di" % len(records), *[r["epsg"] for r in records]
+            ))
+            section.values = _align(data)
+            strings = bytearray()
+            for record in records:
+                texts = dict(record)
+                if cls is not None:
+                    obj = cls(record["epsg"])
+                    data.extend(bytes(obj))
+                    texts.update(
+                        (key, getattr(obj, key)) for key in columns
+                        if hasattr(obj, key)
+                    )
+                for key in columns:
+                    strings.extend(_text(texts.get(key, "")))
+            section.strings = _align(data)
+            data.extend(strings)
+    finally:
+        Gryd.Epsg.registry = linked
+
+    data[:ctypes.sizeof(header)] = bytes(header)
+    with open(snapshot, "wb") as out:
+        out.write(data)
+    return snapshot
+
+
+if __name__ == "__main__":
+    print(write(*sys.argv[1:3]))
@@ -1,5 +1,7 @@
 # -*- coding:utf-8 -*-
+import os
 import sys
+import subprocess
 try:
     from setuptools import Wheel, Extension
 except ImportError:
@@ -14,6 +16,19 @@ class CTypes(Extension):
 
 class build_ctypes_ext(build_ext):
 
+    def run(self):
+        super().run()
+        # EPSG snapshot is built with the package, so once libraries are
+        # built : Gryd.snapshot imports Gryd, which loads them
+        package = os.path.abspath(
+            "." if self.inplace else self.build_lib
+        )
+        if os.path.exists(os.path.join(package, "Gryd", "db", "epsg.sqlite")):
+            subprocess.check_call(
+                [sys.executable, "-m", "Gryd.snapshot"], cwd=package,
+                env=dict(os.environ, PYTHONPATH=package)
+            )
+
     def build_extension(self, ext):
         # identify extension type
         self._ctypes = isinstance(ext, CTypes)
@@ -32,6 +47,19 @@ class build_ctypes_ext(build_ext):
         return super().get_ext_filename(ext_name)
 
 
+#: let the compiler vectorize math loops (no errno nor fp trap side effects)
+if sys.platform.startswith("win"):
+    extra_compile_args = []
+    libraries = []
+else:
+    extra_compile_args = ["-fno-math-errno", "-fno-trapping-math"]
+    #: worker threads of batch functions
+    libraries = ["pthread"]
+
+#: GRYD_STATS=1 environment variable compiles solver statistics in
+define_macros = [("GRYD_STATS", "1")] if os.environ.get("GRYD_STATS") \
+    not in (None, "", "0") else []
+
 f = open("./VERSION", "r")
 long_description = open("./README.md", "r")
 
@@ -59,22 +87,46 @@ kw = {
     "ext_modules": [
         CTypes(
             'Gryd.geoid',
-            extra_compile_args=[],
+            extra_compile_args=extra_compile_args,
+            define_macros=define_macros,
+            libraries=libraries,
             include_dirs=['src/'],
             sources=[
-                "src/geoid.c"
+                "src/geoid.c",
+                "src/karney.c",
+                "src/geohash.c",
+                "src/snapshot.c",
+                "src/calibration.c",
+                "src/track.c",
+                "src/handle.c",
+                "src/handle_geoid.c",
+                "src/stats.c",
+                "src/parallel.c"
             ]
         ),
         CTypes(
             'Gryd.proj',
-            extra_compile_args=[],
+            extra_compile_args=extra_compile_args,
+            define_macros=define_macros,
+            libraries=libraries,
             include_dirs=['src/'],
             sources=[
+                "src/parallel.c",
+                "src/stats.c",
                 "src/tmerc.c",
+                "src/ktmerc.c",
                 "src/miller.c",
                 "src/eqc.c",
                 "src/merc.c",
-                "src/lcc.c"
+                "src/lcc.c",
+                "src/omerc.c",
+                "src/grid.c",
+                "src/prepared.c",
+                "src/transform.c",
+                "src/warp.c",
+                "src/convert.c",
+                "src/handle.c",
+                "src/handle_proj.c"
             ]
         )
     ],
@@ -0,0 +1,409 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <string.h>
+#include "./calibration.h"
+#include "./parallel.h"
+
+/*
+Source :
+Bowyer A., Computing Dirichlet tessellations, The Computer Journal 24 (1981)
+Watson D. F., Computing the n-dimensional Delaunay tessellation with
+application to Voronoi polytopes, The Computer Journal 24 (1981)
+Devillers O., Pion S., Teillaud M., Walking in a triangulation (2002)
+*/
+
+// super triangle half size, normalized coordinates are within [-1, 1]
+#define SUPER 1.0e4
+
+typedef struct{
+	Calibration *calib;
+	double *a;
+	double *b;
+	double *c;
+	double *d;
+	size_t width;
+}Job;
+
+static double orient(const double *a, const double *b, const double *c){
+	return (b[0]-a[0])*(c[1]-a[1]) - (b[1]-a[1])*(c[0]-a[0]);
+}
+
+// > 0 if d is inside the circumcircle of counter clockwise a, b, c
+static double incircle(const double *a, const double *b, const double *c, const double *d){
+	double adx = a[0]-d[0], ady = a[1]-d[1];
+	double bdx = b[0]-d[0], bdy = b[1]-d[1];
+	double cdx = c[0]-d[0], cdy = c[1]-d[1];
+	return (adx*adx + ady*ady)*(bdx*cdy - cdx*bdy) + \
+		(bdx*bdx + bdy*bdy)*(cdx*ady - adx*cdy) + \
+		(cdx*cdx + cdy*cdy)*(adx*bdy - bdx*ady);
+}
+
+// center and scale so that normalized coordinates are within [-1, 1]
+static void normalize(const double *uv, int n, double *norm){
+	double min[2] = {uv[0], uv[1]}, max[2] = {uv[0], uv[1]}, range;
+	int i, j;
+
+	for (i=1; i<n; i++)
+		for (j=0; j<2; j++){
+			if (uv[2*i+j] < min[j]) min[j] = uv[2*i+j];
+			if (uv[2*i+j] > max[j]) max[j] = uv[2*i+j];
+		}
+	norm[0] = (min[0] + max[0])/2;
+	norm[1] = (min[1] + max[1])/2;
+	range = fmax(max[0] - min[0], max[1] - min[1]);
+	norm[2] = (range > 0.) ? 2.0/range : 1.0;
+}
+
+// monomials of a cubic in u and v
+static void terms(double u, double v, double *t){
+	t[0] = 1.0;
+	t[1] = u;
+	t[2] = v;
+	t[3] = u*u;
+	t[4] = u*v;
+	t[5] = v*v;
+	t[6] = u*t[3];
+	t[7] = v*t[3];
+	t[8] = u*t[5];
+	t[9] = v*t[5];
+}
+
+static int term_count(int degree){
+	return (degree+1)*(degree+2)/2;
+}
+
+// solve the normal equations of both target coordinates with gaussian
+// elimination, return 0 if system is singular
+static int least_squares(const double *uv, const double *target, int n, const double *norm, int m, double coef[2][CALIBRATION_TERMS]){
+	double a[CALIBRATION_TERMS][CALIBRATION_TERMS+2], t[CALIBRATION_TERMS], f, row[CALIBRATION_TERMS+2];
+	int i, j, k, p;
+
+	memset(a, 0, sizeof(a));
+	for (k=0; k<n; k++){
+		terms((uv[2*k]-norm[0])*norm[2], (uv[2*k+1]-norm[1])*norm[2], t);
+		for (i=0; i<m; i++){
+			for (j=0; j<m; j++) a[i][j] += t[i]*t[j];
+			a[i][m] += t[i]*target[2*k];
+			a[i][m+1] += t[i]*target[2*k+1];
+		}
+	}
+
+	for (i=0; i<m; i++){
+		p = i;
+		for (k=i+1; k<m; k++)
+			if (fabs(a[k][i]) > fabs(a[p][i])) p = k;
+		if (fabs(a[p][i]) <= 1e-12*n) return 0;
+		if (p != i){
+			memcpy(row, a[i], sizeof(row));
+			memcpy(a[i], a[p], sizeof(row));
+			memcpy(a[p], row, sizeof(row));
+		}
+		for (k=i+1; k<m; k++){
+			f = a[k][i]/a[i][i];
+			for (j=i; j<m+2; j++) a[k][j] -= f*a[i][j];
+		}
+	}
+	for (i=m-1; i>=0; i--)
+		for (j=0; j<2; j++){
+			f = a[i][m+j];
+			for (k=i+1; k<m; k++) f -= a[i][k]*coef[j][k];
+			coef[j][i] = f/a[i][i];
+		}
+	return 1;
+}
+
+// each axis scaled independently, as lagrange interpolation on 2 points
+static int axis_scaling(const double *uv, const double *target, const double *norm, double coef[2][CALIBRATION_TERMS]){
+	double u0, u1;
+	int j;
+
+	for (j=0; j<2; j++){
+		u0 = (uv[j]-norm[j])*norm[2];
+		u1 = (uv[2+j]-norm[j])*norm[2];
+		if (u0 == u1) return 0;
+		coef[j][1+j] = (target[2+j] - target[j])/(u1 - u0);
+		coef[j][0] = target[j] - coef[j][1+j]*u0;
+	}
+	return 1;
+}
+
+static void polynomial(const double *norm, double coef[2][CALIBRATION_TERMS], int m, double a, double b, double *r0, double *r1){
+	double t[CALIBRATION_TERMS];
+	int i;
+
+	terms((a-norm[0])*norm[2], (b-norm[1])*norm[2], t);
+	*r0 = *r1 = 0.;
+	for (i=m-1; i>=0; i--){
+		*r0 += coef[0][i]*t[i];
+		*r1 += coef[1][i]*t[i];
+	}
+}
+
+// Bowyer-Watson insertion of n points of uv (with room for 3 more ones) in
+// a super triangle, tri receives counter clockwise vertex indexes. Return
+// the number of triangles not sharing a super triangle vertex, -1 on memory
+// error.
+static int delaunay(double *uv, int n, int *tri){
+	int cap = 2*n + 8, count = 1, edges_count, i, j, k, l, m, a, b, shared;
+	int *edges = malloc(sizeof(int)*6*cap);
+	char *bad = malloc(cap);
+	double *q;
+
+	if (edges == NULL || bad == NULL){
+		free(edges);
+		free(bad);
+		return -1;
+	}
+	uv[2*n] = -SUPER; uv[2*n+1] = -SUPER;
+	uv[2*n+2] = SUPER; uv[2*n+3] = -SUPER;
+	uv[2*n+4] = 0.; uv[2*n+5] = SUPER;
+	tri[0] = n; tri[1] = n+1; tri[2] = n+2;
+
+	for (k=0; k<n; k++){
+		q = &uv[2*k];
+		for (i=0; i<count; i++)
+			bad[i] = incircle(&uv[2*tri[3*i]], &uv[2*tri[3*i+1]], &uv[2*tri[3*i+2]], q) > 0.;
+		// cavity boundary : edges of bad triangles not shared with another one
+		edges_count = 0;
+		for (i=0; i<count; i++){
+			if (!bad[i]) continue;
+			for (j=0; j<3; j++){
+				a = tri[3*i+j];
+				b = tri[3*i+(j+1)%3];
+				shared = 0;
+				for (m=0; m<count && !shared; m++){
+					if (m == i || !bad[m]) continue;
+					for (l=0; l<3; l++)
+						if (tri[3*m+l] == b && tri[3*m+(l+1)%3] == a) shared = 1;
+				}
+				if (!shared){
+					edges[2*edges_count] = a;
+					edges[2*edges_count+1] = b;
+					edges_count++;
+				}
+			}
+		}
+		m = 0;
+		for (i=0; i<count; i++)
+			if (!bad[i]){
+				memmove(&tri[3*m], &tri[3*i], 3*sizeof(int));
+				m++;
+			}
+		for (i=0; i<edges_count; i++, m++){
+			tri[3*m] = edges[2*i];
+			tri[3*m+1] = edges[2*i+1];
+			tri[3*m+2] = k;
+		}
+		count = m;
+	}
+
+	m = 0;
+	for (i=0; i<count; i++)
+		if (tri[3*i] < n && tri[3*i+1] < n && tri[3*i+2] < n){
+			memmove(&tri[3*m], &tri[3*i], 3*sizeof(int));
+			m++;
+		}
+	free(edges);
+	free(bad);
+	return m;
+}
+
+// coefficients of the affine function taking values v at vertices p
+static int affine(const double p[3][2], const double v[3][2], double *coef){
+	double det = orient(p[0], p[1], p[2]);
+	double dx1 = p[1][0]-p[0][0], dy1 = p[1][1]-p[0][1];
+	double dx2 = p[2][0]-p[0][0], dy2 = p[2][1]-p[0][1];
+	int j;
+
+	if (det == 0.) return 0;
+	for (j=0; j<2; j++){
+		coef[3*j+1] = ((v[1][j]-v[0][j])*dy2 - (v[2][j]-v[0][j])*dy1)/det;
+		coef[3*j+2] = ((v[2][j]-v[0][j])*dx1 - (v[1][j]-v[0][j])*dx2)/det;
+		coef[3*j] = v[0][j] - coef[3*j+1]*p[0][0] - coef[3*j+2]*p[0][1];
+	}
+	return 1;
+}
+
+static int triangulate(const double *pixel, const double *xy, int n, const double *norm, Triangle *triangles){
+	double *uv = malloc(sizeof(double)*2*(n+3));
+	int *tri = malloc(sizeof(int)*3*(2*n+8));
+	int count = -1, i, j, k, s, a, b;
+	Triangle *t;
+
+	if (uv != NULL && tri != NULL){
+		for (i=0; i<n; i++){
+			uv[2*i] = (pixel[2*i]-norm[0])*norm[2];
+			uv[2*i+1] = (pixel[2*i+1]-norm[1])*norm[2];
+		}
+		count = delaunay(uv, n, tri);
+	}
+	for (i=0; i<count; i++){
+		t = &triangles[i];
+		for (j=0; j<3; j++){
+			k = tri[3*i+j];
+			t->pixel[j][0] = pixel[2*k];
+			t->pixel[j][1] = pixel[2*k+1];
+			t->xy[j][0] = xy[2*k];
+			t->xy[j][1] = xy[2*k+1];
+			// neighbour across edge opposite to vertex j
+			a = tri[3*i+(j+1)%3];
+			b = tri[3*i+(j+2)%3];
+			t->neighbour[j] = -1;
+			for (s=0; s<count && t->neighbour[j] < 0; s++)
+				if (s != i && ((tri[3*s] == b && tri[3*s+1] == a) || \
+				               (tri[3*s+1] == b && tri[3*s+2] == a) || \
+				               (tri[3*s+2] == b && tri[3*s] == a)))
+					t->neighbour[j] = s;
+		}
+		if (!affine(t->pixel, t->xy, t->forward) || !affine(t->xy, t->pixel, t->inverse))
+			count = 0;
+	}
+	free(uv);
+	free(tri);
+	return count;
+}
+
+EXPORT int calibration_fit(Point *points, int n, int model, Triangle *triangles, Calibration *calib){
+	double *pixel, *xy;
+	int i, j, m, result = 0;
+
+	if (n < 2 || model < CALIBRATION_TRIANGLES || model > CALIBRATION_CUBIC) return 0;
+	if ((pixel = malloc(sizeof(double)*4*n)) == NULL) return 0;
+	xy = pixel + 2*n;
+	for (i=0; i<n; i++){
+		pixel[2*i] = points[i].px;
+		pixel[2*i+1] = points[i].py;
+		xy[2*i] = points[i].xya.x;
+		xy[2*i+1] = points[i].xya.y;
+		for (j=0; j<i; j++)
+			if (pixel[2*i] == pixel[2*j] && pixel[2*i+1] == pixel[2*j+1]){
+				free(pixel);
+				return 0;
+			}
+	}
+
+	memset(calib, 0, sizeof(Calibration));
+	calib->model = model;
+	calib->triangles = triangles;
+	normalize(pixel, n, calib->pixel);
+	normalize(xy, n, calib->xy);
+	if (model == CALIBRATION_TRIANGLES){
+		if (n >= 3) calib->count = triangulate(pixel, xy, n, calib->pixel, triangles);
+		result = calib->count > 0;
+	}
+	else if (model == CALIBRATION_AFFINE && n == 2){
+		result = axis_scaling(pixel, xy, calib->pixel, calib->forward) && \
+			axis_scaling(xy, pixel, calib->xy, calib->inverse);
+	}
+	else if (n >= (m = term_count(model))){
+		result = least_squares(pixel, xy, n, calib->pixel, m, calib->forward) && \
+			least_squares(xy, pixel, n, calib->xy, m, calib->inverse);
+	}
+	free(pixel);
+	return result;
+}
+
+// walk from triangle t toward q in pixel (space = 0) or geographic space,
+// stop in the triangle containing q or on the hull when q is outside
+static int locate(Calibration *calib, int space, const double *q, int t){
+	const double (*v)[2];
+	Triangle *tri;
+	double sign;
+	int i, next, step;
+
+	if (t < 0 || t >= calib->count) t = 0;
+	for (step=0; step <= 2*calib->count; step++){
+		tri = &calib->triangles[t];
+		v = (const double (*)[2])(space ? tri->xy : tri->pixel);
+		// geographic y axis usually points the other way
+		sign = (orient(v[0], v[1], v[2]) < 0.) ? -1. : 1.;
+		next = -1;
+		for (i=0; i<3 && next < 0; i++)
+			if (tri->neighbour[i] >= 0 && sign*orient(v[(i+1)%3], v[(i+2)%3], q) < 0.)
+				next = tri->neighbour[i];
+		if (next < 0) break;
+		t = next;
+	}
+	return t;
+}
+
+static void forward(Calibration *calib, double px, double py, double *x, double *y, int *hint){
+	double q[2] = {px, py};
+	Triangle *t;
+
+	if (calib->model == CALIBRATION_TRIANGLES){
+		*hint = locate(calib, 0, q, *hint);
+		t = &calib->triangles[*hint];
+		*x = t->forward[0] + t->forward[1]*px + t->forward[2]*py;
+		*y = t->forward[3] + t->forward[4]*px + t->forward[5]*py;
+	}
+	else
+		polynomial(calib->pixel, calib->forward, term_count(calib->model), px, py, x, y);
+}
+
+static void inverse(Calibration *calib, double x, double y, double *px, double *py, int *hint){
+	double q[2] = {x, y};
+	Triangle *t;
+
+	if (calib->model == CALIBRATION_TRIANGLES){
+		*hint = locate(calib, 1, q, *hint);
+		t = &calib->triangles[*hint];
+		*px = t->inverse[0] + t->inverse[1]*x + t->inverse[2]*y;
+		*py = t->inverse[3] + t->inverse[4]*x + t->inverse[5]*y;
+	}
+	else
+		polynomial(calib->xy, calib->inverse, term_count(calib->model), x, y, px, py);
+}
+
+EXPORT Geographic calibration_forward(Calibration *calib, double px, double py){
+	Geographic xya = {0., 0., 0.};
+	int hint = 0;
+	forward(calib, px, py, &xya.x, &xya.y, &hint);
+	return xya;
+}
+
+EXPORT void calibration_inverse(Calibration *calib, Geographic *xya, double *px, double *py){
+	int hint = 0;
+	inverse(calib, xya->x, xya->y, px, py, &hint);
+}
+
+static void forward_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	int hint = 0;
+	size_t i;
+	for (i=start; i<stop; i++)
+		forward(job->calib, job->a[i], job->b[i], &job->c[i], &job->d[i], &hint);
+}
+
+static void inverse_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	int hint = 0;
+	size_t i;
+	for (i=start; i<stop; i++)
+		inverse(job->calib, job->a[i], job->b[i], &job->c[i], &job->d[i], &hint);
+}
+
+// consecutive pixels are neighbours so the walk takes a few steps at most
+static void raster_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	int hint = 0;
+	size_t i;
+	for (i=start; i<stop; i++)
+		forward(job->calib, (double)(i % job->width), (double)(i / job->width), &job->c[i], &job->d[i], &hint);
+}
+
+EXPORT void calibration_forward_n(Calibration *calib, double *px, double *py, double *x, double *y, size_t n){
+	Job job = {calib, px, py, x, y, 0};
+	parallel_for(forward_task, &job, n);
+}
+
+EXPORT void calibration_inverse_n(Calibration *calib, double *x, double *y, double *px, double *py, size_t n){
+	Job job = {calib, x, y, px, py, 0};
+	parallel_for(inverse_task, &job, n);
+}
+
+EXPORT void calibration_raster(Calibration *calib, int width, int height, double *x, double *y){
+	Job job = {calib, NULL, NULL, x, y, (size_t)width};
+	if (width <= 0 || height <= 0) return;
+	parallel_for(raster_task, &job, (size_t)width*(size_t)height);
+}
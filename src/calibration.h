@@ -0,0 +1,56 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Map calibration fitted once from control points (pixel coordinates of a
+// raster image and their geographic coordinates). Polynomial models are
+// least squares fits in both directions, the triangulated model is the
+// piecewise affine mapping over the Delaunay triangulation of pixels, found
+// by walking from the last triangle used so raster scans cost O(1).
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include "./geoid.h"
+
+// models, polynomial ones are given by their degree
+#define CALIBRATION_TRIANGLES 0
+#define CALIBRATION_AFFINE 1
+#define CALIBRATION_QUADRATIC 2
+#define CALIBRATION_CUBIC 3
+// number of terms of a cubic polynomial in two variables
+#define CALIBRATION_TERMS 10
+
+typedef struct{
+    double pixel[3][2];   // vertices in pixel coordinates, counter clockwise
+    double xy[3][2];      // vertices in geographic coordinates
+    int neighbour[3];     // triangle across the edge opposite to vertex, -1 on hull
+    double forward[6];    // x = f0 + f1*px + f2*py and y = f3 + f4*px + f5*py
+    double inverse[6];    // px and py from x and y the same way
+}Triangle;
+
+typedef struct{
+    int model;
+    int count;            // number of triangles
+    double pixel[3];      // center and scale normalizing pixel coordinates
+    double xy[3];         // center and scale normalizing geographic ones
+    double forward[2][CALIBRATION_TERMS];
+    double inverse[2][CALIBRATION_TERMS];
+    Triangle *triangles;  // caller buffer of at least 2*n triangles
+}Calibration;
+
+// fit model on n points, return 0 if there are not enough points for the
+// model, if pixels are duplicated or if the system is singular. With 2
+// points, affine model scales each axis independently.
+EXPORT int calibration_fit(Point *points, int n, int model, Triangle *triangles, Calibration *calib);
+
+EXPORT Geographic calibration_forward(Calibration *calib, double px, double py);
+EXPORT void calibration_inverse(Calibration *calib, Geographic *xya, double *px, double *py);
+
+// batch functions on structures of arrays
+EXPORT void calibration_forward_n(Calibration *calib, double *px, double *py, double *x, double *y, size_t n);
+EXPORT void calibration_inverse_n(Calibration *calib, double *x, double *y, double *px, double *py, size_t n);
+// geographic coordinates of every pixel of a width x height raster, row
+// major order
+EXPORT void calibration_raster(Calibration *calib, int width, int height, double *x, double *y);
+
+#endif
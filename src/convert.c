@@ -0,0 +1,599 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <stdio.h>
+#include <string.h>
+#include "./convert.h"
+#include "./parallel.h"
+
+#if _WIN32
+	#include <windows.h>
+#else
+	#include <pthread.h>
+#endif
+
+#if __linux__
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#elif _WIN32
+	#define fseek64 _fseeki64
+	#define ftell64 _ftelli64
+#else
+	#define fseek64 fseeko
+	#define ftell64 ftello
+#endif
+
+/*
+Input is read through windows moving forward only : the whole file is mapped
+on linux and the next window is read ahead by the kernel while the current
+one is computed, other platforms read windows in a single growing buffer.
+*/
+
+typedef struct{
+	size_t size;
+#if __linux__
+	const char *data;
+#else
+	FILE *file;
+	char *buffer;
+	size_t capacity;
+	size_t offset;      // file offset of buffer[0]
+	size_t filled;
+#endif
+}Input;
+
+static int input_open(Input *in, const char *path){
+#if __linux__
+	struct stat st;
+	void *data;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) return 0;
+	if (fstat(fd, &st) != 0){
+		close(fd);
+		return 0;
+	}
+	in->size = (size_t)st.st_size;
+	in->data = NULL;
+	if (in->size > 0){
+		data = mmap(NULL, in->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (data == MAP_FAILED){
+			close(fd);
+			return 0;
+		}
+		madvise(data, in->size, MADV_SEQUENTIAL);
+		in->data = (const char *)data;
+	}
+	close(fd);
+	return 1;
+#else
+	long long length;
+
+	memset(in, 0, sizeof(Input));
+	if ((in->file = fopen(path, "rb")) == NULL) return 0;
+	if (fseek64(in->file, 0, SEEK_END) != 0 || (length = ftell64(in->file)) < 0 || fseek64(in->file, 0, SEEK_SET) != 0){
+		fclose(in->file);
+		return 0;
+	}
+	in->size = (size_t)length;
+	return 1;
+#endif
+}
+
+static void input_close(Input *in){
+#if __linux__
+	if (in->data != NULL) munmap((void *)in->data, in->size);
+#else
+	fclose(in->file);
+	free(in->buffer);
+#endif
+}
+
+// bytes [offset, offset + size) of the file, offset never moving backward
+static const char *input_view(Input *in, size_t offset, size_t size){
+#if __linux__
+	size_t page = (size_t)sysconf(_SC_PAGESIZE), next = offset + size, ahead;
+
+	if (next < in->size){
+		ahead = (size < in->size - next) ? size : in->size - next;
+		madvise((void *)(in->data + next - next % page), ahead + next % page, MADV_WILLNEED);
+	}
+	return in->data + offset;
+#else
+	size_t keep = 0, skip = offset - in->offset;
+	char *buffer;
+
+	if (skip < in->filled){
+		keep = in->filled - skip;
+		memmove(in->buffer, in->buffer + skip, keep);
+	}
+	in->offset = offset;
+	in->filled = keep;
+	if (size > in->capacity){
+		if ((buffer = realloc(in->buffer, size)) == NULL) return NULL;
+		in->buffer = buffer;
+		in->capacity = size;
+	}
+	if (keep < size){
+		if (fread(in->buffer + keep, 1, size - keep, in->file) != size - keep) return NULL;
+		in->filled = size;
+	}
+	return in->buffer;
+#endif
+}
+
+/*
+Output is double buffered : a background thread writes one buffer while the
+other is filled. If the thread can not be started, buffers are written when
+submitted.
+*/
+
+typedef struct{
+	char *data;
+	size_t capacity;
+	size_t size;
+	int full;
+}Buffer;
+
+typedef struct{
+	FILE *file;
+	Buffer buffers[2];
+	int closed;
+	int failed;
+	int threaded;
+#if _WIN32
+	CRITICAL_SECTION lock;
+	CONDITION_VARIABLE ready;
+	HANDLE thread;
+#else
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+	pthread_t thread;
+#endif
+}Writer;
+
+static void writer_lock(Writer *w){
+#if _WIN32
+	EnterCriticalSection(&w->lock);
+#else
+	pthread_mutex_lock(&w->lock);
+#endif
+}
+
+static void writer_unlock(Writer *w){
+#if _WIN32
+	LeaveCriticalSection(&w->lock);
+#else
+	pthread_mutex_unlock(&w->lock);
+#endif
+}
+
+static void writer_wait(Writer *w){
+#if _WIN32
+	SleepConditionVariableCS(&w->ready, &w->lock, INFINITE);
+#else
+	pthread_cond_wait(&w->ready, &w->lock);
+#endif
+}
+
+static void writer_signal(Writer *w){
+#if _WIN32
+	WakeAllConditionVariable(&w->ready);
+#else
+	pthread_cond_broadcast(&w->ready);
+#endif
+}
+
+// buffers are submitted alternately so they are written in the same order
+static void writer_run(Writer *w){
+	Buffer *b;
+	int k = 0, failed;
+
+	for (;;){
+		b = &w->buffers[k];
+		writer_lock(w);
+		while (!b->full && !w->closed) writer_wait(w);
+		if (!b->full){
+			writer_unlock(w);
+			return;
+		}
+		failed = w->failed;
+		writer_unlock(w);
+		if (!failed && fwrite(b->data, 1, b->size, w->file) != b->size) failed = 1;
+		writer_lock(w);
+		w->failed = failed;
+		b->full = 0;
+		writer_signal(w);
+		writer_unlock(w);
+		k ^= 1;
+	}
+}
+
+#if _WIN32
+static DWORD WINAPI writer_thread(LPVOID arg){
+	writer_run((Writer *)arg);
+	return 0;
+}
+#else
+static void *writer_thread(void *arg){
+	writer_run((Writer *)arg);
+	return NULL;
+}
+#endif
+
+static int writer_open(Writer *w, const char *path){
+	memset(w, 0, sizeof(Writer));
+	if ((w->file = fopen(path, "wb")) == NULL) return 0;
+#if _WIN32
+	InitializeCriticalSection(&w->lock);
+	InitializeConditionVariable(&w->ready);
+	w->thread = CreateThread(NULL, 0, writer_thread, w, 0, NULL);
+	w->threaded = (w->thread != NULL);
+#else
+	pthread_mutex_init(&w->lock, NULL);
+	pthread_cond_init(&w->ready, NULL);
+	w->threaded = (pthread_create(&w->thread, NULL, writer_thread, w) == 0);
+#endif
+	return 1;
+}
+
+// wait until buffer k is written and make it hold size bytes
+static int writer_acquire(Writer *w, int k, size_t size, Buffer **result){
+	Buffer *b = &w->buffers[k];
+	char *data;
+	int failed;
+
+	writer_lock(w);
+	while (b->full) writer_wait(w);
+	failed = w->failed;
+	writer_unlock(w);
+	if (failed) return CONVERT_EWRITE;
+	if (size > b->capacity){
+		if ((data = realloc(b->data, size)) == NULL) return CONVERT_EMEMORY;
+		b->data = data;
+		b->capacity = size;
+	}
+	*result = b;
+	return CONVERT_OK;
+}
+
+static void writer_submit(Writer *w, int k, size_t size){
+	Buffer *b = &w->buffers[k];
+
+	b->size = size;
+	if (!w->threaded){
+		if (!w->failed && fwrite(b->data, 1, size, w->file) != size) w->failed = 1;
+		return;
+	}
+	writer_lock(w);
+	b->full = 1;
+	writer_signal(w);
+	writer_unlock(w);
+}
+
+// write pending buffers and close file, return 0 on write error
+static int writer_close(Writer *w){
+	if (w->threaded){
+		writer_lock(w);
+		w->closed = 1;
+		writer_signal(w);
+		writer_unlock(w);
+#if _WIN32
+		WaitForSingleObject(w->thread, INFINITE);
+		CloseHandle(w->thread);
+#else
+		pthread_join(w->thread, NULL);
+#endif
+	}
+#if _WIN32
+	DeleteCriticalSection(&w->lock);
+#else
+	pthread_cond_destroy(&w->ready);
+	pthread_mutex_destroy(&w->lock);
+#endif
+	if (fclose(w->file) != 0) w->failed = 1;
+	free(w->buffers[0].data);
+	free(w->buffers[1].data);
+	return !w->failed;
+}
+
+/*
+Binary records of 3 doubles are Geographic tables transformed straight from
+input window into output buffer, other record sizes are gathered first.
+*/
+
+static int convert_binary(Transformer *tr, Input *in, Writer *w, Convert *opt){
+	size_t record = sizeof(double)*(size_t)opt->fields, count, start, m, j;
+	Geographic *src = NULL, *dst = NULL;
+	const double *r;
+	double *o;
+	const char *data;
+	Buffer *out;
+	int k = 0, status = CONVERT_OK;
+
+	if (in->size % record != 0) return CONVERT_EFORMAT;
+	count = in->size / record;
+	if (opt->fields != 3){
+		src = malloc(sizeof(Geographic)*opt->chunk);
+		dst = malloc(sizeof(Geographic)*opt->chunk);
+		if (src == NULL || dst == NULL){
+			free(src);
+			free(dst);
+			return CONVERT_EMEMORY;
+		}
+	}
+	for (start=0; start<count; start+=m){
+		m = (count - start < opt->chunk) ? count - start : opt->chunk;
+		if ((data = input_view(in, start*record, m*record)) == NULL){
+			status = CONVERT_EREAD;
+			break;
+		}
+		if ((status = writer_acquire(w, k, m*record, &out)) != CONVERT_OK) break;
+		if (opt->fields == 3){
+			transform_n(tr, (Geographic *)data, (Geographic *)out->data, m);
+		} else {
+			for (j=0; j<m; j++){
+				r = (const double *)(data + j*record);
+				src[j].x = r[0];
+				src[j].y = r[1];
+				src[j].altitude = (opt->fields > 2) ? r[2] : 0.;
+			}
+			transform_n(tr, src, dst, m);
+			memcpy(out->data, data, m*record);
+			for (j=0; j<m; j++){
+				o = (double *)(out->data + j*record);
+				o[0] = dst[j].x;
+				o[1] = dst[j].y;
+				if (opt->fields > 2) o[2] = dst[j].altitude;
+			}
+		}
+		writer_submit(w, k, m*record);
+		opt->points += m;
+		k ^= 1;
+	}
+	free(src);
+	free(dst);
+	return status;
+}
+
+/*
+Csv chunks are split in lines, parsed and formatted by parallel tasks : each
+line is formatted in its own slot of the output buffer, slots are then packed.
+*/
+
+typedef struct{
+	const char *text;
+	size_t length;       // end of line excluded
+	size_t eol;          // end of line length
+	size_t span[3][2];   // x, y and altitude fields [start, stop) in line
+	int status;          // 1 with coordinates, 0 copied verbatim, -1 invalid
+	size_t offset;       // output slot offset
+	size_t size;         // output length
+}Line;
+
+typedef struct{
+	Convert *opt;
+	Line *lines;
+	Geographic *src;
+	Geographic *dst;
+	char *out;
+	int roles;           // coordinates per line
+	int columns[3];      // x, y and altitude column indexes
+	int order[3];        // roles sorted by column
+}Csv;
+
+// lines fully contained in data, the last one may have no end of line only
+// at end of file. Return the number of lines and bytes used.
+static size_t csv_split(Csv *csv, const char *data, size_t size, int eof, uint64_t first, size_t *used){
+	const char *end;
+	Line *line;
+	size_t n = 0, pos = 0;
+
+	while (n < csv->opt->chunk && pos < size){
+		end = memchr(data + pos, '\n', size - pos);
+		if (end == NULL && !eof) break;
+		line = &csv->lines[n];
+		line->text = data + pos;
+		line->length = (end == NULL) ? size - pos : (size_t)(end - line->text);
+		line->eol = (end == NULL) ? 0 : 1;
+		if (line->length > 0 && line->text[line->length-1] == '\r'){
+			line->length--;
+			line->eol++;
+		}
+		line->status = (first + n >= (uint64_t)csv->opt->header && line->length > 0);
+		pos += line->length + line->eol;
+		n++;
+	}
+	*used = pos;
+	return n;
+}
+
+static int csv_number(const char *text, size_t size, double *value){
+	char buffer[CONVERT_FIELD], *end;
+
+	while (size > 0 && (*text == ' ' || *text == '\t')){
+		text++;
+		size--;
+	}
+	while (size > 0 && (text[size-1] == ' ' || text[size-1] == '\t')) size--;
+	if (size == 0 || size >= CONVERT_FIELD) return 0;
+	memcpy(buffer, text, size);
+	buffer[size] = '\0';
+	*value = strtod(buffer, &end);
+	return end == buffer + size;
+}
+
+// write at most CONVERT_FIELD bytes, terminating zero included
+static size_t csv_write(char *out, double value, int precision){
+	int size = snprintf(out, CONVERT_FIELD, "%.*f", precision, value);
+	if (size < 0 || size >= CONVERT_FIELD) size = snprintf(out, CONVERT_FIELD, "%.17g", value);
+	return (size_t)size;
+}
+
+static void csv_parse_task(void *ctx, size_t start, size_t stop){
+	Csv *csv = (Csv *)ctx;
+	char delimiter = csv->opt->delimiter;
+	const char *end;
+	Line *line;
+	double values[3];
+	size_t i, pos, field;
+	int r, column, found;
+
+	for (i=start; i<stop; i++){
+		line = &csv->lines[i];
+		values[0] = values[1] = values[2] = 0.;
+		if (line->status != 0){
+			found = 0;
+			column = 0;
+			pos = 0;
+			while (found < csv->roles && pos <= line->length){
+				end = memchr(line->text + pos, delimiter, line->length - pos);
+				field = (end == NULL) ? line->length : (size_t)(end - line->text);
+				for (r=0; r<csv->roles; r++){
+					if (csv->columns[r] != column) continue;
+					line->span[r][0] = pos;
+					line->span[r][1] = field;
+					if (!csv_number(line->text + pos, field - pos, &values[r])) line->status = -1;
+					found++;
+				}
+				column++;
+				pos = field + 1;
+			}
+			if (found < csv->roles) line->status = -1;
+		}
+		csv->src[i].x = values[0];
+		csv->src[i].y = values[1];
+		csv->src[i].altitude = values[2];
+	}
+}
+
+static void csv_format_task(void *ctx, size_t start, size_t stop){
+	Csv *csv = (Csv *)ctx;
+	int precision = csv->opt->precision, j, r;
+	Line *line;
+	double values[3];
+	char *out;
+	size_t i, prev;
+
+	for (i=start; i<stop; i++){
+		line = &csv->lines[i];
+		out = csv->out + line->offset;
+		prev = 0;
+		if (line->status > 0){
+			values[0] = csv->dst[i].x;
+			values[1] = csv->dst[i].y;
+			values[2] = csv->dst[i].altitude;
+			for (j=0; j<csv->roles; j++){
+				r = csv->order[j];
+				memcpy(out, line->text + prev, line->span[r][0] - prev);
+				out += line->span[r][0] - prev;
+				out += csv_write(out, values[r], precision);
+				prev = line->span[r][1];
+			}
+		}
+		memcpy(out, line->text + prev, line->length + line->eol - prev);
+		out += line->length + line->eol - prev;
+		line->size = (size_t)(out - csv->out) - line->offset;
+	}
+}
+
+static int convert_csv(Transformer *tr, Input *in, Writer *w, Convert *opt){
+	Csv csv;
+	Buffer *out;
+	const char *data;
+	size_t offset = 0, window = opt->chunk*256, size, used, n, i, total;
+	uint64_t first = 0;
+	int k = 0, r, j, status = CONVERT_OK;
+
+	csv.opt = opt;
+	csv.roles = (opt->altitude >= 0) ? 3 : 2;
+	csv.columns[0] = opt->x;
+	csv.columns[1] = opt->y;
+	csv.columns[2] = opt->altitude;
+	for (r=0; r<csv.roles; r++){
+		for (j=r; j>0 && csv.columns[csv.order[j-1]] > csv.columns[r]; j--) csv.order[j] = csv.order[j-1];
+		csv.order[j] = r;
+	}
+	csv.lines = malloc(sizeof(Line)*opt->chunk);
+	csv.src = malloc(sizeof(Geographic)*opt->chunk);
+	csv.dst = malloc(sizeof(Geographic)*opt->chunk);
+	if (csv.lines == NULL || csv.src == NULL || csv.dst == NULL) status = CONVERT_EMEMORY;
+
+	while (status == CONVERT_OK && offset < in->size){
+		size = (window < in->size - offset) ? window : in->size - offset;
+		if ((data = input_view(in, offset, size)) == NULL){
+			status = CONVERT_EREAD;
+			break;
+		}
+		n = csv_split(&csv, data, size, offset + size == in->size, first, &used);
+		// a line longer than the window
+		if (n == 0){
+			window *= 2;
+			continue;
+		}
+		for (i=0, total=0; i<n; i++){
+			csv.lines[i].offset = total;
+			total += csv.lines[i].length + csv.lines[i].eol + 3*CONVERT_FIELD;
+		}
+		if ((status = writer_acquire(w, k, total, &out)) != CONVERT_OK) break;
+		csv.out = out->data;
+
+		parallel_for(csv_parse_task, &csv, n);
+		for (i=0; i<n; i++){
+			if (csv.lines[i].status >= 0) continue;
+			opt->line = first + i + 1;
+			status = CONVERT_ESYNTAX;
+			break;
+		}
+		if (status != CONVERT_OK) break;
+		transform_n(tr, csv.src, csv.dst, n);
+		parallel_for(csv_format_task, &csv, n);
+
+		for (i=0, total=0; i<n; i++){
+			memmove(out->data + total, out->data + csv.lines[i].offset, csv.lines[i].size);
+			total += csv.lines[i].size;
+			opt->points += (csv.lines[i].status > 0);
+		}
+		writer_submit(w, k, total);
+		k ^= 1;
+		offset += used;
+		first += n;
+	}
+	free(csv.lines);
+	free(csv.src);
+	free(csv.dst);
+	return status;
+}
+
+static int convert_check(Convert *opt){
+	if (opt->format == CONVERT_BINARY) return opt->fields >= 2;
+	if (opt->format != CONVERT_CSV) return 0;
+	if (opt->x < 0 || opt->y < 0 || opt->x == opt->y) return 0;
+	if (opt->altitude >= 0 && (opt->altitude == opt->x || opt->altitude == opt->y)) return 0;
+	return opt->delimiter != '\n' && opt->delimiter != '\r' && opt->precision >= 0 && opt->precision <= 20;
+}
+
+EXPORT int convert_file(Transformer *tr, const char *src, const char *dst, Convert *opt){
+	Input in;
+	Writer w;
+	int status;
+
+	opt->points = 0;
+	opt->line = 0;
+	if (opt->chunk == 0) opt->chunk = CONVERT_CHUNK;
+	if (!convert_check(opt)) return CONVERT_EFORMAT;
+	if (!input_open(&in, src)) return CONVERT_EREAD;
+	if (!writer_open(&w, dst)){
+		input_close(&in);
+		return CONVERT_EWRITE;
+	}
+	if (opt->format == CONVERT_CSV)
+		status = convert_csv(tr, &in, &w, opt);
+	else
+		status = convert_binary(tr, &in, &w, opt);
+	if (!writer_close(&w) && status == CONVERT_OK) status = CONVERT_EWRITE;
+	input_close(&in);
+
+	return status;
+}
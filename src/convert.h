@@ -0,0 +1,50 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Streaming conversion of coordinate files through a Transformer. Input is
+// read by fixed size chunks (memory mapped on linux), each chunk is pushed
+// through transform_n kernels and written by a background thread while the
+// next one is computed, so memory use does not depend on file size.
+
+#ifndef CONVERT_H
+#define CONVERT_H
+
+#include <stdint.h>
+#include "./geoid.h"
+
+// file formats
+#define CONVERT_BINARY 0   // records of native doubles, x y [altitude] first
+#define CONVERT_CSV 1      // delimited text lines, no quoted delimiters
+
+// default number of points per chunk
+#define CONVERT_CHUNK 65536
+// longest csv coordinate field read or written
+#define CONVERT_FIELD 64
+
+// convert_file return codes
+#define CONVERT_OK 0
+#define CONVERT_EREAD 1      // input file can not be opened or read
+#define CONVERT_EWRITE 2     // output file can not be created or written
+#define CONVERT_EMEMORY 3
+#define CONVERT_ESYNTAX 4    // csv line Convert.line has no valid coordinates
+#define CONVERT_EFORMAT 5    // bad options or truncated binary record
+
+typedef struct{
+    int format;          // CONVERT_BINARY or CONVERT_CSV
+    int fields;          // binary : doubles per record, 2 or more
+    char delimiter;      // csv : field separator
+    int x;               // csv : column indexes, altitude < 0 if none
+    int y;
+    int altitude;
+    int header;          // csv : lines copied verbatim first
+    int precision;       // csv : decimals of written coordinates
+    size_t chunk;        // points per chunk, CONVERT_CHUNK if 0
+    uint64_t points;     // set by convert_file : points converted
+    uint64_t line;       // set by convert_file : line number of the error
+}Convert;
+
+// convert src file into dst one, csv lines without coordinates (header, empty
+// lines) and other fields or record values are copied verbatim
+EXPORT int convert_file(Transformer *tr, const char *src, const char *dst, Convert *opt);
+
+#endif
@@ -2,22 +2,47 @@
 // All rights reserved.
 #include "./geoid.h"
 
-EXPORT Geographic eqc_forward(Crs *crs, Geodesic *lla){
+EXPORT Geographic eqc_forward_p(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic eqc_inverse_p(Prepared *prep, Geographic *xya);
+EXPORT void eqc_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void eqc_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void eqc_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void eqc_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+
+// coef[0] : a*cos(phi1)
+EXPORT void eqc_prepare(Crs *crs, Prepared *prep){
+	prep->crs = *crs;
+	prep->forward = eqc_forward_p;
+	prep->inverse = eqc_inverse_p;
+	prep->forward_n = eqc_forward_pn;
+	prep->inverse_n = eqc_inverse_pn;
+	prep->forward_soa = eqc_forward_psoa;
+	prep->inverse_soa = eqc_inverse_psoa;
+	prep->graticule = NULL;
+	prep->coef[0] = cos(crs->phi1)*crs->datum.ellipsoid.a;
+}
+
+EXPORT Geographic eqc_forward_p(Prepared *prep, Geodesic *lla){
 	Geographic xya;
+	Crs *crs = &prep->crs;
 
-	xya.x = cos(crs->phi1)*(lla->longitude - crs->lambda0)*crs->datum.ellipsoid.a + crs->x0;
+	xya.x = prep->coef[0]*(lla->longitude - crs->lambda0) + crs->x0;
 	xya.y = (lla->latitude - crs->phi0)*crs->datum.ellipsoid.a + crs->y0;
 	xya.altitude = lla->altitude;
 
 	return xya;
 }
 
-EXPORT Geodesic eqc_inverse(Crs *crs, Geographic *xya){
+EXPORT Geodesic eqc_inverse_p(Prepared *prep, Geographic *xya){
 	Geodesic lla;
+	Crs *crs = &prep->crs;
 
-	lla.longitude = (xya->x - crs->x0)/(cos(crs->phi1)*crs->datum.ellipsoid.a) + crs->lambda0;
+	lla.longitude = (xya->x - crs->x0)/prep->coef[0] + crs->lambda0;
 	lla.latitude = (xya->y - crs->y0)/crs->datum.ellipsoid.a + crs->phi0;
 	lla.altitude = xya->altitude;
 
 	return lla;
 }
+
+PREPARED_BATCH(eqc)
+PREPARED_PROJECTION(eqc)
@@ -0,0 +1,448 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include "./geohash.h"
+#include "./karney.h"
+#include "./parallel.h"
+#include <string.h>
+
+/*
+Bit interleaving : a coordinate quantized on n bits is spread on the even bits
+of a 64 bits word (and squashed back). With BMI2, PDEP and PEXT do it in one
+instruction, otherwise the classic magic numbers sequence is used. The BMI2
+version is picked at run time according to the CPU.
+*/
+#if defined(__GNUC__) && defined(__x86_64__)
+    #include <immintrin.h>
+    #define HAS_BMI2 __builtin_cpu_supports("bmi2")
+    #define TARGET_BMI2 __attribute__((target("bmi2")))
+#else
+    #define HAS_BMI2 0
+#endif
+
+static const uint64_t EVEN_BITS = 0x5555555555555555ULL;
+
+static inline uint64_t spread(uint64_t x){
+	x &= 0xFFFFFFFFULL;
+	x = (x | (x << 16)) & 0x0000FFFF0000FFFFULL;
+	x = (x | (x << 8)) & 0x00FF00FF00FF00FFULL;
+	x = (x | (x << 4)) & 0x0F0F0F0F0F0F0F0FULL;
+	x = (x | (x << 2)) & 0x3333333333333333ULL;
+	x = (x | (x << 1)) & EVEN_BITS;
+	return x;
+}
+
+static inline uint64_t squash(uint64_t x){
+	x &= EVEN_BITS;
+	x = (x | (x >> 1)) & 0x3333333333333333ULL;
+	x = (x | (x >> 2)) & 0x0F0F0F0F0F0F0F0FULL;
+	x = (x | (x >> 4)) & 0x00FF00FF00FF00FFULL;
+	x = (x | (x >> 8)) & 0x0000FFFF0000FFFFULL;
+	x = (x | (x >> 16)) & 0xFFFFFFFFULL;
+	return x;
+}
+
+#ifdef TARGET_BMI2
+TARGET_BMI2 static uint64_t interleave_bmi2(uint64_t even, uint64_t odd){
+	return _pdep_u64(even, EVEN_BITS) | _pdep_u64(odd, ~EVEN_BITS);
+}
+
+TARGET_BMI2 static void deinterleave_bmi2(uint64_t value, uint64_t *even, uint64_t *odd){
+	*even = _pext_u64(value, EVEN_BITS);
+	*odd = _pext_u64(value, ~EVEN_BITS);
+}
+#endif
+
+static uint64_t interleave(uint64_t even, uint64_t odd){
+#ifdef TARGET_BMI2
+	if (HAS_BMI2) return interleave_bmi2(even, odd);
+#endif
+	return spread(even) | (spread(odd) << 1);
+}
+
+static void deinterleave(uint64_t value, uint64_t *even, uint64_t *odd){
+#ifdef TARGET_BMI2
+	if (HAS_BMI2) {deinterleave_bmi2(value, even, odd); return;}
+#endif
+	*even = squash(value);
+	*odd = squash(value >> 1);
+}
+
+static uint64_t mask(int bits){
+	return (bits >= 64) ? ~0ULL : ((1ULL << bits) - 1);
+}
+
+// cell index of value in [start, start + span[ divided in 2^bits cells
+static uint64_t quantize(double value, double start, double span, int bits){
+	double cells = ldexp(1., bits), i = floor((value - start) / span * cells);
+	if (i < 0) return 0;
+	if (i >= cells) return mask(bits);
+	return (uint64_t)i;
+}
+
+// longitude takes the most significant bit, ie the even bits when the
+// geohash length is odd and the odd bits otherwise
+EXPORT uint64_t geohash_encode(double longitude, double latitude, int bits){
+	uint64_t lon, lat;
+	lon = quantize(longitude, -180., 360., (bits + 1)/2);
+	lat = quantize(latitude, -90., 180., bits/2);
+	return (bits % 2) ? interleave(lon, lat) : interleave(lat, lon);
+}
+
+EXPORT void geohash_split(uint64_t value, int bits, uint64_t *lon, uint64_t *lat){
+	value &= mask(bits);
+	if (bits % 2) deinterleave(value, lon, lat);
+	else deinterleave(value, lat, lon);
+}
+
+// lon_bits - lat_bits has to be 0 or 1
+EXPORT uint64_t geohash_join(uint64_t lon, int lon_bits, uint64_t lat, int lat_bits){
+	lon &= mask(lon_bits);
+	lat &= mask(lat_bits);
+	return (lon_bits > lat_bits) ? interleave(lon, lat) : interleave(lat, lon);
+}
+
+// lonlat : south west corner of the cell, size : cell width and height
+EXPORT void geohash_decode(uint64_t value, int bits, double *lonlat, double *size){
+	uint64_t lon, lat;
+	geohash_split(value, bits, &lon, &lat);
+	size[0] = ldexp(360., -(bits + 1)/2);
+	size[1] = ldexp(180., -bits/2);
+	lonlat[0] = -180. + lon*size[0];
+	lonlat[1] = -90. + lat*size[1];
+}
+
+// return the number of characters written (not null terminated)
+EXPORT int geohash_str(uint64_t value, int bits, const char *base, char *result){
+	int i, digits = bits/5;
+	value >>= bits % 5;
+	for (i=digits-1; i>=0; i--){
+		result[i] = base[value & 0x1F];
+		value >>= 5;
+	}
+	return digits;
+}
+
+// return the geohash length in bits, -1 if a character is not in base
+EXPORT int geohash_int(const char *str, int length, const char *base, uint64_t *value){
+	int i, index[256];
+
+	if (length*5 > GEOHASH_BITS) return -1;
+	for (i=0; i<256; i++) index[i] = -1;
+	for (i=0; i<32; i++) index[(unsigned char)base[i]] = i;
+	*value = 0;
+	for (i=0; i<length; i++){
+		if (index[(unsigned char)str[i]] < 0) return -1;
+		*value = (*value << 5) | (uint64_t)index[(unsigned char)str[i]];
+	}
+	return length*5;
+}
+
+typedef struct{
+	void *src;
+	void *dst;
+	const char *base;
+	int bits;
+	int centered;
+}Job;
+
+static void geohash_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geodesic *lla = (Geodesic *)job->src;
+	uint64_t *result = (uint64_t *)job->dst;
+	size_t i;
+	for (i=start; i<stop; i++)
+		result[i] = geohash_encode(lla[i].longitude*RADIAN2DEG, lla[i].latitude*RADIAN2DEG, job->bits);
+}
+
+static void geohash_decode_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	uint64_t *values = (uint64_t *)job->src;
+	Geodesic *lla = (Geodesic *)job->dst;
+	double lonlat[2], size[2], shift = job->centered ? 0.5 : 0.;
+	size_t i;
+	for (i=start; i<stop; i++){
+		geohash_decode(values[i], job->bits, lonlat, size);
+		lla[i].longitude = (lonlat[0] + shift*size[0])*DEGREE2RAD;
+		lla[i].latitude = (lonlat[1] + shift*size[1])*DEGREE2RAD;
+		lla[i].altitude = 0.;
+	}
+}
+
+static void geohash_str_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	uint64_t *values = (uint64_t *)job->src;
+	char *result = (char *)job->dst;
+	int digits = job->bits/5;
+	size_t i;
+	for (i=start; i<stop; i++) geohash_str(values[i], job->bits, job->base, result + i*digits);
+}
+
+EXPORT void geohash_n(Geodesic *lla, uint64_t *result, size_t n, int bits){
+	Job job = {lla, result, NULL, bits, 0};
+	parallel_for(geohash_n_task, &job, n);
+}
+
+// centered : cell center if not null, south west corner otherwise
+EXPORT void geohash_decode_n(uint64_t *values, Geodesic *lla, size_t n, int bits, int centered){
+	Job job = {values, lla, NULL, bits, centered};
+	parallel_for(geohash_decode_n_task, &job, n);
+}
+
+// result : n*(bits/5) characters, no separator
+EXPORT void geohash_str_n(uint64_t *values, size_t n, int bits, const char *base, char *result){
+	Job job = {values, result, base, bits, 0};
+	parallel_for(geohash_str_n_task, &job, n);
+}
+
+/*
+Proximity search : cells are addressed by their (lon, lat) integer indexes at
+a given geohash length, a geohash of b bits being the prefix of all the 64 bits
+keys in [value << (64-b), (value+1) << (64-b)[.
+*/
+static uint64_t cell(uint64_t lon, uint64_t lat, int bits){
+	return (bits % 2) ? interleave(lon, lat) : interleave(lat, lon);
+}
+
+EXPORT int geohash_neighbour(uint64_t value, int bits, int dlon, int dlat, uint64_t *result){
+	uint64_t lon, lat, nlon = mask((bits + 1)/2), nlat = mask(bits/2);
+	int64_t j;
+
+	geohash_split(value, bits, &lon, &lat);
+	j = (int64_t)lat + dlat;
+	if (j < 0 || (uint64_t)j > nlat) return 0;
+	*result = cell((lon + (uint64_t)(int64_t)dlon) & nlon, (uint64_t)j, bits);
+	return 1;
+}
+
+EXPORT void geohash_neighbours(uint64_t value, int bits, uint64_t *result){
+	static const int dlon[8] = {0, 1, 1, 1, 0, -1, -1, -1};
+	static const int dlat[8] = {1, 1, 0, -1, -1, -1, 0, 1};
+	int i;
+	for (i=0; i<8; i++)
+		if (!geohash_neighbour(value, bits, dlon[i], dlat[i], &result[i])) result[i] = value;
+}
+
+static size_t cover(uint64_t lon0, uint64_t lon1, uint64_t lat0, uint64_t lat1, int bits, uint64_t *result, size_t count, size_t max){
+	uint64_t i, j;
+	for (i=lon0; i<=lon1; i++)
+		for (j=lat0; j<=lat1; j++, count++)
+			if (count < max) result[count] = cell(i, j, bits);
+	return count;
+}
+
+EXPORT size_t geohash_cover_box(double lon_min, double lat_min, double lon_max, double lat_max, int bits, uint64_t *result, size_t max){
+	int nlon = (bits + 1)/2, nlat = bits/2;
+	uint64_t lat0, lat1;
+
+	lat0 = quantize(lat_min, -90., 180., nlat);
+	lat1 = quantize(lat_max, -90., 180., nlat);
+	if (lon_min <= lon_max)
+		return cover(quantize(lon_min, -180., 360., nlon), quantize(lon_max, -180., 360., nlon), lat0, lat1, bits, result, 0, max);
+	return cover(0, quantize(lon_max, -180., 360., nlon), lat0, lat1, bits, result,
+		cover(quantize(lon_min, -180., 360., nlon), mask(nlon), lat0, lat1, bits, result, 0, max), max);
+}
+
+/*
+Bounding box of the circle : angular radius is taken on the sphere of radius
+a(1-e^2) (smallest radius of curvature) enlarged by 1%, so the box contains
+the circle whatever the ellipsoid. Cells are then kept if the distance to
+their nearest point (spherical approximation) is within 1% of the radius.
+*/
+static const double COVER_MARGIN = 1.01;
+
+static int circle_box(Ellipsoid *ellps, Geodesic *center, double radius, double *box){
+	double delta, lat, s;
+
+	delta = COVER_MARGIN * radius / (ellps->a * (1 - ellps->e*ellps->e));
+	lat = center->latitude;
+	box[1] = (lat - delta) * RADIAN2DEG;
+	box[3] = (lat + delta) * RADIAN2DEG;
+	if (delta >= M_PI || box[1] <= -90. || box[3] >= 90. || (s = sin(delta)/cos(lat)) >= 1.){
+		box[0] = -180.; box[2] = 180.;
+		box[1] = fmax(box[1], -90.); box[3] = fmin(box[3], 90.);
+		return 0;
+	}
+	delta = asin(s) * RADIAN2DEG;
+	box[0] = center->longitude * RADIAN2DEG - delta;
+	box[2] = center->longitude * RADIAN2DEG + delta;
+	if (box[0] < -180.) box[0] += 360.;
+	if (box[2] > 180.) box[2] -= 360.;
+	return 1;
+}
+
+// distance from center to the nearest point of a cell (spherical geometry for
+// the location of that point, ellipsoid for the distance)
+static double cell_distance(Karney *k, Geodesic *center, uint64_t value, int bits){
+	double lonlat[2], size[2], lon0, lon1, lat0, lat1, dlon, edge;
+	Geodesic nearest;
+
+	geohash_decode(value, bits, lonlat, size);
+	lon0 = lonlat[0] * DEGREE2RAD; lon1 = (lonlat[0] + size[0]) * DEGREE2RAD;
+	lat0 = lonlat[1] * DEGREE2RAD; lat1 = (lonlat[1] + size[1]) * DEGREE2RAD;
+	dlon = remainder(center->longitude - (lon0 + lon1)/2, 2*M_PI);
+	if (fabs(dlon) <= (lon1 - lon0)/2){
+		nearest.longitude = center->longitude;
+		nearest.latitude = fmin(fmax(center->latitude, lat0), lat1);
+	} else {
+		edge = (dlon > 0) ? lon1 : lon0;
+		dlon = remainder(center->longitude - edge, 2*M_PI);
+		nearest.longitude = edge;
+		nearest.latitude = (fabs(dlon) >= HALF_PI) ?
+			((center->latitude > 0) ? lat1 : lat0) :
+			fmin(fmax(atan(tan(center->latitude)/cos(dlon)), lat0), lat1);
+	}
+	nearest.altitude = 0.;
+	return karney_distance(k, center, &nearest).distance;
+}
+
+// number of cells of the box cover at a given length
+static double cover_count(double *box, int bits){
+	double w = ldexp(360., -(bits + 1)/2), h = ldexp(180., -bits/2), lon;
+	lon = (box[0] <= box[2]) ? box[2] - box[0] : box[2] - box[0] + 360.;
+	return (floor(lon/w) + 2) * (floor((box[3] - box[1])/h) + 2);
+}
+
+EXPORT size_t geohash_cover_circle(Ellipsoid *ellps, Geodesic *center, double radius, int *bits, uint64_t *result, size_t max){
+	Karney k;
+	double box[4];
+	size_t i, n, count = 0;
+
+	circle_box(ellps, center, radius, box);
+	if (*bits <= 0){
+		*bits = GEOHASH_BITS;
+		while (*bits > 1 && cover_count(box, *bits) > GEOHASH_COVER) *bits -= 1;
+	}
+	n = geohash_cover_box(box[0], box[1], box[2], box[3], *bits, result, max);
+	if (n > max) return n;
+
+	karney_init(ellps, &k);
+	for (i=0; i<n; i++)
+		if (cell_distance(&k, center, result[i], *bits) <= COVER_MARGIN * radius)
+			result[count++] = result[i];
+	return count;
+}
+
+typedef struct{
+	uint64_t key;
+	size_t index;
+}Entry;
+
+static int entry_cmp(const void *a, const void *b){
+	uint64_t x = ((const Entry *)a)->key, y = ((const Entry *)b)->key;
+	return (x > y) - (x < y);
+}
+
+EXPORT int geohash_index(Geodesic *lla, size_t n, uint64_t *keys, size_t *order){
+	Entry *entries;
+	size_t i;
+
+	geohash_n(lla, keys, n, GEOHASH_BITS);
+	if (n == 0) return 0;
+	entries = (Entry *)malloc(n * sizeof(Entry));
+	if (entries == NULL) return -1;
+	for (i=0; i<n; i++) {entries[i].key = keys[i]; entries[i].index = i;}
+	qsort(entries, n, sizeof(Entry), entry_cmp);
+	for (i=0; i<n; i++) {keys[i] = entries[i].key; order[i] = entries[i].index;}
+	free(entries);
+	return 0;
+}
+
+// first position of keys where key >= value
+static size_t lower_bound(uint64_t *keys, size_t n, uint64_t value){
+	size_t lo = 0, hi = n, mid;
+	while (lo < hi){
+		mid = lo + (hi - lo)/2;
+		if (keys[mid] < value) lo = mid + 1;
+		else hi = mid;
+	}
+	return lo;
+}
+
+// [start, stop[ range of keys prefixed by value
+static void prefix_range(uint64_t *keys, size_t n, uint64_t value, int bits, size_t *start, size_t *stop){
+	int shift = GEOHASH_BITS - bits;
+	uint64_t lo = value << shift, hi = lo | mask(shift);
+	*start = lower_bound(keys, n, lo);
+	*stop = (hi == ~0ULL) ? n : lower_bound(keys, n, hi + 1);
+}
+
+EXPORT long geohash_within(Ellipsoid *ellps, uint64_t *keys, size_t *order, Geodesic *lla, size_t n, Geodesic *center, double radius, size_t *result, double *dist, size_t max){
+	Karney k;
+	uint64_t cells[GEOHASH_COVER*4];
+	size_t i, j, start, stop, ncells;
+	long count = 0;
+	double d;
+	int bits = 0;
+
+	ncells = geohash_cover_circle(ellps, center, radius, &bits, cells, GEOHASH_COVER*4);
+	karney_init(ellps, &k);
+	for (i=0; i<ncells; i++){
+		prefix_range(keys, n, cells[i], bits, &start, &stop);
+		for (j=start; j<stop; j++){
+			d = karney_distance(&k, center, &lla[order[j]]).distance;
+			if (d <= radius){
+				if ((size_t)count < max) {result[count] = order[j]; dist[count] = d;}
+				count++;
+			}
+		}
+	}
+	return count;
+}
+
+typedef struct{
+	double dist;
+	size_t index;
+}Neighbour;
+
+static int neighbour_cmp(const void *a, const void *b){
+	double x = ((const Neighbour *)a)->dist, y = ((const Neighbour *)b)->dist;
+	return (x > y) - (x < y);
+}
+
+/*
+The radius is first bounded by the farthest of k points sharing the longest
+possible prefix with center, then every point within that radius is ranked.
+*/
+EXPORT long geohash_nearest(Ellipsoid *ellps, uint64_t *keys, size_t *order, Geodesic *lla, size_t n, Geodesic *center, size_t k, size_t *result, double *dist){
+	Karney kr;
+	Neighbour *found;
+	size_t *index, i, start, stop, count, m;
+	double *d, radius = 0.;
+	uint64_t key;
+	int bits;
+
+	if (k > n) k = n;
+	if (k == 0) return 0;
+	karney_init(ellps, &kr);
+
+	key = geohash_encode(center->longitude*RADIAN2DEG, center->latitude*RADIAN2DEG, GEOHASH_BITS);
+	for (bits=GEOHASH_BITS; bits>0; bits--){
+		prefix_range(keys, n, key >> (GEOHASH_BITS - bits), bits, &start, &stop);
+		if (stop - start >= k) break;
+	}
+	if (bits == 0) {start = 0; stop = n;}
+	for (i=start; i<stop && i<start+k; i++)
+		radius = fmax(radius, karney_distance(&kr, center, &lla[order[i]]).distance);
+
+	// every point within radius, at least k
+	m = 4*k;
+	for (;;){
+		index = (size_t *)malloc(m * (sizeof(size_t) + sizeof(double)));
+		if (index == NULL) return -1;
+		d = (double *)(index + m);
+		count = (size_t)geohash_within(ellps, keys, order, lla, n, center, radius, index, d, m);
+		if (count <= m) break;
+		free(index);
+		m = count;
+	}
+
+	found = (Neighbour *)malloc(count * sizeof(Neighbour));
+	if (found == NULL) {free(index); return -1;}
+	for (i=0; i<count; i++) {found[i].dist = d[i]; found[i].index = index[i];}
+	qsort(found, count, sizeof(Neighbour), neighbour_cmp);
+	if (k > count) k = count;
+	for (i=0; i<k; i++) {result[i] = found[i].index; dist[i] = found[i].dist;}
+	free(found);
+	free(index);
+	return (long)k;
+}
@@ -0,0 +1,53 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Geohash on 64 bits integers. Longitude and latitude are quantized on
+// (bits+1)/2 and bits/2 bits and interleaved, longitude first, so that the
+// values are the ones of the python bisection in Gryd/geohash.py.
+
+#ifndef GEOHASH_H
+#define GEOHASH_H
+
+#include <stdint.h>
+#include "./geoid.h"
+
+// longest geohash an uint64_t can hold
+#define GEOHASH_BITS 64
+
+EXPORT uint64_t geohash_encode(double longitude, double latitude, int bits);
+EXPORT void geohash_decode(uint64_t value, int bits, double *lonlat, double *size);
+EXPORT void geohash_split(uint64_t value, int bits, uint64_t *lon, uint64_t *lat);
+EXPORT uint64_t geohash_join(uint64_t lon, int lon_bits, uint64_t lat, int lat_bits);
+
+// base32 strings : bits/5 characters, the bits%5 lowest bits are dropped
+EXPORT int geohash_str(uint64_t value, int bits, const char *base, char *result);
+EXPORT int geohash_int(const char *str, int length, const char *base, uint64_t *value);
+
+// batch functions on geodesic coordinates (radians)
+EXPORT void geohash_n(Geodesic *lla, uint64_t *result, size_t n, int bits);
+EXPORT void geohash_decode_n(uint64_t *values, Geodesic *lla, size_t n, int bits, int centered);
+EXPORT void geohash_str_n(uint64_t *values, size_t n, int bits, const char *base, char *result);
+
+// neighbour cell dlon columns east and dlat rows north, longitude wraps around
+// the antimeridian, return 0 beyond the poles
+EXPORT int geohash_neighbour(uint64_t value, int bits, int dlon, int dlat, uint64_t *result);
+// N, NE, E, SE, S, SW, W, NW neighbours, value itself beyond the poles
+EXPORT void geohash_neighbours(uint64_t value, int bits, uint64_t *result);
+
+// cells covering a bounding box in degrees (lon_min > lon_max crosses the
+// antimeridian) or a circle on the ellipsoid. Both return the number of cells
+// and write at most max of them. With *bits <= 0, the longest geohash length
+// covering the circle with at most GEOHASH_COVER cells is used.
+#define GEOHASH_COVER 16
+EXPORT size_t geohash_cover_box(double lon_min, double lat_min, double lon_max, double lat_max, int bits, uint64_t *result, size_t max);
+EXPORT size_t geohash_cover_circle(Ellipsoid *ellps, Geodesic *center, double radius, int *bits, uint64_t *result, size_t max);
+
+// sorted index : keys are the 64 bits geohashes of lla in ascending order and
+// order[i] the lla index of keys[i]. Queries scan key ranges of the circle
+// cover and return the number of points found, writing at most max indexes
+// and distances (sorted by distance for nearest). Return -1 on memory error.
+EXPORT int geohash_index(Geodesic *lla, size_t n, uint64_t *keys, size_t *order);
+EXPORT long geohash_within(Ellipsoid *ellps, uint64_t *keys, size_t *order, Geodesic *lla, size_t n, Geodesic *center, double radius, size_t *result, double *dist, size_t max);
+EXPORT long geohash_nearest(Ellipsoid *ellps, uint64_t *keys, size_t *order, Geodesic *lla, size_t n, Geodesic *center, size_t k, size_t *result, double *dist);
+
+#endif
@@ -25,6 +25,9 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include "./geoid.h"
+#include "./vmath.h"
+#include "./parallel.h"
+#include "./karney.h"
 #include <stdlib.h>
 
 EXPORT double MD(double a, double e, double latitude){
@@ -80,55 +83,208 @@ EXPORT Dmm dmm(double value){
 	return result;
 }
 
+// see lla2xyz and xyz2lla in geoid.h
+EXPORT Geocentric geocentric(Ellipsoid *ellps, Geodesic *lla){
+	return lla2xyz(ellps, lla);
+}
+
+EXPORT Geodesic geodesic(Ellipsoid *ellps, Geocentric *xyz){
+	return xyz2lla(ellps, xyz);
+}
+
 /*
 Source :
-The Mercator projections, Peter Osborne, 2008
-§ Chapter 5. The geometry of the ellipsoid
+Bowring B.R., Transformation from spatial to geographical coordinates,
+Survey Review, 23(181), 1976
+Bowring B.R., The accuracy of geodetic latitude and height equations,
+Survey Review, 28(218), 1985
+
+Parametric latitude is estimated then refined BOWRING_STEPS times through its
+tangent only, so the sole trigonometric calls are the final atan2. Height
+uses the 1985 formula that holds near the poles. Measured on WGS84 from -5 km
+to 40000 km altitude with 2 steps : latitude error below 5e-16 rad, height
+error at rounding level (3e-8 m at 40000 km), about 4 times faster than the
+iterative geodesic function (90 ns against 350 ns); 1 step leaves 1e-8 rad
+at orbital altitudes.
 */
-EXPORT Geocentric geocentric(Ellipsoid *ellps, Geodesic *lla){
-	Geocentric result;
-	double v;
+static const int BOWRING_STEPS = 2;
+
+EXPORT Geodesic geodesic_bowring(Ellipsoid *ellps, Geocentric *xyz){
+	Geodesic result;
+	double a, b, e2, ep2, p, sb, cb, num, den, r, sphi, cphi;
+	int i;
+
+	a = ellps->a;
+	b = ellps->b;
+	e2 = ellps->e*ellps->e;
+	ep2 = e2 / (1 - e2);
+	p = sqrt(xyz->x*xyz->x + xyz->y*xyz->y);
+
+	// tan(beta) = a.z / b.p then tan(beta) = (1-f) tan(phi) at each step
+	sb = a*xyz->z;
+	cb = b*p;
+	for (i=0; i<BOWRING_STEPS; i++){
+		r = sqrt(sb*sb + cb*cb);
+		sb /= r;
+		cb /= r;
+		num = xyz->z + ep2*b*sb*sb*sb;
+		den = p - e2*a*cb*cb*cb;
+		sb = (1 - ellps->f)*num;
+		cb = den;
+	}
+	r = sqrt(num*num + den*den);
+	sphi = num/r;
+	cphi = den/r;
 
-	v = nhu(ellps->a, ellps->e, lla->latitude);
-	result.x = (v+lla->altitude) * cos(lla->latitude) * cos(lla->longitude);
-	result.y = (v+lla->altitude) * cos(lla->latitude) * sin(lla->longitude);
-	result.z = (v * (1 - pow(ellps->e,2)) + lla->altitude) * sin(lla->latitude);
+	result.longitude = atan2(xyz->y, xyz->x);
+	result.latitude = atan2(num, den);
+	result.altitude = p*cphi + xyz->z*sphi - a*sqrt(1 - e2*sphi*sphi);
 
 	return result;
 }
 
-EXPORT Geodesic geodesic(Ellipsoid *ellps, Geocentric *xyz){
+/*
+Source :
+Vermeille H., Direct transformation from geocentric coordinates to geodetic
+coordinates, Journal of Geodesy, 76, 2002
+
+Closed form solution, exact to rounding errors (5e-16 rad, 3e-8 m at 40000
+km) and about 2.5 times faster than the iterative geodesic function. It holds
+outside the evolute of the ellipsoid, ie farther than ~43 km (a.e^2) from
+earth center where r might vanish, points inside are solved iteratively.
+*/
+EXPORT Geodesic geodesic_vermeille(Ellipsoid *ellps, Geocentric *xyz){
 	Geodesic result;
-	double sqrt_xxpyy, phi_i, phi_ip1, e2;
-	int i = 0;
+	double a2, e2, e4, pxy, p, q, r, s, t, u, v, w, k, d, dz;
 
+	a2 = ellps->a*ellps->a;
 	e2 = ellps->e*ellps->e;
-	sqrt_xxpyy = sqrt(xyz->x*xyz->x + xyz->y*xyz->y);
-	phi_i = atan2(xyz->z, ((1 - e2) * sqrt_xxpyy));
-	phi_ip1 = atan2((xyz->z + e2 * nhu(ellps->a, ellps->e, phi_i) * sin(phi_i)), sqrt_xxpyy);
-
-	while ((fabs(phi_i - phi_ip1) > EPS) && (i < MAX_ITER)){
-		phi_i = phi_ip1;
-		phi_ip1 = atan2((xyz->z + e2 * nhu(ellps->a, ellps->e, phi_i) * sin(phi_i)), sqrt_xxpyy);
-		i += 1;
-	}
+	e4 = e2*e2;
+	pxy = sqrt(xyz->x*xyz->x + xyz->y*xyz->y);
+	p = pxy*pxy / a2;
+	q = (1 - e2) / a2 * xyz->z*xyz->z;
+	r = (p + q - e4) / 6;
+	if (r <= 0) return xyz2lla(ellps, xyz);
+
+	s = e4*p*q / (4*r*r*r);
+	t = cbrt(1 + s + sqrt(s*(2 + s)));
+	u = r*(1 + t + 1/t);
+	v = sqrt(u*u + e4*q);
+	w = e2*(u + v - q) / (2*v);
+	k = sqrt(u + v + w*w) - w;
+	d = k*pxy / (k + e2);
+	dz = sqrt(d*d + xyz->z*xyz->z);
 
 	result.longitude = atan2(xyz->y, xyz->x);
-	result.latitude = phi_ip1;
-	result.altitude = 1/cos(phi_ip1) * sqrt_xxpyy - nhu(ellps->a, ellps->e, phi_ip1);
+	result.latitude = 2*atan2(xyz->z, d + dz);
+	result.altitude = (k + e2 - 1) / k * dz;
 
 	return result;
 }
 
+// solver index as used by batch functions
+typedef Geodesic (*Solver)(Ellipsoid *ellps, Geocentric *xyz);
+static const Solver SOLVERS[] = {geodesic, geodesic_bowring, geodesic_vermeille};
+static const int SOLVER_COUNT = sizeof(SOLVERS) / sizeof(Solver);
+
+static Solver solver(int index){
+	return (index > 0 && index < SOLVER_COUNT) ? SOLVERS[index] : SOLVERS[0];
+}
+
+// structure of arrays versions, geocentric loop is vectorized
+VECTORIZE static void geocentric_kernel(double a, double e2, double * RESTRICT lon, double * RESTRICT lat, double * RESTRICT alt, double * RESTRICT x, double * RESTRICT y, double * RESTRICT z, size_t n){
+	double sphi, cphi, slambda, clambda, v;
+	size_t i;
+
+	for (i=0; i<n; i++){
+		vm_sincos(lat[i], &sphi, &cphi);
+		vm_sincos(lon[i], &slambda, &clambda);
+		v = a / sqrt(1 - e2*sphi*sphi);
+		x[i] = (v+alt[i]) * cphi * clambda;
+		y[i] = (v+alt[i]) * cphi * slambda;
+		z[i] = (v * (1 - e2) + alt[i]) * sphi;
+	}
+}
+
+static void geocentric_soa_chunk(Ellipsoid *ellps, Geodesics *lla, Geocentrics *xyz, size_t n){
+	double zero[VBLOCK] = {0.};
+	size_t i, m;
+
+	if (lla->altitude != NULL){
+		geocentric_kernel(ellps->a, ellps->e*ellps->e, lla->longitude, lla->latitude, lla->altitude, xyz->x, xyz->y, xyz->z, n);
+		return;
+	}
+	for (i=0; i<n; i+=VBLOCK){
+		m = (n-i < VBLOCK) ? n-i : VBLOCK;
+		geocentric_kernel(ellps->a, ellps->e*ellps->e, lla->longitude+i, lla->latitude+i, zero, xyz->x+i, xyz->y+i, xyz->z+i, m);
+	}
+}
+
+static void geodesic_soa_chunk(Ellipsoid *ellps, Geocentrics *xyz, Geodesics *lla, size_t n, Solver solve){
+	Geocentric p;
+	Geodesic r;
+	size_t i;
+
+	for (i=0; i<n; i++){
+		p.x = xyz->x[i];
+		p.y = xyz->y[i];
+		p.z = xyz->z[i];
+		r = solve(ellps, &p);
+		lla->longitude[i] = r.longitude;
+		lla->latitude[i] = r.latitude;
+		if (lla->altitude != NULL) lla->altitude[i] = r.altitude;
+	}
+}
+
 /*
 Source :
 http://www.movable-type.co.uk/scripts/latlong-vincenty-direct.html
 */
-EXPORT Vincenty_dist distance(Ellipsoid *ellps, Geodesic *start, Geodesic *stop){ 
+// reduced latitude terms of a point, computed once per point by matrices
+typedef struct{
+	double longitude;
+	double latitude;
+	double sU;
+	double cU;
+}Reduced;
+
+static Reduced reduced(Ellipsoid *ellps, Geodesic *lla){
+	Reduced r;
+	double U = atan((1-ellps->f) * tan(lla->latitude));
+	r.longitude = lla->longitude;
+	r.latitude = lla->latitude;
+	r.sU = sin(U);
+	r.cU = cos(U);
+	return r;
+}
+
+// auxiliary sphere terms of longitude difference x
+typedef struct{
+	double sx, cx, ssigma, csigma, sigma, salpha, calpha2, c2sigma_m;
+}Sphere;
+
+static int sphere(double x, double sU1, double cU1, double sU2, double cU2, Sphere *t){
+	t->sx = sin(x); t->cx = cos(x);
+	t->ssigma = sqrt(pow(cU2*t->sx, 2) + pow(cU1*sU2 - sU1*cU2*t->cx, 2));
+	if (t->ssigma < EPS) return 0;
+	t->csigma = sU1*sU2 + cU1*cU2*t->cx;
+	t->sigma = atan2(t->ssigma, t->csigma);
+	t->salpha = cU1*cU2*t->sx / t->ssigma;
+	t->calpha2 = 1 - pow(t->salpha, 2);
+	t->c2sigma_m = (t->calpha2 < EPS) ? 0. : t->csigma - 2*sU1*sU2/t->calpha2;
+	return 1;
+}
+
+// bearings are left null if not asked for, sparing two atan2. Distance is
+// computed from the terms of the last longitude, so that its error is the
+// one of the converged longitude rather than the last correction (up to
+// tolerance*a, 0.6 mm with default accuracy).
+static Vincenty_dist vincenty(Ellipsoid *ellps, const Accuracy *acc, Reduced *start, Reduced *stop, int bearings){
 	Vincenty_dist result;
+	Sphere t;
 	double x, xp1;
-	double L, U1, U2, sU1, cU1, sU2, cU2, A, B, C, u2, k1;
-	double sx, cx, ssigma, csigma, sigma, salpha, calpha2, c2sigma_m, Dsigma;
+	double L, sU1, cU1, sU2, cU2, A, B, C, u2, k1;
+	double sx, cx, ssigma, csigma, sigma, calpha2, c2sigma_m, Dsigma;
 	int i = 0;
 
 	result.distance = 0;
@@ -136,26 +292,23 @@ EXPORT Vincenty_dist distance(Ellipsoid *ellps, Geodesic *start, Geodesic *stop)
 	result.final_bearing = 0;
 
 	L = stop->longitude - start->longitude; x = L; xp1 = L+1;
-	U1 = atan((1-ellps->f) * tan(start->latitude)); U2 = atan((1-ellps->f) * tan(stop->latitude));
-	cU1 = cos(U1); sU1 = sin(U1); cU2 = cos(U2); sU2 = sin(U2);
-
-	while ((fabs(x - xp1) > EPS) && (i < MAX_ITER)){
-		sx = sin(x); cx = cos(x);
-		ssigma = sqrt(pow(cU2*sx, 2) + pow(cU1*sU2 - sU1*cU2*cx, 2));
-		if (ssigma < EPS) return result;
-		csigma = sU1*sU2 + cU1*cU2*cx;
-		sigma = atan2(ssigma, csigma);
-		salpha = cU1*cU2*sx / ssigma;
-		calpha2 = 1 - pow(salpha, 2);
-		if (calpha2 < EPS){
-			c2sigma_m = 0.;}else{
-			c2sigma_m = csigma - 2*sU1*sU2/calpha2;
+	sU1 = start->sU; cU1 = start->cU; sU2 = stop->sU; cU2 = stop->cU;
+
+	while ((fabs(x - xp1) > acc->tolerance) && (i < acc->iterations)){
+		if (!sphere(x, sU1, cU1, sU2, cU2, &t)){
+			// coincident points
+			STATS_RECORD(STATS_DISTANCE, i, 0, start->longitude, start->latitude, stop->longitude, stop->latitude);
+			return result;
 		}
-		C = ellps->f/16*calpha2 * (4 + ellps->f*(4-3*calpha2));
+		C = ellps->f/16*t.calpha2 * (4 + ellps->f*(4-3*t.calpha2));
 		xp1 = x;
-		x = L + (1-C)*ellps->f*salpha*(sigma + C*ssigma*(c2sigma_m + C*csigma*(-1+2*c2sigma_m*c2sigma_m)));
+		x = L + (1-C)*ellps->f*t.salpha*(t.sigma + C*t.ssigma*(t.c2sigma_m + C*t.csigma*(-1+2*t.c2sigma_m*t.c2sigma_m)));
 		i += 1;
 	}
+	STATS_RECORD(STATS_DISTANCE, i, fabs(x - xp1) > acc->tolerance, start->longitude, start->latitude, stop->longitude, stop->latitude);
+	if (!sphere(x, sU1, cU1, sU2, cU2, &t)) return result;
+	sx = t.sx; cx = t.cx; ssigma = t.ssigma; csigma = t.csigma; sigma = t.sigma;
+	calpha2 = t.calpha2; c2sigma_m = t.c2sigma_m;
 	u2 = calpha2 * (ellps->a*ellps->a - ellps->b*ellps->b) / pow(ellps->b, 2);
 	k1 = (sqrt(1+u2)-1) / (sqrt(1+u2)+1);
 	A = (1 + 0.25*k1*k1) / (1-k1);
@@ -163,13 +316,86 @@ EXPORT Vincenty_dist distance(Ellipsoid *ellps, Geodesic *start, Geodesic *stop)
 	Dsigma = B*ssigma * (c2sigma_m + B/4*(csigma*(-1 + 2*c2sigma_m*c2sigma_m) - B/6*c2sigma_m*(-3 + 4*ssigma*ssigma)*(-3 + 4*c2sigma_m*c2sigma_m)));
 
 	result.distance = ellps->b*A*(sigma - Dsigma);
-	result.initial_bearing = atan2(cU2*sx, (cU1*sU2 - sU1*cU2*cx));
-	result.final_bearing = atan2(cU1*sx, (-sU1*cU2 + cU1*sU2*cx));
+	if (bearings){
+		result.initial_bearing = atan2(cU2*sx, (cU1*sU2 - sU1*cU2*cx));
+		result.final_bearing = atan2(cU1*sx, (-sU1*cU2 + cU1*sU2*cx));
+	}
 
 	return result;
 }
 
+EXPORT Vincenty_dist distance(Ellipsoid *ellps, Geodesic *start, Geodesic *stop){ 
+	Reduced r1 = reduced(ellps, start), r2 = reduced(ellps, stop);
+	return vincenty(ellps, accuracy(ellps), &r1, &r2, 1);
+}
+
+/*
+Approximate distances, bearings are not computed (NaN). Maximum errors
+relative to Karney distances are measured on WGS84 and given in Gryd.
+
+Source :
+Lambert W.D., The distance between two widely separated points on the
+surface of the earth, J. Washington Academy of Sciences, 32(5), 1942
+Snyder J.P., Map projections: a working manual, USGS 1395, 1987, p16
+*/
+
+// squared sine of half central angle between (lat1, lon1) and (lat2, lon2)
+static double haversine(double lat1, double lat2, double dlon){
+	double s1 = sin((lat2 - lat1)/2), s2 = sin(dlon/2);
+	return fmin(1., s1*s1 + cos(lat1)*cos(lat2)*s2*s2);
+}
+
+static Vincenty_dist approximate(Ellipsoid *ellps, double radius, int mode, Geodesic *start, Geodesic *stop){
+	Vincenty_dist result;
+	double h, sigma, dlon, beta1, beta2, P, Q, X, Y, e2, phi, w, M, N;
+
+	result.initial_bearing = result.final_bearing = NAN;
+	dlon = remainder(stop->longitude - start->longitude, TWO_PI);
+	switch (mode){
+		case DISTANCE_HAVERSINE:
+			result.distance = 2*radius*asin(sqrt(haversine(start->latitude, stop->latitude, dlon)));
+			break;
+		case DISTANCE_ANDOYER:
+			// central angle between reduced latitudes, flattening correction
+			beta1 = atan((1 - ellps->f)*tan(start->latitude));
+			beta2 = atan((1 - ellps->f)*tan(stop->latitude));
+			h = haversine(beta1, beta2, dlon);
+			sigma = 2*asin(sqrt(h));
+			result.distance = 0.;
+			if (h <= 0. || h >= 1.) break;
+			P = (beta1 + beta2)/2;
+			Q = (beta2 - beta1)/2;
+			X = (sigma - sin(sigma))*pow(sin(P)*cos(Q), 2)/(1 - h);
+			Y = (sigma + sin(sigma))*pow(cos(P)*sin(Q), 2)/h;
+			result.distance = ellps->a*(sigma - ellps->f/2*(X + Y));
+			break;
+		default:
+			// local tangent plane at mean latitude
+			e2 = ellps->e*ellps->e;
+			phi = (start->latitude + stop->latitude)/2;
+			w = 1 - e2*sin(phi)*sin(phi);
+			N = ellps->a/sqrt(w);
+			M = N*(1 - e2)/w;
+			result.distance = hypot(M*(stop->latitude - start->latitude), N*cos(phi)*dlon);
+	}
+
+	return result;
+}
+
+EXPORT Vincenty_dist distance_haversine(Ellipsoid *ellps, Geodesic *start, Geodesic *stop){
+	return approximate(ellps, authalic_radius(ellps), DISTANCE_HAVERSINE, start, stop);
+}
+
+EXPORT Vincenty_dist distance_andoyer(Ellipsoid *ellps, Geodesic *start, Geodesic *stop){
+	return approximate(ellps, 0., DISTANCE_ANDOYER, start, stop);
+}
+
+EXPORT Vincenty_dist distance_flat(Ellipsoid *ellps, Geodesic *start, Geodesic *stop){
+	return approximate(ellps, 0., DISTANCE_FLAT, start, stop);
+}
+
 EXPORT Vincenty_dest destination(Ellipsoid *ellps, Geodesic *start, Vincenty_dist *dbb){
+	const Accuracy *acc = accuracy(ellps);
 	Vincenty_dest result;
 	double lambda, phi2;
 	double tU1, cU1, sU1, sigma, sigma1, sigma_p, salpha, calpha2, u2, A, B;
@@ -188,7 +414,7 @@ EXPORT Vincenty_dest destination(Ellipsoid *ellps, Geodesic *start, Vincenty_dis
 	B = u2/1024 * (256 + u2*(-128 + u2*(74 - 47*u2)));
 	sigma = dbb->distance / (ellps->b*A); sigma_p = 2*M_PI;
 
-	while ((fabs(sigma - sigma_p) > EPS) && (i < MAX_ITER)){
+	while ((fabs(sigma - sigma_p) > acc->tolerance) && (i < acc->iterations)){
 		c2sigma_m = cos(2*sigma1 + sigma);
 		ssigma = sin(sigma);
 		csigma = cos(sigma);
@@ -197,6 +423,11 @@ EXPORT Vincenty_dest destination(Ellipsoid *ellps, Geodesic *start, Vincenty_dis
 		sigma = dbb->distance / (ellps->b*A) + Dsigma;
 		i += 1;
 	}
+	STATS_RECORD(STATS_DESTINATION, i, fabs(sigma - sigma_p) > acc->tolerance, start->longitude, start->latitude, dbb->initial_bearing, dbb->distance);
+	// terms of the converged arc, as in vincenty inverse
+	c2sigma_m = cos(2*sigma1 + sigma);
+	ssigma = sin(sigma);
+	csigma = cos(sigma);
 	tmp = sU1*ssigma - cU1*csigma*calpha1;
 	phi2 = atan2(sU1*csigma + cU1*ssigma*calpha1, (1-ellps->f)*sqrt(salpha*salpha + tmp*tmp));
 	lambda = atan2(ssigma*salpha1, cU1*csigma - sU1*ssigma*calpha1);
@@ -211,29 +442,19 @@ EXPORT Vincenty_dest destination(Ellipsoid *ellps, Geodesic *start, Vincenty_dis
 }
 
 EXPORT Geocentric dat2dat(Datum *src, Datum *dst, Geocentric *xyz){
-	Geocentric result;
-	double rx, ry, rz, ds;
-
-	rx = (src->rx - dst->rx) * ARCSEC2RAD;
-	ry = (src->ry - dst->ry) * ARCSEC2RAD;
-	rz = (src->rz - dst->rz) * ARCSEC2RAD;
-	ds = (src->ds - dst->ds) / 1000000.0;
-
-	result.x = (src->dx - dst->dx) + (1+ds)*(    xyz->x - rz*xyz->y + ry*xyz->z);
-	result.y = (src->dy - dst->dy) + (1+ds)*( rz*xyz->x +    xyz->y - rx*xyz->z);
-	result.z = (src->dz - dst->dz) + (1+ds)*(-ry*xyz->x + rx*xyz->y +    xyz->z);
-
-	return result;
+	Helmert h;
+	helmert(src, dst, &h);
+	return helmert_apply(&h, xyz);
 }
 
-EXPORT Vincenty_dest * npoints(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, int n){
+// fills result with the n+2 points (start, *intermediaries, end)
+EXPORT void npoints_into(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, int n, Vincenty_dest *result){
 	Vincenty_dist dbb;
 	Geodesic lla;
-	Vincenty_dest llb, *result;
+	Vincenty_dest llb;
 	double step;
 	int i;
 
-	result = malloc((n+2)*sizeof(Vincenty_dest));
 	dbb = distance(ellps, lla0, lla1);
 	step = dbb.distance/(n+1);
 
@@ -250,10 +471,25 @@ EXPORT Vincenty_dest * npoints(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1,
 		llb = destination(ellps, &lla, &dbb);
 		result[i] = llb;
 	}
+}
+
+// allocating versions, returned table has to be released with npoints_free
+EXPORT Vincenty_dest * npoints(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, int n){
+	Vincenty_dest *result = malloc((n+2)*sizeof(Vincenty_dest));
+	if (result != NULL) npoints_into(ellps, lla0, lla1, n, result);
+	return result;
+}
 
+EXPORT Vincenty_dest * npoints_karney(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, int n){
+	Vincenty_dest *result = malloc((n+2)*sizeof(Vincenty_dest));
+	if (result != NULL) npoints_karney_into(ellps, lla0, lla1, n, result);
 	return result;
 }
 
+EXPORT void npoints_free(Vincenty_dest *points){
+	free(points);
+}
+
 
 EXPORT double lagrange(double x, double *nx, double *ny, int n){
 	double result, xi, xj, p;
@@ -274,3 +510,242 @@ EXPORT double lagrange(double x, double *nx, double *ny, int n){
 
 	return result;
 }
+
+
+/*
+Batch functions : arrays of structures (_n) and structures of arrays (_soa)
+versions, spread over worker threads (see set_threads).
+*/
+typedef struct{
+	void *a;
+	void *b;
+	void *src;
+	void *src2;
+	void *dst;
+	int mode;
+}Job;
+
+static double *offset(double *array, size_t start){
+	return (array != NULL) ? array + start : NULL;
+}
+
+static void geocentric_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geodesic *lla = (Geodesic *)job->src;
+	Geocentric *xyz = (Geocentric *)job->dst;
+	size_t i;
+	for (i=start; i<stop; i++) xyz[i] = geocentric((Ellipsoid *)job->a, &lla[i]);
+}
+
+static void geodesic_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geocentric *xyz = (Geocentric *)job->src;
+	Geodesic *lla = (Geodesic *)job->dst;
+	Solver solve = solver(job->mode);
+	size_t i;
+	for (i=start; i<stop; i++) lla[i] = solve((Ellipsoid *)job->a, &xyz[i]);
+}
+
+// job->a is the precomputed Helmert transformation
+static void dat2dat_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geocentric *src = (Geocentric *)job->src, *dst = (Geocentric *)job->dst;
+	size_t i;
+	for (i=start; i<stop; i++) dst[i] = helmert_apply((Helmert *)job->a, &src[i]);
+}
+
+// job->b is the Karney object or the authalic radius, see distance_n
+static void distance_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geodesic *lla0 = (Geodesic *)job->src, *lla1 = (Geodesic *)job->src2;
+	Vincenty_dist *dist = (Vincenty_dist *)job->dst;
+	size_t i;
+	if (job->mode == DISTANCE_KARNEY){
+		for (i=start; i<stop; i++) dist[i] = karney_distance((Karney *)job->b, &lla0[i], &lla1[i]);
+	}else if (job->mode == DISTANCE_VINCENTY){
+		for (i=start; i<stop; i++) dist[i] = distance((Ellipsoid *)job->a, &lla0[i], &lla1[i]);
+	}else{
+		for (i=start; i<stop; i++) dist[i] = approximate((Ellipsoid *)job->a, *(double *)job->b, job->mode, &lla0[i], &lla1[i]);
+	}
+}
+
+static void geocentric_soa_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geodesics *src = (Geodesics *)job->src, lla;
+	Geocentrics *dst = (Geocentrics *)job->dst, xyz;
+
+	lla.longitude = offset(src->longitude, start);
+	lla.latitude = offset(src->latitude, start);
+	lla.altitude = offset(src->altitude, start);
+	xyz.x = offset(dst->x, start);
+	xyz.y = offset(dst->y, start);
+	xyz.z = offset(dst->z, start);
+	geocentric_soa_chunk((Ellipsoid *)job->a, &lla, &xyz, stop-start);
+}
+
+static void geodesic_soa_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geocentrics *src = (Geocentrics *)job->src, xyz;
+	Geodesics *dst = (Geodesics *)job->dst, lla;
+
+	xyz.x = offset(src->x, start);
+	xyz.y = offset(src->y, start);
+	xyz.z = offset(src->z, start);
+	lla.longitude = offset(dst->longitude, start);
+	lla.latitude = offset(dst->latitude, start);
+	lla.altitude = offset(dst->altitude, start);
+	geodesic_soa_chunk((Ellipsoid *)job->a, &xyz, &lla, stop-start, solver(job->mode));
+}
+
+EXPORT void geocentric_n(Ellipsoid *ellps, Geodesic *lla, Geocentric *xyz, size_t n){
+	Job job = {.a = ellps, .src = lla, .dst = xyz};
+	parallel_for(geocentric_n_task, &job, n);
+}
+
+// mode : 0 iterative (geodesic), 1 geodesic_bowring, 2 geodesic_vermeille
+EXPORT void geodesic_n(Ellipsoid *ellps, Geocentric *xyz, Geodesic *lla, size_t n, int mode){
+	Job job = {.a = ellps, .src = xyz, .dst = lla, .mode = mode};
+	parallel_for(geodesic_n_task, &job, n);
+}
+
+EXPORT void dat2dat_n(Datum *src, Datum *dst, Geocentric *xyz, Geocentric *result, size_t n){
+	Helmert h;
+	Job job = {.a = &h, .src = xyz, .dst = result};
+	helmert(src, dst, &h);
+	parallel_for(dat2dat_n_task, &job, n);
+}
+
+// pairwise distances : lla0[i] to lla1[i], mode is one of DISTANCE_*
+EXPORT void distance_n(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, Vincenty_dist *result, size_t n, int mode){
+	Karney k;
+	double radius = authalic_radius(ellps);
+	Job job = {
+		.a = ellps, .b = (mode == DISTANCE_KARNEY) ? (void *)&k : (void *)&radius,
+		.src = lla0, .src2 = lla1, .dst = result, .mode = mode
+	};
+	if (mode == DISTANCE_KARNEY) karney_init(ellps, &k);
+	parallel_for(distance_n_task, &job, n);
+}
+
+typedef struct{
+	Ellipsoid *ellps;
+	Karney *k;
+	double radius;        // authalic radius
+	int mode;
+	Geodesic *origins;
+	Geodesic *targets;
+	size_t m;
+	Vincenty_dist *result;
+	double *distances;
+}Matrix;
+
+// items are flattened row major. In vincenty mode, chunk rows are swept by
+// blocks of VBLOCK targets whose reduced terms are computed once per block
+static void distance_matrix_task(void *ctx, size_t start, size_t stop){
+	Matrix *job = (Matrix *)ctx;
+	const Accuracy *acc = accuracy(job->ellps);
+	Vincenty_dist dist;
+	Reduced origin, targets[VBLOCK];
+	size_t i, j, k, first, last, block, end, jstart, jstop;
+
+	// a single row chunk only covers a part of its row
+	first = start / job->m;
+	last = (stop - 1) / job->m;
+	jstart = (first == last) ? start - first*job->m : 0;
+	jstop = (first == last) ? stop - first*job->m : job->m;
+	for (block=jstart; block<jstop; block+=VBLOCK){
+		end = (block + VBLOCK < jstop) ? block + VBLOCK : jstop;
+		if (job->mode == DISTANCE_VINCENTY)
+			for (j=block; j<end; j++) targets[j-block] = reduced(job->ellps, &job->targets[j]);
+		for (i=first; i<=last; i++){
+			j = (i*job->m + block < start) ? start - i*job->m : block;
+			k = (i*job->m + end > stop) ? stop - i*job->m : end;
+			if (j >= k) continue;
+			if (job->mode == DISTANCE_VINCENTY) origin = reduced(job->ellps, &job->origins[i]);
+			for (; j<k; j++){
+				if (job->mode == DISTANCE_VINCENTY)
+					dist = vincenty(job->ellps, acc, &origin, &targets[j-block], job->result != NULL);
+				else if (job->mode == DISTANCE_KARNEY)
+					dist = karney_distance(job->k, &job->origins[i], &job->targets[j]);
+				else
+					dist = approximate(job->ellps, job->radius, job->mode, &job->origins[i], &job->targets[j]);
+				if (job->result != NULL) job->result[i*job->m + j] = dist;
+				if (job->distances != NULL) job->distances[i*job->m + j] = dist.distance;
+			}
+		}
+	}
+}
+
+// distances from n origins to m targets (one to many with n = 1), n*m row
+// major results written in result and/or distances, one of them may be NULL.
+// Distances only (result NULL) skip Vincenty bearings. Mode is one of
+// DISTANCE_*.
+EXPORT void distance_matrix(Ellipsoid *ellps, Geodesic *origins, size_t n, Geodesic *targets, size_t m, Vincenty_dist *result, double *distances, int mode){
+	Karney k;
+	Matrix job = {ellps, &k, authalic_radius(ellps), mode, origins, targets, m, result, distances};
+
+	if (n == 0 || m == 0) return;
+	if (mode == DISTANCE_KARNEY) karney_init(ellps, &k);
+	parallel_for(distance_matrix_task, &job, n*m);
+}
+
+typedef struct{
+	Ellipsoid *ellps;
+	double *longitudes;
+	size_t nlon;
+	double *latitudes;
+	double altitude;
+	Geocentric *xyz;
+}Sweep;
+
+// see lla2xyz : radius terms of a tile rows and longitude sines and cosines
+// of its columns are computed once
+static void geocentric_graticule_task(void *ctx, size_t start, size_t stop){
+	Sweep *sweep = (Sweep *)ctx;
+	double a = sweep->ellps->a, e2 = sweep->ellps->e*sweep->ellps->e, h = sweep->altitude;
+	double rc[GRATICULE_TILE], rz[GRATICULE_TILE], s[GRATICULE_TILE], c[GRATICULE_TILE], sphi, cphi, v;
+	size_t nlon = sweep->nlon, i0, j0, i, j, nr, nc;
+	Geocentric *row;
+
+	for (i0=start; i0<stop; i0+=GRATICULE_TILE){
+		nr = (stop-i0 < GRATICULE_TILE) ? stop-i0 : GRATICULE_TILE;
+		for (i=0; i<nr; i++){
+			sphi = sin(sweep->latitudes[i0+i]);
+			cphi = cos(sweep->latitudes[i0+i]);
+			v = a / sqrt(1 - e2*sphi*sphi);
+			rc[i] = (v+h) * cphi;
+			rz[i] = (v * (1 - e2) + h) * sphi;
+		}
+		for (j0=0; j0<nlon; j0+=GRATICULE_TILE){
+			nc = (nlon-j0 < GRATICULE_TILE) ? nlon-j0 : GRATICULE_TILE;
+			for (j=0; j<nc; j++){
+				s[j] = sin(sweep->longitudes[j0+j]);
+				c[j] = cos(sweep->longitudes[j0+j]);
+			}
+			for (i=0; i<nr; i++){
+				row = sweep->xyz + (i0+i)*nlon + j0;
+				for (j=0; j<nc; j++){
+					row[j].x = rc[i] * c[j];
+					row[j].y = rc[i] * s[j];
+					row[j].z = rz[i];
+				}
+			}
+		}
+	}
+}
+
+EXPORT void geocentric_graticule(Ellipsoid *ellps, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geocentric *xyz){
+	Sweep sweep = {ellps, longitudes, nlon, latitudes, altitude, xyz};
+	if (nlon == 0 || nlat == 0) return;
+	parallel_split(geocentric_graticule_task, &sweep, nlat, (PARALLEL_GRAIN + nlon - 1)/nlon, GRATICULE_TILE);
+}
+
+EXPORT void geocentric_soa(Ellipsoid *ellps, Geodesics *lla, Geocentrics *xyz, size_t n){
+	Job job = {.a = ellps, .src = lla, .dst = xyz};
+	parallel_for(geocentric_soa_task, &job, n);
+}
+
+EXPORT void geodesic_soa(Ellipsoid *ellps, Geocentrics *xyz, Geodesics *lla, size_t n, int mode){
+	Job job = {.a = ellps, .src = xyz, .dst = lla, .mode = mode};
+	parallel_for(geodesic_soa_task, &job, n);
+}
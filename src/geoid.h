@@ -24,6 +24,9 @@
 // OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#ifndef GEOID_H
+#define GEOID_H
+
 #if __linux__ 
     #define EXPORT extern
 #elif _WIN32
@@ -33,14 +36,16 @@
 
 #include <math.h>
 #include <stdlib.h>
+#include "./stats.h"
 
-static double HALF_PI = M_PI/2;
-static double TWO_PI = M_PI*2;
-static double DEGREE2RAD = M_PI/180.0;
-static double RADIAN2DEG = 180.0/M_PI;
-static double ARCSEC2RAD = M_PI/648000;
-static double EPS = 1e-10;
-static int MAX_ITER = 100;
+// read only constants, safe to share between threads
+static const double HALF_PI = M_PI/2;
+static const double TWO_PI = M_PI*2;
+static const double DEGREE2RAD = M_PI/180.0;
+static const double RADIAN2DEG = 180.0/M_PI;
+static const double ARCSEC2RAD = M_PI/648000;
+// degenerate cases threshold, iterative solvers stop on ACCURACY profiles
+static const double EPS = 1e-10;
 
 typedef struct{
     int epsg;
@@ -58,8 +63,30 @@ typedef struct{
     double b;
     double e;
     double f;
+    int accuracy;      // solver accuracy profile, see ACCURACY
 }Ellipsoid;
 
+// convergence criterion of iterative solvers, chosen per ellipsoid (so per
+// datum, crs or prepared crs) : stop when the correction is below tolerance
+// (radians) or after the given number of iterations
+typedef struct{
+    double tolerance;
+    int iterations;
+}Accuracy;
+
+#define ACCURACY_DEFAULT 0
+#define ACCURACY_FAST 1      // display grade, 1e-7 rad is about 0.6 m
+#define ACCURACY_SURVEY 2
+#define ACCURACY_COUNT 3
+
+static const Accuracy ACCURACY[ACCURACY_COUNT] = {{1e-10, 100}, {1e-7, 20}, {1e-12, 200}};
+
+// unknown profiles fall back to default one
+static inline const Accuracy *accuracy(Ellipsoid *ellps){
+    int k = ellps->accuracy;
+    return &ACCURACY[(k >= 0 && k < ACCURACY_COUNT) ? k : ACCURACY_DEFAULT];
+}
+
 typedef struct{
     Ellipsoid ellipsoid;
     Prime prime;
@@ -85,6 +112,7 @@ typedef struct{
     double x0;
     double y0;
     double azimut;
+    double gamma;
 }Crs;
 
 typedef struct{
@@ -93,6 +121,13 @@ typedef struct{
     double final_bearing;
 }Vincenty_dist;
 
+// distance modes of batch functions, approximate ones have no bearings
+#define DISTANCE_VINCENTY 0
+#define DISTANCE_KARNEY 1
+#define DISTANCE_HAVERSINE 2
+#define DISTANCE_ANDOYER 3
+#define DISTANCE_FLAT 4
+
 typedef struct{
     double longitude;
     double latitude;
@@ -137,6 +172,90 @@ typedef struct{
     double minute;
 }Dmm;
 
+// Structures of arrays for batch kernels : each member points to n values,
+// altitude members may be NULL (read as 0 / not written).
+typedef struct{
+    double *longitude;
+    double *latitude;
+    double *altitude;
+}Geodesics;
+
+typedef struct{
+    double *x;
+    double *y;
+    double *altitude;
+}Geographics;
+
+typedef struct{
+    double *x;
+    double *y;
+    double *z;
+}Geocentrics;
+
+// Crs ready for projection : coef holds projection specific constants
+// derived from crs parameters by the <name>_prepare functions.
+typedef struct Prepared Prepared;
+struct Prepared{
+    Crs crs;
+    Geographic (*forward)(Prepared *prep, Geodesic *lla);
+    Geodesic (*inverse)(Prepared *prep, Geographic *xya);
+    void (*forward_n)(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+    void (*inverse_n)(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+    void (*forward_soa)(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+    void (*inverse_soa)(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+    // rows of constant latitude, NULL if projection has no dedicated kernel
+    void (*graticule)(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya);
+    double coef[32];
+};
+
+// functions on prepared object, x and y being in crs unit, batch ones are
+// spread over worker threads unless serial
+EXPORT Geographic prepared_forward(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic prepared_inverse(Prepared *prep, Geographic *xya);
+EXPORT void prepared_forward_n_serial(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void prepared_inverse_n_serial(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void prepared_forward_n(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void prepared_inverse_n(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void prepared_forward_soa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void prepared_inverse_soa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+
+// graticules : nlat rows of constant latitude by nlon columns of constant
+// longitude (radians) at a single altitude, written row after row. Latitude
+// terms are computed once per row and longitude terms once per column of a
+// tile of GRATICULE_TILE rows. Projected graticules are in crs unit.
+#define GRATICULE_TILE 64
+EXPORT void prepared_graticule(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya);
+EXPORT void geocentric_graticule(Ellipsoid *ellps, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geocentric *xyz);
+
+// Vincenty geodesic problems (geoid.c) and pairwise batch distances
+EXPORT Vincenty_dist distance(Ellipsoid *ellps, Geodesic *start, Geodesic *stop);
+EXPORT Vincenty_dest destination(Ellipsoid *ellps, Geodesic *start, Vincenty_dist *dbb);
+EXPORT void distance_n(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, Vincenty_dist *result, size_t n, int mode);
+
+// seven parameters datum shift expressed as an affine transformation
+// xyz' = t + m.xyz, m being the (1+ds) scaled rotation matrix
+typedef struct{
+    double t[3];
+    double m[9];
+}Helmert;
+
+// <name>_prepare function type
+typedef void (*Prepare)(Crs *crs, Prepared *prep);
+
+// fused crs to crs transformation : deprojection, datum shift and
+// projection with all constants computed once
+typedef struct{
+    Prepared src;
+    Prepared dst;
+    Helmert helmert;
+}Transformer;
+
+EXPORT void transformer_init(Transformer *tr, Crs *src, Prepare src_prepare, Crs *dst, Prepare dst_prepare);
+EXPORT Geographic transform_point(Transformer *tr, Geographic *xya);
+EXPORT void transform_n(Transformer *tr, Geographic *xya, Geographic *result, size_t n);
+EXPORT void transform_n_serial(Transformer *tr, Geographic *xya, Geographic *result, size_t n);
+EXPORT void transform_soa(Transformer *tr, Geographics *xya, Geographics *result, size_t n);
+
 static long factorial(long n){
     long result = 1;
     if (n < 0) return -1;
@@ -154,48 +273,274 @@ static double p(double a, double e, double latitude) {return cos(latitude) * nhu
 static double rho(double a, double e, double latitude) {return  a * (1-e*e) / pow(1 - pow(e * sin(latitude), 2), 1.5);}
 static double isometric_latitude(double e, double latitude){return log(tan(M_PI/4 + latitude/2) * pow((1-e*sin(latitude))/(1+e*sin(latitude)), e/2));}
 
-static double geodesic_latitude(double e, double iso_phi){
-    double phi_i, sinphi_i, phi_ip1;
-    int i = 0;
-    phi_i = 2 * atan(exp(iso_phi)) - M_PI/2;
-    sinphi_i = sin(phi_i);
-    phi_ip1 = 2 * atan(pow((1+e*sinphi_i)/(1-e*sinphi_i), e/2) * exp(iso_phi)) - M_PI/2;
+// radius of the sphere having the ellipsoid area
+static inline double authalic_radius(Ellipsoid *ellps){
+    double e = ellps->e;
+    if (e < EPS) return ellps->a;
+    return ellps->a*sqrt((1 + (1 - e*e)/(2*e)*log((1 + e)/(1 - e)))/2);
+}
 
-    while ((fabs(phi_i - phi_ip1) > EPS) && (i < MAX_ITER)){
-        phi_i = phi_ip1;
-        sinphi_i = sin(phi_i);
-        phi_ip1 = 2 * atan(pow((1+e*sinphi_i)/(1-e*sinphi_i), e/2) * exp(iso_phi)) - M_PI/2;
-        i += 1;
+/*
+Source :
+Karney C.F.F. (2011) Transverse Mercator with an accuracy of a few nanometers
+J. Geodesy 85(8), 475-485, eq. (A5)
+
+Conformal to geodetic latitude series in third flattening n up to n^6 (error
+at rounding level on earth ellipsoids) evaluated with Clenshaw summation, so
+latitude is recovered from isometric latitude without iteration. k holds the
+CONFORMAL_COEF sin(2j.chi) coefficients computed once by conformal_init.
+*/
+#define CONFORMAL_COEF 6
+
+static void conformal_init(double e, double *k){
+    double r, n, n2, n3, n4, n5, n6;
+
+    r = sqrt(1 - e*e);
+    n = (1 - r)/(1 + r);
+    n2 = n*n; n3 = n2*n; n4 = n3*n; n5 = n4*n; n6 = n5*n;
+    k[0] = 2*n - 2*n2/3 - 2*n3 + 116*n4/45 + 26*n5/45 - 2854*n6/675;
+    k[1] = 7*n2/3 - 8*n3/5 - 227*n4/45 + 2704*n5/315 + 2323*n6/945;
+    k[2] = 56*n3/15 - 136*n4/35 - 1262*n5/105 + 73814*n6/2835;
+    k[3] = 4279*n4/630 - 332*n5/35 - 399572*n6/14175;
+    k[4] = 4174*n5/315 - 144838*n6/6237;
+    k[5] = 601676*n6/22275;
+}
+
+// geodetic latitude from conformal latitude chi with s = sin(chi), c = cos(chi)
+static inline double conformal_footpoint(double *k, double chi, double s, double c){
+    double s2, x, b0, b1, b2;
+    int j;
+
+    s2 = 2*s*c;
+    x = 2*(c*c - s*s);
+    b1 = b2 = 0.;
+    for (j=CONFORMAL_COEF-1; j>=0; j--){
+        b0 = x*b1 - b2 + k[j];
+        b2 = b1; b1 = b0;
     }
+    return chi + s2*b1;
+}
 
-    return phi_ip1;
+// geodetic latitude from isometric latitude
+static inline double geodesic_latitude_k(double *k, double iso_phi){
+    double s, c;
+    s = tanh(iso_phi);
+    c = 1/cosh(iso_phi);
+    return conformal_footpoint(k, atan2(s, c), s, c);
 }
 
-static double meridian_distance(double a, double e, double latitude){
-    double e2, e4, e6, e8;
-    double A0, A2, A4, A6, A8;
+static double geodesic_latitude(double e, double iso_phi){
+    double k[CONFORMAL_COEF];
+    conformal_init(e, k);
+    return geodesic_latitude_k(k, iso_phi);
+}
+
+/*
+Source :
+Helmert F.R. (1880) Die mathematischen und physikalischen Theorieen der
+hoheren Geodasie, series in third flattening n
+Deakin R.E., Hunter M.N. (2010) Geometric geodesy part A, § 1.5 and 1.6
+
+Meridian arc and its direct inversion (rectifying latitude to geodetic
+latitude) truncated at n^4, ie better than 0.1 micrometer on earth. The
+table depends only on the ellipsoid so it is computed once per projection :
+m[0]      : rectifying radius
+m[1..4]   : sin(2k.phi) coefficients of the meridian arc
+m[5..8]   : sin(2k.mu) coefficients of the footpoint latitude
+*/
+#define MERIDIAN_COEF 9
+
+static void meridian_init(double a, double e, double *m){
+    double b, n, n2, n3, n4;
+
+    b = a * sqrt(1 - e*e);
+    n = (a - b)/(a + b);
+    n2 = n*n; n3 = n2*n; n4 = n2*n2;
+    m[0] = a/(1 + n) * (1 + n2/4 + n4/64);
+    m[1] = -3*n/2 + 9*n3/16;
+    m[2] = 15*n2/16 - 15*n4/32;
+    m[3] = -35*n3/48;
+    m[4] = 315*n4/512;
+    m[5] = 3*n/2 - 27*n3/32;
+    m[6] = 21*n2/16 - 55*n4/32;
+    m[7] = 151*n3/96;
+    m[8] = 1097*n4/512;
+}
 
-    e2 = pow(e, 2); e4 = pow(e, 4); e6 = pow(e, 6); e8 = pow(e, 8);
-    A0 = 1 - e2/4 - 3*e4/64 - 5*e6/256 - 175*e8/16384;
-    A2 = -3*e2/8 - 3*e4/32 - 45*e6/1024 - 420*e8/16384;
-    A4 = 15*e4/256 + 45*e6/1024 + 525*e8/16384;
-    A6 = -35*e6/3072 - 175*e8/12288;
-    A8 = 315*e8/131072;
+// sum(k[i] * sin(2(i+1)x)) from s = sin(x) and c = cos(x)
+static inline double sin2k_sum(double *k, double s, double c){
+    double s2, c2, s4, c4, s6, s8;
+    s2 = 2*s*c; c2 = 1 - 2*s*s;
+    s4 = 2*s2*c2; c4 = 1 - 2*s2*s2;
+    s6 = s4*c2 + c4*s2;
+    s8 = 2*s4*c4;
+    return k[0]*s2 + k[1]*s4 + k[2]*s6 + k[3]*s8;
+}
+
+static inline double meridian_arc(double *m, double latitude){
+    return m[0] * (latitude + sin2k_sum(m+1, sin(latitude), cos(latitude)));
+}
+
+static inline double meridian_footpoint(double *m, double distance){
+    double mu = distance / m[0];
+    return mu + sin2k_sum(m+5, sin(mu), cos(mu));
+}
 
-    return a * (A0*latitude + A2*sin(2*latitude) + A4*sin(4*latitude) + A6*sin(6*latitude) + A8*sin(8*latitude));
+static double meridian_distance(double a, double e, double latitude){
+    double m[MERIDIAN_COEF];
+    meridian_init(a, e, m);
+    return meridian_arc(m, latitude);
 }
 
 static double footpoint_latitude(double a, double e, double distance){
-    double phi_ip1, phi_i;
+    double m[MERIDIAN_COEF];
+    meridian_init(a, e, m);
+    return meridian_footpoint(m, distance);
+}
+
+/*
+Source :
+The Mercator projections, Peter Osborne, 2008
+§ Chapter 5. The geometry of the ellipsoid
+*/
+static Geocentric lla2xyz(Ellipsoid *ellps, Geodesic *lla){
+    Geocentric result;
+    double v;
+
+    v = nhu(ellps->a, ellps->e, lla->latitude);
+    result.x = (v+lla->altitude) * cos(lla->latitude) * cos(lla->longitude);
+    result.y = (v+lla->altitude) * cos(lla->latitude) * sin(lla->longitude);
+    result.z = (v * (1 - pow(ellps->e,2)) + lla->altitude) * sin(lla->latitude);
+
+    return result;
+}
+
+static Geodesic xyz2lla(Ellipsoid *ellps, Geocentric *xyz){
+    const Accuracy *acc = accuracy(ellps);
+    Geodesic result;
+    double sqrt_xxpyy, phi_i, phi_ip1, e2;
     int i = 0;
-    phi_ip1 = distance/a;
-    phi_i = -phi_ip1;
 
-    while ((fabs(phi_i - phi_ip1) > EPS) && (i < MAX_ITER)){
+    e2 = ellps->e*ellps->e;
+    sqrt_xxpyy = sqrt(xyz->x*xyz->x + xyz->y*xyz->y);
+    phi_i = atan2(xyz->z, ((1 - e2) * sqrt_xxpyy));
+    phi_ip1 = atan2((xyz->z + e2 * nhu(ellps->a, ellps->e, phi_i) * sin(phi_i)), sqrt_xxpyy);
+
+    while ((fabs(phi_i - phi_ip1) > acc->tolerance) && (i < acc->iterations)){
         phi_i = phi_ip1;
-        phi_ip1 = phi_i - (meridian_distance(a, e, phi_i) - distance)/a;
+        phi_ip1 = atan2((xyz->z + e2 * nhu(ellps->a, ellps->e, phi_i) * sin(phi_i)), sqrt_xxpyy);
         i += 1;
     }
+    STATS_RECORD(STATS_GEODESIC, i, fabs(phi_i - phi_ip1) > acc->tolerance, xyz->x, xyz->y, xyz->z, 0.);
+
+    result.longitude = atan2(xyz->y, xyz->x);
+    result.latitude = phi_ip1;
+    result.altitude = 1/cos(phi_ip1) * sqrt_xxpyy - nhu(ellps->a, ellps->e, phi_ip1);
+
+    return result;
+}
+
+static void helmert(Datum *src, Datum *dst, Helmert *h){
+    double rx, ry, rz, k;
+
+    rx = (src->rx - dst->rx) * ARCSEC2RAD;
+    ry = (src->ry - dst->ry) * ARCSEC2RAD;
+    rz = (src->rz - dst->rz) * ARCSEC2RAD;
+    k = 1 + (src->ds - dst->ds) / 1000000.0;
+
+    h->t[0] = src->dx - dst->dx;
+    h->t[1] = src->dy - dst->dy;
+    h->t[2] = src->dz - dst->dz;
+    h->m[0] =     k; h->m[1] = -k*rz; h->m[2] =  k*ry;
+    h->m[3] =  k*rz; h->m[4] =     k; h->m[5] = -k*rx;
+    h->m[6] = -k*ry; h->m[7] =  k*rx; h->m[8] =     k;
+}
 
-    return phi_ip1;
+static Geocentric helmert_apply(Helmert *h, Geocentric *xyz){
+    Geocentric result;
+
+    result.x = h->t[0] + h->m[0]*xyz->x + h->m[1]*xyz->y + h->m[2]*xyz->z;
+    result.y = h->t[1] + h->m[3]*xyz->x + h->m[4]*xyz->y + h->m[5]*xyz->z;
+    result.z = h->t[2] + h->m[6]*xyz->x + h->m[7]*xyz->y + h->m[8]*xyz->z;
+
+    return result;
 }
+
+/*
+Prepared projection entry points : constants derived from crs parameters are
+computed once by <name>_prepare and single point, as well as batch, functions
+are defined on top of the prepared object. All of them work in crs unit.
+*/
+#define PREPARED_PROJECTION(name) \
+EXPORT Geographic name##_forward(Crs *crs, Geodesic *lla){ \
+	Prepared prep; \
+	name##_prepare(crs, &prep); \
+	return prepared_forward(&prep, lla); \
+} \
+EXPORT Geodesic name##_inverse(Crs *crs, Geographic *xya){ \
+	Prepared prep; \
+	name##_prepare(crs, &prep); \
+	return prepared_inverse(&prep, xya); \
+} \
+EXPORT void name##_forward_n(Crs *crs, Geodesic *lla, Geographic *xya, size_t n){ \
+	Prepared prep; \
+	name##_prepare(crs, &prep); \
+	prepared_forward_n(&prep, lla, xya, n); \
+} \
+EXPORT void name##_inverse_n(Crs *crs, Geographic *xya, Geodesic *lla, size_t n){ \
+	Prepared prep; \
+	name##_prepare(crs, &prep); \
+	prepared_inverse_n(&prep, xya, lla, n); \
+} \
+EXPORT void name##_forward_soa(Crs *crs, Geodesics *lla, Geographics *xya, size_t n){ \
+	Prepared prep; \
+	name##_prepare(crs, &prep); \
+	prepared_forward_soa(&prep, lla, xya, n); \
+} \
+EXPORT void name##_inverse_soa(Crs *crs, Geographics *xya, Geodesics *lla, size_t n){ \
+	Prepared prep; \
+	name##_prepare(crs, &prep); \
+	prepared_inverse_soa(&prep, xya, lla, n); \
+}
+
+// point by point batch on prepared object, for projections without a
+// dedicated vectorized kernel
+#define PREPARED_BATCH(name) \
+EXPORT void name##_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n){ \
+	size_t i; \
+	for (i=0; i<n; i++) xya[i] = name##_forward_p(prep, &lla[i]); \
+} \
+EXPORT void name##_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n){ \
+	size_t i; \
+	for (i=0; i<n; i++) lla[i] = name##_inverse_p(prep, &xya[i]); \
+} \
+EXPORT void name##_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n){ \
+	Geodesic p; \
+	Geographic r; \
+	size_t i; \
+	for (i=0; i<n; i++){ \
+		p.longitude = lla->longitude[i]; \
+		p.latitude = lla->latitude[i]; \
+		p.altitude = (lla->altitude != NULL) ? lla->altitude[i] : 0.; \
+		r = name##_forward_p(prep, &p); \
+		xya->x[i] = r.x; \
+		xya->y[i] = r.y; \
+		if (xya->altitude != NULL) xya->altitude[i] = r.altitude; \
+	} \
+} \
+EXPORT void name##_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n){ \
+	Geographic p; \
+	Geodesic r; \
+	size_t i; \
+	for (i=0; i<n; i++){ \
+		p.x = xya->x[i]; \
+		p.y = xya->y[i]; \
+		p.altitude = (xya->altitude != NULL) ? xya->altitude[i] : 0.; \
+		r = name##_inverse_p(prep, &p); \
+		lla->longitude[i] = r.longitude; \
+		lla->latitude[i] = r.latitude; \
+		if (lla->altitude != NULL) lla->altitude[i] = r.altitude; \
+	} \
+}
+
+#endif
@@ -0,0 +1,288 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <stdio.h>
+#include <string.h>
+#include "./grid.h"
+#include "./parallel.h"
+
+/*
+Source :
+DMA Technical Manual 8358.1, Datums, Ellipsoids, Grids and Grid Reference
+Systems (UTM zones, latitude bands and MGRS 100 km squares)
+Ordnance Survey, A guide to coordinate systems in Great Britain (BNG letters)
+Ordnance Survey Ireland, The Irish Grid (ING letters)
+*/
+
+// latitude bands from 80S, 8 degrees each except X (72N to 84N)
+static const char *UTM_BAND = "CDEFGHJKLMNPQRSTUVWX";
+// MGRS column letters, key = zone number % 3
+static const char *E_LETTER[3] = {"STUVWXYZ", "ABCDEFGH", "JKLMNPQR"};
+// MGRS row letters, key = zone number % 2
+static const char *N_LETTER[2] = {"FGHJKLMNPQRSTUVABCDE", "ABCDEFGHJKLMNPQRSTUV"};
+// Bessel 1841 (Ethiopia, Indonesia), Bessel 1841 (Namibia), Clarke 1866 and
+// Clarke 1880 use shifted row letters
+static const char *N_SHIFTED[2] = {"RSTUVABCDEFGHJKLMNPQ", "LMNPQRSTUVABCDEFGHJK"};
+// national grid letters, 5x5 squares from north west corner
+static const char *NG_LETTER = "ABCDEFGHJKLMNOPQRSTUVWXYZ";
+
+typedef struct{
+	Prepared *tm;
+	void *src;
+	void *dst;
+	char *area;
+}Job;
+
+// index of c in letters, -1 if not found
+static int letter_index(const char *letters, char c){
+	const char *found = (c != '\0') ? strchr(letters, c) : NULL;
+	return (found != NULL) ? (int)(found - letters) : -1;
+}
+
+static int shifted(Prepared *zone){
+	int epsg = zone->crs.datum.ellipsoid.epsg;
+	return epsg == 7004 || epsg == 7006 || epsg == 7008 || epsg == 7012;
+}
+
+EXPORT int utm_zone(double longitude, double latitude){
+	double lon, lat;
+
+	lon = longitude + M_PI;
+	lon = (lon - trunc(lon/TWO_PI)*TWO_PI - M_PI)*RADIAN2DEG;
+	lat = latitude*RADIAN2DEG;
+	if (64.0 > lat && lat >= 56.0 && 12.0 > lon && lon >= 3.0)
+		return 32;
+	// special zones for Svalbard
+	if (72.0 <= lat && lat < 84.0){
+		if (0.0 <= lon && lon < 9.0) return 31;
+		else if (0.0 <= lon && lon < 21.0) return 33;
+		else if (0.0 <= lon && lon < 33.0) return 35;
+		else if (0.0 <= lon && lon < 42.0) return 37;
+	}
+	return (int)((lon + 180)/6) + 1;
+}
+
+EXPORT char utm_letter(double latitude){
+	double lat = latitude*RADIAN2DEG;
+	int i;
+
+	if (lat >= 84 || lat < -80) return 'Z';
+	if (lat >= 72) return 'X';
+	// band limits are integers so the division is only a first guess
+	i = (int)floor((lat + 80)/8);
+	if (lat < -80 + 8*i) i--;
+	else if (lat >= -72 + 8*i) i++;
+	return UTM_BAND[i];
+}
+
+static void utm_set(Prepared *zone, int number, int south){
+	zone->crs.lambda0 = ((number-1)*6 - 180 + 3)*DEGREE2RAD;
+	zone->crs.x0 = 500000.0;
+	zone->crs.y0 = south ? 10000000.0 : 0.;
+	zone->crs.k0 = 0.9996;
+}
+
+// "<number><letter>" area, return the number of chars read
+static int utm_parse(const char *area, int *number, char *letter){
+	int i = 0;
+
+	*number = 0;
+	while (area[i] >= '0' && area[i] <= '9' && i < 3)
+		*number = *number*10 + area[i++] - '0';
+	if (i == 0 || *number == 0 || area[i] < 'A' || area[i] > 'Z')
+		return 0;
+	*letter = area[i];
+	return i+1;
+}
+
+static void utm_project(Prepared *zone, Geodesic *lla, Geographic *xya, int *number, char *letter){
+	*number = utm_zone(lla->longitude, lla->latitude);
+	*letter = utm_letter(lla->latitude);
+	utm_set(zone, *number, lla->latitude < 0);
+	*xya = zone->forward(zone, lla);
+	xya->altitude = lla->altitude;
+}
+
+static int utm_enc(Prepared *zone, Geodesic *lla, Geographic *xya, char *area){
+	int number;
+	char letter;
+
+	utm_project(zone, lla, xya, &number, &letter);
+	snprintf(area, GRID_AREA, "%d%c", number, letter);
+	return 1;
+}
+
+static int utm_dec(Prepared *zone, Geographic *xya, const char *area, Geodesic *lla){
+	int number, i;
+	char letter;
+
+	i = utm_parse(area, &number, &letter);
+	if (i == 0 || area[i] != '\0') return 0;
+	utm_set(zone, number, letter < 'N');
+	*lla = zone->inverse(zone, xya);
+	return 1;
+}
+
+static int mgrs_enc(Prepared *zone, Geodesic *lla, Geographic *xya, char *area){
+	int number, col, row;
+	char letter;
+
+	utm_project(zone, lla, xya, &number, &letter);
+	col = (int)floor(xya->x/100000.0);
+	row = (int)floor(xya->y/100000.0);
+	xya->x -= col*100000.0;
+	xya->y -= row*100000.0;
+
+	// column 0 is the last letter of the set as python negative index was
+	col = (col < 1) ? col + 7 : col - 1;
+	row %= 20;
+	if (row < 0) row += 20;
+	if (col < 0 || col > 7){
+		area[0] = '\0';
+		return 0;
+	}
+	snprintf(
+		area, GRID_AREA, "%d%c %c%c", number, letter, E_LETTER[number%3][col],
+		(shifted(zone) ? N_SHIFTED : N_LETTER)[number%2][row]
+	);
+	return 1;
+}
+
+static int mgrs_dec(Prepared *zone, Geographic *xya, const char *area, Geodesic *lla){
+	Geographic utm = *xya;
+	int number, band, col, row, south, i;
+	char letter;
+	double northing;
+
+	i = utm_parse(area, &number, &letter);
+	if (i == 0 || area[i] != ' ') return 0;
+	while (area[i] == ' ') i++;
+	if (area[i] == '\0' || area[i+1] == '\0' || area[i+2] != '\0') return 0;
+
+	band = letter_index(UTM_BAND, letter);
+	col = letter_index(E_LETTER[number%3], area[i]);
+	row = letter_index((shifted(zone) ? N_SHIFTED : N_LETTER)[number%2], area[i+1]);
+	if (band < 0 || col < 0 || row < 0) return 0;
+
+	// row letters cycle every 2000 km : take the first row above the lowest
+	// northing of the latitude band (k0 = 0.9996), lowered by 100 km for the
+	// curvature of parallels at zone edges
+	south = letter < 'N';
+	northing = 0.9996*meridian_distance(
+		zone->crs.datum.ellipsoid.a, zone->crs.datum.ellipsoid.e,
+		(-80 + 8*band)*DEGREE2RAD
+	) + (south ? 10000000.0 : 0.) - 100000.;
+	utm.x += (col+1)*100000.;
+	utm.y += row*100000. + 2000000.*ceil((northing - row*100000.)/2000000.);
+
+	utm_set(zone, number, south);
+	*lla = zone->inverse(zone, &utm);
+	return 1;
+}
+
+// 500 km and 100 km squares of the national grid coordinates
+static void ng_square(Geographic *xya, double size, int *e, int *n){
+	*e = (int)floor(xya->x/size);
+	xya->x -= *e*size;
+	*n = (int)floor(xya->y/size);
+	xya->y -= *n*size;
+}
+
+static int bng_enc(Prepared *zone, Geodesic *lla, Geographic *xya, char *area){
+	int e5, n5, e1, n1;
+
+	*xya = zone->forward(zone, lla);
+	ng_square(xya, 500000., &e5, &n5);
+	ng_square(xya, 100000., &e1, &n1);
+	if (e5 < -2 || e5 > 2 || n5 < -1 || n5 > 3 || e1 > 4 || n1 > 4){
+		area[0] = '\0';
+		return 0;
+	}
+	area[0] = NG_LETTER[(3-n5)*5 + e5+2];
+	area[1] = NG_LETTER[(4-n1)*5 + e1];
+	area[2] = '\0';
+	return 1;
+}
+
+static int bng_dec(Prepared *zone, Geographic *xya, const char *area, Geodesic *lla){
+	Geographic ng = *xya;
+	int i5, i1;
+
+	i5 = letter_index(NG_LETTER, area[0]);
+	i1 = (i5 < 0) ? -1 : letter_index(NG_LETTER, area[1]);
+	if (i1 < 0 || area[2] != '\0') return 0;
+
+	ng.x = xya->x + (i5%5 - 2)*500000. + (i1%5)*100000.;
+	ng.y = xya->y + (3 - i5/5)*500000. + (4 - i1/5)*100000.;
+	*lla = zone->inverse(zone, &ng);
+	return 1;
+}
+
+static int ing_enc(Prepared *zone, Geodesic *lla, Geographic *xya, char *area){
+	int e1, n1;
+
+	*xya = zone->forward(zone, lla);
+	ng_square(xya, 100000., &e1, &n1);
+	if (e1 < 0 || e1 > 4 || n1 < 0 || n1 > 4){
+		area[0] = '\0';
+		return 0;
+	}
+	area[0] = NG_LETTER[(4-n1)*5 + e1];
+	area[1] = '\0';
+	return 1;
+}
+
+static int ing_dec(Prepared *zone, Geographic *xya, const char *area, Geodesic *lla){
+	Geographic ng = *xya;
+	int i1;
+
+	i1 = letter_index(NG_LETTER, area[0]);
+	if (i1 < 0 || area[1] != '\0') return 0;
+
+	ng.x = (i1%5)*100000. + xya->x;
+	ng.y = (4 - i1/5)*100000. + xya->y;
+	*lla = zone->inverse(zone, &ng);
+	return 1;
+}
+
+// scalar functions work on a copy of tm so that it is left untouched, batch
+// tasks copy it once per chunk
+#define GRID_REFERENCE(name) \
+EXPORT int name##_encode(Prepared *tm, Geodesic *lla, Geographic *xya, char *area){ \
+	Prepared zone = *tm; \
+	return name##_enc(&zone, lla, xya, area); \
+} \
+EXPORT int name##_decode(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla){ \
+	Prepared zone = *tm; \
+	return name##_dec(&zone, xya, area, lla); \
+} \
+static void name##_encode_task(void *ctx, size_t start, size_t stop){ \
+	Job *job = (Job *)ctx; \
+	Prepared zone = *job->tm; \
+	size_t i; \
+	for (i=start; i<stop; i++) \
+		name##_enc(&zone, (Geodesic *)job->src + i, (Geographic *)job->dst + i, job->area + i*GRID_AREA); \
+} \
+static void name##_decode_task(void *ctx, size_t start, size_t stop){ \
+	Job *job = (Job *)ctx; \
+	Prepared zone = *job->tm; \
+	Geodesic *lla; \
+	size_t i; \
+	for (i=start; i<stop; i++){ \
+		lla = (Geodesic *)job->dst + i; \
+		if (!name##_dec(&zone, (Geographic *)job->src + i, job->area + i*GRID_AREA, lla)) \
+			lla->longitude = lla->latitude = lla->altitude = NAN; \
+	} \
+} \
+EXPORT void name##_encode_n(Prepared *tm, Geodesic *lla, Geographic *xya, char *area, size_t n){ \
+	Job job = {tm, lla, xya, area}; \
+	parallel_for(name##_encode_task, &job, n); \
+} \
+EXPORT void name##_decode_n(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla, size_t n){ \
+	Job job = {tm, xya, lla, (char *)area}; \
+	parallel_for(name##_decode_task, &job, n); \
+}
+
+GRID_REFERENCE(utm)
+GRID_REFERENCE(mgrs)
+GRID_REFERENCE(bng)
+GRID_REFERENCE(ing)
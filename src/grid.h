@@ -0,0 +1,45 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Grid references on top of a prepared transverse mercator : UTM and MGRS
+// zones are derived from geodesic coordinates, BNG and ING letters from the
+// national grid coordinates. Areas are null terminated strings of at most
+// GRID_AREA chars ("31T", "31T DJ", "TQ" or "O").
+
+#ifndef GRID_H
+#define GRID_H
+
+#include "./geoid.h"
+
+// area buffer size, null char included
+#define GRID_AREA 8
+
+// zone number and latitude band letter ('Z' outside 80S-84N), radians
+EXPORT int utm_zone(double longitude, double latitude);
+EXPORT char utm_letter(double latitude);
+
+// tm is a transverse mercator prepared with phi0 = 0 on the UTM ellipsoid,
+// lambda0, x0, y0 and k0 are set according to the zone. With BNG and ING, tm
+// is the prepared national grid. Encoders return 0 when point is outside the
+// grid and decoders when area is not a valid one.
+EXPORT int utm_encode(Prepared *tm, Geodesic *lla, Geographic *xya, char *area);
+EXPORT int utm_decode(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla);
+EXPORT int mgrs_encode(Prepared *tm, Geodesic *lla, Geographic *xya, char *area);
+EXPORT int mgrs_decode(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla);
+EXPORT int bng_encode(Prepared *tm, Geodesic *lla, Geographic *xya, char *area);
+EXPORT int bng_decode(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla);
+EXPORT int ing_encode(Prepared *tm, Geodesic *lla, Geographic *xya, char *area);
+EXPORT int ing_decode(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla);
+
+// batch functions, area holds n GRID_AREA buffers. Failed encodings get an
+// empty area and failed decodings NaN coordinates.
+EXPORT void utm_encode_n(Prepared *tm, Geodesic *lla, Geographic *xya, char *area, size_t n);
+EXPORT void utm_decode_n(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla, size_t n);
+EXPORT void mgrs_encode_n(Prepared *tm, Geodesic *lla, Geographic *xya, char *area, size_t n);
+EXPORT void mgrs_decode_n(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla, size_t n);
+EXPORT void bng_encode_n(Prepared *tm, Geodesic *lla, Geographic *xya, char *area, size_t n);
+EXPORT void bng_decode_n(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla, size_t n);
+EXPORT void ing_encode_n(Prepared *tm, Geodesic *lla, Geographic *xya, char *area, size_t n);
+EXPORT void ing_decode_n(Prepared *tm, Geographic *xya, const char *area, Geodesic *lla, size_t n);
+
+#endif
@@ -0,0 +1,140 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Stable C API of the geoid and proj libraries for C and C++ programs. It
+// does not depend on geoid.h : objects are opaque handles and coordinates
+// are tables of n triples of doubles (longitude, latitude, altitude in
+// radians and meters, x, y, altitude in crs unit or geocentric x, y, z in
+// meters). Handles are immutable once created, so they can be shared by any
+// number of threads without locking. Computing functions only write their
+// output table, run on the caller thread and do not depend on set_threads.
+//
+// Ellipsoid, datum and crs handles are created by both libraries and can be
+// used with either of them. Snapshot lookups and geodesic problems are in
+// geoid, prepared crs and transformers in proj. handle.c is compiled into
+// both libraries, so a program linking both gets gryd_abi_version and the
+// ellipsoid, datum and crs functions from whichever library loads first.
+
+#ifndef GRYD_H
+#define GRYD_H
+
+#include <stddef.h>
+
+#if defined(EXPORT)
+    #define GRYD_API EXPORT
+#elif _WIN32
+    #define GRYD_API __declspec(dllimport)
+#else
+    #define GRYD_API extern
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// incremented on any incompatible change of the functions below
+#define GRYD_ABI_VERSION 1
+
+typedef struct GrydSnapshot GrydSnapshot;
+typedef struct GrydEllipsoid GrydEllipsoid;
+typedef struct GrydDatum GrydDatum;
+typedef struct GrydCrs GrydCrs;
+typedef struct GrydPrepared GrydPrepared;
+typedef struct GrydTransformer GrydTransformer;
+
+// return codes of computing functions
+#define GRYD_OK 0
+#define GRYD_EHANDLE 1       // NULL handle or handle of another type, passing
+                             // a freed handle is undefined
+#define GRYD_EARGUMENT 2     // NULL table or unknown mode
+
+// solver accuracy profiles, GRYD_ACCURACY_KEEP leaves the ellipsoid one
+#define GRYD_ACCURACY_KEEP -1
+#define GRYD_ACCURACY_DEFAULT 0
+#define GRYD_ACCURACY_FAST 1
+#define GRYD_ACCURACY_SURVEY 2
+
+// distance modes
+#define GRYD_DISTANCE_VINCENTY 0
+#define GRYD_DISTANCE_KARNEY 1
+#define GRYD_DISTANCE_HAVERSINE 2
+#define GRYD_DISTANCE_ANDOYER 3
+#define GRYD_DISTANCE_FLAT 4
+
+// gryd_crs_new parameters, angles in radians
+#define GRYD_LAMBDA0 0
+#define GRYD_PHI0 1
+#define GRYD_PHI1 2
+#define GRYD_PHI2 3
+#define GRYD_K0 4
+#define GRYD_X0 5
+#define GRYD_Y0 6
+#define GRYD_AZIMUT 7
+#define GRYD_GAMMA 8
+#define GRYD_PARAMETERS 9
+
+// longest projection name, null terminated
+#define GRYD_NAME 16
+
+// GRYD_ABI_VERSION the library was built with
+GRYD_API int gryd_abi_version(void);
+
+// constructors return NULL on bad parameters or memory error, free functions
+// accept NULL. rf is the inverse flattening, 0 for a sphere.
+GRYD_API GrydEllipsoid *gryd_ellipsoid_new(int epsg, double a, double rf, int accuracy);
+GRYD_API void gryd_ellipsoid_free(GrydEllipsoid *ellps);
+GRYD_API int gryd_ellipsoid_epsg(const GrydEllipsoid *ellps);
+GRYD_API int gryd_ellipsoid_axes(const GrydEllipsoid *ellps, double *a, double *b);
+
+// prime meridian longitude in radians, towgs84 is the seven parameters
+// shift ds (ppm), dx, dy, dz (meters), rx, ry, rz (arc seconds), NULL for
+// none
+GRYD_API GrydDatum *gryd_datum_new(const GrydEllipsoid *ellps, int epsg, double prime, const double *towgs84);
+GRYD_API void gryd_datum_free(GrydDatum *datum);
+GRYD_API int gryd_datum_epsg(const GrydDatum *datum);
+// geodesic to geocentric coordinates and back, longitudes from datum prime
+// meridian
+GRYD_API int gryd_datum_geocentric(const GrydDatum *datum, const double *lla, double *xyz, size_t n);
+GRYD_API int gryd_datum_geodesic(const GrydDatum *datum, const double *xyz, double *lla, size_t n);
+// geocentric coordinates from src to dst datum
+GRYD_API int gryd_datum_shift(const GrydDatum *src, const GrydDatum *dst, const double *xyz, double *result, size_t n);
+
+// ratio is the crs unit in meters, parameters GRYD_PARAMETERS values indexed
+// by GRYD_LAMBDA0...GRYD_GAMMA, a NaN gamma standing for the azimut one
+GRYD_API GrydCrs *gryd_crs_new(const GrydDatum *datum, int epsg, const char *projection, double ratio, const double *parameters);
+GRYD_API void gryd_crs_free(GrydCrs *crs);
+GRYD_API int gryd_crs_epsg(const GrydCrs *crs);
+GRYD_API const char *gryd_crs_projection(const GrydCrs *crs);
+
+// geoid : EPSG snapshot built with the package (Gryd/db/epsg.bin), objects
+// are copied so they outlive the snapshot
+GRYD_API GrydSnapshot *gryd_snapshot_open(const char *path);
+GRYD_API void gryd_snapshot_close(GrydSnapshot *snap);
+GRYD_API GrydEllipsoid *gryd_snapshot_ellipsoid(const GrydSnapshot *snap, int epsg);
+GRYD_API GrydDatum *gryd_snapshot_datum(const GrydSnapshot *snap, int epsg);
+GRYD_API GrydCrs *gryd_snapshot_crs(const GrydSnapshot *snap, int epsg);
+
+// geoid : pairwise distances, result holds n triples of distance, initial
+// and final bearings (0 in approximate modes)
+GRYD_API int gryd_ellipsoid_distance(const GrydEllipsoid *ellps, const double *lla0, const double *lla1, double *result, size_t n, int mode);
+// geoid : points reached from lla along dbb triples of distance and initial
+// bearing (third value ignored), result holds longitude, latitude and final
+// bearing triples. Mode is GRYD_DISTANCE_VINCENTY or GRYD_DISTANCE_KARNEY.
+GRYD_API int gryd_ellipsoid_destination(const GrydEllipsoid *ellps, const double *lla, const double *dbb, double *result, size_t n, int mode);
+
+// proj : crs ready for projection, NULL if projection is not a C one
+GRYD_API GrydPrepared *gryd_prepared_new(const GrydCrs *crs, int accuracy);
+GRYD_API void gryd_prepared_free(GrydPrepared *prep);
+GRYD_API int gryd_prepared_forward(const GrydPrepared *prep, const double *lla, double *xya, size_t n);
+GRYD_API int gryd_prepared_inverse(const GrydPrepared *prep, const double *xya, double *lla, size_t n);
+
+// proj : crs to crs transformation, accuracy applies to both ellipsoids
+GRYD_API GrydTransformer *gryd_transformer_new(const GrydCrs *src, const GrydCrs *dst, int accuracy);
+GRYD_API void gryd_transformer_free(GrydTransformer *tr);
+GRYD_API int gryd_transformer_apply(const GrydTransformer *tr, const double *xya, double *result, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,182 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <string.h>
+#include "./handle.h"
+
+// gryd.h functions common to geoid and proj libraries
+
+EXPORT int gryd_abi_version(void){
+	return GRYD_ABI_VERSION;
+}
+
+void *handle_new(size_t size, uint32_t magic){
+	void *handle = calloc(1, size);
+	if (handle != NULL) *(uint32_t *)handle = magic;
+	return handle;
+}
+
+void handle_free(void *handle, uint32_t magic){
+	if (handle == NULL || *(uint32_t *)handle != magic) return;
+	*(uint32_t *)handle = 0;
+	free(handle);
+}
+
+GrydEllipsoid *handle_ellipsoid(const Ellipsoid *ellps){
+	GrydEllipsoid *handle = handle_new(sizeof(GrydEllipsoid), HANDLE_ELLIPSOID);
+	if (handle != NULL) handle->ellipsoid = *ellps;
+	return handle;
+}
+
+GrydDatum *handle_datum(const Datum *datum){
+	GrydDatum *handle = handle_new(sizeof(GrydDatum), HANDLE_DATUM);
+	if (handle != NULL) handle->datum = *datum;
+	return handle;
+}
+
+GrydCrs *handle_crs(const Crs *crs, const char *projection){
+	GrydCrs *handle;
+
+	if (projection == NULL) projection = "latlong";
+	if (strlen(projection) >= GRYD_NAME) return NULL;
+	if ((handle = handle_new(sizeof(GrydCrs), HANDLE_CRS)) == NULL) return NULL;
+	handle->crs = *crs;
+	strcpy(handle->projection, projection);
+	return handle;
+}
+
+EXPORT GrydEllipsoid *gryd_ellipsoid_new(int epsg, double a, double rf, int accuracy){
+	Ellipsoid ellps;
+	double f = (rf != 0.) ? 1/rf : 0.;
+
+	if (!(a > 0.) || f < 0. || f >= 1. || accuracy < 0 || accuracy >= ACCURACY_COUNT) return NULL;
+	ellps.epsg = epsg;
+	ellps.a = a;
+	ellps.f = f;
+	ellps.b = a*(1 - f);
+	ellps.e = sqrt(2*f - f*f);
+	ellps.accuracy = accuracy;
+	return handle_ellipsoid(&ellps);
+}
+
+EXPORT void gryd_ellipsoid_free(GrydEllipsoid *ellps){
+	handle_free(ellps, HANDLE_ELLIPSOID);
+}
+
+EXPORT int gryd_ellipsoid_epsg(const GrydEllipsoid *ellps){
+	return HANDLE_VALID(ellps, HANDLE_ELLIPSOID) ? ellps->ellipsoid.epsg : 0;
+}
+
+EXPORT int gryd_ellipsoid_axes(const GrydEllipsoid *ellps, double *a, double *b){
+	if (!HANDLE_VALID(ellps, HANDLE_ELLIPSOID)) return GRYD_EHANDLE;
+	if (a != NULL) *a = ellps->ellipsoid.a;
+	if (b != NULL) *b = ellps->ellipsoid.b;
+	return GRYD_OK;
+}
+
+EXPORT GrydDatum *gryd_datum_new(const GrydEllipsoid *ellps, int epsg, double prime, const double *towgs84){
+	Datum datum;
+
+	if (!HANDLE_VALID(ellps, HANDLE_ELLIPSOID)) return NULL;
+	memset(&datum, 0, sizeof(Datum));
+	datum.ellipsoid = ellps->ellipsoid;
+	datum.prime.longitude = prime;
+	datum.epsg = epsg;
+	if (towgs84 != NULL){
+		datum.ds = towgs84[0];
+		datum.dx = towgs84[1];
+		datum.dy = towgs84[2];
+		datum.dz = towgs84[3];
+		datum.rx = towgs84[4];
+		datum.ry = towgs84[5];
+		datum.rz = towgs84[6];
+	}
+	return handle_datum(&datum);
+}
+
+EXPORT void gryd_datum_free(GrydDatum *datum){
+	handle_free(datum, HANDLE_DATUM);
+}
+
+EXPORT int gryd_datum_epsg(const GrydDatum *datum){
+	return HANDLE_VALID(datum, HANDLE_DATUM) ? datum->datum.epsg : 0;
+}
+
+EXPORT int gryd_datum_geocentric(const GrydDatum *datum, const double *lla, double *xyz, size_t n){
+	Ellipsoid *ellps;
+	Geodesic point;
+	size_t i;
+
+	if (!HANDLE_VALID(datum, HANDLE_DATUM)) return GRYD_EHANDLE;
+	if (n > 0 && (lla == NULL || xyz == NULL)) return GRYD_EARGUMENT;
+	ellps = (Ellipsoid *)&datum->datum.ellipsoid;
+	for (i=0; i<n; i++){
+		point = ((const Geodesic *)lla)[i];
+		point.longitude += datum->datum.prime.longitude;
+		((Geocentric *)xyz)[i] = lla2xyz(ellps, &point);
+	}
+	return GRYD_OK;
+}
+
+EXPORT int gryd_datum_geodesic(const GrydDatum *datum, const double *xyz, double *lla, size_t n){
+	Ellipsoid *ellps;
+	Geocentric point;
+	Geodesic *result = (Geodesic *)lla;
+	size_t i;
+
+	if (!HANDLE_VALID(datum, HANDLE_DATUM)) return GRYD_EHANDLE;
+	if (n > 0 && (lla == NULL || xyz == NULL)) return GRYD_EARGUMENT;
+	ellps = (Ellipsoid *)&datum->datum.ellipsoid;
+	for (i=0; i<n; i++){
+		point = ((const Geocentric *)xyz)[i];
+		result[i] = xyz2lla(ellps, &point);
+		result[i].longitude -= datum->datum.prime.longitude;
+	}
+	return GRYD_OK;
+}
+
+EXPORT int gryd_datum_shift(const GrydDatum *src, const GrydDatum *dst, const double *xyz, double *result, size_t n){
+	Helmert h;
+	Geocentric point;
+	size_t i;
+
+	if (!HANDLE_VALID(src, HANDLE_DATUM) || !HANDLE_VALID(dst, HANDLE_DATUM)) return GRYD_EHANDLE;
+	if (n > 0 && (xyz == NULL || result == NULL)) return GRYD_EARGUMENT;
+	helmert((Datum *)&src->datum, (Datum *)&dst->datum, &h);
+	for (i=0; i<n; i++){
+		point = ((const Geocentric *)xyz)[i];
+		((Geocentric *)result)[i] = helmert_apply(&h, &point);
+	}
+	return GRYD_OK;
+}
+
+EXPORT GrydCrs *gryd_crs_new(const GrydDatum *datum, int epsg, const char *projection, double ratio, const double *parameters){
+	Crs crs;
+
+	if (!HANDLE_VALID(datum, HANDLE_DATUM) || !(ratio > 0.) || parameters == NULL) return NULL;
+	memset(&crs, 0, sizeof(Crs));
+	crs.datum = datum->datum;
+	crs.unit.ratio = ratio;
+	crs.epsg = epsg;
+	crs.lambda0 = parameters[GRYD_LAMBDA0];
+	crs.phi0 = parameters[GRYD_PHI0];
+	crs.phi1 = parameters[GRYD_PHI1];
+	crs.phi2 = parameters[GRYD_PHI2];
+	crs.k0 = parameters[GRYD_K0];
+	crs.x0 = parameters[GRYD_X0];
+	crs.y0 = parameters[GRYD_Y0];
+	crs.azimut = parameters[GRYD_AZIMUT];
+	crs.gamma = parameters[GRYD_GAMMA];
+	return handle_crs(&crs, projection);
+}
+
+EXPORT void gryd_crs_free(GrydCrs *crs){
+	handle_free(crs, HANDLE_CRS);
+}
+
+EXPORT int gryd_crs_epsg(const GrydCrs *crs){
+	return HANDLE_VALID(crs, HANDLE_CRS) ? crs->crs.epsg : 0;
+}
+
+EXPORT const char *gryd_crs_projection(const GrydCrs *crs){
+	return HANDLE_VALID(crs, HANDLE_CRS) ? crs->projection : NULL;
+}
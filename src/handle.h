@@ -0,0 +1,64 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Layout of the gryd.h opaque handles, shared by geoid and proj libraries so
+// that a handle created by one is usable by the other. Every handle starts
+// with a magic number checked on each call to reject NULL handles and
+// handles of another type. It is cleared when the handle is freed, but freed
+// memory may be reused at once, so passing a freed handle is undefined.
+// Coordinate triples are read in place as the geoid.h structures and
+// handles are never written once returned, kernels taking non const
+// pointers only read them.
+
+#ifndef HANDLE_H
+#define HANDLE_H
+
+#include <stdint.h>
+#include "./geoid.h"
+#include "./gryd.h"
+
+#define HANDLE_ELLIPSOID 0x47524501
+#define HANDLE_DATUM 0x47524502
+#define HANDLE_CRS 0x47524503
+#define HANDLE_PREPARED 0x47524504
+#define HANDLE_TRANSFORMER 0x47524505
+#define HANDLE_SNAPSHOT 0x47524506
+
+#define HANDLE_VALID(handle, kind) ((handle) != NULL && (handle)->magic == (kind))
+
+struct GrydEllipsoid{
+    uint32_t magic;
+    Ellipsoid ellipsoid;
+};
+
+struct GrydDatum{
+    uint32_t magic;
+    Datum datum;
+};
+
+struct GrydCrs{
+    uint32_t magic;
+    Crs crs;
+    char projection[GRYD_NAME];
+};
+
+struct GrydPrepared{
+    uint32_t magic;
+    Prepared prepared;
+};
+
+struct GrydTransformer{
+    uint32_t magic;
+    Transformer transformer;
+};
+
+// new handle with magic set, NULL on memory error
+void *handle_new(size_t size, uint32_t magic);
+void handle_free(void *handle, uint32_t magic);
+
+// copy record into a new handle, projection may be NULL (latlong)
+GrydEllipsoid *handle_ellipsoid(const Ellipsoid *ellps);
+GrydDatum *handle_datum(const Datum *datum);
+GrydCrs *handle_crs(const Crs *crs, const char *projection);
+
+#endif
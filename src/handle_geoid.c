@@ -0,0 +1,103 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include "./handle.h"
+#include "./snapshot.h"
+#include "./karney.h"
+
+// gryd.h functions of geoid library
+
+EXPORT Vincenty_dist distance_haversine(Ellipsoid *ellps, Geodesic *start, Geodesic *stop);
+EXPORT Vincenty_dist distance_andoyer(Ellipsoid *ellps, Geodesic *start, Geodesic *stop);
+EXPORT Vincenty_dist distance_flat(Ellipsoid *ellps, Geodesic *start, Geodesic *stop);
+
+struct GrydSnapshot{
+	uint32_t magic;
+	Snapshot *snap;
+};
+
+EXPORT GrydSnapshot *gryd_snapshot_open(const char *path){
+	GrydSnapshot *handle;
+	Snapshot *snap;
+
+	if ((snap = snapshot_open(path)) == NULL) return NULL;
+	if ((handle = handle_new(sizeof(GrydSnapshot), HANDLE_SNAPSHOT)) == NULL){
+		snapshot_close(snap);
+		return NULL;
+	}
+	handle->snap = snap;
+	return handle;
+}
+
+EXPORT void gryd_snapshot_close(GrydSnapshot *snap){
+	if (!HANDLE_VALID(snap, HANDLE_SNAPSHOT)) return;
+	snapshot_close(snap->snap);
+	handle_free(snap, HANDLE_SNAPSHOT);
+}
+
+// record of epsg id in table, NULL if not found
+static const void *record(const GrydSnapshot *snap, int table, int epsg, long *index){
+	if (!HANDLE_VALID(snap, HANDLE_SNAPSHOT)) return NULL;
+	if ((*index = snapshot_find(snap->snap, table, epsg)) < 0) return NULL;
+	return snapshot_value(snap->snap, table, *index);
+}
+
+EXPORT GrydEllipsoid *gryd_snapshot_ellipsoid(const GrydSnapshot *snap, int epsg){
+	long index;
+	const Ellipsoid *ellps = record(snap, SNAPSHOT_ELLIPSOID, epsg, &index);
+	return (ellps != NULL) ? handle_ellipsoid(ellps) : NULL;
+}
+
+EXPORT GrydDatum *gryd_snapshot_datum(const GrydSnapshot *snap, int epsg){
+	long index;
+	const Datum *datum = record(snap, SNAPSHOT_DATUM, epsg, &index);
+	return (datum != NULL) ? handle_datum(datum) : NULL;
+}
+
+// projection name is the third string of crs records
+EXPORT GrydCrs *gryd_snapshot_crs(const GrydSnapshot *snap, int epsg){
+	long index;
+	const Crs *crs = record(snap, SNAPSHOT_CRS, epsg, &index);
+	return (crs != NULL) ? handle_crs(crs, snapshot_text(snap->snap, SNAPSHOT_CRS, index, 2)) : NULL;
+}
+
+EXPORT int gryd_ellipsoid_distance(const GrydEllipsoid *ellps, const double *lla0, const double *lla1, double *result, size_t n, int mode){
+	Ellipsoid *e;
+	Geodesic *start = (Geodesic *)lla0, *stop = (Geodesic *)lla1;
+	Vincenty_dist *dist = (Vincenty_dist *)result;
+	Karney k;
+	size_t i;
+
+	if (!HANDLE_VALID(ellps, HANDLE_ELLIPSOID)) return GRYD_EHANDLE;
+	if (mode < DISTANCE_VINCENTY || mode > DISTANCE_FLAT) return GRYD_EARGUMENT;
+	if (n > 0 && (lla0 == NULL || lla1 == NULL || result == NULL)) return GRYD_EARGUMENT;
+	e = (Ellipsoid *)&ellps->ellipsoid;
+	if (mode == DISTANCE_KARNEY) karney_init(e, &k);
+	for (i=0; i<n; i++){
+		switch (mode){
+			case DISTANCE_VINCENTY: dist[i] = distance(e, &start[i], &stop[i]); break;
+			case DISTANCE_KARNEY: dist[i] = karney_distance(&k, &start[i], &stop[i]); break;
+			case DISTANCE_HAVERSINE: dist[i] = distance_haversine(e, &start[i], &stop[i]); break;
+			case DISTANCE_ANDOYER: dist[i] = distance_andoyer(e, &start[i], &stop[i]); break;
+			default: dist[i] = distance_flat(e, &start[i], &stop[i]);
+		}
+	}
+	return GRYD_OK;
+}
+
+EXPORT int gryd_ellipsoid_destination(const GrydEllipsoid *ellps, const double *lla, const double *dbb, double *result, size_t n, int mode){
+	Ellipsoid *e;
+	Geodesic *start = (Geodesic *)lla;
+	Vincenty_dist *step = (Vincenty_dist *)dbb;
+	Vincenty_dest *dest = (Vincenty_dest *)result;
+	Karney k;
+	size_t i;
+
+	if (!HANDLE_VALID(ellps, HANDLE_ELLIPSOID)) return GRYD_EHANDLE;
+	if (mode != DISTANCE_VINCENTY && mode != DISTANCE_KARNEY) return GRYD_EARGUMENT;
+	if (n > 0 && (lla == NULL || dbb == NULL || result == NULL)) return GRYD_EARGUMENT;
+	e = (Ellipsoid *)&ellps->ellipsoid;
+	if (mode == DISTANCE_KARNEY) karney_init(e, &k);
+	for (i=0; i<n; i++)
+		dest[i] = (mode == DISTANCE_KARNEY) ? karney_destination(&k, &start[i], &step[i]) : destination(e, &start[i], &step[i]);
+	return GRYD_OK;
+}
@@ -0,0 +1,99 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <string.h>
+#include "./handle.h"
+
+// gryd.h functions of proj library
+
+EXPORT void tmerc_prepare(Crs *crs, Prepared *prep);
+EXPORT void ktmerc_prepare(Crs *crs, Prepared *prep);
+EXPORT void merc_prepare(Crs *crs, Prepared *prep);
+EXPORT void lcc_prepare(Crs *crs, Prepared *prep);
+EXPORT void omerc_prepare(Crs *crs, Prepared *prep);
+EXPORT void eqc_prepare(Crs *crs, Prepared *prep);
+EXPORT void miller_prepare(Crs *crs, Prepared *prep);
+
+typedef struct{
+	const char *name;
+	Prepare prepare;
+}Projection;
+
+static const Projection PROJECTIONS[] = {
+	{"tmerc", tmerc_prepare}, {"ktmerc", ktmerc_prepare}, {"merc", merc_prepare},
+	{"lcc", lcc_prepare}, {"omerc", omerc_prepare}, {"eqc", eqc_prepare},
+	{"miller", miller_prepare}
+};
+
+// NULL if crs is not a valid handle or its projection is not a C one
+static Prepare prepare_fn(const GrydCrs *crs){
+	size_t i;
+
+	if (!HANDLE_VALID(crs, HANDLE_CRS)) return NULL;
+	for (i=0; i<sizeof(PROJECTIONS)/sizeof(Projection); i++)
+		if (strcmp(PROJECTIONS[i].name, crs->projection) == 0) return PROJECTIONS[i].prepare;
+	return NULL;
+}
+
+static int accuracy_valid(int accuracy){
+	return accuracy == GRYD_ACCURACY_KEEP || (accuracy >= 0 && accuracy < ACCURACY_COUNT);
+}
+
+EXPORT GrydPrepared *gryd_prepared_new(const GrydCrs *crs, int accuracy){
+	GrydPrepared *handle;
+	Prepare prepare = prepare_fn(crs);
+	Crs copy;
+
+	if (prepare == NULL || !accuracy_valid(accuracy)) return NULL;
+	if ((handle = handle_new(sizeof(GrydPrepared), HANDLE_PREPARED)) == NULL) return NULL;
+	copy = crs->crs;
+	if (accuracy != GRYD_ACCURACY_KEEP) copy.datum.ellipsoid.accuracy = accuracy;
+	prepare(&copy, &handle->prepared);
+	return handle;
+}
+
+EXPORT void gryd_prepared_free(GrydPrepared *prep){
+	handle_free(prep, HANDLE_PREPARED);
+}
+
+// x and y are in crs unit, as done by Crs.__call__
+EXPORT int gryd_prepared_forward(const GrydPrepared *prep, const double *lla, double *xya, size_t n){
+	if (!HANDLE_VALID(prep, HANDLE_PREPARED)) return GRYD_EHANDLE;
+	if (n > 0 && (lla == NULL || xya == NULL)) return GRYD_EARGUMENT;
+	prepared_forward_n_serial((Prepared *)&prep->prepared, (Geodesic *)lla, (Geographic *)xya, n);
+	return GRYD_OK;
+}
+
+EXPORT int gryd_prepared_inverse(const GrydPrepared *prep, const double *xya, double *lla, size_t n){
+	if (!HANDLE_VALID(prep, HANDLE_PREPARED)) return GRYD_EHANDLE;
+	if (n > 0 && (lla == NULL || xya == NULL)) return GRYD_EARGUMENT;
+	prepared_inverse_n_serial((Prepared *)&prep->prepared, (Geographic *)xya, (Geodesic *)lla, n);
+	return GRYD_OK;
+}
+
+EXPORT GrydTransformer *gryd_transformer_new(const GrydCrs *src, const GrydCrs *dst, int accuracy){
+	GrydTransformer *handle;
+	Prepare src_prepare = prepare_fn(src), dst_prepare = prepare_fn(dst);
+	Crs src_copy, dst_copy;
+
+	if (src_prepare == NULL || dst_prepare == NULL || !accuracy_valid(accuracy)) return NULL;
+	if ((handle = handle_new(sizeof(GrydTransformer), HANDLE_TRANSFORMER)) == NULL) return NULL;
+	src_copy = src->crs;
+	dst_copy = dst->crs;
+	if (accuracy != GRYD_ACCURACY_KEEP){
+		src_copy.datum.ellipsoid.accuracy = accuracy;
+		dst_copy.datum.ellipsoid.accuracy = accuracy;
+	}
+	transformer_init(&handle->transformer, &src_copy, src_prepare, &dst_copy, dst_prepare);
+	return handle;
+}
+
+EXPORT void gryd_transformer_free(GrydTransformer *tr){
+	handle_free(tr, HANDLE_TRANSFORMER);
+}
+
+EXPORT int gryd_transformer_apply(const GrydTransformer *tr, const double *xya, double *result, size_t n){
+	if (!HANDLE_VALID(tr, HANDLE_TRANSFORMER)) return GRYD_EHANDLE;
+	if (n > 0 && (xya == NULL || result == NULL)) return GRYD_EARGUMENT;
+	transform_n_serial((Transformer *)&tr->transformer, (Geographic *)xya, (Geographic *)result, n);
+	return GRYD_OK;
+}
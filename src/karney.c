@@ -0,0 +1,772 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include "./karney.h"
+#include <float.h>
+
+#if _WIN32
+	#define THREAD_LOCAL __declspec(thread)
+#else
+	#define THREAD_LOCAL __thread
+#endif
+
+/*
+Source :
+Karney C.F.F., Algorithms for geodesics, Journal of Geodesy, 87, 2013
+https://doi.org/10.1007/s00190-012-0578-z
+GeographicLib geodesic.c (MIT/X11 License), Charles Karney, 2012-2021
+
+Series are truncated to order 6 in the third flattening n, so distances are
+accurate to 15 nm on earth ellipsoids. Direct problem is solved without any
+iteration. Inverse problem solves a single equation with Newton's method
+safeguarded by bisection, started from an accurate estimate (astroid for
+nearly antipodal points) : it converges in 2 to 4 steps and is bounded by
+MAXIT2 evaluations, antipodal points included. Areas (C4 series) are not
+computed.
+
+Angles are handled in degrees internally so that exact reductions can be
+done, interface takes and returns radians as the rest of the library.
+*/
+
+// number of coefficients of each series
+#define NC1 KARNEY_ORDER
+#define NC1P KARNEY_ORDER
+#define NC2 KARNEY_ORDER
+#define NA3 KARNEY_ORDER
+#define NC3 KARNEY_ORDER
+#define NC (KARNEY_ORDER+1)
+
+static const double TOL0 = DBL_EPSILON;
+static const int MAXIT1 = 20;
+static const int MAXIT2 = 20 + DBL_MANT_DIG + 10;
+
+static double sq(double x){return x*x;}
+
+static double polyval(int n, const double *p, double x){
+	double y = n < 0 ? 0 : *p++;
+	while (--n >= 0) y = y*x + *p++;
+	return y;
+}
+
+// error free sum, t receives the rounding error
+static double sumx(double u, double v, double *t){
+	double s = u + v, up = s - v, vpp = s - up;
+	up -= u;
+	vpp -= v;
+	*t = -(up + vpp);
+	return s;
+}
+
+static double ang_normalize(double x){
+	x = remainder(x, 360.);
+	return x != -180. ? x : 180.;
+}
+
+static double ang_diff(double x, double y, double *e){
+	double t, d = ang_normalize(sumx(ang_normalize(-x), ang_normalize(y), &t));
+	if (d == 180. && t > 0){
+		d = -180.;
+	}
+	return sumx(d, t, e);
+}
+
+// round tiny values so that ones below 1/16 keep only their leading bits
+static double ang_round(double x){
+	const double z = 1/16.;
+	double y = fabs(x);
+	if (x == 0) return 0;
+	y = y < z ? z - (z - y) : y;
+	return x < 0 ? -y : y;
+}
+
+static double lat_fix(double x){return fabs(x) > 90. ? NAN : x;}
+
+static void norm2(double *s, double *c){
+	double r = hypot(*s, *c);
+	*s /= r;
+	*c /= r;
+}
+
+static void sincosd(double x, double *sinx, double *cosx){
+	double r, s, c;
+	int q = 0;
+
+	r = remquo(x, 90., &q);
+	r *= DEGREE2RAD;
+	s = sin(r);
+	c = cos(r);
+	switch ((unsigned)q & 3U){
+		case 0U: *sinx =  s; *cosx =  c; break;
+		case 1U: *sinx =  c; *cosx = -s; break;
+		case 2U: *sinx = -s; *cosx = -c; break;
+		default: *sinx = -c; *cosx =  s; break;
+	}
+	if (x != 0){
+		*sinx += 0.;
+		*cosx += 0.;
+	}
+}
+
+static double atan2d(double y, double x){
+	double ang, t;
+	int q = 0;
+
+	if (fabs(y) > fabs(x)){
+		t = x; x = y; y = t;
+		q = 2;
+	}
+	if (x < 0){
+		x = -x;
+		++q;
+	}
+	ang = atan2(y, x) * RADIAN2DEG;
+	switch (q){
+		case 1: ang = (y >= 0 ? 180 : -180) - ang; break;
+		case 2: ang =  90 - ang; break;
+		case 3: ang = -90 + ang; break;
+	}
+	return ang;
+}
+
+/*
+Clenshaw summation of sum(c[l] * sin(2*l*x), l=1..n) if sinp, else of
+sum(c[l] * cos((2*l+1)*x), l=0..n-1)
+*/
+static double sincos_series(int sinp, double sinx, double cosx, const double *c, int n){
+	double ar, y0, y1;
+
+	c += (n + sinp);
+	ar = 2 * (cosx - sinx) * (cosx + sinx);
+	y0 = (n & 1) ? *--c : 0;
+	y1 = 0;
+	n /= 2;
+	while (n--){
+		y1 = ar * y0 - y1 + *--c;
+		y0 = ar * y1 - y0 + *--c;
+	}
+	return sinp ? 2 * sinx * cosx * y0 : cosx * (y0 - y1);
+}
+
+// (1-eps)*A1-1
+static double A1m1f(double eps){
+	static const double coeff[] = {1, 4, 64, 0, 256};
+	double t = polyval(NC1/2, coeff, sq(eps)) / coeff[NC1/2 + 1];
+	return (t + eps) / (1 - eps);
+}
+
+static void C1f(double eps, double *c){
+	static const double coeff[] = {
+		-1, 6, -16, 32,
+		-9, 64, -128, 2048,
+		9, -16, 768,
+		3, -5, 512,
+		-7, 1280,
+		-7, 2048,
+	};
+	double eps2 = sq(eps), d = eps;
+	int o = 0, l, m;
+	for (l = 1; l <= NC1; ++l){
+		m = (NC1 - l) / 2;
+		c[l] = d * polyval(m, coeff + o, eps2) / coeff[o + m + 1];
+		o += m + 2;
+		d *= eps;
+	}
+}
+
+static void C1pf(double eps, double *c){
+	static const double coeff[] = {
+		205, -432, 768, 1536,
+		4005, -4736, 3840, 12288,
+		-225, 116, 384,
+		-7173, 2695, 7680,
+		3467, 7680,
+		38081, 61440,
+	};
+	double eps2 = sq(eps), d = eps;
+	int o = 0, l, m;
+	for (l = 1; l <= NC1P; ++l){
+		m = (NC1P - l) / 2;
+		c[l] = d * polyval(m, coeff + o, eps2) / coeff[o + m + 1];
+		o += m + 2;
+		d *= eps;
+	}
+}
+
+// (1+eps)*A2-1
+static double A2m1f(double eps){
+	static const double coeff[] = {-11, -28, -192, 0, 256};
+	double t = polyval(NC2/2, coeff, sq(eps)) / coeff[NC2/2 + 1];
+	return (t - eps) / (1 + eps);
+}
+
+static void C2f(double eps, double *c){
+	static const double coeff[] = {
+		1, 2, 16, 32,
+		35, 64, 384, 2048,
+		15, 80, 768,
+		7, 35, 512,
+		63, 1280,
+		77, 2048,
+	};
+	double eps2 = sq(eps), d = eps;
+	int o = 0, l, m;
+	for (l = 1; l <= NC2; ++l){
+		m = (NC2 - l) / 2;
+		c[l] = d * polyval(m, coeff + o, eps2) / coeff[o + m + 1];
+		o += m + 2;
+		d *= eps;
+	}
+}
+
+static void A3coeff(Karney *k){
+	static const double coeff[] = {
+		-3, 128,
+		-2, -3, 64,
+		-1, -3, -1, 16,
+		3, -1, -2, 8,
+		1, -1, 2,
+		1, 1,
+	};
+	int o = 0, i = 0, j, m;
+	for (j = NA3 - 1; j >= 0; --j){
+		m = NA3 - j - 1 < j ? NA3 - j - 1 : j;
+		k->A3x[i++] = polyval(m, coeff + o, k->n) / coeff[o + m + 1];
+		o += m + 2;
+	}
+}
+
+static void C3coeff(Karney *k){
+	static const double coeff[] = {
+		3, 128,
+		2, 5, 128,
+		-1, 3, 3, 64,
+		-1, 0, 1, 8,
+		-1, 1, 4,
+		5, 256,
+		1, 3, 128,
+		-3, -2, 3, 64,
+		1, -3, 2, 32,
+		7, 512,
+		-10, 9, 384,
+		5, -9, 5, 192,
+		7, 512,
+		-14, 7, 512,
+		21, 2560,
+	};
+	int o = 0, i = 0, l, j, m;
+	for (l = 1; l < NC3; ++l){
+		for (j = NC3 - 1; j >= l; --j){
+			m = NC3 - j - 1 < j ? NC3 - j - 1 : j;
+			k->C3x[i++] = polyval(m, coeff + o, k->n) / coeff[o + m + 1];
+			o += m + 2;
+		}
+	}
+}
+
+static double A3f(Karney *k, double eps){
+	return polyval(NA3 - 1, k->A3x, eps);
+}
+
+static void C3f(Karney *k, double eps, double *c){
+	double mult = 1;
+	int o = 0, l, m;
+	for (l = 1; l < NC3; ++l){
+		m = NC3 - l - 1;
+		mult *= eps;
+		c[l] = mult * polyval(m, k->C3x + o, eps);
+		o += m + 1;
+	}
+}
+
+EXPORT void karney_init(Ellipsoid *ellps, Karney *k){
+	double tol2 = sqrt(TOL0);
+
+	k->a = ellps->a;
+	k->f = ellps->f;
+	k->f1 = 1 - k->f;
+	k->e2 = k->f * (2 - k->f);
+	k->ep2 = k->e2 / sq(k->f1);
+	k->n = k->f / (2 - k->f);
+	k->b = k->a * k->f1;
+	k->etol2 = 0.1 * tol2 / sqrt(fmax(0.001, fabs(k->f)) * fmin(1., 1 - k->f/2) / 2);
+	A3coeff(k);
+	C3coeff(k);
+}
+
+// distance s12b and reduced length m12b (both divided by b) along a geodesic
+static void lengths(double eps, double sig12, double ssig1, double csig1, double dn1, double ssig2, double csig2, double dn2, double *ps12b, double *pm12b, double *pm0){
+	double Ca[NC], Cb[NC];
+	double A1, A2, m0x, J12, B1, B2;
+	int l;
+
+	A1 = A1m1f(eps);
+	C1f(eps, Ca);
+	A2 = A2m1f(eps);
+	C2f(eps, Cb);
+	m0x = A1 - A2;
+	A2 = 1 + A2;
+	A1 = 1 + A1;
+
+	if (ps12b != NULL){
+		B1 = sincos_series(1, ssig2, csig2, Ca, NC1) - sincos_series(1, ssig1, csig1, Ca, NC1);
+		B2 = sincos_series(1, ssig2, csig2, Cb, NC2) - sincos_series(1, ssig1, csig1, Cb, NC2);
+		*ps12b = A1 * (sig12 + B1);
+		J12 = m0x * sig12 + (A1 * B1 - A2 * B2);
+	}else{
+		for (l = 1; l <= NC2; ++l) Cb[l] = A1 * Ca[l] - A2 * Cb[l];
+		J12 = m0x * sig12 + (sincos_series(1, ssig2, csig2, Cb, NC2) - sincos_series(1, ssig1, csig1, Cb, NC2));
+	}
+	if (pm0 != NULL) *pm0 = m0x;
+	if (pm12b != NULL) *pm12b = dn2 * (csig1 * ssig2) - dn1 * (ssig1 * csig2) - csig1 * csig2 * J12;
+}
+
+// solve k^4 + 2*k^3 - (x^2 + y^2 - 1)*k^2 - 2*y^2*k - y^2 = 0 for positive root k
+static double astroid(double x, double y){
+	double p = sq(x), q = sq(y), r = (p + q - 1) / 6;
+	double S, r2, r3, disc, u, v, uv, w, T3, T, ang;
+
+	if (q == 0 && r <= 0) return 0;
+
+	S = p * q / 4;
+	r2 = sq(r);
+	r3 = r * r2;
+	disc = S * (S + 2 * r3);
+	u = r;
+	if (disc >= 0){
+		T3 = S + r3;
+		T3 += T3 < 0 ? -sqrt(disc) : sqrt(disc);
+		T = cbrt(T3);
+		u += T + (T != 0 ? r2 / T : 0);
+	}else{
+		ang = atan2(sqrt(-disc), -(S + r3));
+		u += 2 * r * cos(ang / 3);
+	}
+	v = sqrt(sq(u) + q);
+	uv = u < 0 ? q / (v - u) : u + v;
+	w = (uv - q) / (2 * v);
+	return uv / (sqrt(uv + sq(w)) + w);
+}
+
+// starting azimuth of the Newton iteration, returns sig12 >= 0 for short lines
+// which are then solved directly
+static double inverse_start(Karney *k, double sbet1, double cbet1, double sbet2, double cbet2, double lam12, double slam12, double clam12, double *psalp1, double *pcalp1, double *psalp2, double *pcalp2, double *pdnm){
+	double salp1, calp1, salp2 = 0, calp2 = 0, dnm = 0;
+	double sig12 = -1, sbet12, cbet12, sbet12a, sbetm2, omg12;
+	double somg12, comg12, ssig12, csig12, x, y, lamscale, betscale, lam12x, k2, eps, kk, omg12a;
+	int shortline;
+
+	sbet12 = sbet2 * cbet1 - cbet2 * sbet1;
+	cbet12 = cbet2 * cbet1 + sbet2 * sbet1;
+	sbet12a = sbet2 * cbet1 + cbet2 * sbet1;
+	shortline = cbet12 >= 0 && sbet12 < 0.5 && cbet2 * lam12 < 0.5;
+
+	if (shortline){
+		sbetm2 = sq(sbet1 + sbet2);
+		sbetm2 /= sbetm2 + sq(cbet1 + cbet2);
+		dnm = sqrt(1 + k->ep2 * sbetm2);
+		omg12 = lam12 / (k->f1 * dnm);
+		somg12 = sin(omg12);
+		comg12 = cos(omg12);
+	}else{
+		somg12 = slam12;
+		comg12 = clam12;
+	}
+
+	salp1 = cbet2 * somg12;
+	calp1 = comg12 >= 0 ?
+		sbet12 + cbet2 * sbet1 * sq(somg12) / (1 + comg12) :
+		sbet12a - cbet2 * sbet1 * sq(somg12) / (1 - comg12);
+
+	ssig12 = hypot(salp1, calp1);
+	csig12 = sbet1 * sbet2 + cbet1 * cbet2 * comg12;
+
+	if (shortline && ssig12 < k->etol2){
+		salp2 = cbet1 * somg12;
+		calp2 = sbet12 - cbet1 * sbet2 * (comg12 >= 0 ? sq(somg12) / (1 + comg12) : 1 - comg12);
+		norm2(&salp2, &calp2);
+		sig12 = atan2(ssig12, csig12);
+	}else if (fabs(k->n) > 0.1 || csig12 >= 0 || ssig12 >= 6 * fabs(k->n) * M_PI * sq(cbet1)){
+		// zeroth order spherical approximation is good enough
+	}else{
+		// nearly antipodal points, oblate ellipsoid
+		lam12x = atan2(-slam12, -clam12);
+		k2 = sq(sbet1) * k->ep2;
+		eps = k2 / (2 * (1 + sqrt(1 + k2)) + k2);
+		lamscale = k->f * cbet1 * A3f(k, eps) * M_PI;
+		betscale = lamscale * cbet1;
+		x = lam12x / lamscale;
+		y = sbet12a / betscale;
+
+		if (y > -200 * TOL0 && x > -1 - 1000 * sqrt(TOL0)){
+			salp1 = fmin(1., -x);
+			calp1 = -sqrt(1 - sq(salp1));
+		}else{
+			kk = astroid(x, y);
+			omg12a = lamscale * (-x * kk / (1 + kk));
+			somg12 = sin(omg12a);
+			comg12 = -cos(omg12a);
+			salp1 = cbet2 * somg12;
+			calp1 = sbet12a - cbet2 * sbet1 * sq(somg12) / (1 - comg12);
+		}
+	}
+	if (!(salp1 <= 0)){
+		norm2(&salp1, &calp1);
+	}else{
+		salp1 = 1;
+		calp1 = 0;
+	}
+
+	*psalp1 = salp1; *pcalp1 = calp1;
+	*psalp2 = salp2; *pcalp2 = calp2;
+	*pdnm = dnm;
+	return sig12;
+}
+
+// longitude difference error for starting azimuth alp1 and its derivative
+static double lambda12(Karney *k, double sbet1, double cbet1, double dn1, double sbet2, double cbet2, double dn2, double salp1, double calp1, double slam120, double clam120, double *psalp2, double *pcalp2, double *psig12, double *pssig1, double *pcsig1, double *pssig2, double *pcsig2, double *peps, int diffp, double *pdlam12){
+	double Ca[NC];
+	double salp2, calp2, sig12, ssig1, csig1, ssig2, csig2, eps, dlam12 = 0;
+	double salp0, calp0, somg1, comg1, somg2, comg2, somg12, comg12;
+	double B312, eta, k2, domg12;
+
+	if (sbet1 == 0 && calp1 == 0) calp1 = -sqrt(DBL_MIN);
+
+	salp0 = salp1 * cbet1;
+	calp0 = hypot(calp1, salp1 * sbet1);
+
+	ssig1 = sbet1; somg1 = salp0 * sbet1;
+	csig1 = comg1 = calp1 * cbet1;
+	norm2(&ssig1, &csig1);
+
+	salp2 = cbet2 != cbet1 ? salp0 / cbet2 : salp1;
+	calp2 = cbet2 != cbet1 || fabs(sbet2) != -sbet1 ?
+		sqrt(sq(calp1 * cbet1) + (cbet1 < -sbet1 ? (cbet2 - cbet1) * (cbet1 + cbet2) : (sbet1 - sbet2) * (sbet1 + sbet2))) / cbet2 :
+		fabs(calp1);
+	ssig2 = sbet2; somg2 = salp0 * sbet2;
+	csig2 = comg2 = calp2 * cbet2;
+	norm2(&ssig2, &csig2);
+
+	sig12 = atan2(fmax(0., csig1 * ssig2 - ssig1 * csig2), csig1 * csig2 + ssig1 * ssig2);
+	somg12 = fmax(0., comg1 * somg2 - somg1 * comg2);
+	comg12 = comg1 * comg2 + somg1 * somg2;
+	eta = atan2(somg12 * clam120 - comg12 * slam120, comg12 * clam120 + somg12 * slam120);
+	k2 = sq(calp0) * k->ep2;
+	eps = k2 / (2 * (1 + sqrt(1 + k2)) + k2);
+	C3f(k, eps, Ca);
+	B312 = sincos_series(1, ssig2, csig2, Ca, NC3-1) - sincos_series(1, ssig1, csig1, Ca, NC3-1);
+	domg12 = -k->f * A3f(k, eps) * salp0 * (sig12 + B312);
+
+	if (diffp){
+		if (calp2 == 0){
+			dlam12 = -2 * k->f1 * dn1 / sbet1;
+		}else{
+			lengths(eps, sig12, ssig1, csig1, dn1, ssig2, csig2, dn2, NULL, &dlam12, NULL);
+			dlam12 *= k->f1 / (calp2 * cbet2);
+		}
+	}
+
+	*psalp2 = salp2; *pcalp2 = calp2;
+	*psig12 = sig12;
+	*pssig1 = ssig1; *pcsig1 = csig1;
+	*pssig2 = ssig2; *pcsig2 = csig2;
+	*peps = eps;
+	*pdlam12 = dlam12;
+	return eta + domg12;
+}
+
+// pnumit gets the number of newton or bisection steps (0 for closed form
+// solutions) and pfailed whether they stopped on MAXIT2
+static double inverse_solve(Karney *k, double lat1, double lon1, double lat2, double lon2, double *pazi1, double *pazi2, int *pnumit, int *pfailed){
+	double tiny = sqrt(DBL_MIN), tolb = TOL0 * sqrt(TOL0);
+	double lon12, lon12s, lam12, slam12, clam12, t;
+	double sbet1, cbet1, sbet2, cbet2, dn1, dn2, s12x = 0, m12x = 0;
+	double sig12, calp1 = 0, salp1 = 0, calp2 = 0, salp2 = 0;
+	double ssig1, csig1, ssig2, csig2, eps = 0, dnm = 0;
+	double salp1a, calp1a, salp1b, calp1b, v, dv, dalp1, sdalp1, cdalp1, nsalp1;
+	int lonsign, latsign, swapp, meridian, numit, tripn, tripb;
+
+	lon12 = ang_diff(lon1, lon2, &lon12s);
+	lonsign = lon12 >= 0 ? 1 : -1;
+	lon12 = lonsign * ang_round(lon12);
+	lon12s = ang_round((180 - lon12) - lonsign * lon12s);
+	lam12 = lon12 * DEGREE2RAD;
+	if (lon12 > 90){
+		sincosd(lon12s, &slam12, &clam12);
+		clam12 = -clam12;
+	}else{
+		sincosd(lon12, &slam12, &clam12);
+	}
+
+	// make lat1 <= 0 and |lat1| >= |lat2|
+	lat1 = ang_round(lat_fix(lat1));
+	lat2 = ang_round(lat_fix(lat2));
+	swapp = fabs(lat1) < fabs(lat2) ? -1 : 1;
+	if (swapp < 0){
+		lonsign *= -1;
+		t = lat1; lat1 = lat2; lat2 = t;
+	}
+	latsign = lat1 < 0 ? 1 : -1;
+	lat1 *= latsign;
+	lat2 *= latsign;
+
+	sincosd(lat1, &sbet1, &cbet1);
+	sbet1 *= k->f1;
+	norm2(&sbet1, &cbet1);
+	cbet1 = fmax(tiny, cbet1);
+
+	sincosd(lat2, &sbet2, &cbet2);
+	sbet2 *= k->f1;
+	norm2(&sbet2, &cbet2);
+	cbet2 = fmax(tiny, cbet2);
+
+	if (cbet1 < -sbet1){
+		if (cbet2 == cbet1) sbet2 = sbet2 < 0 ? sbet1 : -sbet1;
+	}else{
+		if (fabs(sbet2) == -sbet1) cbet2 = cbet1;
+	}
+
+	dn1 = sqrt(1 + k->ep2 * sq(sbet1));
+	dn2 = sqrt(1 + k->ep2 * sq(sbet2));
+
+	meridian = lat1 == -90 || slam12 == 0;
+	if (meridian){
+		calp1 = clam12; salp1 = slam12;
+		calp2 = 1; salp2 = 0;
+		ssig1 = sbet1; csig1 = calp1 * cbet1;
+		ssig2 = sbet2; csig2 = calp2 * cbet2;
+		sig12 = atan2(fmax(0., csig1 * ssig2 - ssig1 * csig2), csig1 * csig2 + ssig1 * ssig2);
+		lengths(k->n, sig12, ssig1, csig1, dn1, ssig2, csig2, dn2, &s12x, &m12x, NULL);
+		if (sig12 < 1 || m12x >= 0){
+			if (sig12 < 3 * tiny || (sig12 < TOL0 && (s12x < 0 || m12x < 0))) sig12 = m12x = s12x = 0;
+			s12x *= k->b;
+		}else{
+			// antipodal points on a meridian, the shortest path is not a meridian
+			meridian = 0;
+		}
+	}
+
+	if (!meridian && sbet1 == 0 && (k->f <= 0 || lon12s >= k->f * 180)){
+		// geodesic runs along equator
+		calp1 = calp2 = 0;
+		salp1 = salp2 = 1;
+		s12x = k->a * lam12;
+	}else if (!meridian){
+		sig12 = inverse_start(k, sbet1, cbet1, sbet2, cbet2, lam12, slam12, clam12, &salp1, &calp1, &salp2, &calp2, &dnm);
+		if (sig12 >= 0){
+			s12x = sig12 * k->b * dnm;
+		}else{
+			salp1a = tiny; calp1a = 1; salp1b = tiny; calp1b = -1;
+			tripn = tripb = 0;
+			ssig1 = csig1 = ssig2 = csig2 = 0;
+			for (numit = 0;; ++numit){
+				dv = 0;
+				v = lambda12(k, sbet1, cbet1, dn1, sbet2, cbet2, dn2, salp1, calp1, slam12, clam12, &salp2, &calp2, &sig12, &ssig1, &csig1, &ssig2, &csig2, &eps, numit < MAXIT1, &dv);
+				if (tripb || !(fabs(v) >= (tripn ? 8 : 1) * TOL0) || numit == MAXIT2) break;
+				// update bracketing values
+				if (v > 0 && (numit > MAXIT1 || calp1/salp1 > calp1b/salp1b)){
+					salp1b = salp1; calp1b = calp1;
+				}else if (v < 0 && (numit > MAXIT1 || calp1/salp1 < calp1a/salp1a)){
+					salp1a = salp1; calp1a = calp1;
+				}
+				if (numit < MAXIT1 && dv > 0){
+					dalp1 = -v/dv;
+					if (fabs(dalp1) < M_PI){
+						sdalp1 = sin(dalp1); cdalp1 = cos(dalp1);
+						nsalp1 = salp1 * cdalp1 + calp1 * sdalp1;
+						if (nsalp1 > 0){
+							calp1 = calp1 * cdalp1 - salp1 * sdalp1;
+							salp1 = nsalp1;
+							norm2(&salp1, &calp1);
+							tripn = fabs(v) <= 16 * TOL0;
+							continue;
+						}
+					}
+				}
+				// Newton step failed, bisect
+				salp1 = (salp1a + salp1b)/2;
+				calp1 = (calp1a + calp1b)/2;
+				norm2(&salp1, &calp1);
+				tripn = 0;
+				tripb = (fabs(salp1a - salp1) + (calp1a - calp1) < tolb || fabs(salp1 - salp1b) + (calp1 - calp1b) < tolb);
+			}
+			*pnumit = numit;
+			*pfailed = !tripb && fabs(v) >= (tripn ? 8 : 1) * TOL0;
+			lengths(eps, sig12, ssig1, csig1, dn1, ssig2, csig2, dn2, &s12x, &m12x, NULL);
+			s12x *= k->b;
+		}
+	}
+
+	if (swapp < 0){
+		t = salp1; salp1 = salp2; salp2 = t;
+		t = calp1; calp1 = calp2; calp2 = t;
+	}
+	salp1 *= swapp * lonsign; calp1 *= swapp * latsign;
+	salp2 *= swapp * lonsign; calp2 *= swapp * latsign;
+
+	*pazi1 = atan2d(salp1, calp1);
+	*pazi2 = atan2d(salp2, calp2);
+	return 0 + s12x;
+}
+
+static double inverse(Karney *k, double lat1, double lon1, double lat2, double lon2, double *pazi1, double *pazi2){
+	int numit = 0, failed = 0;
+	double s12 = inverse_solve(k, lat1, lon1, lat2, lon2, pazi1, pazi2, &numit, &failed);
+	STATS_RECORD(STATS_KARNEY, numit, failed, lon1*DEGREE2RAD, lat1*DEGREE2RAD, lon2*DEGREE2RAD, lat2*DEGREE2RAD);
+	return s12;
+}
+
+// geodesic line from a start point and azimuth, positions along it are then
+// obtained without iteration
+typedef struct{
+	double lon1;
+	double salp0, calp0;
+	double ssig1, csig1, somg1, comg1;
+	double k2, A1m1, B11, stau1, ctau1, A3c, B31;
+	double C1a[NC], C1pa[NC], C3a[NC];
+}Line;
+
+static void line_init(Karney *k, Line *l, double lat1, double lon1, double azi1){
+	double tiny = sqrt(DBL_MIN);
+	double salp1, calp1, sbet1, cbet1, eps, s, c;
+
+	l->lon1 = lon1;
+	azi1 = ang_normalize(azi1);
+	sincosd(ang_round(azi1), &salp1, &calp1);
+
+	lat1 = lat_fix(lat1);
+	sincosd(ang_round(lat1), &sbet1, &cbet1);
+	sbet1 *= k->f1;
+	norm2(&sbet1, &cbet1);
+	cbet1 = fmax(tiny, cbet1);
+
+	l->salp0 = salp1 * cbet1;
+	l->calp0 = hypot(calp1, salp1 * sbet1);
+	l->ssig1 = sbet1; l->somg1 = l->salp0 * sbet1;
+	l->csig1 = l->comg1 = sbet1 != 0 || calp1 != 0 ? cbet1 * calp1 : 1;
+	norm2(&l->ssig1, &l->csig1);
+
+	l->k2 = sq(l->calp0) * k->ep2;
+	eps = l->k2 / (2 * (1 + sqrt(1 + l->k2)) + l->k2);
+
+	l->A1m1 = A1m1f(eps);
+	C1f(eps, l->C1a);
+	l->B11 = sincos_series(1, l->ssig1, l->csig1, l->C1a, NC1);
+	s = sin(l->B11); c = cos(l->B11);
+	l->stau1 = l->ssig1 * c + l->csig1 * s;
+	l->ctau1 = l->csig1 * c - l->ssig1 * s;
+	C1pf(eps, l->C1pa);
+	C3f(k, eps, l->C3a);
+	l->A3c = -k->f * l->salp0 * A3f(k, eps);
+	l->B31 = sincos_series(1, l->ssig1, l->csig1, l->C3a, NC3-1);
+}
+
+static void line_position(Karney *k, Line *l, double s12, double *plat2, double *plon2, double *pazi2){
+	double tiny = sqrt(DBL_MIN);
+	double tau12, s, c, B12, sig12, ssig12, csig12, serr, ssig2, csig2, sbet2, cbet2, somg2, comg2, salp2, calp2, omg12, lam12;
+
+	tau12 = s12 / (k->b * (1 + l->A1m1));
+	s = sin(tau12); c = cos(tau12);
+	B12 = -sincos_series(1, l->stau1 * c + l->ctau1 * s, l->ctau1 * c - l->stau1 * s, l->C1pa, NC1P);
+	sig12 = tau12 - (B12 - l->B11);
+	ssig12 = sin(sig12); csig12 = cos(sig12);
+	if (fabs(k->f) > 0.01){
+		// reverted series is not accurate enough, one Newton step
+		ssig2 = l->ssig1 * csig12 + l->csig1 * ssig12;
+		csig2 = l->csig1 * csig12 - l->ssig1 * ssig12;
+		B12 = sincos_series(1, ssig2, csig2, l->C1a, NC1);
+		serr = (1 + l->A1m1) * (sig12 + (B12 - l->B11)) - s12 / k->b;
+		sig12 = sig12 - serr / sqrt(1 + l->k2 * sq(ssig2));
+		ssig12 = sin(sig12); csig12 = cos(sig12);
+	}
+
+	ssig2 = l->ssig1 * csig12 + l->csig1 * ssig12;
+	csig2 = l->csig1 * csig12 - l->ssig1 * ssig12;
+	sbet2 = l->calp0 * ssig2;
+	cbet2 = hypot(l->salp0, l->calp0 * csig2);
+	if (cbet2 == 0) cbet2 = csig2 = tiny;
+	salp2 = l->salp0;
+	calp2 = l->calp0 * csig2;
+
+	somg2 = l->salp0 * ssig2; comg2 = csig2;
+	omg12 = atan2(somg2 * l->comg1 - comg2 * l->somg1, comg2 * l->comg1 + somg2 * l->somg1);
+	lam12 = omg12 + l->A3c * (sig12 + (sincos_series(1, ssig2, csig2, l->C3a, NC3-1) - l->B31));
+
+	*plon2 = ang_normalize(ang_normalize(l->lon1) + ang_normalize(lam12 * RADIAN2DEG));
+	*plat2 = atan2d(sbet2, k->f1 * cbet2);
+	*pazi2 = atan2d(salp2, calp2);
+}
+
+static double direct(Karney *k, double lat1, double lon1, double azi1, double s12, double *plat2, double *plon2, double *pazi2){
+	Line l;
+	line_init(k, &l, lat1, lon1, azi1);
+	line_position(k, &l, s12, plat2, plon2, pazi2);
+	return s12;
+}
+
+EXPORT Vincenty_dist karney_distance(Karney *k, Geodesic *start, Geodesic *stop){
+	Vincenty_dist result;
+	double azi1, azi2;
+
+	result.distance = inverse(k, start->latitude*RADIAN2DEG, start->longitude*RADIAN2DEG, stop->latitude*RADIAN2DEG, stop->longitude*RADIAN2DEG, &azi1, &azi2);
+	result.initial_bearing = azi1*DEGREE2RAD;
+	result.final_bearing = azi2*DEGREE2RAD;
+
+	return result;
+}
+
+EXPORT Vincenty_dest karney_destination(Karney *k, Geodesic *start, Vincenty_dist *dbb){
+	Vincenty_dest result;
+	double lat2, lon2, azi2;
+
+	direct(k, start->latitude*RADIAN2DEG, start->longitude*RADIAN2DEG, dbb->initial_bearing*RADIAN2DEG, dbb->distance, &lat2, &lon2, &azi2);
+	result.longitude = lon2*DEGREE2RAD;
+	result.latitude = lat2*DEGREE2RAD;
+	result.destination_bearing = azi2*DEGREE2RAD;
+
+	return result;
+}
+
+// coefficients of the last ellipsoid used by single point calls of the
+// calling thread, recomputed when axis or flattening differ
+static THREAD_LOCAL Karney CACHE;
+
+static Karney *karney_cached(Ellipsoid *ellps){
+	if (CACHE.a != ellps->a || CACHE.f != ellps->f) karney_init(ellps, &CACHE);
+	return &CACHE;
+}
+
+EXPORT Vincenty_dist distance_karney(Ellipsoid *ellps, Geodesic *start, Geodesic *stop){
+	return karney_distance(karney_cached(ellps), start, stop);
+}
+
+EXPORT Vincenty_dest destination_karney(Ellipsoid *ellps, Geodesic *start, Vincenty_dist *dbb){
+	return karney_destination(karney_cached(ellps), start, dbb);
+}
+
+/*
+Densification : the inverse problem is solved once, the n intermediary
+points are then evaluated along the geodesic line by distance, at constant
+cost and without error build up. Returns n+2 points (start, *intermediaries,
+end) as npoints_into does.
+*/
+EXPORT void npoints_karney_into(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, int n, Vincenty_dest *result){
+	Karney *k = karney_cached(ellps);
+	Line l;
+	double lat1, lon1, s12, azi1, azi2, step, lat, lon, azi;
+	int i;
+
+	lat1 = lla0->latitude*RADIAN2DEG;
+	lon1 = lla0->longitude*RADIAN2DEG;
+	s12 = inverse(k, lat1, lon1, lla1->latitude*RADIAN2DEG, lla1->longitude*RADIAN2DEG, &azi1, &azi2);
+	line_init(k, &l, lat1, lon1, azi1);
+	step = s12/(n+1);
+
+	result[0].longitude = lla0->longitude;
+	result[0].latitude = lla0->latitude;
+	result[0].destination_bearing = azi1*DEGREE2RAD;
+	for (i=1; i<n+2; i++){
+		line_position(k, &l, i*step, &lat, &lon, &azi);
+		result[i].longitude = lon*DEGREE2RAD;
+		result[i].latitude = lat*DEGREE2RAD;
+		result[i].destination_bearing = azi*DEGREE2RAD;
+	}
+}
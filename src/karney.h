@@ -0,0 +1,41 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Geodesic problems on the ellipsoid solved with Karney series.
+
+#ifndef KARNEY_H
+#define KARNEY_H
+
+#include "./geoid.h"
+
+// series order
+#define KARNEY_ORDER 6
+
+// ellipsoid constants and series coefficients depending only on flattening
+typedef struct{
+    double a;
+    double f;
+    double f1;
+    double e2;
+    double ep2;
+    double n;
+    double b;
+    double etol2;
+    double A3x[KARNEY_ORDER];
+    double C3x[(KARNEY_ORDER*(KARNEY_ORDER-1))/2];
+}Karney;
+
+EXPORT void karney_init(Ellipsoid *ellps, Karney *k);
+EXPORT Vincenty_dist karney_distance(Karney *k, Geodesic *start, Geodesic *stop);
+EXPORT Vincenty_dest karney_destination(Karney *k, Geodesic *start, Vincenty_dist *dbb);
+
+// same as above with coefficients of the last ellipsoid used by the calling
+// thread kept, so that single point calls do not recompute them
+EXPORT Vincenty_dist distance_karney(Ellipsoid *ellps, Geodesic *start, Geodesic *stop);
+EXPORT Vincenty_dest destination_karney(Ellipsoid *ellps, Geodesic *start, Vincenty_dist *dbb);
+
+// n intermediary points along the geodesic from lla0 to lla1 written in
+// result, a n+2 items table
+EXPORT void npoints_karney_into(Ellipsoid *ellps, Geodesic *lla0, Geodesic *lla1, int n, Vincenty_dest *result);
+
+#endif
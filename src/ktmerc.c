@@ -0,0 +1,154 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include "./geoid.h"
+
+/*
+Source :
+Krüger, L. (1912) Konforme Abbildung des Erdellipsoids in der Ebene
+Karney C.F.F. (2011) Transverse Mercator with an accuracy of a few nanometers
+J. Geodesy 85(8), 475-485
+
+Third flattening n series up to n^6 : error is under 5 nm within 3900 km of
+the central meridian (about 35 degrees of longitude at the equator) so a
+single zone can span several UTM zones. Conformal latitude is computed in
+closed form on the way forward and with Newton steps on the way back.
+
+coef[0]      : rectifying radius A
+coef[1]      : meridian distance of phi0 (A * xi0)
+coef[2..7]   : alpha_j, conformal sphere to rectifying plane
+coef[8..13]  : beta_j, rectifying plane to conformal sphere
+*/
+#define KTMERC_ORDER 6
+
+static const int KTMERC_STEPS = 5;
+
+EXPORT Geographic ktmerc_forward_p(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic ktmerc_inverse_p(Prepared *prep, Geographic *xya);
+EXPORT void ktmerc_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void ktmerc_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void ktmerc_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void ktmerc_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+
+// sum(c[j] * sin(2*(j+1)*(xi + i*eta))) using complex Clenshaw recurrence
+static void clenshaw(double *c, double xi, double eta, double *rxi, double *reta){
+	double s, co, sh, ch, ar, ai, yr, yi, zr, zi, tr, ti;
+	int j;
+
+	s = sin(2*xi); co = cos(2*xi);
+	sh = sinh(2*eta); ch = cosh(2*eta);
+	// a = 2 cos(2 zeta)
+	ar = 2*co*ch;
+	ai = -2*s*sh;
+	yr = yi = zr = zi = 0.;
+	for (j=KTMERC_ORDER-1; j>=0; j--){
+		tr = ar*yr - ai*yi - zr + c[j];
+		ti = ar*yi + ai*yr - zi;
+		zr = yr; zi = yi;
+		yr = tr; yi = ti;
+	}
+	// result = sin(2 zeta) * y
+	*rxi = s*ch*yr - co*sh*yi;
+	*reta = s*ch*yi + co*sh*yr;
+}
+
+static double conformal_tau(double tau, double e){
+	double sigma = sinh(e*atanh(e*tau/sqrt(1 + tau*tau)));
+	return tau*sqrt(1 + sigma*sigma) - sigma*sqrt(1 + tau*tau);
+}
+
+EXPORT void ktmerc_prepare(Crs *crs, Prepared *prep){
+	double a, b, n, n2, n3, n4, n5, n6, *alpha, *beta, chi0, dxi, deta;
+
+	prep->crs = *crs;
+	prep->forward = ktmerc_forward_p;
+	prep->inverse = ktmerc_inverse_p;
+	prep->forward_n = ktmerc_forward_pn;
+	prep->inverse_n = ktmerc_inverse_pn;
+	prep->forward_soa = ktmerc_forward_psoa;
+	prep->inverse_soa = ktmerc_inverse_psoa;
+	prep->graticule = NULL;
+
+	a = crs->datum.ellipsoid.a;
+	b = crs->datum.ellipsoid.b;
+	n = (a - b)/(a + b);
+	n2 = n*n; n3 = n2*n; n4 = n3*n; n5 = n4*n; n6 = n5*n;
+	alpha = prep->coef + 2;
+	beta = prep->coef + 8;
+
+	prep->coef[0] = a/(1 + n) * (1 + n2/4 + n4/64 + n6/256);
+
+	alpha[0] = n/2 - 2*n2/3 + 5*n3/16 + 41*n4/180 - 127*n5/288 + 7891*n6/37800;
+	alpha[1] = 13*n2/48 - 3*n3/5 + 557*n4/1440 + 281*n5/630 - 1983433*n6/1935360;
+	alpha[2] = 61*n3/240 - 103*n4/140 + 15061*n5/26880 + 167603*n6/181440;
+	alpha[3] = 49561*n4/161280 - 179*n5/168 + 6601661*n6/7257600;
+	alpha[4] = 34729*n5/80640 - 3418889*n6/1995840;
+	alpha[5] = 212378941*n6/319334400;
+
+	beta[0] = n/2 - 2*n2/3 + 37*n3/96 - n4/360 - 81*n5/512 + 96199*n6/604800;
+	beta[1] = n2/48 + n3/15 - 437*n4/1440 + 46*n5/105 - 1118711*n6/3870720;
+	beta[2] = 17*n3/480 - 37*n4/840 - 209*n5/4480 + 5569*n6/90720;
+	beta[3] = 4397*n4/161280 - 11*n5/504 - 830251*n6/7257600;
+	beta[4] = 4583*n5/161280 - 108847*n6/3991680;
+	beta[5] = 20648693*n6/638668800;
+
+	chi0 = atan(conformal_tau(tan(crs->phi0), crs->datum.ellipsoid.e));
+	clenshaw(alpha, chi0, 0., &dxi, &deta);
+	prep->coef[1] = prep->coef[0] * (chi0 + dxi);
+}
+
+EXPORT Geographic ktmerc_forward_p(Prepared *prep, Geodesic *lla){
+	Geographic xya;
+	Crs *crs = &prep->crs;
+	double lambda, taup, cl, xip, etap, dxi, deta;
+
+	lambda = lla->longitude - crs->lambda0;
+	taup = conformal_tau(tan(lla->latitude), crs->datum.ellipsoid.e);
+	cl = cos(lambda);
+	xip = atan2(taup, cl);
+	etap = asinh(sin(lambda)/sqrt(taup*taup + cl*cl));
+	clenshaw(prep->coef + 2, xip, etap, &dxi, &deta);
+
+	xya.x = crs->k0*prep->coef[0]*(etap + deta) + crs->x0;
+	xya.y = crs->k0*(prep->coef[0]*(xip + dxi) - prep->coef[1]) + crs->y0;
+	xya.altitude = lla->altitude;
+
+	return xya;
+}
+
+EXPORT Geodesic ktmerc_inverse_p(Prepared *prep, Geographic *xya){
+	Geodesic lla;
+	Crs *crs = &prep->crs;
+	double e, e2, xi, eta, dxi, deta, xip, etap, shp, cp, taup, tau, t, dtau;
+	double tolerance = accuracy(&crs->datum.ellipsoid)->tolerance;
+	int i;
+
+	e = crs->datum.ellipsoid.e;
+	e2 = e*e;
+	xi = ((xya->y - crs->y0)/crs->k0 + prep->coef[1])/prep->coef[0];
+	eta = (xya->x - crs->x0)/(crs->k0*prep->coef[0]);
+	clenshaw(prep->coef + 8, xi, eta, &dxi, &deta);
+	xip = xi - dxi;
+	etap = eta - deta;
+
+	shp = sinh(etap);
+	cp = cos(xip);
+	taup = sin(xip)/sqrt(shp*shp + cp*cp);
+
+	// Newton on tau, quadratic convergence from tau' guess
+	tau = taup/(1 - e2);
+	for (i=0; i<KTMERC_STEPS; i++){
+		t = conformal_tau(tau, e);
+		dtau = (taup - t)/sqrt(1 + t*t) * (1 + (1 - e2)*tau*tau)/((1 - e2)*sqrt(1 + tau*tau));
+		tau += dtau;
+		if (fabs(dtau) < tolerance*fmax(1., fabs(tau))) break;
+	}
+
+	lla.longitude = atan2(shp, cp) + crs->lambda0;
+	lla.latitude = atan(tau);
+	lla.altitude = xya->altitude;
+
+	return lla;
+}
+
+PREPARED_BATCH(ktmerc)
+PREPARED_PROJECTION(ktmerc)
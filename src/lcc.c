@@ -35,12 +35,34 @@ static void coef(double *result, double a, double e, double lambda0, double phi0
 }
 
 
-EXPORT Geographic lcc_forward(Crs *crs, Geodesic *lla){
+EXPORT Geographic lcc_forward_p(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic lcc_inverse_p(Prepared *prep, Geographic *xya);
+EXPORT void lcc_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void lcc_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void lcc_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void lcc_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+EXPORT void lcc_graticule_p(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya);
+
+// coef[0..4] : lambda0, n, c, xs, ys
+// coef[5..10] : conformal latitude series
+EXPORT void lcc_prepare(Crs *crs, Prepared *prep){
+	prep->crs = *crs;
+	prep->forward = lcc_forward_p;
+	prep->inverse = lcc_inverse_p;
+	prep->forward_n = lcc_forward_pn;
+	prep->inverse_n = lcc_inverse_pn;
+	prep->forward_soa = lcc_forward_psoa;
+	prep->inverse_soa = lcc_inverse_psoa;
+	prep->graticule = lcc_graticule_p;
+	coef(prep->coef, crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->lambda0, crs->phi0, crs->phi1, crs->phi2, crs->x0, crs->y0, crs->k0);
+	conformal_init(crs->datum.ellipsoid.e, prep->coef+5);
+}
+
+EXPORT Geographic lcc_forward_p(Prepared *prep, Geodesic *lla){
 	Geographic xya;
-	double L, result[5];
+	double L, *result = prep->coef;
 
-	coef(result, crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->lambda0, crs->phi0, crs->phi1, crs->phi2, crs->x0, crs->y0, crs->k0);
-	L = isometric_latitude(crs->datum.ellipsoid.e, lla->latitude);
+	L = isometric_latitude(prep->crs.datum.ellipsoid.e, lla->latitude);
 
 	xya.x = result[3] + result[2]*exp(-result[1]*L) * sin(result[1]*(lla->longitude-result[0]));
 	xya.y = result[4] - result[2]*exp(-result[1]*L) * cos(result[1]*(lla->longitude-result[0]));
@@ -49,17 +71,47 @@ EXPORT Geographic lcc_forward(Crs *crs, Geodesic *lla){
 	return xya;
 }
 
-EXPORT Geodesic lcc_inverse(Crs *crs, Geographic *xya){
+EXPORT Geodesic lcc_inverse_p(Prepared *prep, Geographic *xya){
 	Geodesic lla;
-	double R, v, result[5];
+	double R, v, *result = prep->coef;
 
-	coef(result, crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->lambda0, crs->phi0, crs->phi1, crs->phi2, crs->x0, crs->y0, crs->k0);
 	R = sqrt(pow(xya->x-result[3], 2) + pow(xya->y-result[4], 2));
 	v = atan2(xya->x-result[3], result[4]-xya->y);
 
 	lla.longitude = result[0] + v/result[1];
-	lla.latitude = geodesic_latitude(crs->datum.ellipsoid.e, -1/result[1] * log(fabs(R/result[2])));
+	lla.latitude = geodesic_latitude_k(result+5, -1/result[1] * log(fabs(R/result[2])));
 	lla.altitude = xya->altitude;
 
 	return lla;
 }
+
+// cone radius of a tile rows and angle terms of its columns are computed once
+EXPORT void lcc_graticule_p(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya){
+	double *result = prep->coef, e = prep->crs.datum.ellipsoid.e;
+	double r[GRATICULE_TILE], s[GRATICULE_TILE], c[GRATICULE_TILE];
+	Geographic *row;
+	size_t i0, j0, i, j, nr, nc;
+
+	for (i0=0; i0<nlat; i0+=GRATICULE_TILE){
+		nr = (nlat-i0 < GRATICULE_TILE) ? nlat-i0 : GRATICULE_TILE;
+		for (i=0; i<nr; i++) r[i] = result[2]*exp(-result[1]*isometric_latitude(e, latitudes[i0+i]));
+		for (j0=0; j0<nlon; j0+=GRATICULE_TILE){
+			nc = (nlon-j0 < GRATICULE_TILE) ? nlon-j0 : GRATICULE_TILE;
+			for (j=0; j<nc; j++){
+				s[j] = sin(result[1]*(longitudes[j0+j]-result[0]));
+				c[j] = cos(result[1]*(longitudes[j0+j]-result[0]));
+			}
+			for (i=0; i<nr; i++){
+				row = xya + (i0+i)*nlon + j0;
+				for (j=0; j<nc; j++){
+					row[j].x = result[3] + r[i]*s[j];
+					row[j].y = result[4] - r[i]*c[j];
+					row[j].altitude = altitude;
+				}
+			}
+		}
+	}
+}
+
+PREPARED_BATCH(lcc)
+PREPARED_PROJECTION(lcc)
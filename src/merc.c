@@ -2,11 +2,34 @@
 // All rights reserved.
 #include "./geoid.h"
 
-EXPORT Geographic merc_forward(Crs *crs, Geodesic *lla){
+EXPORT Geographic merc_forward_p(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic merc_inverse_p(Prepared *prep, Geographic *xya);
+EXPORT void merc_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void merc_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void merc_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void merc_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+EXPORT void merc_graticule_p(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya);
+
+// coef[0] : ak0
+// coef[1..6] : conformal latitude series
+EXPORT void merc_prepare(Crs *crs, Prepared *prep){
+	prep->crs = *crs;
+	prep->forward = merc_forward_p;
+	prep->inverse = merc_inverse_p;
+	prep->forward_n = merc_forward_pn;
+	prep->inverse_n = merc_inverse_pn;
+	prep->forward_soa = merc_forward_psoa;
+	prep->inverse_soa = merc_inverse_psoa;
+	prep->graticule = merc_graticule_p;
+	prep->coef[0] = cos(fabs(crs->phi1)) * nhu(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->phi1);
+	conformal_init(crs->datum.ellipsoid.e, prep->coef+1);
+}
+
+EXPORT Geographic merc_forward_p(Prepared *prep, Geodesic *lla){
 	Geographic xya;
-	double ak0;
+	Crs *crs = &prep->crs;
+	double ak0 = prep->coef[0];
 
-	ak0 = cos(fabs(crs->phi1)) * nhu(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->phi1);
 	xya.x = crs->x0 + crs->k0 * ak0 * (lla->longitude - crs->lambda0);
 	xya.y = crs->k0 * ak0 * isometric_latitude(crs->datum.ellipsoid.e, lla->latitude - crs->phi0) + crs->y0;
 	xya.altitude = lla->altitude;
@@ -14,14 +37,35 @@ EXPORT Geographic merc_forward(Crs *crs, Geodesic *lla){
 	return xya;
 }
 
-EXPORT Geodesic merc_inverse(Crs *crs, Geographic *xya){
+EXPORT Geodesic merc_inverse_p(Prepared *prep, Geographic *xya){
 	Geodesic lla;
-	double ak0;
+	Crs *crs = &prep->crs;
+	double ak0 = prep->coef[0];
 
-	ak0 = cos(fabs(crs->phi1)) * nhu(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->phi1);
 	lla.longitude = (xya->x - crs->x0)/(ak0 * crs->k0) + crs->lambda0;
-	lla.latitude = geodesic_latitude(crs->datum.ellipsoid.e, (xya->y - crs->y0)/(ak0 * crs->k0)) + crs->phi0;
+	lla.latitude = geodesic_latitude_k(prep->coef+1, (xya->y - crs->y0)/(ak0 * crs->k0)) + crs->phi0;
 	lla.altitude = xya->altitude;
 
 	return lla;
 }
+
+// y only depends on row latitude and x on column longitude
+EXPORT void merc_graticule_p(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya){
+	Crs *crs = &prep->crs;
+	double k = crs->k0 * prep->coef[0], y;
+	Geographic *row;
+	size_t i, j;
+
+	for (i=0; i<nlat; i++){
+		y = k * isometric_latitude(crs->datum.ellipsoid.e, latitudes[i] - crs->phi0) + crs->y0;
+		row = xya + i*nlon;
+		for (j=0; j<nlon; j++){
+			row[j].x = crs->x0 + k * (longitudes[j] - crs->lambda0);
+			row[j].y = y;
+			row[j].altitude = altitude;
+		}
+	}
+}
+
+PREPARED_BATCH(merc)
+PREPARED_PROJECTION(merc)
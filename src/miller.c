@@ -9,8 +9,28 @@
 // atan(exp(4y/5a)) - pi/4 = 2phi/5
 // 5/2 * (atan(exp(4y/5a)) - pi/4) = phi : reverse formula
 
-EXPORT Geographic miller_forward(Crs *crs, Geodesic *lla){
+EXPORT Geographic miller_forward_p(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic miller_inverse_p(Prepared *prep, Geographic *xya);
+EXPORT void miller_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void miller_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void miller_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void miller_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+
+// no derived constant
+EXPORT void miller_prepare(Crs *crs, Prepared *prep){
+	prep->crs = *crs;
+	prep->forward = miller_forward_p;
+	prep->inverse = miller_inverse_p;
+	prep->forward_n = miller_forward_pn;
+	prep->inverse_n = miller_inverse_pn;
+	prep->forward_soa = miller_forward_psoa;
+	prep->inverse_soa = miller_inverse_psoa;
+	prep->graticule = NULL;
+}
+
+EXPORT Geographic miller_forward_p(Prepared *prep, Geodesic *lla){
 	Geographic xya;
+	Crs *crs = &prep->crs;
 
 	xya.x = crs->datum.ellipsoid.a * (lla->longitude - crs->lambda0) + crs->x0;
 	xya.y = crs->datum.ellipsoid.a * 1.25 * log(tan(M_PI/4 + 0.4*lla->latitude)) + crs->y0;
@@ -19,8 +39,9 @@ EXPORT Geographic miller_forward(Crs *crs, Geodesic *lla){
 	return xya;
 }
 
-EXPORT Geodesic miller_inverse(Crs *crs, Geographic *xya){
+EXPORT Geodesic miller_inverse_p(Prepared *prep, Geographic *xya){
 	Geodesic lla;
+	Crs *crs = &prep->crs;
 
 	lla.longitude = (xya->x - crs->x0)/crs->datum.ellipsoid.a + crs->lambda0;
 	lla.latitude = 2.5 * (atan(exp(0.8*(xya->y - crs->y0)/crs->datum.ellipsoid.a)) - M_PI/4);
@@ -28,3 +49,6 @@ EXPORT Geodesic miller_inverse(Crs *crs, Geographic *xya){
 
 	return lla;
 }
+
+PREPARED_BATCH(miller)
+PREPARED_PROJECTION(miller)
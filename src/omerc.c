@@ -2,81 +2,122 @@
 // All rights reserved.
 #include "./geoid.h"
 
-typedef struct{
-	double B;
-	double A;
-	double t0;
-	double D;
-	double D2;
-	double F;
-	double H;
-	double G;
-	double g0;
-	double l0;
-	double uc;
-	double vc;
-}Coef;
-
-EXPORT Coef omerc_coef(double a, double e, double lambda0, double phi0, double k0, double azimut){
-	Coef result;
-	double e2, cphi0, sphi0;
+/*
+Source :
+IOGP Publication 373-7-2 – Geomatics Guidance Note number 7, part 2
+Hotine Oblique Mercator (variant B, false origin at the projection centre)
 
+lambda0 and phi0 are the projection centre, azimut the initial line azimuth
+at the centre and gamma the rectified grid angle (defaults to azimut when
+NaN, so that an explicit 0 is kept).
+*/
+
+EXPORT Geographic omerc_forward_p(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic omerc_inverse_p(Prepared *prep, Geographic *xya);
+EXPORT void omerc_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void omerc_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void omerc_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void omerc_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+
+// coef[0] : B
+// coef[1] : A
+// coef[2] : H
+// coef[3] : lambda0 of the aposphere
+// coef[4] : uc, signed u of the projection centre
+// coef[5], coef[6] : sin and cos of gamma0
+// coef[7], coef[8] : sin and cos of gammac
+// coef[9..14] : conformal latitude series
+EXPORT void omerc_prepare(Crs *crs, Prepared *prep){
+	double e, e2, sphi0, cphi0, sign, B, A, t0, D, D2, F, H, G, g0, gc;
+
+	prep->crs = *crs;
+	prep->forward = omerc_forward_p;
+	prep->inverse = omerc_inverse_p;
+	prep->forward_n = omerc_forward_pn;
+	prep->inverse_n = omerc_inverse_pn;
+	prep->forward_soa = omerc_forward_psoa;
+	prep->inverse_soa = omerc_inverse_psoa;
+	prep->graticule = NULL;
+
+	e = crs->datum.ellipsoid.e;
 	e2 = e*e;
-	cphi0 = cos(phi0); sphi0 = sin(phi0);
-
-	result.B = sqrt(1 + e2*pow(cphi0, 4) / (1 - e2));
-	result.A = sqrt(a*result.B*k0*(1 - e2 )) / (1 - e2*pow(sin(lambda0), 2));
-	result.t0 = tan(M_PI/4 - phi0/2) / pow((1 - e*sphi0) / (1 + e*sphi0), e/2);
-	result.D = result.B * sqrt(1 - e2) / (cphi0 * sqrt(1 - e2*pow(sphi0, 2)));
-	result.D2 = (result.D > 1) ? pow(result.D, 2) : 1;
-	result.F = result.D + sqrt(result.D2 - 1) * ((phi0 > 0) ? 1 : -1);
-	result.H = pow(result.F*result.t0, result.B);
-	result.G = (result.F - 1/result.F) / 2;
-	result.g0 =	asin(sin(azimut) / result.D);
-	result.l0 =	phi0 - (asin(result.G * tan(result.g0))) / result.B;
-	result.uc = abs((int)cos(azimut)) < EPS ? result.A * (lambda0 - result.l0) : (result.A/result.B) * atan2(sqrt(result.D2 - 1), cos(azimut)) * ((phi0 > 0) ? 1 : -1);
-	result.vc = 0;
-
-	return result;
+	cphi0 = cos(crs->phi0); sphi0 = sin(crs->phi0);
+	sign = (crs->phi0 < 0) ? -1 : 1;
+
+	B = sqrt(1 + e2*pow(cphi0, 4)/(1 - e2));
+	A = crs->datum.ellipsoid.a*B*crs->k0*sqrt(1 - e2)/(1 - e2*sphi0*sphi0);
+	t0 = tan(M_PI/4 - crs->phi0/2)/pow((1 - e*sphi0)/(1 + e*sphi0), e/2);
+	D = B*sqrt(1 - e2)/(cphi0*sqrt(1 - e2*sphi0*sphi0));
+	D2 = (D > 1) ? D*D : 1;
+	F = D + sqrt(D2 - 1)*sign;
+	H = F*pow(t0, B);
+	G = (F - 1/F)/2;
+	g0 = asin(sin(crs->azimut)/D);
+	gc = isnan(crs->gamma) ? crs->azimut : crs->gamma;
+
+	prep->coef[0] = B;
+	prep->coef[1] = A;
+	prep->coef[2] = H;
+	prep->coef[3] = crs->lambda0 - asin(G*tan(g0))/B;
+	prep->coef[4] = (fabs(cos(crs->azimut)) < EPS) ?
+		A*(crs->lambda0 - prep->coef[3]) :
+		(A/B)*atan2(sqrt(D2 - 1), cos(crs->azimut))*sign;
+	prep->coef[5] = sin(g0);
+	prep->coef[6] = cos(g0);
+	prep->coef[7] = sin(gc);
+	prep->coef[8] = cos(gc);
+	conformal_init(e, prep->coef+9);
 }
 
-EXPORT Geographic omerc_forward(Crs *crs, Geodesic *lla){
+EXPORT Geographic omerc_forward_p(Prepared *prep, Geodesic *lla){
 	Geographic xya;
-	Coef coef;
-	double t, Q, S, T, V, U, v, u, cphi, sphi;
-
-	coef = omerc_coef(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->lambda0, crs->phi0, crs->k0, crs->azimut);
-	cphi = cos(lla->latitude); sphi = sin(lla->latitude);
-// t	=	tan(p / 4 - f / 2) / ((1 - e sin (f)) / (1 + e sin (f)))e/2
-	t = tan(M_PI/4 - lla->latitude/2) / pow(1-crs->datum.ellipsoid.e*sphi/(1+crs->datum.ellipsoid.e*sphi), crs->datum.ellipsoid.e/2);
-// Q	=	H / tB
-	Q = coef.H/pow(t, coef.B);
-// S	=	(Q - 1 / Q) / 2
-	S = (Q - 1 / Q) / 2;
-// T	=	(Q + 1 / Q) / 2
-	T = (Q + 1 / Q) / 2;
-// V	=	sin(B (l - l0))
-	V = sin(coef.B * (lla->longitude - coef.l0));
-// U	=	(- V cos(g0) + S sin(g0)) / T
-	U = (-V * cos(coef.g0) + S * sin(coef.g0));
-// v	=	A ln((1 - U) / (1 + U)) / 2 B
-	v = coef.A * log((1-U)/(1+U)) / (2*coef.B);
-// u	=	A atan((S cos(g0) + V sin(g0)) / cos(B (l - l0 ))) / B
-	u = coef.A * atan2((S * cos(coef.g0) + V * sin(coef.g0)), cos(coef.B * (lla->longitude - coef.l0))) / coef.B;
-	u -= coef.uc;
-
-// E	= v cos(gc) + u sin(gc) + (FE or Ec)
-// N 	= u cos(gc) - v sin(gc) + (FN or Nc)
-// gc = 0.
-	xya.x = u + crs->x0;
-	xya.y = v + crs->y0;
+	Crs *crs = &prep->crs;
+	double *c = prep->coef, e, sphi, t, Q, S, T, V, U, v, u, dl;
+
+	e = crs->datum.ellipsoid.e;
+	sphi = sin(lla->latitude);
+	dl = c[0]*(lla->longitude - c[3]);
+
+	t = tan(M_PI/4 - lla->latitude/2)/pow((1 - e*sphi)/(1 + e*sphi), e/2);
+	Q = c[2]/pow(t, c[0]);
+	S = (Q - 1/Q)/2;
+	T = (Q + 1/Q)/2;
+	V = sin(dl);
+	U = (-V*c[6] + S*c[5])/T;
+	v = c[1]*log((1 - U)/(1 + U))/(2*c[0]);
+	u = c[1]*atan2(S*c[6] + V*c[5], cos(dl))/c[0] - c[4];
+
+	xya.x = v*c[8] + u*c[7] + crs->x0;
+	xya.y = u*c[8] - v*c[7] + crs->y0;
 	xya.altitude = lla->altitude;
+
 	return xya;
 }
 
-EXPORT Geodesic omerc_inverse(Crs *crs, Geodesic *xya){
+EXPORT Geodesic omerc_inverse_p(Prepared *prep, Geographic *xya){
 	Geodesic lla;
-	Coef coef;
-	coef = omerc_coef(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->lambda0, crs->phi0, crs->k0, crs->azimut);
+	Crs *crs = &prep->crs;
+	double *c = prep->coef, dx, dy, v, u, Q, S, T, V, U, t, chi;
+
+	dx = xya->x - crs->x0;
+	dy = xya->y - crs->y0;
+	v = dx*c[8] - dy*c[7];
+	u = dy*c[8] + dx*c[7] + c[4];
+
+	Q = exp(-c[0]*v/c[1]);
+	S = (Q - 1/Q)/2;
+	T = (Q + 1/Q)/2;
+	V = sin(c[0]*u/c[1]);
+	U = (V*c[6] + S*c[5])/T;
+	t = pow(c[2]/sqrt((1 + U)/(1 - U)), 1/c[0]);
+	chi = M_PI/2 - 2*atan(t);
+
+	lla.latitude = conformal_footpoint(c+9, chi, sin(chi), cos(chi));
+	lla.longitude = c[3] - atan2(S*c[6] - V*c[5], cos(c[0]*u/c[1]))/c[0];
+	lla.altitude = xya->altitude;
+
 	return lla;
 }
+
+PREPARED_BATCH(omerc)
+PREPARED_PROJECTION(omerc)
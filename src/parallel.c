@@ -0,0 +1,172 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include "./parallel.h"
+#include "./vmath.h"
+
+#if _WIN32
+    #include <windows.h>
+    typedef HANDLE Thread;
+    typedef SRWLOCK Lock;
+    typedef CONDITION_VARIABLE Condition;
+    #define LOCK_INIT SRWLOCK_INIT
+    #define CONDITION_INIT CONDITION_VARIABLE_INIT
+    #define LOCK_ACQUIRE(lock) AcquireSRWLockExclusive(lock)
+    #define LOCK_TRY(lock) TryAcquireSRWLockExclusive(lock)
+    #define LOCK_RELEASE(lock) ReleaseSRWLockExclusive(lock)
+    #define CONDITION_WAIT(cond, lock) SleepConditionVariableSRW(cond, lock, INFINITE, 0)
+    #define CONDITION_BROADCAST(cond) WakeAllConditionVariable(cond)
+    static volatile LONG THREADS = 1;
+    #define THREADS_LOAD() ((int)InterlockedCompareExchange(&THREADS, 0, 0))
+    #define THREADS_STORE(n) InterlockedExchange(&THREADS, (LONG)(n))
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+    typedef pthread_t Thread;
+    typedef pthread_mutex_t Lock;
+    typedef pthread_cond_t Condition;
+    #define LOCK_INIT PTHREAD_MUTEX_INITIALIZER
+    #define CONDITION_INIT PTHREAD_COND_INITIALIZER
+    #define LOCK_ACQUIRE(lock) pthread_mutex_lock(lock)
+    #define LOCK_TRY(lock) (pthread_mutex_trylock(lock) == 0)
+    #define LOCK_RELEASE(lock) pthread_mutex_unlock(lock)
+    #define CONDITION_WAIT(cond, lock) pthread_cond_wait(cond, lock)
+    #define CONDITION_BROADCAST(cond) pthread_cond_broadcast(cond)
+    static int THREADS = 1;
+    #define THREADS_LOAD() __atomic_load_n(&THREADS, __ATOMIC_RELAXED)
+    #define THREADS_STORE(n) __atomic_store_n(&THREADS, n, __ATOMIC_RELAXED)
+#endif
+
+typedef struct{
+	Task task;
+	void *ctx;
+	size_t start;
+	size_t stop;
+}Chunk;
+
+// Worker threads are started on demand and then wait for batches for the
+// library lifetime. One batch runs on the pool at a time : BUSY is held by
+// its caller, other callers (and nested batches) run on their own thread.
+// Chunks of the current batch are taken in any order by the caller and
+// the workers, WORK and DONE are signaled under POOL lock.
+static Lock BUSY = LOCK_INIT;
+static Lock POOL = LOCK_INIT;
+static Condition WORK = CONDITION_INIT;
+static Condition DONE = CONDITION_INIT;
+static int WORKERS = 0;
+static Chunk *CHUNKS = NULL;
+static size_t COUNT = 0, NEXT = 0, FINISHED = 0;
+static unsigned long BATCH = 0;
+
+static int cpu_count(void){
+#if _WIN32
+	SYSTEM_INFO info;
+	GetSystemInfo(&info);
+	return (int)info.dwNumberOfProcessors;
+#else
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return (n > 0) ? (int)n : 1;
+#endif
+}
+
+// run chunks of current batch until none is left, POOL lock being held
+static void run_chunks(void){
+	Chunk *chunk;
+
+	while (NEXT < COUNT){
+		chunk = &CHUNKS[NEXT++];
+		LOCK_RELEASE(&POOL);
+		chunk->task(chunk->ctx, chunk->start, chunk->stop);
+		LOCK_ACQUIRE(&POOL);
+		if (++FINISHED == COUNT) CONDITION_BROADCAST(&DONE);
+	}
+}
+
+#if _WIN32
+static DWORD WINAPI worker(LPVOID arg){
+#else
+static void *worker(void *arg){
+#endif
+	unsigned long batch = 0;
+
+	(void)arg;
+	LOCK_ACQUIRE(&POOL);
+	for (;;){
+		while (BATCH == batch) CONDITION_WAIT(&WORK, &POOL);
+		batch = BATCH;
+		run_chunks();
+	}
+#if _WIN32
+	return 0;
+#else
+	return NULL;
+#endif
+}
+
+// start workers up to n, return the number running
+static int start_workers(int n){
+	Thread thread;
+
+	while (WORKERS < n){
+#if _WIN32
+		if ((thread = CreateThread(NULL, 0, worker, NULL, 0, NULL)) == NULL) break;
+		CloseHandle(thread);
+#else
+		if (pthread_create(&thread, NULL, worker, NULL) != 0) break;
+		pthread_detach(thread);
+#endif
+		WORKERS++;
+	}
+	return WORKERS;
+}
+
+// n <= 0 uses all online processors
+EXPORT void set_threads(int n){
+	if (n <= 0) n = cpu_count();
+	THREADS_STORE((n > MAX_THREADS) ? MAX_THREADS : n);
+}
+
+EXPORT int get_threads(void){
+	return THREADS_LOAD();
+}
+
+void parallel_for(Task task, void *ctx, size_t n){
+	// chunks start on VBLOCK boundaries so that points are gathered in the
+	// same vector blocks whatever the thread count, results are bitwise equal
+	parallel_split(task, ctx, n, PARALLEL_GRAIN, VBLOCK);
+}
+
+void parallel_split(Task task, void *ctx, size_t n, size_t grain, size_t align){
+	Chunk chunks[MAX_THREADS];
+	size_t count, step, k;
+
+	count = (n + grain - 1) / grain;
+	if (count > (size_t)get_threads()) count = (size_t)get_threads();
+	if (count <= 1 || !LOCK_TRY(&BUSY)){
+		task(ctx, 0, n);
+		return;
+	}
+
+	step = (n + count - 1) / count;
+	step = (step + align - 1) / align * align;
+	count = (n + step - 1) / step;
+	for (k=0; k<count; k++){
+		chunks[k].task = task;
+		chunks[k].ctx = ctx;
+		chunks[k].start = k*step;
+		chunks[k].stop = ((k+1)*step < n) ? (k+1)*step : n;
+	}
+
+	// chunks left by workers that can not be started are run by the caller
+	LOCK_ACQUIRE(&POOL);
+	start_workers((int)count - 1);
+	CHUNKS = chunks;
+	COUNT = count;
+	NEXT = FINISHED = 0;
+	BATCH++;
+	CONDITION_BROADCAST(&WORK);
+	run_chunks();
+	while (FINISHED < COUNT) CONDITION_WAIT(&DONE, &POOL);
+	COUNT = 0;
+	LOCK_RELEASE(&POOL);
+	LOCK_RELEASE(&BUSY);
+}
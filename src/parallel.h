@@ -0,0 +1,33 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Chunked execution of batch kernels on a configurable number of threads.
+// Kernels only read their (const after init) inputs and write their own
+// output slice, so no locking is needed. Worker threads are kept in a pool
+// started on first use. parallel.c is compiled into both geoid and proj
+// libraries, so each one has its own pool and thread count setting.
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include "./geoid.h"
+
+// maximum number of worker threads
+#define MAX_THREADS 64
+// minimum number of points per chunk, smaller batches run on caller thread
+#define PARALLEL_GRAIN 4096
+
+// process items [start, stop) of a batch described by ctx
+typedef void (*Task)(void *ctx, size_t start, size_t stop);
+
+EXPORT void set_threads(int n);
+EXPORT int get_threads(void);
+
+// split [0, n) in contiguous chunks processed by up to get_threads() threads,
+// the caller thread takes the first one and returns when all are done
+void parallel_for(Task task, void *ctx, size_t n);
+// same with chunks of at least grain items starting on multiples of align,
+// for batches of costly items such as raster tiles
+void parallel_split(Task task, void *ctx, size_t n, size_t grain, size_t align);
+
+#endif
@@ -0,0 +1,200 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include "./geoid.h"
+#include "./vmath.h"
+#include "./parallel.h"
+
+// projection agnostic functions working on any prepared crs
+
+typedef struct{
+	Prepared *prep;
+	void *src;
+	void *dst;
+}Job;
+
+// x and y are in crs unit : forward results are divided by crs unit ratio
+// and inverse inputs multiplied by it, by blocks of VBLOCK points so that
+// they are left untouched
+
+static void unscale(double ratio, double *x, double *y, size_t n){
+	size_t i;
+
+	if (ratio == 1.) return;
+	for (i=0; i<n; i++){
+		x[i] /= ratio;
+		y[i] /= ratio;
+	}
+}
+
+EXPORT void prepared_forward_n_serial(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n){
+	double ratio = prep->crs.unit.ratio;
+	size_t i;
+
+	prep->forward_n(prep, lla, xya, n);
+	if (ratio != 1.)
+		for (i=0; i<n; i++){
+			xya[i].x /= ratio;
+			xya[i].y /= ratio;
+		}
+}
+
+EXPORT void prepared_inverse_n_serial(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n){
+	Geographic block[VBLOCK];
+	double ratio = prep->crs.unit.ratio;
+	size_t i, j, m;
+
+	if (ratio == 1.){
+		prep->inverse_n(prep, xya, lla, n);
+		return;
+	}
+	for (i=0; i<n; i+=VBLOCK){
+		m = (n-i < VBLOCK) ? n-i : VBLOCK;
+		for (j=0; j<m; j++){
+			block[j].x = xya[i+j].x * ratio;
+			block[j].y = xya[i+j].y * ratio;
+			block[j].altitude = xya[i+j].altitude;
+		}
+		prep->inverse_n(prep, block, lla + i, m);
+	}
+}
+
+static void forward_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	prepared_forward_n_serial(job->prep, (Geodesic *)job->src + start, (Geographic *)job->dst + start, stop-start);
+}
+
+static void inverse_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	prepared_inverse_n_serial(job->prep, (Geographic *)job->src + start, (Geodesic *)job->dst + start, stop-start);
+}
+
+static double *offset(double *array, size_t start){
+	return (array != NULL) ? array + start : NULL;
+}
+
+static void forward_soa_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geodesics *src = (Geodesics *)job->src, lla;
+	Geographics *dst = (Geographics *)job->dst, xya;
+
+	lla.longitude = offset(src->longitude, start);
+	lla.latitude = offset(src->latitude, start);
+	lla.altitude = offset(src->altitude, start);
+	xya.x = offset(dst->x, start);
+	xya.y = offset(dst->y, start);
+	xya.altitude = offset(dst->altitude, start);
+	job->prep->forward_soa(job->prep, &lla, &xya, stop-start);
+	unscale(job->prep->crs.unit.ratio, xya.x, xya.y, stop-start);
+}
+
+static void inverse_soa_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Prepared *prep = job->prep;
+	Geographics *src = (Geographics *)job->src, xya;
+	Geodesics *dst = (Geodesics *)job->dst, lla;
+	double x[VBLOCK], y[VBLOCK], ratio = prep->crs.unit.ratio;
+	size_t i, j, m, step = (ratio == 1.) ? stop-start : VBLOCK;
+
+	// without unit ratio, the whole chunk is a single block
+	for (i=start; i<stop; i+=step){
+		m = (stop-i < step) ? stop-i : step;
+		xya.x = offset(src->x, i);
+		xya.y = offset(src->y, i);
+		xya.altitude = offset(src->altitude, i);
+		if (ratio != 1.){
+			for (j=0; j<m; j++){
+				x[j] = xya.x[j] * ratio;
+				y[j] = xya.y[j] * ratio;
+			}
+			xya.x = x;
+			xya.y = y;
+		}
+		lla.longitude = offset(dst->longitude, i);
+		lla.latitude = offset(dst->latitude, i);
+		lla.altitude = offset(dst->altitude, i);
+		prep->inverse_soa(prep, &xya, &lla, m);
+	}
+}
+
+EXPORT Geographic prepared_forward(Prepared *prep, Geodesic *lla){
+	Geographic xya = prep->forward(prep, lla);
+	unscale(prep->crs.unit.ratio, &xya.x, &xya.y, 1);
+	return xya;
+}
+
+EXPORT Geodesic prepared_inverse(Prepared *prep, Geographic *xya){
+	Geographic scaled = *xya;
+	scaled.x *= prep->crs.unit.ratio;
+	scaled.y *= prep->crs.unit.ratio;
+	return prep->inverse(prep, &scaled);
+}
+
+EXPORT void prepared_forward_n(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n){
+	Job job = {prep, lla, xya};
+	parallel_for(forward_n_task, &job, n);
+}
+
+EXPORT void prepared_inverse_n(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n){
+	Job job = {prep, xya, lla};
+	parallel_for(inverse_n_task, &job, n);
+}
+
+EXPORT void prepared_forward_soa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n){
+	Job job = {prep, lla, xya};
+	parallel_for(forward_soa_task, &job, n);
+}
+
+EXPORT void prepared_inverse_soa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n){
+	Job job = {prep, xya, lla};
+	parallel_for(inverse_soa_task, &job, n);
+}
+
+typedef struct{
+	Prepared *prep;
+	double *longitudes;
+	size_t nlon;
+	double *latitudes;
+	double altitude;
+	Geographic *xya;
+}Sweep;
+
+// without a dedicated kernel, rows are projected by blocks of forward_n, in
+// meters as dedicated kernels do
+static void graticule_rows(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya){
+	Geodesic lla[VBLOCK];
+	size_t i, j, k, m;
+
+	for (i=0; i<nlat; i++){
+		for (j=0; j<nlon; j+=VBLOCK){
+			m = (nlon-j < VBLOCK) ? nlon-j : VBLOCK;
+			for (k=0; k<m; k++){
+				lla[k].longitude = longitudes[j+k];
+				lla[k].latitude = latitudes[i];
+				lla[k].altitude = altitude;
+			}
+			prep->forward_n(prep, lla, xya + i*nlon + j, m);
+		}
+	}
+}
+
+static void graticule_task(void *ctx, size_t start, size_t stop){
+	Sweep *sweep = (Sweep *)ctx;
+	Prepared *prep = sweep->prep;
+	Geographic *xya = sweep->xya + start*sweep->nlon;
+	double ratio = prep->crs.unit.ratio;
+	size_t i, n = (stop-start)*sweep->nlon;
+
+	(prep->graticule != NULL ? prep->graticule : graticule_rows)(prep, sweep->longitudes, sweep->nlon, sweep->latitudes + start, stop-start, sweep->altitude, xya);
+	if (ratio != 1.)
+		for (i=0; i<n; i++){
+			xya[i].x /= ratio;
+			xya[i].y /= ratio;
+		}
+}
+
+// chunks of whole rows, at least PARALLEL_GRAIN points each
+EXPORT void prepared_graticule(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya){
+	Sweep sweep = {prep, longitudes, nlon, latitudes, altitude, xya};
+	if (nlon == 0 || nlat == 0) return;
+	parallel_split(graticule_task, &sweep, nlat, (PARALLEL_GRAIN + nlon - 1)/nlon, GRATICULE_TILE);
+}
@@ -0,0 +1,159 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <stdio.h>
+#include <string.h>
+#include "./snapshot.h"
+
+#if __linux__
+	#include <fcntl.h>
+	#include <unistd.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+#endif
+
+// record size of each section as compiled
+static const size_t SIZES[SNAPSHOT_TABLES] = {
+	sizeof(Unit), sizeof(Prime), sizeof(Ellipsoid), sizeof(Datum), sizeof(Crs), 0
+};
+
+// map the whole file (linux) or read it in memory (windows)
+static void *load(const char *path, size_t *size){
+#if __linux__
+	struct stat st;
+	void *data;
+	int fd = open(path, O_RDONLY);
+
+	if (fd < 0) return NULL;
+	if (fstat(fd, &st) != 0 || st.st_size == 0){
+		close(fd);
+		return NULL;
+	}
+	*size = (size_t)st.st_size;
+	data = mmap(NULL, *size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+	close(fd);
+	return (data == MAP_FAILED) ? NULL : data;
+#else
+	FILE *f = fopen(path, "rb");
+	void *data = NULL;
+	long length;
+
+	if (f == NULL) return NULL;
+	if (fseek(f, 0, SEEK_END) == 0 && (length = ftell(f)) > 0){
+		*size = (size_t)length;
+		rewind(f);
+		data = malloc(*size);
+		if (data != NULL && fread(data, 1, *size, f) != *size){
+			free(data);
+			data = NULL;
+		}
+	}
+	fclose(f);
+	return data;
+#endif
+}
+
+static void unload(void *data, size_t size){
+#if __linux__
+	munmap(data, size);
+#else
+	free(data);
+#endif
+}
+
+static int check(SnapshotHeader *header, size_t size){
+	Section *s;
+	uint64_t end;
+	int i;
+
+	if (size < sizeof(SnapshotHeader)) return 0;
+	if (memcmp(header->magic, SNAPSHOT_MAGIC, 8) != 0 || header->version != SNAPSHOT_VERSION)
+		return 0;
+	for (i=0; i<SNAPSHOT_TABLES; i++){
+		s = &header->sections[i];
+		if (s->size != SIZES[i] || s->texts == 0 || s->keys % 4 != 0 || s->values % 8 != 0)
+			return 0;
+		end = s->keys + 4*s->count;
+		if (s->size > 0 && s->values + s->size*s->count > end) end = s->values + s->size*s->count;
+		if (s->strings + s->texts*SNAPSHOT_TEXT*s->count > end) end = s->strings + s->texts*SNAPSHOT_TEXT*s->count;
+		if (end > size) return 0;
+	}
+	return 1;
+}
+
+EXPORT Snapshot *snapshot_open(const char *path){
+	Snapshot *snap;
+	size_t size = 0;
+	void *data = load(path, &size);
+
+	if (data == NULL) return NULL;
+	if (!check((SnapshotHeader *)data, size) || (snap = malloc(sizeof(Snapshot))) == NULL){
+		unload(data, size);
+		return NULL;
+	}
+	snap->header = (SnapshotHeader *)data;
+	snap->size = size;
+	return snap;
+}
+
+EXPORT void snapshot_close(Snapshot *snap){
+	if (snap == NULL) return;
+	unload(snap->header, snap->size);
+	free(snap);
+}
+
+EXPORT const SnapshotHeader *snapshot_header(Snapshot *snap){
+	return snap->header;
+}
+
+static Section *section(Snapshot *snap, int table){
+	return (table >= 0 && table < SNAPSHOT_TABLES) ? &snap->header->sections[table] : NULL;
+}
+
+EXPORT long snapshot_find(Snapshot *snap, int table, int epsg){
+	Section *s = section(snap, table);
+	const int32_t *keys;
+	size_t lo = 0, hi, mid;
+
+	if (s == NULL) return -1;
+	keys = (const int32_t *)((char *)snap->header + s->keys);
+	hi = (size_t)s->count;
+	while (lo < hi){
+		mid = (lo + hi)/2;
+		if (keys[mid] < epsg) lo = mid + 1;
+		else hi = mid;
+	}
+	return (lo < s->count && keys[lo] == epsg) ? (long)lo : -1;
+}
+
+EXPORT long snapshot_search(Snapshot *snap, int table, const char *name){
+	Section *s = section(snap, table);
+	const char *strings;
+	size_t i, stride;
+
+	if (s == NULL || name == NULL) return -1;
+	strings = (char *)snap->header + s->strings;
+	stride = (size_t)s->texts*SNAPSHOT_TEXT;
+	for (i=0; i<s->count; i++)
+		if (strncmp(strings + i*stride, name, SNAPSHOT_TEXT) == 0)
+			return (long)i;
+	return -1;
+}
+
+EXPORT int snapshot_key(Snapshot *snap, int table, long index){
+	Section *s = section(snap, table);
+	if (s == NULL || index < 0 || (uint64_t)index >= s->count) return 0;
+	return ((const int32_t *)((char *)snap->header + s->keys))[index];
+}
+
+EXPORT const void *snapshot_value(Snapshot *snap, int table, long index){
+	Section *s = section(snap, table);
+	if (s == NULL || s->size == 0 || index < 0 || (uint64_t)index >= s->count) return NULL;
+	return (char *)snap->header + s->values + index*s->size;
+}
+
+EXPORT const char *snapshot_text(Snapshot *snap, int table, long index, int column){
+	Section *s = section(snap, table);
+	if (s == NULL || index < 0 || (uint64_t)index >= s->count || column < 0 || (uint64_t)column >= s->texts)
+		return NULL;
+	return (char *)snap->header + s->strings + (index*s->texts + column)*SNAPSHOT_TEXT;
+}
@@ -0,0 +1,69 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Binary snapshot of the EPSG database generated at build time from
+// db/epsg.sqlite (see Gryd/snapshot.py). Every table is a section of fixed
+// size records laid out as the geoid.h structures, sorted by epsg id, with
+// SNAPSHOT_TEXT chars strings (name first) for each record. The file is
+// mapped copy-on-write so records are read in place and never written back.
+
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include "./geoid.h"
+
+#define SNAPSHOT_MAGIC "GRYDEPSG"
+#define SNAPSHOT_VERSION 2
+// null terminated string size
+#define SNAPSHOT_TEXT 80
+
+// sections
+#define SNAPSHOT_UNIT 0
+#define SNAPSHOT_PRIME 1
+#define SNAPSHOT_ELLIPSOID 2
+#define SNAPSHOT_DATUM 3
+#define SNAPSHOT_CRS 4
+#define SNAPSHOT_PROJECTION 5
+#define SNAPSHOT_TABLES 6
+
+// offsets are from the start of file
+typedef struct{
+    uint64_t count;   // number of records
+    uint64_t size;    // record size, 0 if section only holds strings
+    uint64_t texts;   // number of strings per record
+    uint64_t keys;    // int32_t epsg ids in ascending order
+    uint64_t values;  // records
+    uint64_t strings; // texts*SNAPSHOT_TEXT chars per record
+}Section;
+
+// source is the sqlite file change counter and length its size, so a
+// snapshot of an edited database is detected as stale
+typedef struct{
+    char magic[8];
+    uint32_t version;
+    uint32_t source;
+    uint64_t length;
+    Section sections[SNAPSHOT_TABLES];
+}SnapshotHeader;
+
+typedef struct{
+    SnapshotHeader *header;
+    size_t size;
+}Snapshot;
+
+// NULL if file is missing, truncated or records do not match the structures
+EXPORT Snapshot *snapshot_open(const char *path);
+EXPORT void snapshot_close(Snapshot *snap);
+EXPORT const SnapshotHeader *snapshot_header(Snapshot *snap);
+
+// record index of epsg id (binary search) or first record named name, -1 if
+// not found
+EXPORT long snapshot_find(Snapshot *snap, int table, int epsg);
+EXPORT long snapshot_search(Snapshot *snap, int table, const char *name);
+
+EXPORT int snapshot_key(Snapshot *snap, int table, long index);
+EXPORT const void *snapshot_value(Snapshot *snap, int table, long index);
+EXPORT const char *snapshot_text(Snapshot *snap, int table, long index, int column);
+
+#endif
@@ -0,0 +1,204 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <string.h>
+#include "./geoid.h"
+
+#ifdef GRYD_STATS
+
+#if _WIN32
+	#include <windows.h>
+	#define THREAD_LOCAL __declspec(thread)
+	static SRWLOCK LOCK = SRWLOCK_INIT;
+	static DWORD KEY;
+	#define LOCK_INIT(lock) InitializeSRWLock(lock)
+	#define LOCK_ACQUIRE(lock) AcquireSRWLockExclusive(lock)
+	#define LOCK_RELEASE(lock) ReleaseSRWLockExclusive(lock)
+	#define LOCK_DESTROY(lock) ((void)0)
+#else
+	#include <pthread.h>
+	#define THREAD_LOCAL __thread
+	static pthread_mutex_t LOCK = PTHREAD_MUTEX_INITIALIZER;
+	static pthread_key_t KEY;
+	#define LOCK_INIT(lock) pthread_mutex_init(lock, NULL)
+	#define LOCK_ACQUIRE(lock) pthread_mutex_lock(lock)
+	#define LOCK_RELEASE(lock) pthread_mutex_unlock(lock)
+	#define LOCK_DESTROY(lock) pthread_mutex_destroy(lock)
+#endif
+
+// counters of a thread, registered in a list so that flush and reset reach
+// every thread, merged and unlinked when the thread exits
+typedef struct Local{
+	Stats stats[STATS_SOLVERS];
+	struct Local *next;
+#if _WIN32
+	SRWLOCK lock;
+#else
+	pthread_mutex_t lock;
+#endif
+}Local;
+
+// TOTALS, REGISTRY and KEY_READY are guarded by LOCK, the counters of a
+// thread by its own lock, always acquired after LOCK
+static Stats TOTALS[STATS_SOLVERS];
+static Local *REGISTRY = NULL;
+static int KEY_READY = 0;
+static THREAD_LOCAL Local *LOCAL = NULL;
+
+static void sample(Stats *s, const double *values){
+	memcpy(s->sample[s->next], values, sizeof(double)*4);
+	s->next = (s->next + 1) % STATS_SAMPLES;
+	if (s->samples < STATS_SAMPLES) s->samples++;
+}
+
+// local samples are appended oldest first so the ring keeps the last ones
+static void merge(Stats *total, Stats *local){
+	int k, i;
+
+	total->calls += local->calls;
+	total->iterations += local->iterations;
+	total->failures += local->failures;
+	for (k=0; k<STATS_BINS; k++) total->histogram[k] += local->histogram[k];
+	for (k=0; k<local->samples; k++){
+		i = (local->next - local->samples + k + STATS_SAMPLES) % STATS_SAMPLES;
+		sample(total, local->sample[i]);
+	}
+	memset(local, 0, sizeof(Stats));
+}
+
+// merge counters of local into totals, LOCK being held
+static void merge_local(Local *local){
+	int k;
+
+	LOCK_ACQUIRE(&local->lock);
+	for (k=0; k<STATS_SOLVERS; k++) merge(&TOTALS[k], &local->stats[k]);
+	LOCK_RELEASE(&local->lock);
+}
+
+static void merge_registry(void){
+	Local *local;
+
+	for (local=REGISTRY; local!=NULL; local=local->next) merge_local(local);
+}
+
+// thread exit callback
+#if _WIN32
+static VOID WINAPI unregister(PVOID arg){
+#else
+static void unregister(void *arg){
+#endif
+	Local *local = (Local *)arg, **link;
+
+	if (local == NULL) return;
+	LOCK_ACQUIRE(&LOCK);
+	merge_local(local);
+	for (link=&REGISTRY; *link!=NULL; link=&(*link)->next)
+		if (*link == local){
+			*link = local->next;
+			break;
+		}
+	LOCK_RELEASE(&LOCK);
+	LOCK_DESTROY(&local->lock);
+	free(local);
+}
+
+// counters of calling thread, NULL if they can not be allocated
+static Local *local_stats(void){
+	Local *local;
+
+	if (LOCAL != NULL) return LOCAL;
+	if ((local = calloc(1, sizeof(Local))) == NULL) return NULL;
+	LOCK_INIT(&local->lock);
+	LOCK_ACQUIRE(&LOCK);
+	if (!KEY_READY){
+#if _WIN32
+		KEY = FlsAlloc(unregister);
+		KEY_READY = (KEY != FLS_OUT_OF_INDEXES);
+#else
+		KEY_READY = (pthread_key_create(&KEY, unregister) == 0);
+#endif
+	}
+	if (KEY_READY){
+		local->next = REGISTRY;
+		REGISTRY = local;
+	}
+	LOCK_RELEASE(&LOCK);
+	if (!KEY_READY){
+		LOCK_DESTROY(&local->lock);
+		free(local);
+		return NULL;
+	}
+#if _WIN32
+	FlsSetValue(KEY, local);
+#else
+	pthread_setspecific(KEY, local);
+#endif
+	return LOCAL = local;
+}
+
+void stats_record(int solver, int iterations, int failed, double a, double b, double c, double d){
+	Local *local = local_stats();
+	Stats *s;
+	double values[4] = {a, b, c, d};
+
+	if (local == NULL) return;
+	s = &local->stats[solver];
+	LOCK_ACQUIRE(&local->lock);
+	s->calls++;
+	s->iterations += (uint64_t)iterations;
+	s->histogram[(iterations < STATS_BINS) ? iterations : STATS_BINS-1]++;
+	if (failed){
+		s->failures++;
+		sample(s, values);
+	}
+	LOCK_RELEASE(&local->lock);
+}
+
+EXPORT int stats_enabled(void){
+	return 1;
+}
+
+EXPORT void stats_flush(void){
+	LOCK_ACQUIRE(&LOCK);
+	merge_registry();
+	LOCK_RELEASE(&LOCK);
+}
+
+EXPORT int stats_read(int solver, Stats *result){
+	if (solver < 0 || solver >= STATS_SOLVERS) return 0;
+	LOCK_ACQUIRE(&LOCK);
+	merge_registry();
+	*result = TOTALS[solver];
+	LOCK_RELEASE(&LOCK);
+	return 1;
+}
+
+EXPORT void stats_reset(void){
+	Local *local;
+
+	LOCK_ACQUIRE(&LOCK);
+	for (local=REGISTRY; local!=NULL; local=local->next){
+		LOCK_ACQUIRE(&local->lock);
+		memset(local->stats, 0, sizeof(local->stats));
+		LOCK_RELEASE(&local->lock);
+	}
+	memset(TOTALS, 0, sizeof(TOTALS));
+	LOCK_RELEASE(&LOCK);
+}
+
+#else
+
+EXPORT int stats_enabled(void){
+	return 0;
+}
+
+EXPORT void stats_flush(void){}
+
+EXPORT int stats_read(int solver, Stats *result){
+	if (solver < 0 || solver >= STATS_SOLVERS) return 0;
+	memset(result, 0, sizeof(Stats));
+	return 1;
+}
+
+EXPORT void stats_reset(void){}
+
+#endif
@@ -0,0 +1,62 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Convergence statistics of iterative solvers, compiled in with GRYD_STATS
+// defined (GRYD_STATS=1 environment variable at build time). Every solver
+// call records its iteration count and whether it stopped on its iteration
+// limit in counters of its thread. Counters of every thread are registered
+// so that stats_flush, stats_read and stats_reset reach all of them, and are
+// merged into library totals when their thread exits. Without GRYD_STATS,
+// STATS_RECORD expands to nothing.
+//
+// Included by geoid.h, EXPORT has to be defined before.
+
+#ifndef STATS_H
+#define STATS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// instrumented solvers
+#define STATS_GEODESIC 0      // iterative geocentric to geodesic latitude
+#define STATS_DISTANCE 1      // vincenty inverse problem
+#define STATS_DESTINATION 2   // vincenty direct problem
+#define STATS_KARNEY 3        // karney inverse problem newton iterations
+#define STATS_SOLVERS 4
+// iteration histogram bins, last one gathers longer runs
+#define STATS_BINS 128
+// inputs of the last non converged calls kept by solver
+#define STATS_SAMPLES 16
+
+typedef struct{
+    uint64_t calls;
+    uint64_t iterations;
+    uint64_t failures;             // calls stopped on iteration limit
+    uint64_t histogram[STATS_BINS];
+    int samples;                   // number of valid samples
+    int next;                      // ring index of next sample
+    double sample[STATS_SAMPLES][4];
+}Stats;
+
+#ifdef GRYD_STATS
+    void stats_record(int solver, int iterations, int failed, double a, double b, double c, double d);
+    // a, b, c and d are the solver inputs kept when failed : x, y, z for
+    // geodesic, longitudes and latitudes for inverse problems, longitude,
+    // latitude, bearing and distance for direct ones (radians and meters)
+    #define STATS_RECORD(solver, iterations, failed, a, b, c, d) \
+        stats_record(solver, iterations, failed, a, b, c, d)
+#else
+    #define STATS_RECORD(solver, iterations, failed, a, b, c, d) ((void)0)
+#endif
+
+// 1 if statistics are compiled in
+EXPORT int stats_enabled(void);
+// merge counters of every thread into library totals
+EXPORT void stats_flush(void);
+// copy library totals of solver into result after flushing every thread,
+// return 0 on unknown solver
+EXPORT int stats_read(int solver, Stats *result);
+// clear library totals and counters of every thread
+EXPORT void stats_reset(void);
+
+#endif
@@ -1,19 +1,44 @@
 // Copyright (c) 2015-2021, THOORENS Bruno
 // All rights reserved.
 #include "./geoid.h"
+#include "./vmath.h"
 
-static double F3 = 3*2;
-static double F4 = 4*3*2;
-static double F5 = 5*4*3*2;
-static double F6 = 6*5*4*3*2;
-static double F7 = 7*6*5*4*3*2;
-static double F8 = 8*7*6*5*4*3*2;
+static const double F3 = 3*2;
+static const double F4 = 4*3*2;
+static const double F5 = 5*4*3*2;
+static const double F6 = 6*5*4*3*2;
+static const double F7 = 7*6*5*4*3*2;
+static const double F8 = 8*7*6*5*4*3*2;
 
-EXPORT Geographic tmerc_forward(Crs *crs, Geodesic *lla){
+EXPORT Geographic tmerc_forward_p(Prepared *prep, Geodesic *lla);
+EXPORT Geodesic tmerc_inverse_p(Prepared *prep, Geographic *xya);
+EXPORT void tmerc_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n);
+EXPORT void tmerc_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n);
+EXPORT void tmerc_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n);
+EXPORT void tmerc_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n);
+EXPORT void tmerc_graticule_p(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya);
+
+// coef[0] : meridian distance of phi0
+// coef[1..9] : meridian arc table of the ellipsoid
+EXPORT void tmerc_prepare(Crs *crs, Prepared *prep){
+	prep->crs = *crs;
+	prep->forward = tmerc_forward_p;
+	prep->inverse = tmerc_inverse_p;
+	prep->forward_n = tmerc_forward_pn;
+	prep->inverse_n = tmerc_inverse_pn;
+	prep->forward_soa = tmerc_forward_psoa;
+	prep->inverse_soa = tmerc_inverse_psoa;
+	prep->graticule = tmerc_graticule_p;
+	meridian_init(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, prep->coef+1);
+	prep->coef[0] = meridian_arc(prep->coef+1, crs->phi0);
+}
+
+EXPORT Geographic tmerc_forward_p(Prepared *prep, Geodesic *lla){
 	Geographic xya;
+	Crs *crs = &prep->crs;
 	double m, v, lc, B, t, lc2, B2, B3, B4, t2, t4, t6, W3, W4, W5, W6, W7_, W8_, X, Y;
 
-	m   = meridian_distance(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, lla->latitude) - meridian_distance(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->phi0);
+	m   = meridian_arc(prep->coef+1, lla->latitude) - prep->coef[0];
 	v   = nhu(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, lla->latitude);
 	B   = v/rho(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, lla->latitude);
 	lc  = cos(lla->latitude)*(lla->longitude-crs->lambda0);
@@ -41,11 +66,12 @@ EXPORT Geographic tmerc_forward(Crs *crs, Geodesic *lla){
 	return xya;
 }
 
-EXPORT Geodesic tmerc_inverse(Crs* crs, Geographic *xya){
+EXPORT Geodesic tmerc_inverse_p(Prepared *prep, Geographic *xya){
 	Geodesic lla;
+	Crs *crs = &prep->crs;
 	double f, v, x, x2, B, t, c, B2, B3, B4, t2, t4, t6, V3, V5, V7_, U4, U6, U8_, lambda, phi;
 
-	f = footpoint_latitude(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, meridian_distance(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, crs->phi0) + (xya->y - crs->y0)/crs->k0);
+	f = meridian_footpoint(prep->coef+1, prep->coef[0] + (xya->y - crs->y0)/crs->k0);
 	v = nhu(crs->datum.ellipsoid.a, crs->datum.ellipsoid.e, f);
 	x = (xya->x - crs->x0)/(crs->k0*v);
 	x2 = x*x;
@@ -74,3 +100,199 @@ EXPORT Geodesic tmerc_inverse(Crs* crs, Geographic *xya){
 
 	return lla;
 }
+
+// same series as tmerc_forward_p, every latitude term and coefficient being
+// computed once per row so that points only cost the lc polynomials
+EXPORT void tmerc_graticule_p(Prepared *prep, double *longitudes, size_t nlon, double *latitudes, size_t nlat, double altitude, Geographic *xya){
+	Crs *crs = &prep->crs;
+	double a = crs->datum.ellipsoid.a, e = crs->datum.ellipsoid.e;
+	double phi, m, v, vt, c, B, t, B2, B3, B4, t2, t4, t6, A3, A5, A7, C4, C6, C8, lc, lc2, X, Y;
+	Geographic *row;
+	size_t i, j;
+
+	for (i=0; i<nlat; i++){
+		phi = latitudes[i];
+		m   = meridian_arc(prep->coef+1, phi) - prep->coef[0];
+		v   = nhu(a, e, phi);
+		B   = v/rho(a, e, phi);
+		t   = tan(phi);
+		c   = cos(phi);
+		vt  = v*t;
+
+		B2 = B*B;  t2 = t*t;
+		B3 = B*B2; t4 = t2*t2;
+		B4 = B*B3; t6 = t2*t4;
+
+		A3 = (B - t2)/F3;
+		A5 = (4*B3*(1-6*t2) + B2*(1+8*t2) - 2*B*t2 + t4)/F5;
+		A7 = (61 - 479*t2 + 179*t4 - t6)/F7;
+		C4 = (4*B2 + B - t2)/F4;
+		C6 = (8*B4*(11-24*t2) - 28*B3*(1-6*t2) + B2*(1-32*t2) - 2*B*t2 + t4)/F6;
+		C8 = (1385 - 3111*t2 + 543*t4 - t6)/F8;
+
+		row = xya + i*nlon;
+		for (j=0; j<nlon; j++){
+			lc  = c*(longitudes[j]-crs->lambda0);
+			lc2 = lc*lc;
+			X = v*lc * (1. + lc2 * (A3 + lc2 * (A5 + lc2*A7)));
+			Y = m + vt*lc2 * (0.5 + lc2 * (C4 + lc2 * (C6 + lc2*C8)));
+			row[j].x = crs->k0*X + crs->x0;
+			row[j].y = crs->k0*Y + crs->y0;
+			row[j].altitude = altitude;
+		}
+	}
+}
+
+/*
+Vectorized kernels : same series as tmerc_forward_p and tmerc_inverse_p on
+structure of arrays. Every trigonometric term is derived from one vm_sincos
+call (multiple angles by recurrence, tan = sin/cos) and nhu/rho powers are
+replaced by sqrt so that the loop body is straight-line code.
+
+Footpoint latitude comes from the direct series of the meridian arc table
+so the inverse needs no iteration.
+*/
+
+// n <= VBLOCK
+VECTORIZE static void tmerc_forward_kernel(Prepared *prep, double *lon, double *lat, double *x, double *y, size_t n){
+	Crs *crs = &prep->crs;
+	double a, e2, m0, M[MERIDIAN_COEF];
+	double s, c, w, m, v, lc, B, t, lc2, B2, B3, B4, t2, t4, t6, W3, W4, W5, W6, W7_, W8_, X, Y;
+	size_t i;
+
+	a = crs->datum.ellipsoid.a;
+	e2 = crs->datum.ellipsoid.e * crs->datum.ellipsoid.e;
+	m0 = prep->coef[0];
+	for (i=0; i<MERIDIAN_COEF; i++) M[i] = prep->coef[1+i];
+
+	for (i=0; i<n; i++){
+		vm_sincos(lat[i], &s, &c);
+		w   = 1 - e2*s*s;
+		m   = M[0]*(lat[i] + sin2k_sum(M+1, s, c)) - m0;
+		v   = a / sqrt(w);
+		B   = w / (1 - e2);
+		lc  = c*(lon[i]-crs->lambda0);
+		t   = s/c;
+		lc2 = lc*lc;
+
+		B2 = B*B;  t2 = t*t;
+		B3 = B*B2; t4 = t2*t2;
+		B4 = B*B3; t6 = t2*t4;
+
+		W3  = B - t2;
+		W4  = 4*B2 + B - t2;
+		W5  = 4*B3*(1-6*t2) + B2*(1+8*t2) - 2*B*t2 + t4;
+		W6  = 8*B4*(11-24*t2) - 28*B3*(1-6*t2) + B2*(1-32*t2) - 2*B*t2 + t4;
+		W7_ = 61 - 479*t2 + 179*t4 - t6;
+		W8_ = 1385 - 3111*t2 + 543*t4 - t6;
+
+		X = v*lc * (1. + lc2 * (W3/F3 + lc2 * (W5/F5 + lc2*W7_/F7)));
+		Y = m + v*t*lc2 * (0.5 + lc2 * (W4/F4 + lc2 * (W6/F6 + lc2*W8_/F8)));
+
+		x[i] = crs->k0*X + crs->x0;
+		y[i] = crs->k0*Y + crs->y0;
+	}
+}
+
+// n <= VBLOCK
+VECTORIZE static void tmerc_inverse_kernel(Prepared *prep, double *x_, double *y_, double *lon, double *lat, size_t n){
+	Crs *crs = &prep->crs;
+	double a, e2, m0, M[MERIDIAN_COEF], mu, f;
+	double s, w, v, x, x2, B, t, c, B2, B3, B4, t2, t4, t6, V3, V5, V7_, U4, U6, U8_;
+	size_t i;
+
+	a = crs->datum.ellipsoid.a;
+	e2 = crs->datum.ellipsoid.e * crs->datum.ellipsoid.e;
+	m0 = prep->coef[0];
+	for (i=0; i<MERIDIAN_COEF; i++) M[i] = prep->coef[1+i];
+
+	for (i=0; i<n; i++){
+		mu = (m0 + (y_[i] - crs->y0)/crs->k0)/M[0];
+		vm_sincos(mu, &s, &c);
+		f = mu + sin2k_sum(M+5, s, c);
+		vm_sincos(f, &s, &c);
+		w = 1 - e2*s*s;
+		v = a / sqrt(w);
+		x = (x_[i] - crs->x0)/(crs->k0*v);
+		x2 = x*x;
+
+		B = w / (1 - e2);
+		t = s/c;
+
+		B2 = B*B;  t2 = t*t;
+		B3 = B*B2; t4 = t2*t2;
+		B4 = B*B3; t6 = t2*t4;
+
+		V3  = B + 2*t2;
+		V5  = 4*B3*(1-6*t2) - B2*(9-68*t2) - 72*B*t2 - 24*t4;
+		V7_ = 61 + 662*t2 + 1320*t4 + 720*t6;
+		U4  = 4*B2 - 9*B*(1-t2) - 12*t2;
+		U6  = 8*B4*(11-24*t2) - 12*B3*(21-71*t2) + 15*B2*(15-98*t2+15*t4) + 180*B*(5*t2-3*t4) + 360*t4;
+		U8_ = -1385 - 3633*t2 - 4095*t4 - 1575*t6;
+
+		lon[i] = x/c * (1. - x2 * (V3/F3 + x2 * (V5/F5 + x2 * V7_/F7))) + crs->lambda0;
+		lat[i] = f - x2*B*t * (0.5 + x2 * (U4/F4 + x2 * (U6/F6 + x2 * U8_/F8)));
+	}
+}
+
+EXPORT void tmerc_forward_pn(Prepared *prep, Geodesic *lla, Geographic *xya, size_t n){
+	double lon[VBLOCK], lat[VBLOCK], x[VBLOCK], y[VBLOCK];
+	size_t i, j, m;
+
+	for (i=0; i<n; i+=VBLOCK){
+		m = (n-i < VBLOCK) ? n-i : VBLOCK;
+		for (j=0; j<m; j++){
+			lon[j] = lla[i+j].longitude;
+			lat[j] = lla[i+j].latitude;
+		}
+		tmerc_forward_kernel(prep, lon, lat, x, y, m);
+		for (j=0; j<m; j++){
+			xya[i+j].x = x[j];
+			xya[i+j].y = y[j];
+			xya[i+j].altitude = lla[i+j].altitude;
+		}
+	}
+}
+
+EXPORT void tmerc_inverse_pn(Prepared *prep, Geographic *xya, Geodesic *lla, size_t n){
+	double x[VBLOCK], y[VBLOCK], lon[VBLOCK], lat[VBLOCK];
+	size_t i, j, m;
+
+	for (i=0; i<n; i+=VBLOCK){
+		m = (n-i < VBLOCK) ? n-i : VBLOCK;
+		for (j=0; j<m; j++){
+			x[j] = xya[i+j].x;
+			y[j] = xya[i+j].y;
+		}
+		tmerc_inverse_kernel(prep, x, y, lon, lat, m);
+		for (j=0; j<m; j++){
+			lla[i+j].longitude = lon[j];
+			lla[i+j].latitude = lat[j];
+			lla[i+j].altitude = xya[i+j].altitude;
+		}
+	}
+}
+
+EXPORT void tmerc_forward_psoa(Prepared *prep, Geodesics *lla, Geographics *xya, size_t n){
+	size_t i, j, m;
+
+	for (i=0; i<n; i+=VBLOCK){
+		m = (n-i < VBLOCK) ? n-i : VBLOCK;
+		tmerc_forward_kernel(prep, lla->longitude+i, lla->latitude+i, xya->x+i, xya->y+i, m);
+		if (xya->altitude != NULL)
+			for (j=i; j<i+m; j++) xya->altitude[j] = (lla->altitude != NULL) ? lla->altitude[j] : 0.;
+	}
+}
+
+EXPORT void tmerc_inverse_psoa(Prepared *prep, Geographics *xya, Geodesics *lla, size_t n){
+	size_t i, j, m;
+
+	for (i=0; i<n; i+=VBLOCK){
+		m = (n-i < VBLOCK) ? n-i : VBLOCK;
+		tmerc_inverse_kernel(prep, xya->x+i, xya->y+i, lla->longitude+i, lla->latitude+i, m);
+		if (lla->altitude != NULL)
+			for (j=i; j<i+m; j++) lla->altitude[j] = (xya->altitude != NULL) ? xya->altitude[j] : 0.;
+	}
+}
+
+PREPARED_PROJECTION(tmerc)
@@ -0,0 +1,218 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <string.h>
+#include "./track.h"
+#include "./karney.h"
+#include "./parallel.h"
+
+typedef struct{
+	Ellipsoid *ellps;
+	Geodesic *points;     // first vertex of the round
+	size_t n;             // segments of the round
+	int mode;
+	double *cumulative;   // length at the end of the first segment, or NULL
+	double sums[MAX_THREADS];
+}Round;
+
+// blocks of TRACK_BLOCK segments solved in a stack buffer, lengths being
+// summed from the block start
+static void track_length_task(void *ctx, size_t start, size_t stop){
+	Round *job = (Round *)ctx;
+	Vincenty_dist segments[TRACK_BLOCK];
+	double length;
+	size_t b, i, first, size;
+
+	for (b=start; b<stop; b++){
+		first = b*TRACK_BLOCK;
+		size = (job->n - first < TRACK_BLOCK) ? job->n - first : TRACK_BLOCK;
+		distance_n(job->ellps, job->points + first, job->points + first+1, segments, size, job->mode);
+		for (i=0, length=0.; i<size; i++){
+			length += segments[i].distance;
+			if (job->cumulative != NULL) job->cumulative[first+i] = length;
+		}
+		job->sums[b] = length;
+	}
+}
+
+EXPORT double track_length(Ellipsoid *ellps, Track *track, Geodesic *points, size_t n, int mode, double *cumulative){
+	Round job = {.ellps = ellps, .mode = mode};
+	Vincenty_dist bridge;
+	size_t i, b, start, blocks;
+
+	if (n == 0) return track->length;
+
+	// segment from the previous chunk
+	if (track->count > 0){
+		distance_n(ellps, &track->last, points, &bridge, 1, mode);
+		track->length += bridge.distance;
+	}
+	if (cumulative != NULL) cumulative[0] = track->length;
+	// rounds of MAX_THREADS blocks, block sums are added in track order so
+	// that lengths do not depend on thread count
+	for (start=0; start<n-1; start+=job.n){
+		job.points = points + start;
+		job.n = (n-1 - start < MAX_THREADS*TRACK_BLOCK) ? n-1 - start : MAX_THREADS*TRACK_BLOCK;
+		job.cumulative = (cumulative != NULL) ? cumulative + start+1 : NULL;
+		blocks = (job.n + TRACK_BLOCK - 1) / TRACK_BLOCK;
+		parallel_split(track_length_task, &job, blocks, 1, 1);
+		for (b=0; b<blocks; b++){
+			if (cumulative != NULL)
+				for (i=b*TRACK_BLOCK; i<job.n && i<(b+1)*TRACK_BLOCK; i++) job.cumulative[i] += track->length;
+			track->length += job.sums[b];
+		}
+	}
+	track->last = points[n-1];
+	track->count += n;
+
+	return track->length;
+}
+
+EXPORT size_t track_resample(Ellipsoid *ellps, Track *track, Geodesic *points, size_t n, double spacing, int mode, Geodesic *result, size_t capacity, size_t *consumed){
+	Karney k;
+	Vincenty_dist dist, step;
+	Vincenty_dest dest;
+	double s;
+	size_t i = 0, count = 0;
+
+	*consumed = 0;
+	if (n == 0 || capacity == 0 || !(spacing > 0.)) return 0;
+	if (mode == DISTANCE_KARNEY) karney_init(ellps, &k);
+
+	if (track->count == 0){
+		result[count++] = points[0];
+		track->last = points[0];
+		track->count = 1;
+		track->length = 0.;
+		track->samples = 1;
+		i = 1;
+	}
+	for (; i<n; i++){
+		dist = (mode == DISTANCE_KARNEY) ? karney_distance(&k, &track->last, &points[i]) : distance(ellps, &track->last, &points[i]);
+		// segment is solved again when resumed, samples are not written twice
+		while (track->samples*spacing <= track->length + dist.distance){
+			if (count == capacity){
+				*consumed = i;
+				return count;
+			}
+			s = track->samples*spacing - track->length;
+			step = dist;
+			step.distance = s;
+			dest = (mode == DISTANCE_KARNEY) ? karney_destination(&k, &track->last, &step) : destination(ellps, &track->last, &step);
+			result[count].longitude = dest.longitude;
+			result[count].latitude = dest.latitude;
+			result[count].altitude = track->last.altitude + (dist.distance > 0. ? (points[i].altitude - track->last.altitude)*s/dist.distance : 0.);
+			count++;
+			track->samples++;
+		}
+		track->length += dist.distance;
+		track->last = points[i];
+		track->count++;
+	}
+	*consumed = n;
+
+	return count;
+}
+
+/*
+Douglas-Peucker on unit vectors : cross track distance of a vertex is its
+angular distance to the great circle arc of the segment, or to the nearest
+segment end when it lies beyond.
+*/
+
+static void unit_task(void *ctx, size_t start, size_t stop){
+	Geodesic *points = ((Geodesic **)ctx)[0];
+	Geocentric *u = ((Geocentric **)ctx)[1];
+	size_t i;
+	for (i=start; i<stop; i++){
+		u[i].x = cos(points[i].latitude)*cos(points[i].longitude);
+		u[i].y = cos(points[i].latitude)*sin(points[i].longitude);
+		u[i].z = sin(points[i].latitude);
+	}
+}
+
+static Geocentric cross(Geocentric *a, Geocentric *b){
+	Geocentric c;
+	c.x = a->y*b->z - a->z*b->y;
+	c.y = a->z*b->x - a->x*b->z;
+	c.z = a->x*b->y - a->y*b->x;
+	return c;
+}
+
+static double dot(Geocentric *a, Geocentric *b){
+	return a->x*b->x + a->y*b->y + a->z*b->z;
+}
+
+static double angle(Geocentric *a, Geocentric *b){
+	Geocentric c = cross(a, b);
+	return atan2(sqrt(dot(&c, &c)), dot(a, b));
+}
+
+static double cross_track(Geocentric *a, Geocentric *b, Geocentric *p){
+	Geocentric n = cross(a, b), ap, pb;
+	double norm = sqrt(dot(&n, &n));
+
+	if (norm < EPS) return angle(a, p);
+	ap = cross(a, p);
+	pb = cross(p, b);
+	if (dot(&ap, &n) >= 0. && dot(&pb, &n) >= 0.)
+		return fabs(asin(fmax(-1., fmin(1., dot(&n, p)/norm))));
+	return fmin(angle(a, p), angle(b, p));
+}
+
+EXPORT size_t track_simplify(Ellipsoid *ellps, Geodesic *points, size_t n, double tolerance, unsigned char *keep){
+	Geocentric *u;
+	size_t *stack, top = 0, first, last, i, index, count = 2;
+	double d, worst, limit;
+	void *ctx[2];
+
+	if (n <= 2){
+		memset(keep, 1, n);
+		return n;
+	}
+	u = malloc(sizeof(Geocentric)*n);
+	// pending ranges are disjoint so there are less than n of them
+	stack = malloc(sizeof(size_t)*n);
+	if (u == NULL || stack == NULL){
+		free(u);
+		free(stack);
+		return 0;
+	}
+	ctx[0] = points;
+	ctx[1] = u;
+	parallel_for(unit_task, ctx, n);
+
+	limit = fmax(tolerance, 0.)/authalic_radius(ellps);
+	memset(keep, 0, n);
+	keep[0] = keep[n-1] = 1;
+	stack[top++] = 0;
+	stack[top++] = n-1;
+	while (top > 0){
+		last = stack[--top];
+		first = stack[--top];
+		worst = -1.;
+		index = first;
+		for (i=first+1; i<last; i++){
+			d = cross_track(&u[first], &u[last], &u[i]);
+			if (d > worst){
+				worst = d;
+				index = i;
+			}
+		}
+		if (worst > limit){
+			keep[index] = 1;
+			count++;
+			if (index - first > 1){
+				stack[top++] = first;
+				stack[top++] = index;
+			}
+			if (last - index > 1){
+				stack[top++] = index;
+				stack[top++] = last;
+			}
+		}
+	}
+	free(u);
+	free(stack);
+
+	return count;
+}
@@ -0,0 +1,45 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Tracks, polylines of geodesic points (radians) in contiguous buffers.
+// Length and resampling are fed chunk by chunk through a Track state, so
+// that tracks of any size are processed in bounded memory, segments being
+// geodesics solved by distance / destination kernels. Simplification is
+// Douglas-Peucker on the whole track.
+
+#ifndef TRACK_H
+#define TRACK_H
+
+#include "./geoid.h"
+
+// segments solved per distance_n call by track_length, in a stack buffer
+#define TRACK_BLOCK 1024
+
+// zero initialized for a new track
+typedef struct{
+    Geodesic last;        // last vertex fed
+    size_t count;         // number of vertices fed
+    double length;        // length of the track fed so far
+    size_t samples;       // number of resampled points written so far
+}Track;
+
+// add n vertices to track, cumulative (n values, may be NULL) gets the track
+// length at each of them. Mode is one of DISTANCE_*. Return track length
+EXPORT double track_length(Ellipsoid *ellps, Track *track, Geodesic *points, size_t n, int mode, double *cumulative);
+
+// write points located every spacing meters along the track, its first
+// vertex included, altitudes being interpolated. At most capacity points are
+// written and consumed gets the number of vertices used, lower than n when
+// result is full so that the remaining ones have to be fed again. Karney
+// geodesics with DISTANCE_KARNEY mode, Vincenty ones otherwise. Return the
+// number of points written.
+EXPORT size_t track_resample(Ellipsoid *ellps, Track *track, Geodesic *points, size_t n, double spacing, int mode, Geodesic *result, size_t capacity, size_t *consumed);
+
+// Douglas-Peucker : set keep[i] to 1 for kept vertices, 0 for the others, so
+// that no removed vertex is farther than tolerance meters from the
+// simplified track. Cross track distances are measured on the authalic
+// sphere (within 0.5% of geodesic ones). Return the number of kept vertices,
+// 0 on memory error.
+EXPORT size_t track_simplify(Ellipsoid *ellps, Geodesic *points, size_t n, double tolerance, unsigned char *keep);
+
+#endif
@@ -0,0 +1,134 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include "./geoid.h"
+#include "./vmath.h"
+#include "./parallel.h"
+
+/*
+Fused crs to crs transformation. Geographic coordinates are deprojected,
+shifted from source to destination datum through geocentric coordinates and
+projected again without leaving C. Unit ratios and prime meridians of both
+crs are taken into account, so results match Crs.transform.
+*/
+
+EXPORT void transformer_init(Transformer *tr, Crs *src, Prepare src_prepare, Crs *dst, Prepare dst_prepare){
+	src_prepare(src, &tr->src);
+	dst_prepare(dst, &tr->dst);
+	helmert(&src->datum, &dst->datum, &tr->helmert);
+}
+
+// source to destination datum shift of geodesic coordinates
+static Geodesic shift(Transformer *tr, Geodesic *lla){
+	Geocentric xyz;
+	Geodesic result;
+
+	result = *lla;
+	result.longitude += tr->src.crs.datum.prime.longitude;
+	xyz = lla2xyz(&tr->src.crs.datum.ellipsoid, &result);
+	xyz = helmert_apply(&tr->helmert, &xyz);
+	result = xyz2lla(&tr->dst.crs.datum.ellipsoid, &xyz);
+	result.longitude -= tr->dst.crs.datum.prime.longitude;
+
+	return result;
+}
+
+EXPORT Geographic transform_point(Transformer *tr, Geographic *xya){
+	Geographic result;
+	Geodesic lla;
+	double ratio = tr->src.crs.unit.ratio;
+
+	result.x = xya->x * ratio;
+	result.y = xya->y * ratio;
+	result.altitude = xya->altitude;
+	lla = tr->src.inverse(&tr->src, &result);
+	lla = shift(tr, &lla);
+	result = tr->dst.forward(&tr->dst, &lla);
+	result.x /= tr->dst.crs.unit.ratio;
+	result.y /= tr->dst.crs.unit.ratio;
+
+	return result;
+}
+
+// one shot transformation of a single point (the Crs.transform fast path)
+EXPORT Geographic crs_transform(Crs *src, Prepare src_prepare, Crs *dst, Prepare dst_prepare, Geographic *xya){
+	Transformer tr;
+	transformer_init(&tr, src, src_prepare, dst, dst_prepare);
+	return transform_point(&tr, xya);
+}
+
+// VBLOCK points at most, so that projection batch kernels are used
+static void transform_block(Transformer *tr, Geographic *xya, Geographic *result, size_t n){
+	Geographic src[VBLOCK];
+	Geodesic lla[VBLOCK];
+	double ratio = tr->src.crs.unit.ratio;
+	size_t i;
+
+	for (i=0; i<n; i++){
+		src[i].x = xya[i].x * ratio;
+		src[i].y = xya[i].y * ratio;
+		src[i].altitude = xya[i].altitude;
+	}
+	tr->src.inverse_n(&tr->src, src, lla, n);
+	for (i=0; i<n; i++) lla[i] = shift(tr, &lla[i]);
+	tr->dst.forward_n(&tr->dst, lla, result, n);
+	ratio = tr->dst.crs.unit.ratio;
+	for (i=0; i<n; i++){
+		result[i].x /= ratio;
+		result[i].y /= ratio;
+	}
+}
+
+typedef struct{
+	Transformer *tr;
+	void *src;
+	void *dst;
+}Job;
+
+static void transform_n_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geographic *src = (Geographic *)job->src, *dst = (Geographic *)job->dst;
+	size_t i, m;
+
+	for (i=start; i<stop; i+=VBLOCK){
+		m = (stop-i < VBLOCK) ? stop-i : VBLOCK;
+		transform_block(job->tr, src+i, dst+i, m);
+	}
+}
+
+static void transform_soa_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	Geographics *src = (Geographics *)job->src, *dst = (Geographics *)job->dst;
+	Geographic xya[VBLOCK], result[VBLOCK];
+	size_t i, j, m;
+
+	for (i=start; i<stop; i+=VBLOCK){
+		m = (stop-i < VBLOCK) ? stop-i : VBLOCK;
+		for (j=0; j<m; j++){
+			xya[j].x = src->x[i+j];
+			xya[j].y = src->y[i+j];
+			xya[j].altitude = (src->altitude != NULL) ? src->altitude[i+j] : 0.;
+		}
+		transform_block(job->tr, xya, result, m);
+		for (j=0; j<m; j++){
+			dst->x[i+j] = result[j].x;
+			dst->y[i+j] = result[j].y;
+			if (dst->altitude != NULL) dst->altitude[i+j] = result[j].altitude;
+		}
+	}
+}
+
+EXPORT void transform_n(Transformer *tr, Geographic *xya, Geographic *result, size_t n){
+	Job job = {tr, xya, result};
+	parallel_for(transform_n_task, &job, n);
+}
+
+// on caller thread only, for callers running their own workers (see gryd.h)
+EXPORT void transform_n_serial(Transformer *tr, Geographic *xya, Geographic *result, size_t n){
+	Job job = {tr, xya, result};
+	transform_n_task(&job, 0, n);
+}
+
+EXPORT void transform_soa(Transformer *tr, Geographics *xya, Geographics *result, size_t n){
+	Job job = {tr, xya, result};
+	parallel_for(transform_soa_task, &job, n);
+}
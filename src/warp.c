@@ -0,0 +1,236 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+#include <string.h>
+#include "./warp.h"
+#include "./parallel.h"
+
+/*
+Source :
+GDAL, gdalwarp approximate transformer (exact transformations on a coarse
+mesh, linear interpolation in between while the error is within tolerance)
+*/
+
+// checked points of a block : center and middle of edges
+static const double CHECK[5][2] = {{.5, .5}, {.5, 0.}, {.5, 1.}, {0., .5}, {1., .5}};
+
+typedef struct{
+	Transformer *tr;
+	Extent *dst;
+	Extent *src;
+	double tolerance;
+	size_t columns;   // number of tiles per row
+	double *px;
+	double *py;
+	size_t *counts;   // exact transformations per tile of the round
+	size_t first;     // first tile of the round
+	const double *band;
+	int method;
+	double nodata;
+	double *result;
+}Job;
+
+typedef struct{
+	Job *job;
+	int i0;           // tile origin in destination raster
+	int j0;
+	double *u;        // tile origin in output buffers
+	double *v;
+	size_t stride;
+	size_t count;
+}Tile;
+
+static void exact(Tile *t, double i, double j, double *u, double *v){
+	Extent *dst = t->job->dst, *src = t->job->src;
+	Geographic xya, result;
+
+	xya.x = dst->x0 + i*dst->dx;
+	xya.y = dst->y0 + j*dst->dy;
+	xya.altitude = 0.;
+	result = transform_point(t->job->tr, &xya);
+	t->count++;
+	if (!isfinite(result.x) || !isfinite(result.y)){
+		*u = *v = NAN;
+	}
+	else if (src != NULL){
+		*u = (result.x - src->x0)/src->dx;
+		*v = (result.y - src->y0)/src->dy;
+	}
+	else{
+		*u = result.x;
+		*v = result.y;
+	}
+}
+
+static void store(Tile *t, int i, int j, double u, double v){
+	size_t k = (size_t)(j - t->j0)*t->stride + (size_t)(i - t->i0);
+	t->u[k] = u;
+	t->v[k] = v;
+}
+
+// corners are top left, top right, bottom left and bottom right ones
+static double bilinear(const double *c, double a, double b){
+	return (c[0]*(1-a) + c[1]*a)*(1-b) + (c[2]*(1-a) + c[3]*a)*b;
+}
+
+// pixels [i0, i0+w) x [j0, j0+h) interpolated between (i0, j0) and
+// (i0+w, j0+h) corners when the checked points are within tolerance,
+// split in four blocks otherwise (null tolerance transforms every pixel)
+static void block(Tile *t, int i0, int j0, int w, int h){
+	double cu[4], cv[4], u, v, a, b, tolerance = t->job->tolerance;
+	int i, j, k, w2, h2, ok = 1;
+
+	if ((w <= 2 && h <= 2) || tolerance <= 0.){
+		for (j=j0; j<j0+h; j++)
+			for (i=i0; i<i0+w; i++){
+				exact(t, i, j, &u, &v);
+				store(t, i, j, u, v);
+			}
+		return;
+	}
+
+	exact(t, i0, j0, &cu[0], &cv[0]);
+	exact(t, i0+w, j0, &cu[1], &cv[1]);
+	exact(t, i0, j0+h, &cu[2], &cv[2]);
+	exact(t, i0+w, j0+h, &cu[3], &cv[3]);
+	// NaN comparisons are false so failed transformations are refined
+	for (k=0; k<5 && ok; k++){
+		exact(t, i0 + CHECK[k][0]*w, j0 + CHECK[k][1]*h, &u, &v);
+		ok = fabs(u - bilinear(cu, CHECK[k][0], CHECK[k][1])) <= tolerance && \
+			fabs(v - bilinear(cv, CHECK[k][0], CHECK[k][1])) <= tolerance;
+	}
+	if (ok){
+		for (j=0; j<h; j++){
+			b = (double)j/h;
+			for (i=0; i<w; i++){
+				a = (double)i/w;
+				store(t, i0+i, j0+j, bilinear(cu, a, b), bilinear(cv, a, b));
+			}
+		}
+		return;
+	}
+
+	w2 = (w > 2) ? w/2 : w;
+	h2 = (h > 2) ? h/2 : h;
+	block(t, i0, j0, w2, h2);
+	if (w2 < w) block(t, i0+w2, j0, w-w2, h2);
+	if (h2 < h){
+		block(t, i0, j0+h2, w2, h-h2);
+		if (w2 < w) block(t, i0+w2, j0+h2, w-w2, h-h2);
+	}
+}
+
+static void tile(Job *job, size_t index, Tile *t, int *w, int *h){
+	t->job = job;
+	t->i0 = (int)(index % job->columns)*WARP_TILE;
+	t->j0 = (int)(index / job->columns)*WARP_TILE;
+	t->count = 0;
+	*w = (job->dst->width - t->i0 < WARP_TILE) ? job->dst->width - t->i0 : WARP_TILE;
+	*h = (job->dst->height - t->j0 < WARP_TILE) ? job->dst->height - t->j0 : WARP_TILE;
+}
+
+static size_t tile_count(Job *job){
+	job->columns = ((size_t)job->dst->width + WARP_TILE - 1)/WARP_TILE;
+	return job->columns*(((size_t)job->dst->height + WARP_TILE - 1)/WARP_TILE);
+}
+
+static double sample(const double *band, Extent *src, double u, double v, int method, double nodata){
+	double a, b, weight, value, sum = 0., total = 0.;
+	int i, j, di, dj;
+
+	// NaN positions fail the test too
+	if (!(u >= -.5 && v >= -.5 && u < src->width - .5 && v < src->height - .5))
+		return nodata;
+	if (method == WARP_NEAREST)
+		return band[(size_t)floor(v + .5)*src->width + (size_t)floor(u + .5)];
+
+	i = (int)floor(u);
+	j = (int)floor(v);
+	a = u - i;
+	b = v - j;
+	for (dj=0; dj<2; dj++)
+		for (di=0; di<2; di++){
+			weight = (di ? a : 1-a)*(dj ? b : 1-b);
+			if (weight == 0. || i+di < 0 || j+dj < 0 || i+di >= src->width || j+dj >= src->height)
+				continue;
+			value = band[(size_t)(j+dj)*src->width + i+di];
+			if (value == nodata || isnan(value)) continue;
+			sum += weight*value;
+			total += weight;
+		}
+	return (total > 0.) ? sum/total : nodata;
+}
+
+static void map_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	size_t k, offset;
+	Tile t;
+	int w, h;
+
+	for (k=start; k<stop; k++){
+		tile(job, job->first + k, &t, &w, &h);
+		offset = (size_t)t.j0*job->dst->width + t.i0;
+		t.u = job->px + offset;
+		t.v = job->py + offset;
+		t.stride = (size_t)job->dst->width;
+		block(&t, t.i0, t.j0, w, h);
+		job->counts[k] = t.count;
+	}
+}
+
+static void band_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	double u[WARP_TILE*WARP_TILE], v[WARP_TILE*WARP_TILE];
+	size_t k;
+	Tile t;
+	int w, h, i, j;
+
+	for (k=start; k<stop; k++){
+		tile(job, k, &t, &w, &h);
+		t.u = u;
+		t.v = v;
+		t.stride = WARP_TILE;
+		block(&t, t.i0, t.j0, w, h);
+		for (j=0; j<h; j++)
+			for (i=0; i<w; i++)
+				job->result[(size_t)(t.j0+j)*job->dst->width + t.i0+i] = sample(
+					job->band, job->src, u[j*WARP_TILE+i], v[j*WARP_TILE+i], job->method, job->nodata
+				);
+	}
+}
+
+static void resample_task(void *ctx, size_t start, size_t stop){
+	Job *job = (Job *)ctx;
+	size_t i;
+	for (i=start; i<stop; i++)
+		job->result[i] = sample(job->band, job->src, job->px[i], job->py[i], job->method, job->nodata);
+}
+
+// tiles are mapped by rounds of WARP_ROUND, counts of a round on the stack
+#define WARP_ROUND (4*MAX_THREADS)
+
+EXPORT size_t warp_map(Transformer *tr, Extent *dst, Extent *src, double tolerance, double *px, double *py){
+	size_t counts[WARP_ROUND];
+	Job job = {tr, dst, src, fmax(tolerance, 0.), 0, px, py, counts, 0, NULL, 0, 0., NULL};
+	size_t n, k, size, count = 0;
+
+	if (dst->width <= 0 || dst->height <= 0) return 0;
+	n = tile_count(&job);
+	for (job.first=0; job.first<n; job.first+=size){
+		size = (n - job.first < WARP_ROUND) ? n - job.first : WARP_ROUND;
+		parallel_split(map_task, &job, size, 1, 1);
+		for (k=0; k<size; k++) count += counts[k];
+	}
+	return count;
+}
+
+EXPORT void warp_resample(const double *band, Extent *src, const double *px, const double *py, size_t n, int method, double nodata, double *result){
+	Job job = {NULL, NULL, src, 0., 0, (double *)px, (double *)py, NULL, 0, band, method, nodata, result};
+	parallel_for(resample_task, &job, n);
+}
+
+EXPORT void warp_band(Transformer *tr, Extent *dst, Extent *src, double tolerance, const double *band, int method, double nodata, double *result){
+	Job job = {tr, dst, src, fmax(tolerance, 0.), 0, NULL, NULL, NULL, 0, band, method, nodata, result};
+
+	if (dst->width <= 0 || dst->height <= 0) return;
+	parallel_split(band_task, &job, tile_count(&job), 1, 1);
+}
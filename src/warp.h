@@ -0,0 +1,48 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// Raster reprojection by inverse mapping : every destination pixel is
+// transformed to the source crs with a fused transformer (destination crs to
+// source crs). Transformations are exact on the corners of blocks refined
+// until bilinear interpolation in between is within tolerance, and tiles of
+// WARP_TILE x WARP_TILE pixels are spread over worker threads.
+
+#ifndef WARP_H
+#define WARP_H
+
+#include "./geoid.h"
+
+// tile size in pixels
+#define WARP_TILE 64
+
+// resampling methods
+#define WARP_NEAREST 0
+#define WARP_BILINEAR 1
+
+// north up raster georeferencing : pixel (column, row) is located at
+// (x0 + column*dx, y0 + row*dy) in crs units
+typedef struct{
+    double x0;
+    double y0;
+    double dx;
+    double dy;
+    int width;
+    int height;
+}Extent;
+
+// fill px and py (dst->width*dst->height values, row major) with the source
+// pixel positions of destination pixels, source crs coordinates if src is
+// NULL. Tolerance is given in those units, 0 transforms every pixel. Pixels
+// that can not be transformed get NaN. Return the number of exact
+// transformations done.
+EXPORT size_t warp_map(Transformer *tr, Extent *dst, Extent *src, double tolerance, double *px, double *py);
+
+// sample band (src->width*src->height values, row major) at n pixel
+// positions, positions outside band or NaN get nodata and so do nodata
+// neighbours in bilinear interpolation
+EXPORT void warp_resample(const double *band, Extent *src, const double *px, const double *py, size_t n, int method, double nodata, double *result);
+
+// warp_map and warp_resample fused tile by tile, without the full map
+EXPORT void warp_band(Transformer *tr, Extent *dst, Extent *src, double tolerance, const double *band, int method, double nodata, double *result);
+
+#endif
@@ -0,0 +1,558 @@
+# -*- encoding:utf-8 -*-
+# Gryd kernels benchmark
+
+"""
+Speed and accuracy benchmark of Gryd C kernels on standard point clouds.
+
+```
+$ python -m test.benchmark [-n POINTS] [-t THREADS] [-r REPEAT] [KERNEL ...]
+```
+
+Batch kernels are timed on a single foreign function call so that figures
+are the ones of the C loops, and on every thread count given. Kernels with
+scalar entry points only (`destination`, `lagrange`) are timed per foreign
+function call and flagged with `*`. Accuracy is measured by round trips
+(forward then inverse, encode then decode...) or against a reference, and
+each case has an error budget so that `run` results can gate speed changes
+against accuracy regressions.
+"""
+
+import sys
+import math
+import time
+import array
+import random
+import ctypes
+import argparse
+import Gryd
+
+WGS84 = Gryd.Ellipsoid(epsg=7030)
+
+
+class Result(object):
+    """
+    Benchmark row : kernel name, thread count, nanoseconds per point and
+    max / RMS errors with their budget.
+    """
+
+    def __init__(self, kernel, threads, ns, errors=None, unit="m",
+                 limit=None, call=False):
+        self.kernel = kernel
+        self.threads = threads
+        self.ns = ns
+        self.unit = unit
+        self.limit = limit
+        self.call = call
+        if errors:
+            self.max = max(errors)
+            self.rms = math.sqrt(sum(e * e for e in errors) / len(errors))
+        else:
+            self.max = self.rms = None
+
+    @property
+    def ok(self):
+        # NaN errors fail the comparison
+        return self.limit is None or self.max is None or \
+            self.max <= self.limit
+
+    def __repr__(self):
+        line = "%-24s %3d %10.1f%s %9.2f" % (
+            self.kernel, self.threads, self.ns, "*" if self.call else " ",
+            1e3 / self.ns if self.ns else 0.
+        )
+        if self.max is not None:
+            line += " %10.2e %10.2e %-3s %s" % (
+                self.max, self.rms, self.unit,
+                "" if self.ok else "> %.0e" % self.limit
+            )
+        return line
+
+
+def cloud(n, lon=(-180., 180.), lat=(-85., 85.), alt=(0., 0.), seed=0):
+    """
+    Return (lon, lat, alt) float64 arrays of n points uniformly spread over
+    the ellipsoid area within bounds, angles in radians.
+    """
+    rng = random.Random(seed)
+    s0, s1 = [math.sin(math.radians(v)) for v in lat]
+    return (
+        array.array("d", [
+            math.radians(rng.uniform(*lon)) for i in range(n)
+        ]),
+        array.array("d", [math.asin(rng.uniform(s0, s1)) for i in range(n)]),
+        array.array("d", [rng.uniform(*alt) for i in range(n)])
+    )
+
+
+# ctypes table of n structures of 3 doubles sharing memory with columns
+def aos(ctype, *columns):
+    n = len(columns[0])
+    data = array.array("d", bytes(24 * n))
+    for i, column in enumerate(columns):
+        data[i::3] = column
+    table = (ctype * n).from_buffer(data)
+    table._data = data
+    return table
+
+
+def columns(table):
+    data = array.array("d", bytes(table))
+    return data[0::3], data[1::3], data[2::3]
+
+
+# surface distances in meters between two clouds given in radians
+def surface_errors(lon0, lat0, lon1, lat1, a=WGS84.a):
+    result = []
+    for i in range(len(lon0)):
+        dlon = (lon1[i] - lon0[i] + math.pi) % (2 * math.pi) - math.pi
+        result.append(a * math.hypot(
+            lat1[i] - lat0[i], dlon * math.cos(lat0[i])
+        ))
+    return result
+
+
+# best time per item in nanoseconds
+def timing(func, n, repeat):
+    best = float("inf")
+    for i in range(repeat):
+        t0 = time.perf_counter()
+        func()
+        best = min(best, time.perf_counter() - t0)
+    return best / max(n, 1) * 1e9
+
+
+def _rso():
+    return Gryd.Crs(
+        datum=4298, projection="omerc", lambda0=115., phi0=4., k0=0.99984,
+        azimut=53 + 18/60. + 56.9537/3600.,
+        gamma=53 + 7/60. + 48.3685/3600., x0=590476.87, y0=442857.65
+    )
+
+
+def _ktmerc():
+    crs = Gryd.Crs(epsg=27700)
+    crs.projection = "ktmerc"
+    return crs
+
+
+#: projection kernels : crs, lon and lat bounds, round trip budget (m)
+PROJECTIONS = {
+    # series truncation grows with the distance to the central meridian
+    "tmerc": (lambda: Gryd.Crs(epsg=27700), (-8., 4.), (49., 61.), 1e-3),
+    "ktmerc": (_ktmerc, (-32., 28.), (-80., 80.), 1e-6),
+    "merc": (lambda: Gryd.Crs(epsg=3395), (-180., 180.), (-85., 85.), 1e-6),
+    "lcc": (lambda: Gryd.Crs(epsg=2154), (-5., 10.), (41., 52.), 1e-6),
+    "omerc": (_rso, (109., 120.), (0., 8.), 1e-6),
+    "eqc": (
+        lambda: Gryd.Crs(datum=4326, projection="eqc"),
+        (-180., 180.), (-85., 85.), 1e-6
+    ),
+    "miller": (
+        lambda: Gryd.Crs(datum=4326, projection="miller"),
+        (-180., 180.), (-85., 85.), 1e-6
+    )
+}
+
+
+def bench_projection(name, n, threads, repeat):
+    factory, lon, lat, limit = PROJECTIONS[name]
+    prep = factory().prepare()
+    lons, lats, alts = cloud(n, lon, lat)
+    xyz = [Gryd.t_zeros(n) for i in range(3)]
+    back = [Gryd.t_zeros(n) for i in range(3)]
+    lla = Gryd.Geodesics(*[Gryd.t_buffer(b) for b in (lons, lats, alts)])
+    xya = Gryd.Geographics(*[Gryd.t_buffer(b) for b in xyz])
+    result = Gryd.Geodesics(*[Gryd.t_buffer(b) for b in back])
+    errors = None
+    for t in threads:
+        Gryd.set_threads(t)
+        forward = timing(
+            lambda: Gryd.prepared_forward_soa(prep, lla, xya, n), n, repeat
+        )
+        inverse = timing(
+            lambda: Gryd.prepared_inverse_soa(prep, xya, result, n), n,
+            repeat
+        )
+        if errors is None:
+            errors = surface_errors(lons, lats, back[0], back[1])
+        yield Result(name + " forward", t, forward)
+        yield Result(name + " inverse", t, inverse, errors, limit=limit)
+
+
+def bench_geocentric(n, threads, repeat):
+    datum = Gryd.Datum(epsg=4326)
+    ellps = datum.ellipsoid
+    # from sub-surface to beyond geostationary orbit
+    lons, lats, alts = cloud(n, lat=(-90., 90.), alt=(-1e4, 4e7))
+    xyz = [Gryd.t_zeros(n) for i in range(3)]
+    back = [Gryd.t_zeros(n) for i in range(3)]
+    lla = Gryd.Geodesics(*[Gryd.t_buffer(b) for b in (lons, lats, alts)])
+    geocentrics = Gryd.Geocentrics(*[Gryd.t_buffer(b) for b in xyz])
+    result = Gryd.Geodesics(*[Gryd.t_buffer(b) for b in back])
+    for t in threads:
+        Gryd.set_threads(t)
+        yield Result("geocentric", t, timing(
+            lambda: Gryd.geocentric_soa(ellps, lla, geocentrics, n), n,
+            repeat
+        ))
+        for solver, (index, func) in sorted(Gryd.SOLVERS.items()):
+            ns = timing(
+                lambda: Gryd.geodesic_soa(
+                    ellps, geocentrics, result, n, index
+                ), n, repeat
+            )
+            errors = [
+                math.hypot(e, back[2][i] - alts[i]) for i, e in enumerate(
+                    surface_errors(lons, lats, back[0], back[1], ellps.a)
+                )
+            ]
+            yield Result(
+                "geodesic " + solver, t, ns, errors,
+                limit=1e-5
+            )
+
+
+def bench_graticule(n, threads, repeat):
+    # square graticule of about n points, errors against point by point
+    # batch kernels
+    side = max(2, int(math.sqrt(n)))
+    for name in ["tmerc", "merc", "lcc", "geocentric"]:
+        if name == "geocentric":
+            lon, lat = (-180., 180.), (-90., 90.)
+        else:
+            factory, lon, lat, limit = PROJECTIONS[name]
+            prep = factory().prepare()
+        lons = array.array("d", [
+            math.radians(lon[0] + (lon[1] - lon[0]) * i / (side - 1))
+            for i in range(side)
+        ])
+        lats = array.array("d", [
+            math.radians(lat[0] + (lat[1] - lat[0]) * i / (side - 1))
+            for i in range(side)
+        ])
+        lla = aos(
+            Gryd.Geodesic,
+            array.array("d", [lo for la in lats for lo in lons]),
+            array.array("d", [la for la in lats for lo in lons]),
+            Gryd.t_zeros(side * side)
+        )
+        if name == "geocentric":
+            ctype = Gryd.Geocentric
+            sweep = lambda: Gryd.geocentric_graticule(
+                WGS84, Gryd.t_buffer(lons), side, Gryd.t_buffer(lats), side,
+                0., result
+            )
+            batch = lambda: Gryd.geocentric_n(
+                WGS84, lla, expected, side * side
+            )
+        else:
+            ctype = Gryd.Geographic
+            sweep = lambda: Gryd.prepared_graticule(
+                prep, Gryd.t_buffer(lons), side, Gryd.t_buffer(lats), side,
+                0., result
+            )
+            batch = lambda: Gryd.prepared_forward_n(
+                prep, lla, expected, side * side
+            )
+        result = (ctype * (side * side))()
+        expected = (ctype * (side * side))()
+        batch()
+        for t in threads:
+            Gryd.set_threads(t)
+            ns = timing(sweep, side * side, repeat)
+            got, ref = columns(result), columns(expected)
+            errors = [
+                max(abs(got[k][i] - ref[k][i]) for k in range(3))
+                for i in range(side * side)
+            ]
+            yield Result("graticule " + name, t, ns, errors, limit=1e-6)
+
+
+def bench_dat2dat(n, threads, repeat):
+    wgs84, osgb36 = Gryd.Datum(epsg=4326), Gryd.Datum(epsg=4277)
+    lons, lats, alts = cloud(n, (-8., 4.), (49., 61.))
+    x, y, z = [Gryd.t_zeros(n) for i in range(3)]
+    wgs84.xyz_arrays(lons, lats, alts, out=(x, y, z))
+    src = aos(Gryd.Geocentric, x, y, z)
+    shifted = (Gryd.Geocentric * n)()
+    back = (Gryd.Geocentric * n)()
+    for t in threads:
+        Gryd.set_threads(t)
+        ns = timing(
+            lambda: Gryd.dat2dat_n(wgs84, osgb36, src, shifted, n), n, repeat
+        )
+        Gryd.dat2dat_n(osgb36, wgs84, shifted, back, n)
+        bx, by, bz = columns(back)
+        errors = [
+            math.sqrt((bx[i]-x[i])**2 + (by[i]-y[i])**2 + (bz[i]-z[i])**2)
+            for i in range(n)
+        ]
+        # reverse shift uses opposite parameters, a first order inverse
+        yield Result("dat2dat", t, ns, errors, limit=0.05)
+
+
+def bench_geodesic(n, threads, repeat):
+    lons, lats, alts = cloud(n, lat=(-80., 80.), seed=1)
+    lons1, lats1, alts1 = cloud(n, lat=(-80., 80.), seed=2)
+    # vincenty does not converge near antipodes (see Gryd.stats), pairs are
+    # kept within 170 degrees of longitude
+    for i in range(n):
+        dlon = (lons1[i] - lons[i] + math.pi) % (2 * math.pi) - math.pi
+        lons1[i] = lons[i] + dlon * 17. / 18.
+    starts = aos(Gryd.Geodesic, lons, lats, alts)
+    stops = aos(Gryd.Geodesic, lons1, lats1, alts1)
+    dists = dict(
+        (mode, (Gryd.Vincenty_dist * n)()) for mode in Gryd.GEODESIC_MODES
+    )
+    # scalar and densification entry points on a subset
+    m = max(1, min(n, 10000))
+    lines = max(1, min(n // 100, 200))
+    buffer = (Gryd.Vincenty_dest * 102)()
+    for t in threads:
+        Gryd.set_threads(t)
+        # karney first, it is the reference
+        for mode, (index, dist, dest, into) in sorted(
+            Gryd.GEODESIC_MODES.items()
+        ):
+            # vincenty series truncation reaches centimeters on long lines
+            # and npoints chains one destination per intermediate point
+            limit = 1e-6 if mode == "karney" else 0.1
+            ns = timing(
+                lambda: Gryd.distance_n(
+                    WGS84, starts, stops, dists[mode], n, index
+                ), n, repeat
+            )
+            # vincenty is checked against karney reference
+            errors = [
+                abs(a.distance - b.distance)
+                for a, b in zip(dists[mode], dists["karney"])
+            ] if mode != "karney" else None
+            yield Result("distance " + mode, t, ns, errors, limit=0.1)
+
+            # same pairs count as a rows x n / rows matrix, distances only
+            rows = max(1, int(math.sqrt(n)))
+            columns_ = n // rows
+            matrix = Gryd.t_zeros(rows * columns_)
+            ns = timing(
+                lambda: Gryd.distance_matrix(
+                    WGS84, starts, rows, stops, columns_, None,
+                    Gryd.t_buffer(matrix), index
+                ), rows * columns_, repeat
+            )
+            # first row against single pair solver
+            errors = [
+                abs(matrix[j] - dist(WGS84, starts[0], stops[j]).distance)
+                for j in range(min(columns_, 1000))
+            ]
+            yield Result("matrix " + mode, t, ns, errors, limit=0.)
+
+            def destinations():
+                return [
+                    dest(WGS84, starts[i], dists[mode][i]) for i in range(m)
+                ]
+
+            ns = timing(destinations, m, repeat)
+            ends = destinations()
+            errors = surface_errors(
+                lons1[:m], lats1[:m], [e.longitude for e in ends],
+                [e.latitude for e in ends]
+            )
+            yield Result(
+                "destination " + mode, t, ns, errors, limit=limit, call=True
+            )
+
+            def densify():
+                for i in range(lines):
+                    into(WGS84, starts[i], stops[i], 100, buffer)
+
+            ns = timing(densify, lines * 102, repeat)
+            errors = []
+            for i in range(lines):
+                into(WGS84, starts[i], stops[i], 100, buffer)
+                errors.extend(surface_errors(
+                    [lons1[i]], [lats1[i]], [buffer[101].longitude],
+                    [buffer[101].latitude]
+                ))
+            yield Result("npoints " + mode, t, ns, errors, limit=limit)
+
+
+def bench_approximate(n, threads, repeat):
+    lons, lats, alts = cloud(n, lat=(-80., 80.), seed=5)
+    starts = aos(Gryd.Geodesic, lons, lats, alts)
+    # long pairs, and short ones for the tangent plane mode
+    far = aos(Gryd.Geodesic, *cloud(n, lat=(-80., 80.), seed=6))
+    rng = random.Random(7)
+    near = (Gryd.Geodesic * n)()
+    for i in range(n):
+        end = Gryd.destination_karney(WGS84, starts[i], Gryd.Vincenty_dist(
+            rng.uniform(1., 1e5), rng.uniform(-math.pi, math.pi)
+        ))
+        near[i] = Gryd.Geodesic()
+        near[i].longitude = end.longitude
+        near[i].latitude = max(-math.radians(80.), min(
+            math.radians(80.), end.latitude
+        ))
+    dists = (Gryd.Vincenty_dist * n)()
+    reference = dict(
+        (id(stops), (Gryd.Vincenty_dist * n)()) for stops in (far, near)
+    )
+    for stops in (far, near):
+        Gryd.distance_n(WGS84, starts, stops, reference[id(stops)], n, 1)
+    for t in threads:
+        Gryd.set_threads(t)
+        for mode, (index, func, error, domain) in sorted(
+            Gryd.APPROXIMATE_MODES.items()
+        ):
+            stops = near if mode == "flat" else far
+            ns = timing(
+                lambda: Gryd.distance_n(WGS84, starts, stops, dists, n, index),
+                n, repeat
+            )
+            errors = [
+                abs(a.distance - b.distance) / b.distance
+                for a, b in zip(dists, reference[id(stops)]) if b.distance
+            ]
+            yield Result(
+                "approximate " + mode, t, ns, errors, unit="rel", limit=error
+            )
+
+
+def bench_calibration(n, threads, repeat):
+    rng = random.Random(3)
+
+    def model(px, py):
+        return 1000. + 2. * px - 0.5 * py, 5000. - 0.3 * px - 3. * py
+
+    points = []
+    for i in range(30):
+        px, py = rng.uniform(0, 1000), rng.uniform(0, 1000)
+        points.append(Gryd.Point(
+            px, py, Gryd.Geodesic(), Gryd.Geographic(*model(px, py) + (0.,))
+        ))
+    px = array.array("d", [rng.uniform(0, 1000) for i in range(n)])
+    py = array.array("d", [rng.uniform(0, 1000) for i in range(n)])
+    exact = [model(px[i], py[i]) for i in range(n)]
+    # lagrange interpolation on 8 points of each axis (legacy scalar kernel)
+    m = max(1, min(n, 10000))
+    nodes = Gryd.t_byref(ctypes.c_double, 8, *[p.px for p in points[:8]])
+    values = Gryd.t_byref(
+        ctypes.c_double, 8, *[2. * p.px for p in points[:8]]
+    )
+    for t in threads:
+        Gryd.set_threads(t)
+        ns = timing(
+            lambda: [Gryd.lagrange(px[i], nodes, values, 8) for i in range(m)],
+            m, repeat
+        )
+        errors = [
+            abs(Gryd.lagrange(px[i], nodes, values, 8) - 2. * px[i])
+            for i in range(m)
+        ]
+        yield Result("lagrange", t, ns, errors, limit=1e-6, call=True)
+        for name in ["affine", "triangles"]:
+            calibration = Gryd.Calibration(points, name)
+            x, y = Gryd.t_zeros(n), Gryd.t_zeros(n)
+            ns = timing(
+                lambda: calibration.forward_arrays(px, py, out=(x, y)), n,
+                repeat
+            )
+            errors = [
+                math.hypot(x[i] - e[0], y[i] - e[1])
+                for i, e in enumerate(exact)
+            ]
+            yield Result("calibration " + name, t, ns, errors, limit=1e-6)
+
+
+def bench_geohash(n, threads, repeat, bits=52):
+    lons, lats, alts = cloud(n, lat=(-90., 90.), seed=4)
+    lla = aos(Gryd.Geodesic, lons, lats, alts)
+    values = (ctypes.c_uint64 * n)()
+    back = (Gryd.Geodesic * n)()
+    # half diagonal of the cell at equator
+    limit = WGS84.a * math.hypot(
+        math.pi / 2 ** ((bits + 1) // 2), math.pi / 2 / 2 ** (bits // 2)
+    )
+    for t in threads:
+        Gryd.set_threads(t)
+        encode = timing(
+            lambda: Gryd.geohash_n(lla, values, n, bits), n, repeat
+        )
+        decode = timing(
+            lambda: Gryd.geohash_decode_n(values, back, n, bits, 1), n,
+            repeat
+        )
+        blon, blat, balt = columns(back)
+        errors = surface_errors(lons, lats, blon, blat)
+        yield Result("geohash encode", t, encode)
+        yield Result("geohash decode", t, decode, errors, limit=limit)
+
+
+#: kernel families by name, run in this order
+KERNELS = [(name, (
+    lambda name: lambda n, threads, repeat:
+        bench_projection(name, n, threads, repeat)
+)(name)) for name in sorted(PROJECTIONS)] + [
+    ("geocentric", bench_geocentric),
+    ("graticule", bench_graticule),
+    ("dat2dat", bench_dat2dat),
+    ("geodesic", bench_geodesic),
+    ("approximate", bench_approximate),
+    ("calibration", bench_calibration),
+    ("geohash", bench_geohash)
+]
+
+
+def run(n=100000, threads=(1,), repeat=3, kernels=None, output=None):
+    """
+    Run benchmark and return the `Result` list.
+
+    Arguments:
+        n (int): number of points of clouds
+        threads (list): thread counts to time batch kernels with
+        repeat (int): best time out of repeat runs is kept
+        kernels (list): kernel families to run, all by default
+        output (file): optional stream to print rows to
+    Returns:
+        `list` of `Result`
+    """
+    results = []
+    previous = Gryd.get_threads()
+    if output:
+        output.write("%-24s %3s %11s %9s %10s %10s\n" % (
+            "kernel", "thr", "ns/point", "Mpts/s", "max err", "rms err"
+        ))
+    try:
+        for name, bench in KERNELS:
+            if kernels and name not in kernels:
+                continue
+            for result in bench(n, threads, repeat):
+                results.append(result)
+                if output:
+                    output.write("%r\n" % result)
+                    output.flush()
+    finally:
+        Gryd.set_threads(previous)
+    return results
+
+
+def main(argv=None):
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("kernels", nargs="*", help="kernel families (%s)" % (
+        ", ".join(name for name, bench in KERNELS)
+    ))
+    parser.add_argument("-n", type=int, default=100000, help="cloud size")
+    parser.add_argument(
+        "-t", default="1", help="comma separated thread counts (0 = all)"
+    )
+    parser.add_argument("-r", type=int, default=3, help="repeat count")
+    args = parser.parse_args(argv)
+    threads = []
+    for t in args.t.split(","):
+        Gryd.set_threads(int(t))
+        threads.append(Gryd.get_threads())
+    results = run(args.n, threads, args.r, args.kernels, sys.stdout)
+    return 0 if all(r.ok for r in results) else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
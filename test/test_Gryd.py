@@ -2,9 +2,21 @@
 
 import Gryd
 
+import io
+import os
+import copy
+import ctypes
 import math
+import shutil
+import sysconfig
+import subprocess
+import sqlite3
+import tempfile
+import array
 import random
 import unittest
+import threading
+import contextlib
 
 
 class Test(unittest.TestCase):
@@ -35,6 +47,106 @@ class Test(unittest.TestCase):
         self.assertAlmostEqual(vdest.longitude, dublin.longitude, places=8)
         self.assertAlmostEqual(vdest.latitude, dublin.latitude, places=8)
 
+    def test_Karney(self):
+        wgs84 = Gryd.Ellipsoid(epsg=7030)
+        equator, pole = Gryd.Geodesic(0, 0), Gryd.Geodesic(0, 90)
+        self.assertAlmostEqual(
+            wgs84.distance(equator, pole, mode="karney").distance,
+            10001965.7293, places=4
+        )
+        # shortest path between antipodal equatorial points runs over pole
+        self.assertAlmostEqual(
+            wgs84.distance(
+                equator, Gryd.Geodesic(180, 0), mode="karney"
+            ).distance, 20003931.4586, places=4
+        )
+        for i in range(200):
+            start = Gryd.Geodesic(
+                random.uniform(-180, 180), random.uniform(-89, 89)
+            )
+            stop = Gryd.Geodesic(
+                random.uniform(-180, 180), random.uniform(-89, 89)
+            )
+            if i % 2:
+                stop = Gryd.Geodesic(
+                    math.degrees(start.longitude) + random.uniform(179, 181),
+                    random.uniform(-1, 1) - math.degrees(start.latitude)
+                )
+            kdist = wgs84.distance(start, stop, mode="karney")
+            if not i % 2:
+                self.assertAlmostEqual(
+                    wgs84.distance(start, stop).distance, kdist.distance,
+                    places=2
+                )
+            kdest = wgs84.destination(
+                start, math.degrees(kdist.initial_bearing), kdist.distance,
+                mode="karney"
+            )
+            self.assertAlmostEqual(kdest.latitude, stop.latitude, places=12)
+            self.assertAlmostEqual(
+                math.cos(kdest.longitude - stop.longitude), 1., places=12
+            )
+            self.assertAlmostEqual(
+                wgs84.distance_many([start], [stop], mode="karney")[0].distance,
+                kdist.distance, places=6
+            )
+        self.assertRaises(ValueError, wgs84.distance, start, stop, mode="xx")
+
+    def test_densification(self):
+        wgs84 = Gryd.Ellipsoid(epsg=7030)
+        jfk, sin = Gryd.Geodesic(-73.78, 40.64), Gryd.Geodesic(103.99, 1.36)
+        dist = wgs84.distance(jfk, sin, mode="karney").distance
+        points = wgs84.npoints(jfk, sin, 100, mode="karney")
+        self.assertEqual(len(points), 102)
+        for i in range(1, len(points)):
+            first = Gryd.Geodesic(
+                math.degrees(points[i-1].longitude),
+                math.degrees(points[i-1].latitude)
+            )
+            last = Gryd.Geodesic(
+                math.degrees(points[i].longitude),
+                math.degrees(points[i].latitude)
+            )
+            self.assertAlmostEqual(
+                wgs84.distance(first, last, mode="karney").distance,
+                dist / 101, places=5
+            )
+        self.assertAlmostEqual(last.latitude, sin.latitude, places=12)
+        self.assertAlmostEqual(last.longitude, sin.longitude, places=12)
+        segmented = wgs84.npoints(jfk, sin, max_segment=50000.)
+        self.assertEqual(len(segmented) - 1, math.ceil(dist / 50000.))
+        self.assertEqual(len(wgs84.npoints(jfk, sin, max_segment=2 * dist)), 2)
+        self.assertRaises(TypeError, wgs84.npoints, jfk, sin)
+
+    def test_output_buffers(self):
+        wgs84 = Gryd.Ellipsoid(epsg=7030)
+        jfk, sin = Gryd.Geodesic(-73.78, 40.64), Gryd.Geodesic(103.99, 1.36)
+        table = (Gryd.Vincenty_dest * 12)()
+        points = wgs84.npoints(jfk, sin, 10, out=table)
+        self.assertEqual(
+            [(p.longitude, p.latitude) for p in points],
+            [(p.longitude, p.latitude) for p in wgs84.npoints(jfk, sin, 10)]
+        )
+        self.assertEqual(points[5].latitude, table[5].latitude)
+        self.assertRaises(
+            ValueError, wgs84.npoints, jfk, sin, 11, None, "vincenty", table
+        )
+        crs = Gryd.Crs(epsg=2154)
+        lla = [Gryd.Geodesic(2. + i * .01, 46. + i * .01) for i in range(16)]
+        xya = (Gryd.Geographic * 16)()
+        self.assertIs(crs.forward_many(lla, out=xya), xya)
+        self.assertEqual(xya[7].x, crs(lla[7]).x)
+        self.assertRaises(
+            ValueError, crs.forward_many, lla, (Gryd.Geographic * 8)()
+        )
+        self.assertRaises(
+            TypeError, crs.forward_many, lla, (Gryd.Geodesic * 16)()
+        )
+        self.assertRaises(
+            TypeError, wgs84.npoints, jfk, sin, 10, None, "vincenty",
+            (Gryd.Geodesic * 12)()
+        )
+
     def test_Geodetics(self):
         wgs84 = Gryd.Datum("WGS 84")
         airy = Gryd.Datum(epsg=4277)
@@ -46,3 +158,1131 @@ class Test(unittest.TestCase):
         self.assertAlmostEqual(dublin.latitude, dubl_2.latitude, places=8)
         self.assertAlmostEqual(dublin.longitude, dubl_3.longitude, places=8)
         self.assertAlmostEqual(dublin.latitude, dubl_3.latitude, places=8)
+
+    def test_batch_projection(self):
+        london = Gryd.Geodesic(-0.127005, 51.518602, 0.)
+        dublin = Gryd.Geodesic(-6.259437, 53.350765, 0.)
+        feet = Gryd.Crs(epsg=2136)
+        feet.unit = 9002
+        for crs in [
+            Gryd.Crs(epsg=27700), Gryd.Crs(epsg=3785), Gryd.Crs(epsg=2154),
+            Gryd.Crs(datum=4326, projection="eqc"),
+            Gryd.Crs(datum=4326, projection="miller"), feet
+        ]:
+            xyas = crs.forward_many([london, dublin])
+            for lla, xya in zip([london, dublin], xyas):
+                single = crs(lla)
+                self.assertAlmostEqual(single.x, xya.x, places=6)
+                self.assertAlmostEqual(single.y, xya.y, places=6)
+            llas = crs.inverse_many(xyas)
+            for lla, back in zip([london, dublin], llas):
+                self.assertAlmostEqual(lla.longitude, back.longitude, places=8)
+                self.assertAlmostEqual(lla.latitude, back.latitude, places=8)
+        # batch functions apply unit ratio once
+        meters = Gryd.Crs(epsg=2136)
+        meters.unit = 9001
+        ref = meters(london)
+        xya = feet.forward_many([london])[0]
+        self.assertAlmostEqual(xya.x * feet.unit.ratio, ref.x, places=6)
+        self.assertAlmostEqual(xya.y * feet.unit.ratio, ref.y, places=6)
+
+    def test_prepared_crs(self):
+        london = Gryd.Geodesic(-0.127005, 51.518602, 0.)
+        feet = Gryd.Crs(epsg=27700)
+        feet.unit = Gryd.Unit(name="foot")
+        for crs in [
+            Gryd.Crs(epsg=27700), Gryd.Crs(epsg=3785), Gryd.Crs(epsg=2154),
+            feet
+        ]:
+            prep = crs.prepare()
+            xya, ref = prep(london), crs(london)
+            self.assertAlmostEqual(xya.x, ref.x, places=6)
+            self.assertAlmostEqual(xya.y, ref.y, places=6)
+            lla = prep(xya)
+            self.assertAlmostEqual(lla.longitude, london.longitude, places=8)
+            self.assertAlmostEqual(lla.latitude, london.latitude, places=8)
+            xyas = prep.forward_many([london] * 3)
+            self.assertAlmostEqual(xyas[2].x, ref.x, places=6)
+            self.assertAlmostEqual(xyas[2].y, ref.y, places=6)
+            llas = prep.inverse_many(xyas)
+            self.assertEqual(xyas[2].x, xya.x)
+            self.assertAlmostEqual(llas[2].latitude, london.latitude, 8)
+            x, y, alt = prep.forward_arrays(
+                array.array("d", [london.longitude] * 3),
+                array.array("d", [london.latitude] * 3)
+            )
+            self.assertAlmostEqual(y[2], ref.y, places=6)
+            lon, lat, alt = prep.inverse_arrays(x, y)
+            self.assertEqual(x[2], xyas[2].x)
+            self.assertAlmostEqual(lon[2], london.longitude, places=8)
+        self.assertRaises(Exception, Gryd.Crs(projection="utm").prepare)
+
+    def test_batch_utm_mgrs(self):
+        points = [
+            Gryd.Geodesic(random.uniform(-180, 180), random.uniform(0, 70))
+            for i in range(200)
+        ]
+        for projection in ["utm", "mgrs"]:
+            crs = Gryd.Crs(projection=projection)
+            grids = crs.forward_many(points)
+            for lla, grid in zip(points, grids):
+                single = crs(lla)
+                self.assertEqual(single.area, grid.area)
+                self.assertAlmostEqual(single.easting, grid.easting, places=5)
+                self.assertAlmostEqual(single.northing, grid.northing, places=5)
+            llas = crs.inverse_many(grids)
+            for grid, back in zip(grids, llas):
+                single = crs(copy.copy(grid))
+                self.assertAlmostEqual(single.longitude, back.longitude, places=9)
+                self.assertAlmostEqual(single.latitude, back.latitude, places=9)
+
+    def test_registry(self):
+        london = Gryd.Geodesic(-0.127005, 51.518602, 0.)
+        shared = Gryd.REGISTRY.crs(27700)
+        self.assertIs(shared, Gryd.REGISTRY.crs(27700))
+        self.assertRaises(AttributeError, setattr, shared, "k0", 1.)
+        self.assertRaises(
+            AttributeError, setattr, shared.datum.ellipsoid, "a", 1.
+        )
+        crs = Gryd.Crs(epsg=27700)
+        self.assertEqual(crs.k0, shared.k0)
+        self.assertEqual(crs.datum.ellipsoid.a, shared.datum.ellipsoid.a)
+        xya = shared(copy.copy(london))
+        self.assertEqual(xya.x, crs(copy.copy(london)).x)
+        writable = copy.deepcopy(shared)
+        writable.k0 = 1.
+        self.assertNotEqual(shared.k0, writable.k0)
+        self.assertEqual(shared(copy.copy(london)).x, xya.x)
+        # no sqlite cursor shared with the main thread
+        result = []
+        worker = threading.Thread(
+            target=lambda: result.append(Gryd.Crs(epsg=2154).projection)
+        )
+        worker.start()
+        worker.join()
+        self.assertEqual(result, ["lcc"])
+
+    def test_snapshot(self):
+        import Gryd.snapshot
+        folder = tempfile.mkdtemp()
+        path = os.path.join(folder, "epsg.sqlite")
+        shutil.copy(Gryd.REGISTRY.path, path)
+        Gryd.snapshot.write(path)
+        mapped = Gryd.Registry(path)
+        self.assertTrue(mapped.mapped)
+        sqlite = Gryd.Registry(path, snapshot=False)
+        self.assertFalse(sqlite.mapped)
+        linked = Gryd.Epsg.registry
+        try:
+            for epsg in [27700, 2154, 3785, 29900, 4326, 7030, 9002, 8902]:
+                objects = []
+                for registry in [mapped, sqlite]:
+                    Gryd.Epsg.registry = registry
+                    table = registry.sections[
+                        "grid" if sqlite.record("grid", epsg) else
+                        "datum" if sqlite.record("datum", epsg) else
+                        "ellipsoid" if sqlite.record("ellipsoid", epsg) else
+                        "unit" if sqlite.record("unit", epsg) else "prime"
+                    ]
+                    cls = [
+                        Gryd.Unit, Gryd.Prime, Gryd.Ellipsoid, Gryd.Datum,
+                        Gryd.Crs
+                    ][table]
+                    objects.append(cls(epsg))
+                self.assertEqual(bytes(objects[0]), bytes(objects[1]))
+                self.assertEqual(objects[0].name, objects[1].name)
+            Gryd.Epsg.registry = mapped
+            crs = mapped.crs("RGF93 / Lambert-93")
+            self.assertEqual(crs.projection, "lcc")
+            self.assertEqual(crs.epsg, 2154)
+        finally:
+            Gryd.Epsg.registry = linked
+        # an edit of the database makes the snapshot stale
+        con = sqlite3.connect(path)
+        con.execute("UPDATE grid SET k0=1.0 WHERE epsg=27700")
+        con.commit()
+        con.close()
+        edited = Gryd.Registry(path)
+        self.assertFalse(edited.mapped)
+        self.assertEqual(edited.record("grid", 27700)["k0"], 1.0)
+        shutil.rmtree(folder)
+
+    def test_grid_references(self):
+        for projection, lon, lat in [
+                ("utm", (-180, 180), (-80, 84)),
+                ("mgrs", (-180, 180), (-80, 84)),
+                ("bng", (-7, 1.5), (50, 60)),
+                ("ing", (-10, -6), (51.5, 55))
+        ]:
+            crs = Gryd.Crs(projection=projection)
+            points = [
+                Gryd.Geodesic(random.uniform(*lon), random.uniform(*lat))
+                for i in range(300)
+            ]
+            grids = crs.forward_many(points)
+            llas = crs.inverse_many(grids)
+            for lla, grid, back in zip(points, grids, llas):
+                single = crs(copy.copy(lla))
+                self.assertEqual(single.area, grid.area)
+                self.assertEqual(single.easting, grid.easting)
+                self.assertLess(grid.easting, 1000000.)
+                self.assertAlmostEqual(back.longitude, lla.longitude, places=9)
+                self.assertAlmostEqual(back.latitude, lla.latitude, places=9)
+        # Svalbard zones do not catch western longitudes
+        grid = Gryd.Crs(projection="utm")(Gryd.Geodesic(-30., 75.))
+        self.assertEqual(grid.area, "26X")
+        bng = Gryd.Crs(projection="bng")
+        self.assertEqual(bng(Gryd.Geodesic(-0.1275, 51.5072)).area, "TQ")
+        self.assertRaises(
+            ValueError, bng, Gryd.Grid(area="TI", easting=0, northing=0)
+        )
+        self.assertRaises(ValueError, bng, Gryd.Geodesic(-40., 51.5))
+
+    def test_calibration(self):
+        pvs = Gryd.Crs(epsg=3785)
+        pvs.add_map_point(0, 0, Gryd.Geodesic(-179.999, 85))
+        pvs.add_map_point(512, 512, Gryd.Geodesic(179.999, -85))
+        # 2 points affine scales each axis as lagrange interpolation did
+        x0, x1 = [p.xya.x for p in pvs.map_points]
+        self.assertAlmostEqual(
+            pvs.map2crs(384, 384, geographic=True).x,
+            x0 + (x1 - x0) * 384 / 512, 6
+        )
+        self.assertEqual(pvs.calibrate(), pvs.calibrate())
+        with self.assertRaises(ValueError):
+            pvs.calibration = "triangles"
+            pvs.calibrate()
+
+        def model(px, py):
+            return Gryd.Geographic(
+                1000 + 2 * px - 0.5 * py + 1e-4 * px * px,
+                5000 - 0.3 * px - 3 * py + 2e-4 * px * py, 0
+            )
+
+        random.seed(7)
+        crs = Gryd.Crs(epsg=27700)
+        for i in range(30):
+            px, py = random.uniform(0, 1000), random.uniform(0, 1000)
+            crs.add_map_point(px, py, model(px, py))
+        for name in ["affine", "quadratic", "cubic", "triangles"]:
+            crs.calibration = name
+            calibration = crs.calibrate()
+            exact = name in ["quadratic", "cubic", "triangles"]
+            for p in crs.map_points if exact else []:
+                xya = calibration.forward(p.px, p.py)
+                self.assertAlmostEqual(xya.x, p.xya.x, 6)
+                self.assertAlmostEqual(xya.y, p.xya.y, 6)
+            width, height = 40, 30
+            x, y = calibration.raster(width, height)
+            px, py = calibration.inverse_arrays(x, y)
+            for i in range(0, width * height, 37):
+                xya = calibration.forward(i % width, i // width)
+                self.assertAlmostEqual(x[i], xya.x, 9)
+                self.assertAlmostEqual(y[i], xya.y, 9)
+                if name == "triangles":
+                    self.assertAlmostEqual(px[i], i % width, 6)
+                    self.assertAlmostEqual(py[i], i // width, 6)
+            point = crs.crs2map(crs.map2crs(500., 500., geographic=True))
+            self.assertAlmostEqual(point.px, 500., 0 if exact else -1)
+            self.assertAlmostEqual(point.py, 500., 0 if exact else -1)
+        # undersized or read only buffers never reach C
+        short = Gryd.t_zeros(width * height - 1)
+        frozen = memoryview(bytes(8 * width * height)).cast("d")
+        with self.assertRaises(ValueError):
+            calibration.raster(width, height, out=(x, short))
+        with self.assertRaises(ValueError):
+            calibration.raster(width, height, out=(frozen, y))
+        with self.assertRaises(ValueError):
+            calibration.forward_arrays(px, short)
+        with self.assertRaises(ValueError):
+            calibration.inverse_arrays(x, y, out=(short, py))
+        crs.delete_map_point(1)
+        self.assertIsNot(crs.calibrate(), calibration)
+        triangles = crs.calibrate().triangles[:crs.calibrate().count]
+        for i, triangle in enumerate(triangles):
+            for j in triangle.neighbour:
+                if j >= 0:
+                    self.assertIn(i, list(triangles[j].neighbour))
+
+    def test_convert(self):
+        import Gryd.convert
+        tr = Gryd.Crs(epsg=27700).transformer(Gryd.Crs(epsg=3785))
+        # values written in csv file are read back exactly
+        points = [
+            Gryd.Geographic(
+                round(random.uniform(1e5, 6e5), 6),
+                round(random.uniform(1e5, 9e5), 6),
+                round(random.uniform(0, 100), 6)
+            ) for i in range(1000)
+        ]
+        expected = tr.transform_many(points)
+        folder = tempfile.mkdtemp()
+        try:
+            src = os.path.join(folder, "survey.csv")
+            dst = os.path.join(folder, "result.csv")
+            with open(src, "w", newline="") as f:
+                f.write("id;y;name;x;z\n")
+                for i, p in enumerate(points):
+                    f.write("%d;%.6f; p%d ;%.6f;%.6f\r\n" % (
+                        i, p.y, i, p.x, p.altitude
+                    ))
+                f.write("\n")
+            # chunks smaller than the file
+            self.assertEqual(tr.convert(
+                src, dst, columns=(3, 1, 4), delimiter=";", header=1,
+                precision=3, chunk=100
+            ), len(points))
+            with open(dst, "r", newline="") as f:
+                lines = f.read().splitlines(True)
+            self.assertEqual(lines[0], "id;y;name;x;z\n")
+            self.assertEqual(lines[-1], "\n")
+            self.assertEqual(len(lines), len(points) + 2)
+            for i, p in enumerate(expected):
+                self.assertEqual(
+                    lines[i + 1], "%d;%.3f; p%d ;%.3f;%.3f\r\n" % (
+                        i, p.y, i, p.x, p.altitude
+                    )
+                )
+            with open(src, "a") as f:
+                f.write("1000;1e5;x;y;0\n")
+            with self.assertRaises(ValueError) as error:
+                tr.convert(src, dst, columns=(3, 1), delimiter=";", header=1)
+            self.assertIn("line 1003", str(error.exception))
+            # plain x,y file with the command line defaults
+            with open(src, "w") as f:
+                for p in points:
+                    f.write("%.6f,%.6f\n" % (p.x, p.y))
+            with contextlib.redirect_stdout(io.StringIO()) as output:
+                self.assertEqual(Gryd.convert.main([
+                    "27700", "3785", src, dst, "-p", "6"
+                ]), 0)
+            self.assertEqual(output.getvalue(), "1000 points converted\n")
+            with open(dst, "r") as f:
+                x, y = map(float, f.readline().split(","))
+            flat = tr(Gryd.Geographic(points[0].x, points[0].y, 0.))
+            self.assertAlmostEqual(x, flat.x, places=5)
+            self.assertAlmostEqual(y, flat.y, places=5)
+
+            # binary records with an extra value, converted by the command
+            # line entry too
+            src = os.path.join(folder, "survey.bin")
+            dst = os.path.join(folder, "result.bin")
+            with open(src, "wb") as f:
+                array.array("d", [
+                    v for p in points for v in (p.x, p.y, p.altitude, 7.)
+                ]).tofile(f)
+            self.assertEqual(tr.convert(
+                src, dst, format="binary", fields=4
+            ), len(points))
+            with contextlib.redirect_stdout(io.StringIO()) as output:
+                self.assertEqual(Gryd.convert.main([
+                    "27700", "3785", src, dst + "2", "-f", "binary",
+                    "--fields", "4", "--chunk", "333"
+                ]), 0)
+            self.assertEqual(output.getvalue(), "1000 points converted\n")
+            for path in [dst, dst + "2"]:
+                result = array.array("d")
+                with open(path, "rb") as f:
+                    result.frombytes(f.read())
+                for i, p in enumerate(expected):
+                    self.assertAlmostEqual(result[4 * i], p.x, places=6)
+                    self.assertAlmostEqual(result[4 * i + 1], p.y, places=6)
+                    self.assertAlmostEqual(
+                        result[4 * i + 2], p.altitude, places=6
+                    )
+                    self.assertEqual(result[4 * i + 3], 7.)
+            with self.assertRaises(ValueError):
+                tr.convert(src, dst, format="binary", fields=6)
+            with self.assertRaises(IOError):
+                tr.convert(os.path.join(folder, "missing"), dst)
+        finally:
+            shutil.rmtree(folder)
+
+    def test_graticule(self):
+        lons = array.array(
+            "d", [math.radians(random.uniform(-8, 3)) for i in range(70)]
+        )
+        lats = array.array(
+            "d", [math.radians(random.uniform(49, 61)) for i in range(150)]
+        )
+        points = [
+            Gryd.Geodesic(math.degrees(lon), math.degrees(lat), 25.)
+            for lat in lats for lon in lons
+        ]
+        feet = Gryd.Crs(epsg=2154)
+        feet.unit = Gryd.Unit(name="foot")
+        # dedicated kernels and forward_n fallback
+        for crs in [
+            Gryd.Crs(epsg=27700), Gryd.Crs(epsg=3785), Gryd.Crs(epsg=2154),
+            Gryd.Crs(epsg=27572), Gryd.Crs(datum=4326, projection="ktmerc"),
+            Gryd.Crs(datum=4326, projection="eqc"), feet
+        ]:
+            prep = crs.prepare()
+            xya = prep.graticule(lons, lats, 25.)
+            expected = prep.forward_many(points)
+            self.assertEqual(len(xya), len(points))
+            for p, q in zip(xya, expected):
+                self.assertAlmostEqual(p.x, q.x, places=6)
+                self.assertAlmostEqual(p.y, q.y, places=6)
+                self.assertEqual(p.altitude, 25.)
+        self.assertEqual(len(prep.graticule(lons, [])), 0)
+
+        # Bern 1898 datum with its prime meridian
+        datum = Gryd.Datum(epsg=4801)
+        xyz = datum.xyz_graticule(lons, lats, 25.)
+        for p, q in zip(xyz, datum.xyz_many(points)):
+            self.assertAlmostEqual(p.x, q.x, places=6)
+            self.assertAlmostEqual(p.y, q.y, places=6)
+            self.assertAlmostEqual(p.z, q.z, places=6)
+
+    def test_warp(self):
+        osgb36 = Gryd.Crs(epsg=27700)
+        pvs = Gryd.Crs(epsg=3785)
+        tr = pvs.transformer(osgb36)
+        # sizes that are not multiple of tiles
+        dst = Gryd.Extent(-20000, 6720000, 200, -200, 150, 70)
+        src = Gryd.Extent(515000, 215000, 250, -250, 100, 80)
+        approx = tr.warp_map(dst, src, tolerance=0.01)
+        exact = tr.warp_map(dst, src, tolerance=0.)
+        n = dst.width * dst.height
+        self.assertLess(Gryd.warp_map(
+            tr, dst, src, 0.01, Gryd.t_buffer(Gryd.t_zeros(n)),
+            Gryd.t_buffer(Gryd.t_zeros(n))
+        ), n // 2)
+        for i in range(n):
+            self.assertLessEqual(abs(approx[0][i] - exact[0][i]), 0.01)
+            self.assertLessEqual(abs(approx[1][i] - exact[1][i]), 0.01)
+        for i, j in [(0, 0), (17, 33), (149, 69)]:
+            xya = tr(Gryd.Geographic(
+                dst.x0 + i * dst.dx, dst.y0 + j * dst.dy, 0
+            ))
+            k = j * dst.width + i
+            self.assertAlmostEqual(exact[0][k], (xya.x - src.x0) / src.dx, 9)
+            self.assertAlmostEqual(exact[1][k], (xya.y - src.y0) / src.dy, 9)
+
+        # band linear in pixels is interpolated exactly
+        band = array.array("d", [
+            i % src.width + 1000. * (i // src.width)
+            for i in range(src.width * src.height)
+        ])
+        result = tr.warp(band, dst, src, tolerance=0.01, nodata=-1.)
+        nearest = tr.warp(band, dst, src, method="nearest", nodata=-1.)
+        for i in range(n):
+            u, v = approx[0][i], approx[1][i]
+            if 0 <= u <= src.width - 1 and 0 <= v <= src.height - 1:
+                self.assertAlmostEqual(result[i], u + 1000. * v, 6)
+                self.assertEqual(nearest[i], round(u) + 1000. * round(v))
+            elif not (-.5 <= u < src.width - .5 and
+                      -.5 <= v < src.height - .5):
+                self.assertEqual(result[i], -1.)
+                self.assertEqual(nearest[i], -1.)
+        self.assertEqual(
+            list(src.resample(band, *approx, nodata=-1.)), list(result)
+        )
+        with self.assertRaises(ValueError):
+            tr.warp(band[:10], dst, src)
+        short, readonly = Gryd.t_zeros(n - 1), memoryview(bytes(8 * n))
+        for out in [(short, approx[1]), (approx[0], readonly.cast("d"))]:
+            self.assertRaises(ValueError, tr.warp_map, dst, src, out=out)
+        for out in [short, readonly.cast("d")]:
+            self.assertRaises(ValueError, tr.warp, band, dst, src, out=out)
+            self.assertRaises(
+                ValueError, src.resample, band, *approx, out=out
+            )
+        self.assertRaises(ValueError, src.resample, band, approx[0], short)
+
+    def test_structure_of_arrays(self):
+        points = [
+            Gryd.Geodesic(random.uniform(-8, 2), random.uniform(49, 61), 10.)
+            for i in range(100)
+        ]
+        lon = array.array("d", [p.longitude for p in points])
+        lat = array.array("d", [p.latitude for p in points])
+        alt = array.array("d", [p.altitude for p in points])
+        for crs in [Gryd.Crs(epsg=27700), Gryd.Crs(epsg=2154)]:
+            x, y, z = crs.forward_arrays(lon, lat, alt)
+            for i, p in enumerate(points):
+                single = crs(p)
+                self.assertAlmostEqual(single.x, x[i], places=6)
+                self.assertAlmostEqual(single.y, y[i], places=6)
+                self.assertEqual(z[i], 10.)
+            lon_, lat_, alt_ = crs.inverse_arrays(x, y)
+            for i in range(len(points)):
+                self.assertAlmostEqual(lon[i], lon_[i], places=8)
+                self.assertAlmostEqual(lat[i], lat_[i], places=8)
+        datum = Gryd.Datum(epsg=4326)
+        x, y, z = datum.xyz_arrays(lon, lat, alt)
+        for i, p in enumerate(points):
+            single = datum.xyz(Gryd.Geodesic(
+                math.degrees(p.longitude), math.degrees(p.latitude), 10.
+            ))
+            self.assertAlmostEqual(single.x, x[i], places=6)
+            self.assertAlmostEqual(single.z, z[i], places=6)
+        lon_, lat_, alt_ = datum.lla_arrays(x, y, z)
+        for i in range(len(points)):
+            self.assertAlmostEqual(lon[i], lon_[i], places=10)
+            self.assertAlmostEqual(lat[i], lat_[i], places=10)
+            self.assertAlmostEqual(alt[i], alt_[i], places=4)
+
+        # undersized or read only buffers never reach C
+        class ReadOnly(object):
+            def __init__(self, buffer):
+                self.buffer = buffer
+                self.__array_interface__ = {
+                    "typestr": "<f8", "shape": (len(buffer),),
+                    "data": (buffer.buffer_info()[0], True), "version": 3
+                }
+
+        prep, short = Gryd.Crs(epsg=27700).prepare(), Gryd.t_zeros(4)
+        frozen = memoryview(bytes(8 * len(lon))).cast("d")
+        for args, kw in [
+            ((lon, lat[:1]), {}),
+            ((lon, lat), {"out": (short, short, short)}),
+            ((lon, lat), {"out": (x, y, frozen)}),
+            ((lon, lat), {"out": (x, ReadOnly(y), z)})
+        ]:
+            for function in [prep.forward_arrays, datum.xyz_arrays]:
+                with self.assertRaises(ValueError):
+                    function(*args, **kw)
+        self.assertRaises(ValueError, prep.inverse_arrays, x, y, alt[:3])
+        self.assertRaises(
+            ValueError, datum.lla_arrays, x, y, z, out=(x, frozen, z)
+        )
+        self.assertRaises(TypeError, prep.forward_arrays, lon, lat, out=(
+            [0.] * len(lon), y, z
+        ))
+        self.assertRaises(
+            TypeError, datum.xyz_arrays, lon, lat, out=(x, y, None)
+        )
+
+    def test_geodesic_solvers(self):
+        datum = Gryd.Datum(epsg=4326)
+        for alt in [-5000., 0., 1e4, 4e5, 3.6e7]:
+            points = [
+                Gryd.Geodesic(
+                    random.uniform(-180, 180), random.uniform(-90, 90), alt
+                ) for i in range(100)
+            ]
+            xyz = [datum.xyz(copy.copy(p)) for p in points]
+            for solver in ["iterative", "bowring", "vermeille"]:
+                batch = datum.lla_many(xyz, solver=solver)
+                lon, lat, h = datum.lla_arrays(
+                    array.array("d", [p.x for p in xyz]),
+                    array.array("d", [p.y for p in xyz]),
+                    array.array("d", [p.z for p in xyz]), solver=solver
+                )
+                for i, p in enumerate(points):
+                    single = datum.lla(xyz[i], solver=solver)
+                    for q in [single, batch[i]]:
+                        self.assertAlmostEqual(
+                            p.latitude, q.latitude, places=11
+                        )
+                        self.assertAlmostEqual(
+                            p.altitude, q.altitude, places=5
+                        )
+                    self.assertAlmostEqual(p.latitude, lat[i], places=11)
+                    self.assertAlmostEqual(p.altitude, h[i], places=5)
+        self.assertRaises(ValueError, datum.lla, xyz[0], solver="fukushima")
+
+    def test_fused_transform(self):
+        points = [
+            Gryd.Geodesic(random.uniform(-6, 1), random.uniform(50, 58), 0.)
+            for i in range(200)
+        ]
+        src = Gryd.Crs(epsg=27700)
+        for dst in [
+            Gryd.Crs(epsg=2154), Gryd.Crs(epsg=27572), Gryd.Crs(epsg=3785)
+        ]:
+            xya = [src(copy.copy(p)) for p in points]
+            chained = [
+                dst(src.datum.transform(dst.datum, src(copy.copy(p))))
+                for p in xya
+            ]
+            fused = src.transform_many(dst, xya)
+            x, y, alt = src.transformer(dst).transform_arrays(
+                array.array("d", [p.x for p in xya]),
+                array.array("d", [p.y for p in xya])
+            )
+            for i, p in enumerate(chained):
+                single = src.transform(dst, xya[i])
+                for q in [single, fused[i]]:
+                    self.assertAlmostEqual(p.x, q.x, places=6)
+                    self.assertAlmostEqual(p.y, q.y, places=6)
+                    self.assertAlmostEqual(p.altitude, q.altitude, places=6)
+                self.assertAlmostEqual(p.x, x[i], places=6)
+                self.assertAlmostEqual(p.y, y[i], places=6)
+        tr = src.transformer(dst)
+        self.assertRaises(ValueError, tr.transform_arrays, x, y[:10])
+        self.assertRaises(
+            ValueError, tr.transform_arrays, x, y,
+            out=(x, memoryview(bytes(8 * len(x))).cast("d"), None)
+        )
+        self.assertRaises(
+            Exception, Gryd.Transformer, src, Gryd.Crs(projection="utm")
+        )
+
+    def test_kruger_tmerc(self):
+        tmerc = Gryd.Crs(epsg=27700)
+        ktmerc = copy.deepcopy(tmerc)
+        ktmerc.projection = "ktmerc"
+        for i in range(200):
+            near = Gryd.Geodesic(
+                random.uniform(-4, 0), random.uniform(-80, 80), 0.
+            )
+            a, b = tmerc(copy.copy(near)), ktmerc(copy.copy(near))
+            self.assertAlmostEqual(a.x, b.x, places=4)
+            self.assertAlmostEqual(a.y, b.y, places=4)
+            wide = Gryd.Geodesic(
+                random.uniform(-32, 28), random.uniform(-80, 80), 0.
+            )
+            back = ktmerc(ktmerc(copy.copy(wide)))
+            self.assertAlmostEqual(back.longitude, wide.longitude, places=12)
+            self.assertAlmostEqual(back.latitude, wide.latitude, places=12)
+        prepared = Gryd.Prepared(ktmerc)
+        xya = prepared.forward_many([wide])
+        self.assertEqual(xya[0].x, ktmerc(copy.copy(wide)).x)
+
+    def test_benchmark(self):
+        from test import benchmark
+        results = benchmark.run(512, (1, 2), 1)
+        kernels = set(r.kernel.split()[0] for r in results)
+        self.assertEqual(kernels, set(benchmark.PROJECTIONS) | set([
+            "geocentric", "geodesic", "dat2dat", "distance", "destination",
+            "npoints", "matrix", "approximate", "lagrange", "calibration",
+            "geohash", "graticule"
+        ]))
+        for result in results:
+            self.assertTrue(result.ok, result)
+            self.assertGreater(result.ns, 0.)
+
+    def test_stats(self):
+        wgs84 = Gryd.Datum(epsg=4326)
+        # three chunks of parallel grain
+        n = 3 * 4096
+        lon = array.array("d", [random.uniform(-3, 3) for i in range(n)])
+        lat = array.array("d", [random.uniform(-1.5, 1.5) for i in range(n)])
+        x, y, z = wgs84.xyz_arrays(lon, lat)
+        threads = Gryd.get_threads()
+        Gryd.reset_stats()
+        try:
+            Gryd.set_threads(3)
+            wgs84.lla_arrays(x, y, z)
+        finally:
+            Gryd.set_threads(threads)
+        # antipodal pair vincenty does not solve
+        wgs84.ellipsoid.distance(
+            Gryd.Geodesic(0., 0.5, 0.), Gryd.Geodesic(179.7, -0.5, 0.)
+        )
+        stats = Gryd.stats(reset=True)
+        self.assertEqual(set(stats), set(Gryd.STATS_SOLVERS))
+        if not Gryd.STATS_ENABLED:
+            for value in stats.values():
+                self.assertEqual(value["calls"], 0)
+            return
+        geodesic = stats["geodesic"]
+        self.assertEqual(geodesic["calls"], n)
+        self.assertEqual(sum(geodesic["histogram"]), n)
+        self.assertLessEqual(geodesic["p50"], geodesic["p99"])
+        self.assertEqual(geodesic["failures"], 0)
+        self.assertEqual(stats["distance"]["failures"], 1)
+        self.assertEqual(len(stats["distance"]["inputs"]), 1)
+        self.assertAlmostEqual(
+            stats["distance"]["inputs"][0][2], math.radians(179.7)
+        )
+        self.assertEqual(Gryd.stats()["geodesic"]["calls"], 0)
+        # counters of a thread still running are read and reset
+        done, release = threading.Event(), threading.Event()
+
+        def single():
+            wgs84.ellipsoid.distance(
+                Gryd.Geodesic(0., 0.5, 0.), Gryd.Geodesic(179.7, -0.5, 0.)
+            )
+            done.set()
+            release.wait()
+
+        thread = threading.Thread(target=single)
+        thread.start()
+        try:
+            done.wait()
+            self.assertEqual(Gryd.stats()["distance"]["failures"], 1)
+            Gryd.reset_stats()
+            self.assertEqual(Gryd.stats()["distance"]["calls"], 0)
+        finally:
+            release.set()
+            thread.join()
+        self.assertEqual(Gryd.stats()["distance"]["calls"], 0)
+
+    def test_accuracy(self):
+        wgs84 = Gryd.Datum(epsg=4326)
+        self.assertEqual(wgs84.ellipsoid.accuracy, "default")
+        fast = copy.deepcopy(wgs84)
+        fast.ellipsoid.accuracy = "fast"
+        survey = copy.deepcopy(wgs84)
+        survey.ellipsoid.accuracy = "survey"
+        with self.assertRaises(ValueError):
+            survey.ellipsoid.accuracy = "exact"
+        n = 1000
+        lon = array.array("d", [random.uniform(-3, 3) for i in range(n)])
+        lat = array.array("d", [random.uniform(-1.5, 1.5) for i in range(n)])
+        alt = array.array("d", [random.uniform(0, 1e5) for i in range(n)])
+        x, y, z = wgs84.xyz_arrays(lon, lat, alt)
+        errors = {}
+        for datum in [fast, wgs84, survey]:
+            result = datum.lla_arrays(x, y, z)[1]
+            errors[datum.ellipsoid.accuracy] = max(
+                abs(a - b) for a, b in zip(result, lat)
+            )
+        self.assertLess(errors["fast"], 1e-7)
+        self.assertLess(errors["default"], 1e-10)
+        self.assertLess(errors["survey"], 1e-12)
+        self.assertLessEqual(errors["survey"], errors["default"])
+        # profile travels with pickled crs and is set on prepared copies
+        crs = copy.deepcopy(Gryd.Crs(epsg=27700))
+        crs.projection = "ktmerc"
+        crs.datum.ellipsoid.accuracy = "fast"
+        self.assertEqual(
+            copy.deepcopy(crs).datum.ellipsoid.accuracy, "fast"
+        )
+        prep = crs.prepare(accuracy="survey")
+        self.assertEqual(prep.crs.datum.ellipsoid.accuracy, "survey")
+        self.assertEqual(crs.datum.ellipsoid.accuracy, "fast")
+        london = Gryd.Geodesic(-0.127005, 51.518602, 0.)
+        back = prep(prep(london))
+        self.assertAlmostEqual(back.latitude, london.latitude, places=12)
+        tr = crs.transformer(Gryd.Crs(epsg=3785), accuracy="fast")
+        self.assertEqual(tr.dst.crs.datum.ellipsoid.accuracy, "fast")
+
+    def test_distance_matrix(self):
+        wgs84 = Gryd.Ellipsoid("WGS 84")
+        origins = [
+            Gryd.Geodesic(random.uniform(-180, 180), random.uniform(-80, 80))
+            for i in range(7)
+        ]
+        targets = [
+            Gryd.Geodesic(random.uniform(-180, 180), random.uniform(-80, 80))
+            for i in range(900)
+        ] + origins[:1]
+        m = len(targets)
+        for mode in Gryd.GEODESIC_MODES:
+            table = wgs84.distance_matrix(origins, targets, mode=mode)
+            distances = wgs84.distance_matrix(
+                origins, targets, mode=mode, bearings=False
+            )
+            self.assertEqual(len(table), len(origins) * m)
+            self.assertEqual(len(distances), len(origins) * m)
+            for i in range(len(origins)):
+                pairs = wgs84.distance_many(
+                    [origins[i]] * m, targets, mode=mode
+                )
+                for j in range(m):
+                    expected, value = pairs[j], table[i*m + j]
+                    self.assertEqual(value.distance, expected.distance)
+                    self.assertEqual(
+                        value.initial_bearing, expected.initial_bearing
+                    )
+                    self.assertEqual(
+                        value.final_bearing, expected.final_bearing
+                    )
+                    self.assertEqual(distances[i*m + j], expected.distance)
+            self.assertEqual(table[m - 1].distance, 0.)
+        # one to many into a given buffer
+        out = array.array("d", [-1.] * m)
+        row = wgs84.distance_matrix(origins[2], targets, bearings=False,
+                                    out=out)
+        self.assertIs(row, out)
+        self.assertEqual(list(out), [
+            d.distance for d in wgs84.distance_many([origins[2]] * m, targets)
+        ])
+        self.assertEqual(len(wgs84.distance_matrix(origins, [])), 0)
+        with self.assertRaises(ValueError):
+            wgs84.distance_matrix(origins, targets, bearings=False, out=out)
+
+    def test_approximate_distance(self):
+        wgs84 = Gryd.Ellipsoid("WGS 84")
+        origin = Gryd.Geodesic(-6.259437, 53.350765, 0.)
+        targets = []
+        for i in range(500):
+            end = wgs84.destination(
+                origin, random.uniform(0, 360), random.uniform(1, 2e5),
+                mode="karney"
+            )
+            targets.append(Gryd.Geodesic(
+                math.degrees(end.longitude), math.degrees(end.latitude)
+            ))
+        exact = wgs84.distance_matrix(
+            origin, targets, mode="karney", bearings=False
+        )
+        for mode, values in Gryd.APPROXIMATE_MODES.items():
+            index, func, error, (distance, latitude) = values
+            batch = wgs84.distance_matrix(origin, targets, mode=mode)
+            for i, target in enumerate(targets):
+                value = wgs84.distance(origin, target, mode=mode)
+                self.assertEqual(batch[i].distance, value.distance)
+                self.assertTrue(math.isnan(value.initial_bearing))
+                if exact[i] < distance:
+                    self.assertLessEqual(
+                        abs(value.distance - exact[i]), error * exact[i]
+                    )
+            self.assertEqual(
+                wgs84.within(origin, targets, 1e5, mode=mode),
+                [i for i, d in enumerate(exact) if d < 1e5]
+            )
+        with self.assertRaises(ValueError):
+            wgs84.within(origin, targets, 1e5, mode="karney")
+        # beyond flat earth domain, over the pole and next to it
+        origin = Gryd.Geodesic(0, 60)
+        targets = [Gryd.Geodesic(180, 60), Gryd.Geodesic(0, 89.9)]
+        for mode in Gryd.APPROXIMATE_MODES:
+            self.assertEqual(
+                wgs84.within(origin, targets, 7e6, mode=mode), [0, 1]
+            )
+        self.assertEqual(wgs84.within(
+            Gryd.Geodesic(0, 89.99), [Gryd.Geodesic(180, 89.99)], 3e3,
+            mode="flat"
+        ), [0])
+
+    def test_track(self):
+        wgs84 = Gryd.Ellipsoid("WGS 84")
+        points, lla = [], Gryd.Geodesic(-6.259437, 53.350765, 0.)
+        for i in range(3000):
+            points.append(lla)
+            end = wgs84.destination(
+                lla, random.uniform(0, 360), random.uniform(0, 500),
+                mode="karney"
+            )
+            lla = Gryd.Geodesic(
+                math.degrees(end.longitude), math.degrees(end.latitude),
+                random.uniform(0, 100)
+            )
+        total = sum(
+            wgs84.distance(a, b).distance for a, b in zip(points, points[1:])
+        )
+        cumulative = wgs84.track_length(points, cumulative=True)
+        self.assertAlmostEqual(cumulative[-1], total, places=6)
+        # streaming chunk by chunk gives the same lengths
+        track, out = Gryd.Track(wgs84), Gryd.t_zeros(len(points))
+        for i in range(0, len(points), 777):
+            chunk = points[i:i + 777]
+            length = track.feed(chunk, out=memoryview(out)[i:i + 777])
+        self.assertEqual(track.count, len(points))
+        self.assertAlmostEqual(length, total, places=6)
+        for a, b in zip(out, cumulative):
+            self.assertAlmostEqual(a, b, places=6)
+
+        spacing = 250.
+        for mode in ["vincenty", "karney"]:
+            whole = wgs84.resample(points, spacing, mode=mode, end=False)
+            self.assertEqual(len(whole), int(total // spacing) + 1)
+            # small output blocks make vertices to be fed again
+            track = Gryd.Track(wgs84, mode=mode, spacing=spacing)
+            chunks = []
+            for i in range(0, len(points), 500):
+                chunks.extend(track.resample(points[i:i + 500], block=7))
+            self.assertEqual(len(chunks), len(whole))
+            self.assertRaises(ValueError, track.resample, points, block=0)
+            for a, b in zip(whole, chunks):
+                self.assertAlmostEqual(a.longitude, b.longitude, places=12)
+                self.assertAlmostEqual(a.latitude, b.latitude, places=12)
+            steps = wgs84.distance_many(whole[:-1], whole[1:], mode=mode)
+            for step in steps:
+                self.assertLessEqual(step.distance, spacing + 1e-6)
+        last = wgs84.resample(points, spacing)[-1]
+        self.assertEqual(last.longitude, points[-1].longitude)
+
+        # vertices along a geodesic are removed but the shifted one and its
+        # neighbours
+        line = [
+            Gryd.Geodesic(
+                math.degrees(p.longitude), math.degrees(p.latitude)
+            ) for p in wgs84.npoints(points[0], points[-1], 50, mode="karney")
+        ]
+        line[20] = Gryd.Geodesic(
+            math.degrees(line[20].longitude) + 0.01,
+            math.degrees(line[20].latitude)
+        )
+        self.assertEqual(wgs84.simplify(line, 1.), [0, 19, 20, 21, 51])
+        self.assertEqual(wgs84.simplify(points, 1e7), [0, len(points) - 1])
+        kept = wgs84.simplify(points, 10.)
+        self.assertLess(len(kept), len(points))
+        self.assertEqual(wgs84.simplify(points, -1.), list(range(len(points))))
+
+    def test_oblique_mercator(self):
+        # IOGP guidance note 7-2, Timbalai 1948 / RSO Borneo example
+        rso = Gryd.Crs(
+            datum=4298, projection="omerc", lambda0=115., phi0=4., k0=0.99984,
+            azimut=53 + 18/60. + 56.9537/3600.,
+            gamma=53 + 7/60. + 48.3685/3600.,
+            x0=590476.87, y0=442857.65
+        )
+        point = Gryd.Geodesic(
+            115 + 48/60. + 19.8196/3600., 5 + 23/60. + 14.1129/3600.
+        )
+        xya = rso(point)
+        self.assertAlmostEqual(xya.x, 679245.73, places=2)
+        self.assertAlmostEqual(xya.y, 596562.78, places=2)
+        back = rso(xya)
+        self.assertAlmostEqual(back.longitude, point.longitude, places=10)
+        self.assertAlmostEqual(back.latitude, point.latitude, places=10)
+        self.assertEqual(rso.forward_many([point])[0].x, xya.x)
+        # gamma defaults to azimut, an explicit 0 is kept
+        for gamma, same in [(None, True), (0., False)]:
+            other = copy.deepcopy(rso)
+            other.gamma = math.nan if gamma is None else gamma
+            rectified = copy.deepcopy(rso)
+            rectified.gamma = rso.azimut
+            self.assertEqual(
+                other(copy.copy(point)).x == rectified(copy.copy(point)).x,
+                same
+            )
+        self.assertTrue(math.isnan(Gryd.Crs(epsg=3785).gamma))
+
+    def test_conformal_latitude(self):
+        for crs, lat in [
+                (Gryd.Crs(epsg=3395), (-85, 85)),
+                (Gryd.Crs(epsg=2154), (41, 52))
+        ]:
+            points = [
+                Gryd.Geodesic(random.uniform(-5, 9), random.uniform(*lat))
+                for i in range(200)
+            ]
+            back = crs.inverse_many(crs.forward_many(points))
+            for p, q in zip(points, back):
+                self.assertAlmostEqual(p.latitude, q.latitude, places=14)
+                self.assertAlmostEqual(p.longitude, q.longitude, places=14)
+
+    def test_threaded_batch(self):
+        n = 10000
+        points = [
+            Gryd.Geodesic(random.uniform(-8, 2), random.uniform(49, 61), 0.)
+            for i in range(n)
+        ]
+        stops = [
+            Gryd.Geodesic(random.uniform(-8, 2), random.uniform(49, 61), 0.)
+            for i in range(n)
+        ]
+        crs = Gryd.Crs(epsg=27700)
+        wgs84, airy = Gryd.Datum(epsg=4326), Gryd.Datum(epsg=4277)
+        lon = array.array("d", [p.longitude for p in points])
+        lat = array.array("d", [p.latitude for p in points])
+
+        def run():
+            return (
+                [(p.x, p.y) for p in crs.forward_many(points)],
+                list(zip(*crs.forward_arrays(lon, lat)[:2])),
+                [(p.x, p.z) for p in wgs84.xyz_many(points)],
+                [(p.longitude, p.latitude)
+                 for p in wgs84.transform_many(airy, points)],
+                [d.distance for d in wgs84.ellipsoid.distance_many(
+                    points, stops
+                )]
+            )
+
+        Gryd.set_threads(1)
+        single = run()
+        Gryd.set_threads(4)
+        try:
+            self.assertEqual(Gryd.get_threads(), 4)
+            self.assertEqual(single, run())
+        finally:
+            Gryd.set_threads(1)
+        p = wgs84.transform(airy, Gryd.Geodesic(
+            math.degrees(points[0].longitude), math.degrees(points[0].latitude)
+        ))
+        self.assertAlmostEqual(p.longitude, single[3][0][0], places=12)
+        self.assertAlmostEqual(p.latitude, single[3][0][1], places=12)
+
+    def test_handles(self):
+        import Gryd.snapshot
+        n = 5000
+        points = (Gryd.Geodesic * n)(*[
+            Gryd.Geodesic(random.uniform(-6, 1), random.uniform(50, 58), 0.)
+            for i in range(n)
+        ])
+        for lib in [Gryd.geoid, Gryd.proj]:
+            self.assertEqual(lib.gryd_abi_version(), Gryd.GRYD_ABI_VERSION)
+        folder = tempfile.mkdtemp()
+        path = os.path.join(folder, "epsg.sqlite")
+        shutil.copy(Gryd.REGISTRY.path, path)
+        snap = Gryd.gryd_snapshot_open(
+            Gryd.snapshot.write(path).encode("utf-8")
+        )
+        self.assertTrue(snap)
+        src = Gryd.gryd_snapshot_crs(snap, 27700)
+        dst = Gryd.gryd_snapshot_crs(snap, 2154)
+        wgs84 = Gryd.gryd_snapshot_datum(snap, 4326)
+        self.assertIsNone(Gryd.gryd_snapshot_crs(snap, 1))
+        # handles outlive the snapshot
+        Gryd.gryd_snapshot_close(snap)
+        shutil.rmtree(folder)
+        self.assertEqual(Gryd.gryd_crs_epsg(src), 27700)
+        self.assertEqual(Gryd.gryd_crs_projection(src), b"tmerc")
+        osgb36, rgf93 = Gryd.Crs(epsg=27700), Gryd.Crs(epsg=2154)
+
+        # projection, any table of double triples being accepted
+        prep = Gryd.gryd_prepared_new(src, Gryd.GRYD_ACCURACY_KEEP)
+        xya = (Gryd.Geographic * n)()
+        self.assertEqual(
+            Gryd.gryd_prepared_forward(prep, points, xya, n), Gryd.GRYD_OK
+        )
+        expected = osgb36.prepare().forward_many(points)
+        for p, q in zip(xya, expected):
+            self.assertEqual((p.x, p.y), (q.x, q.y))
+        lla = (ctypes.c_double * (3 * n))()
+        Gryd.gryd_prepared_inverse(prep, xya, lla, n)
+        for i in range(0, n, 97):
+            self.assertAlmostEqual(lla[3*i], points[i].longitude, places=10)
+            self.assertAlmostEqual(lla[3*i+1], points[i].latitude, places=10)
+
+        # crs from parameters in feet
+        osgb36.unit = 9002
+        airy = Gryd.gryd_ellipsoid_new(
+            7001, osgb36.datum.ellipsoid.a,
+            1 / osgb36.datum.ellipsoid.f, 0
+        )
+        datum = Gryd.gryd_datum_new(
+            airy, 4277, 0., (ctypes.c_double * 7)(*[
+                getattr(osgb36.datum, k)
+                for k in ["ds", "dx", "dy", "dz", "rx", "ry", "rz"]
+            ])
+        )
+        feet = Gryd.gryd_crs_new(
+            datum, 27700, b"tmerc", osgb36.unit.ratio,
+            (ctypes.c_double * 9)(*[
+                getattr(osgb36, k) for k in Gryd.GRYD_PARAMETERS
+            ])
+        )
+        prep_feet = Gryd.gryd_prepared_new(feet, Gryd.GRYD_ACCURACY_KEEP)
+        Gryd.gryd_prepared_forward(prep_feet, points, xya, n)
+        expected = osgb36.prepare().forward_many(points)
+        for p, q in zip(xya, expected):
+            self.assertAlmostEqual(p.x, q.x, places=6)
+            self.assertAlmostEqual(p.y, q.y, places=6)
+        Gryd.gryd_prepared_inverse(prep_feet, xya, lla, n)
+        self.assertAlmostEqual(lla[0], points[0].longitude, places=10)
+        self.assertAlmostEqual(lla[1], points[0].latitude, places=10)
+
+        # geodesy and datum shift
+        xyz = (Gryd.Geocentric * n)()
+        Gryd.gryd_datum_geocentric(wgs84, points, xyz, n)
+        expected = Gryd.Datum(epsg=4326).xyz_many(points)
+        for p, q in zip(xyz, expected):
+            self.assertEqual((p.x, p.y, p.z), (q.x, q.y, q.z))
+        shifted = (Gryd.Geocentric * n)()
+        Gryd.gryd_datum_shift(wgs84, datum, xyz, shifted, n)
+        back = (Gryd.Geodesic * n)()
+        Gryd.gryd_datum_geodesic(datum, shifted, back, n)
+        expected = Gryd.Datum(epsg=4326).transform_many(
+            Gryd.Datum(epsg=4277), points
+        )
+        for p, q in zip(back, expected):
+            self.assertAlmostEqual(p.longitude, q.longitude, places=10)
+            self.assertAlmostEqual(p.latitude, q.latitude, places=10)
+        wgs84_ellps = Gryd.gryd_ellipsoid_new(7030, 6378137., 298.257223563, 0)
+        dist = (Gryd.Vincenty_dist * (n - 1))()
+        # karney bearings last, destinations go back to the stops
+        for mode, name in [(2, "haversine"), (0, "vincenty"), (1, "karney")]:
+            Gryd.gryd_ellipsoid_distance(
+                wgs84_ellps, points, ctypes.byref(points[1]), dist, n - 1,
+                mode
+            )
+            expected = Gryd.Datum(epsg=4326).ellipsoid.distance_many(
+                points[:-1], points[1:], mode=name
+            )
+            for p, q in zip(dist, expected):
+                self.assertAlmostEqual(p.distance, q.distance, places=6)
+        dest = (Gryd.Vincenty_dest * (n - 1))()
+        Gryd.gryd_ellipsoid_destination(
+            wgs84_ellps, points, dist, dest, n - 1, 1
+        )
+        for i in range(0, n - 1, 97):
+            self.assertAlmostEqual(
+                dest[i].latitude, points[i+1].latitude, places=8
+            )
+
+        # one transformer shared by threads without lock
+        tr = Gryd.gryd_transformer_new(src, dst, Gryd.GRYD_ACCURACY_KEEP)
+        xya = Gryd.Crs(epsg=27700).forward_many(points)
+        expected = Gryd.Crs(epsg=27700).transform_many(rgf93, xya)
+        results = [(Gryd.Geographic * n)() for i in range(4)]
+        threads = [
+            threading.Thread(
+                target=Gryd.gryd_transformer_apply,
+                args=(tr, xya, result, n)
+            ) for result in results
+        ]
+        for thread in threads:
+            thread.start()
+        for thread in threads:
+            thread.join()
+        for result in results:
+            for p, q in zip(result, expected):
+                self.assertAlmostEqual(p.x, q.x, places=6)
+                self.assertAlmostEqual(p.y, q.y, places=6)
+
+        # wrong handles are rejected
+        self.assertEqual(
+            Gryd.gryd_prepared_forward(datum, points, xya, n),
+            Gryd.GRYD_EHANDLE
+        )
+        self.assertEqual(
+            Gryd.gryd_transformer_apply(None, xya, xya, n), Gryd.GRYD_EHANDLE
+        )
+        self.assertEqual(
+            Gryd.gryd_ellipsoid_distance(airy, None, None, None, 1, 0),
+            Gryd.GRYD_EARGUMENT
+        )
+        latlong = Gryd.gryd_crs_new(
+            datum, 4277, None, 1., (ctypes.c_double * 9)()
+        )
+        self.assertIsNone(Gryd.gryd_prepared_new(latlong, 0))
+        self.assertIsNone(Gryd.gryd_ellipsoid_new(0, -1., 0., 0))
+
+        Gryd.gryd_transformer_free(tr)
+        for handle in [prep, prep_feet]:
+            Gryd.gryd_prepared_free(handle)
+        for handle in [src, dst, feet, latlong]:
+            Gryd.gryd_crs_free(handle)
+        for handle in [wgs84, datum]:
+            Gryd.gryd_datum_free(handle)
+        Gryd.gryd_ellipsoid_free(airy)
+        Gryd.gryd_ellipsoid_free(wgs84_ellps)
+
+    @unittest.skipIf(
+        os.name != "posix" or not shutil.which(
+            (sysconfig.get_config_var("CC") or "cc").split()[0]
+        ), "C compiler linking shared objects required"
+    )
+    def test_c_api(self):
+        import Gryd.snapshot
+        root = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+        folder = tempfile.mkdtemp()
+        try:
+            path = os.path.join(folder, "epsg.sqlite")
+            shutil.copy(Gryd.REGISTRY.path, path)
+            snapshot = Gryd.snapshot.write(path)
+            program = os.path.join(folder, "test_gryd")
+            subprocess.check_call(
+                (sysconfig.get_config_var("CC") or "cc").split() + [
+                    "-I", os.path.join(root, "src"),
+                    os.path.join(root, "test", "test_gryd.c"),
+                    Gryd.geoid._name, Gryd.proj._name, "-lm", "-o", program
+                ]
+            )
+            output = subprocess.run(
+                [program, snapshot], stdout=subprocess.PIPE,
+                stderr=subprocess.PIPE, universal_newlines=True
+            )
+        finally:
+            shutil.rmtree(folder)
+        self.assertEqual(output.returncode, 0, output.stderr)
+        london = Gryd.Geodesic(-0.127005, 51.518602, 0.)
+        paris = Gryd.Geodesic(2.351789, 48.856455, 0.)
+        osgb36, pvs = Gryd.Crs(epsg=27700), Gryd.Crs(epsg=3785)
+        xya = osgb36.prepare()(london)
+        result = osgb36.transformer(pvs)(xya)
+        dist = Gryd.Ellipsoid(epsg=7030).distance(london, paris, mode="karney")
+        for value, expected in zip(
+            map(float, output.stdout.split()),
+            [xya.x, xya.y, result.x, result.y, dist.distance]
+        ):
+            self.assertAlmostEqual(value, expected, places=6)
@@ -2,6 +2,7 @@
 
 import Gryd
 
+import math
 import random
 import unittest
 
@@ -16,6 +17,17 @@ class Test(unittest.TestCase):
         lon, lat, (dlon, dlat) = Gryd.geohash.lonlat(dublin)
         self.assertAlmostEqual(longitude, lon)
         self.assertAlmostEqual(latitude, lat)
+        # python bisection beyond C bits gives the same half size
+        for bits in [65, 70, 80]:
+            value = Gryd.geohash.geoh(10., 20., bits)
+            lon, lat, (dlon, dlat) = Gryd.geohash.lonlat(value)
+            self.assertAlmostEqual(dlon, 180. / 2 ** ((bits + 1) // 2), 20)
+            self.assertAlmostEqual(dlat, 90. / 2 ** (bits // 2), 20)
+            self.assertTrue(lon <= 10. < lon + 2 * dlon)
+            self.assertTrue(lat <= 20. < lat + 2 * dlat)
+            center = Gryd.geohash.lonlat(value, centered=True)
+            self.assertAlmostEqual(center[0], lon + dlon, places=12)
+            self.assertAlmostEqual(center[1], lat + dlat, places=12)
 
     def test_as_str(self):
         longitude = -6.272877
@@ -40,3 +52,87 @@ class Test(unittest.TestCase):
             dublin,
             Gryd.geohash.join(*Gryd.geohash.split(dublin))
         )
+
+    def test_c_geohash(self):
+        points = [
+            Gryd.Geodesic(random.uniform(-180, 180), random.uniform(-90, 90))
+            for i in range(500)
+        ]
+        values = Gryd.geohash.geoh_many(points, bits=50)
+        strings = Gryd.geohash.geohash_many(points, digit=10)
+        corners = Gryd.geohash.lonlat_many(values, bits=50)
+        for point, value, string, corner in zip(
+            points, values, strings, corners
+        ):
+            lon, lat = math.degrees(point.longitude), \
+                math.degrees(point.latitude)
+            bits = random.randint(1, 64)
+            # C values are prefixes of python bisection ones
+            long_value = Gryd.geohash.geoh(lon, lat, bits=115)
+            self.assertEqual(
+                Gryd.geohash.geoh(lon, lat, bits=bits),
+                long_value >> (115 - bits)
+            )
+            geoh = Gryd.geohash.geoh(lon, lat, bits=50)
+            self.assertEqual(value, geoh)
+            self.assertEqual(string, Gryd.geohash.geohash(lon, lat))
+            self.assertEqual(Gryd.geohash.as_int(string), value)
+            x, y, (dx, dy) = Gryd.geohash.lonlat(geoh)
+            self.assertAlmostEqual(math.degrees(corner.longitude), x, places=9)
+            self.assertAlmostEqual(math.degrees(corner.latitude), y, places=9)
+            self.assertTrue(x <= lon < x + 2 * dx and y <= lat < y + 2 * dy)
+        # leading zero digit is kept
+        south_west = Gryd.geohash.geohash(-179.9999, -89.9999, 6)
+        self.assertEqual(south_west, "000000")
+        self.assertEqual(
+            Gryd.geohash.geodesic(south_west, centered=False)[:2],
+            (-180., -90.)
+        )
+
+    def test_proximity(self):
+        wgs84 = Gryd.Ellipsoid(epsg=7030)
+        points = [
+            Gryd.Geodesic(random.uniform(-180, 180), random.uniform(-90, 90))
+            for i in range(2000)
+        ]
+        index = Gryd.geohash.Index(points, wgs84)
+        for i in range(10):
+            center = Gryd.Geodesic(
+                random.uniform(-180, 180), random.uniform(-90, 90)
+            )
+            radius = random.choice([2e5, 1e6, 3e6])
+            brute = sorted(
+                [
+                    (j, wgs84.distance(center, p, mode="karney").distance)
+                    for j, p in enumerate(points)
+                ], key=lambda e: e[1]
+            )
+            self.assertEqual(
+                [j for j, d in index.within(center, radius)],
+                [j for j, d in brute if d <= radius]
+            )
+            self.assertEqual(
+                [j for j, d in index.nearest(center, 10)],
+                [j for j, d in brute[:10]]
+            )
+            # every point within radius falls in a cover cell
+            cells = Gryd.geohash.cover(
+                math.degrees(center.longitude), math.degrees(center.latitude),
+                radius
+            )
+            bits = cells[0]._bit_length
+            for j, d in brute:
+                if d > radius:
+                    break
+                p = points[j]
+                self.assertIn(
+                    Gryd.geohash.geoh(
+                        math.degrees(p.longitude), math.degrees(p.latitude),
+                        bits
+                    ), cells
+                )
+        dublin = Gryd.geohash.geoh(-6.272877, 53.344606, bits=31)
+        east = Gryd.geohash.neighbours(dublin)[2]
+        self.assertEqual(Gryd.geohash.neighbours(east)[6], dublin)
+        north_pole = Gryd.geohash.geoh(0., 90., bits=20)
+        self.assertIsNone(Gryd.geohash.neighbours(north_pole)[0])
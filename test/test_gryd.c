@@ -0,0 +1,70 @@
+// Copyright (c) 2015-2021, THOORENS Bruno
+// All rights reserved.
+//
+// gryd.h client built and run by test_Gryd.py (test_c_api) : it links both
+// libraries, checks return codes and prints results compared with Gryd ones.
+//
+// usage : test_gryd <epsg.bin path>
+// output : x y of London in EPSG:27700, x y of the same point in EPSG:3785
+// transformed from EPSG:27700 and Karney distance from London to Paris
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include "gryd.h"
+
+#define DEG (3.14159265358979323846/180.)
+#define CHECK(test) if (!(test)){ \
+	fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #test); \
+	return 1; \
+}
+
+int main(int argc, char *argv[]){
+	GrydSnapshot *snap;
+	GrydEllipsoid *wgs84;
+	GrydCrs *osgb36, *pvs;
+	GrydPrepared *prep;
+	GrydTransformer *tr;
+	double lla[6] = {-0.127005*DEG, 51.518602*DEG, 0., 2.351789*DEG, 48.856455*DEG, 0.};
+	double xya[3], back[3], result[3], dist[3], parameters[GRYD_PARAMETERS] = {0};
+
+	CHECK(argc == 2);
+	CHECK(gryd_abi_version() == GRYD_ABI_VERSION);
+	CHECK((snap = gryd_snapshot_open(argv[1])) != NULL);
+	wgs84 = gryd_snapshot_ellipsoid(snap, 7030);
+	osgb36 = gryd_snapshot_crs(snap, 27700);
+	pvs = gryd_snapshot_crs(snap, 3785);
+	CHECK(gryd_snapshot_crs(snap, 1) == NULL);
+	// handles outlive the snapshot
+	gryd_snapshot_close(snap);
+	CHECK(wgs84 != NULL && osgb36 != NULL && pvs != NULL);
+	CHECK(gryd_ellipsoid_epsg(wgs84) == 7030);
+	CHECK(gryd_crs_epsg(osgb36) == 27700);
+	CHECK(strcmp(gryd_crs_projection(osgb36), "tmerc") == 0);
+
+	CHECK((prep = gryd_prepared_new(osgb36, GRYD_ACCURACY_KEEP)) != NULL);
+	CHECK(gryd_prepared_forward(prep, lla, xya, 1) == GRYD_OK);
+	CHECK(gryd_prepared_inverse(prep, xya, back, 1) == GRYD_OK);
+	CHECK(fabs(back[0] - lla[0]) < 1e-10 && fabs(back[1] - lla[1]) < 1e-10);
+
+	CHECK((tr = gryd_transformer_new(osgb36, pvs, GRYD_ACCURACY_KEEP)) != NULL);
+	CHECK(gryd_transformer_apply(tr, xya, result, 1) == GRYD_OK);
+	CHECK(gryd_ellipsoid_distance(wgs84, lla, lla + 3, dist, 1, GRYD_DISTANCE_KARNEY) == GRYD_OK);
+
+	// handles of another type, NULL tables and unknown modes
+	CHECK(gryd_prepared_forward(NULL, lla, xya, 1) == GRYD_EHANDLE);
+	CHECK(gryd_transformer_apply((const GrydTransformer *)prep, xya, result, 1) == GRYD_EHANDLE);
+	CHECK(gryd_prepared_forward(prep, NULL, xya, 1) == GRYD_EARGUMENT);
+	CHECK(gryd_prepared_forward(prep, NULL, NULL, 0) == GRYD_OK);
+	CHECK(gryd_ellipsoid_distance(wgs84, lla, lla + 3, dist, 1, -1) == GRYD_EARGUMENT);
+	CHECK(gryd_prepared_new(gryd_crs_new(NULL, 0, "tmerc", 1., parameters), GRYD_ACCURACY_KEEP) == NULL);
+
+	printf("%.9f %.9f %.9f %.9f %.9f\n", xya[0], xya[1], result[0], result[1], dist[0]);
+	gryd_transformer_free(tr);
+	gryd_prepared_free(prep);
+	gryd_crs_free(pvs);
+	gryd_crs_free(osgb36);
+	gryd_ellipsoid_free(wgs84);
+	gryd_prepared_free(NULL);
+	return 0;
+}